@@ -0,0 +1,673 @@
+/*
+** exasync.c
+** ---------
+**
+** Description
+** -----------
+**	Asynchronous variants of ex_execute_cmd() and ex_fetch_data().
+**
+**	On a connection whose CS_NETIO is CS_ASYNC_IO (or CS_DEFER_IO),
+**	ct_send(), ct_results(), ct_fetch() and ct_cancel() return
+**	CS_PENDING right away and Client-Library reports their completion
+**	through the CS_COMPLETION_CB callback that ex_init() installs. The
+**	results loop of a request is therefore written as a state machine:
+**	ex_async_step() issues the next call for the one that completed
+**	and returns as soon as a call is pending, and the completion
+**	callback finds the request again through the CS_USERDATA property
+**	of its command. A single thread can keep requests in flight on any
+**	number of connections this way.
+**
+**	The same state machine runs unchanged on a CS_SYNC_IO connection,
+**	where every call completes before it returns.
+**
+** Routines Used
+** -------------
+**	ct_send, ct_results, ct_fetch, ct_cancel, ct_poll, ct_cmd_props
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exasync.h"
+#include "exwriter.h"
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_async_start(
+	EX_ASYNC *async,
+	CS_CONNECTION *connection,
+	CS_CHAR *cmdbuf
+	);
+CS_STATIC CS_VOID ex_async_step(
+	EX_ASYNC *async,
+	CS_INT function,
+	CS_RETCODE status
+	);
+CS_STATIC CS_RETCODE ex_async_restype(
+	EX_ASYNC *async,
+	CS_INT *function
+	);
+CS_STATIC CS_RETCODE ex_async_bind(
+	EX_ASYNC *async
+	);
+CS_STATIC CS_VOID ex_async_unbind(
+	EX_ASYNC *async
+	);
+CS_STATIC CS_VOID ex_async_finish(
+	EX_ASYNC *async,
+	CS_RETCODE status
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC ex_async_display_row(
+	EX_ASYNC *async,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt,
+	EX_COLUMN_DATA *coldata
+	);
+
+/*
+** ex_async_netio()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets the I/O mode of one connection. The context stays in
+**	CS_SYNC_IO, so the synchronous helpers keep working on every other
+**	connection.
+**
+** Parameters:
+** 	connection	- The connection; it must have no pending call.
+** 	netio		- CS_SYNC_IO, CS_ASYNC_IO or CS_DEFER_IO.
+**
+** Returns:
+** 	Result of ct_con_props().
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_async_netio(CS_CONNECTION *connection, CS_INT netio)
+{
+	CS_RETCODE	retcode;
+
+	retcode = ct_con_props(connection, CS_SET, CS_NETIO, &netio,
+			CS_UNUSED, NULL);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_async_netio: ct_con_props(CS_NETIO) failed");
+	}
+	return retcode;
+}
+
+/*
+** ex_async_execute_cmd()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Non-blocking ex_execute_cmd(): sends a language command that is
+**	not expected to return rows, and returns without waiting for the
+**	results. donefunc is called once the command has completed, from
+**	whichever thread reports the last completion.
+**
+** Parameters:
+** 	async		- The request, owned by the caller.
+** 	connection	- The connection to send the command on.
+** 	cmdbuf		- The command; it must stay valid until the request
+**			  is done.
+** 	donefunc	- Completion routine, may be NULL.
+** 	userdata	- Stored in async->userdata.
+**
+** Returns:
+** 	CS_PENDING while the request is in flight, otherwise its final
+**	status (donefunc has been called by then).
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_async_execute_cmd(EX_ASYNC *async, CS_CONNECTION *connection,
+		     CS_CHAR *cmdbuf, EX_ASYNC_DONE_FUNC donefunc,
+		     CS_VOID *userdata)
+{
+	memset(async, 0, sizeof (EX_ASYNC));
+	async->donefunc = donefunc;
+	async->userdata = userdata;
+
+	return ex_async_start(async, connection, cmdbuf);
+}
+
+/*
+** ex_async_fetch_data()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Non-blocking query: sends a language command and fetches its row
+**	results, calling rowfunc for every row. Without a rowfunc the
+**	rows are displayed like ex_fetch_data() does.
+**
+** Parameters:
+** 	async		- The request, owned by the caller.
+** 	connection	- The connection to send the command on.
+** 	cmdbuf		- The command; it must stay valid until the request
+**			  is done.
+** 	rowfunc		- Row routine, may be NULL.
+** 	donefunc	- Completion routine, may be NULL.
+** 	userdata	- Stored in async->userdata.
+**
+** Returns:
+** 	CS_PENDING while the request is in flight, otherwise its final
+**	status (donefunc has been called by then).
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_async_fetch_data(EX_ASYNC *async, CS_CONNECTION *connection,
+		    CS_CHAR *cmdbuf, EX_ASYNC_ROW_FUNC rowfunc,
+		    EX_ASYNC_DONE_FUNC donefunc, CS_VOID *userdata)
+{
+	memset(async, 0, sizeof (EX_ASYNC));
+	async->flags = EX_ASYNC_F_FETCH;
+	async->rowfunc = (rowfunc != NULL) ? rowfunc : ex_async_display_row;
+	async->donefunc = donefunc;
+	async->userdata = userdata;
+
+	return ex_async_start(async, connection, cmdbuf);
+}
+
+/*
+** ex_async_done()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Tells whether a request has completed. Safe to call from any
+**	thread.
+*/
+
+CS_BOOL CS_PUBLIC
+ex_async_done(EX_ASYNC *async)
+{
+	return (__sync_fetch_and_add(&async->done, 0) != 0) ? CS_TRUE : CS_FALSE;
+}
+
+/*
+** ex_async_wait()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Blocks until a request has completed. ct_poll() drives the
+**	completions of a CS_DEFER_IO connection from this thread; on a
+**	CS_ASYNC_IO connection they are reported by Client-Library itself
+**	and ct_poll() only paces the loop.
+**
+** Returns:
+** 	The final status of the request.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_async_wait(EX_ASYNC *async)
+{
+	CS_CONNECTION	*compconn;
+	CS_COMMAND	*compcmd;
+	CS_INT		compid;
+	CS_RETCODE	compstatus;
+	CS_RETCODE	retcode;
+
+	while (!ex_async_done(async))
+	{
+		retcode = ct_poll(NULL, async->connection, EX_ASYNC_POLL_MS,
+				&compconn, &compcmd, &compid, &compstatus);
+		if (retcode != CS_SUCCEED && retcode != CS_TIMED_OUT
+			&& retcode != CS_QUIET)
+		{
+			ex_error("ex_async_wait: ct_poll() failed");
+			return CS_FAIL;
+		}
+	}
+
+	return async->status;
+}
+
+/*
+** ex_async_completion_cb()
+**
+** Type of function:
+** 	example program client-library callback
+**
+** Purpose:
+** 	The CS_COMPLETION_CB callback installed by ex_init(). Hands the
+**	completed call to the state machine of its request. Completions
+**	of calls that aren't part of a request (ct_connect() and the
+**	like) are ignored.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_async_completion_cb(CS_CONNECTION *connection, CS_COMMAND *cmd,
+		       CS_INT function, CS_RETCODE status)
+{
+	EX_ASYNC	*async = NULL;
+
+	if (cmd == NULL)
+	{
+		return CS_SUCCEED;
+	}
+
+	if (ct_cmd_props(cmd, CS_GET, CS_USERDATA, &async, CS_SIZEOF(async),
+			NULL) != CS_SUCCEED || async == NULL)
+	{
+		return CS_SUCCEED;
+	}
+
+	ex_async_step(async, function, status);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_async_start()
+**
+** Purpose:
+** 	Allocates the command of a request and sends it.
+*/
+
+CS_STATIC CS_RETCODE
+ex_async_start(EX_ASYNC *async, CS_CONNECTION *connection, CS_CHAR *cmdbuf)
+{
+	CS_RETCODE	retcode;
+
+	async->connection = connection;
+	async->status = CS_SUCCEED;
+
+	if ((retcode = ct_cmd_alloc(connection, &async->cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_async_start: ct_cmd_alloc() failed");
+		async->cmd = NULL;
+		ex_async_finish(async, retcode);
+		return retcode;
+	}
+
+	if ((retcode = ct_cmd_props(async->cmd, CS_SET, CS_USERDATA, &async,
+			CS_SIZEOF(async), NULL)) != CS_SUCCEED)
+	{
+		ex_error("ex_async_start: ct_cmd_props(CS_USERDATA) failed");
+		ex_async_finish(async, retcode);
+		return retcode;
+	}
+
+	if ((retcode = ct_command(async->cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM,
+			CS_UNUSED)) != CS_SUCCEED)
+	{
+		ex_error("ex_async_start: ct_command() failed");
+		ex_async_finish(async, retcode);
+		return retcode;
+	}
+
+	retcode = ct_send(async->cmd);
+	if (retcode == CS_PENDING)
+	{
+		return CS_PENDING;
+	}
+
+	/*
+	** The connection isn't asynchronous (or the send completed right
+	** away): run the results loop from here.
+	*/
+	ex_async_step(async, CT_SEND, retcode);
+
+	return ex_async_done(async) ? async->status : CS_PENDING;
+}
+
+/*
+** ex_async_step()
+**
+** Purpose:
+** 	Advances the results loop of a request after the call function
+**	completed with status. Calls that complete right away are
+**	followed up in place; the routine returns as soon as a call is
+**	pending, or the request is done.
+*/
+
+CS_STATIC CS_VOID
+ex_async_step(EX_ASYNC *async, CS_INT function, CS_RETCODE status)
+{
+	CS_COMMAND	*cmd = async->cmd;
+	CS_RETCODE	retcode;
+
+	for (;;)
+	{
+		switch ((int)function)
+		{
+		    case CT_SEND:
+			if (status != CS_SUCCEED)
+			{
+				ex_error("ex_async_step: ct_send() failed");
+				ex_async_finish(async, status);
+				return;
+			}
+			function = CT_RESULTS;
+			retcode = ct_results(cmd, &async->restype);
+			break;
+
+		    case CT_RESULTS:
+			if (status == CS_END_RESULTS)
+			{
+				ex_async_finish(async, async->status);
+				return;
+			}
+			if (status != CS_SUCCEED)
+			{
+				ex_error("ex_async_step: ct_results() failed");
+				async->status = CS_FAIL;
+				async->cancel = CS_CANCEL_ALL;
+				function = CT_CANCEL;
+				retcode = ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+				break;
+			}
+			retcode = ex_async_restype(async, &function);
+			break;
+
+		    case CT_FETCH:
+			if (status == CS_SUCCEED || status == CS_ROW_FAIL)
+			{
+				async->rowcount += async->count;
+				if (status == CS_ROW_FAIL)
+				{
+					ex_writer_printf(ex_writer_stdout(),
+						"Error on row %d.\n", async->rowcount);
+				}
+				else if ((*async->rowfunc)(async, async->numcols,
+						async->datafmt, async->coldata)
+						!= CS_SUCCEED)
+				{
+					async->status = CS_FAIL;
+					async->cancel = CS_CANCEL_ALL;
+					function = CT_CANCEL;
+					retcode = ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+					break;
+				}
+				retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED,
+						CS_UNUSED, &async->count);
+				break;
+			}
+
+			ex_async_unbind(async);
+			if (async->rowfunc == ex_async_display_row)
+			{
+				ex_writer_flush(ex_writer_stdout());
+			}
+			if (status != CS_END_DATA)
+			{
+				ex_error("ex_async_step: ct_fetch() failed");
+				async->status = CS_FAIL;
+				async->cancel = CS_CANCEL_ALL;
+				function = CT_CANCEL;
+				retcode = ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+				break;
+			}
+			function = CT_RESULTS;
+			retcode = ct_results(cmd, &async->restype);
+			break;
+
+		    case CT_CANCEL:
+			if (status != CS_SUCCEED)
+			{
+				ex_error("ex_async_step: ct_cancel() failed");
+				async->status = CS_FAIL;
+			}
+			if (status != CS_SUCCEED || async->cancel == CS_CANCEL_ALL)
+			{
+				ex_async_finish(async, async->status);
+				return;
+			}
+			function = CT_RESULTS;
+			retcode = ct_results(cmd, &async->restype);
+			break;
+
+		    default:
+			ex_error("ex_async_step: unexpected completion");
+			ex_async_finish(async, CS_FAIL);
+			return;
+		}
+
+		if (retcode == CS_PENDING)
+		{
+			return;
+		}
+		status = retcode;
+	}
+}
+
+/*
+** ex_async_restype()
+**
+** Purpose:
+** 	Handles the result type returned by ct_results() the way
+**	ex_execute_cmd() and ex_fetch_data() do, and issues the call that
+**	follows it.
+**
+** Returns:
+** 	The return code of the call issued; *function is set to it.
+*/
+
+CS_STATIC CS_RETCODE
+ex_async_restype(EX_ASYNC *async, CS_INT *function)
+{
+	CS_COMMAND	*cmd = async->cmd;
+
+	switch ((int)async->restype)
+	{
+	    case CS_CMD_SUCCEED:
+	    case CS_CMD_DONE:
+		*function = CT_RESULTS;
+		return ct_results(cmd, &async->restype);
+
+	    case CS_ROW_RESULT:
+	    case CS_CURSOR_RESULT:
+	    case CS_PARAM_RESULT:
+	    case CS_COMPUTE_RESULT:
+		if ((async->flags & EX_ASYNC_F_FETCH) != 0
+			&& ex_async_bind(async) == CS_SUCCEED)
+		{
+			*function = CT_FETCH;
+			return ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					&async->count);
+		}
+		break;
+
+	    case CS_STATUS_RESULT:
+		async->cancel = CS_CANCEL_CURRENT;
+		*function = CT_CANCEL;
+		return ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+
+	    default:
+		break;
+	}
+
+	/*
+	** The command failed, or returned results we don't expect:
+	** throw the rest of them away.
+	*/
+	async->status = CS_FAIL;
+	async->cancel = CS_CANCEL_ALL;
+	*function = CT_CANCEL;
+	return ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+}
+
+/*
+** ex_async_bind()
+**
+** Purpose:
+** 	Describes the columns of the current result set and binds them
+**	to null terminated strings, as ex_fetch_data() does.
+*/
+
+CS_STATIC CS_RETCODE
+ex_async_bind(EX_ASYNC *async)
+{
+	CS_COMMAND	*cmd = async->cmd;
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	retcode = ct_res_info(cmd, CS_NUMDATA, &async->numcols, CS_UNUSED, NULL);
+	if (retcode != CS_SUCCEED || async->numcols <= 0)
+	{
+		ex_error("ex_async_bind: ct_res_info() failed");
+		return CS_FAIL;
+	}
+
+	async->coldata = (EX_COLUMN_DATA *)calloc(async->numcols,
+				sizeof (EX_COLUMN_DATA));
+	async->datafmt = (CS_DATAFMT *)calloc(async->numcols,
+				sizeof (CS_DATAFMT));
+	if (async->coldata == NULL || async->datafmt == NULL)
+	{
+		ex_error("ex_async_bind: calloc() failed");
+		ex_async_unbind(async);
+		return CS_MEM_ERROR;
+	}
+
+	for (i = 0; i < async->numcols; i++)
+	{
+		retcode = ct_describe(cmd, (i + 1), &async->datafmt[i]);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_async_bind: ct_describe() failed");
+			break;
+		}
+
+		async->datafmt[i].maxlength = ex_display_dlen(&async->datafmt[i]) + 1;
+		async->datafmt[i].datatype = CS_CHAR_TYPE;
+		async->datafmt[i].format = CS_FMT_NULLTERM;
+
+		async->coldata[i].value = (CS_CHAR *)malloc(async->datafmt[i].maxlength);
+		if (async->coldata[i].value == NULL)
+		{
+			ex_error("ex_async_bind: malloc() failed");
+			retcode = CS_MEM_ERROR;
+			break;
+		}
+
+		retcode = ct_bind(cmd, (i + 1), &async->datafmt[i],
+				async->coldata[i].value, &async->coldata[i].valuelen,
+				(CS_SMALLINT *)&async->coldata[i].indicator);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_async_bind: ct_bind() failed");
+			break;
+		}
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		ex_async_unbind(async);
+		return retcode;
+	}
+
+	if (async->rowfunc == ex_async_display_row)
+	{
+		ex_display_header(async->numcols, async->datafmt);
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_async_unbind()
+**
+** Purpose:
+** 	Frees the column buffers of the current result set.
+*/
+
+CS_STATIC CS_VOID
+ex_async_unbind(EX_ASYNC *async)
+{
+	CS_INT		i;
+
+	if (async->coldata != NULL)
+	{
+		for (i = 0; i < async->numcols; i++)
+		{
+			free(async->coldata[i].value);
+		}
+	}
+	free(async->coldata);
+	free(async->datafmt);
+	async->coldata = NULL;
+	async->datafmt = NULL;
+	async->numcols = 0;
+}
+
+/*
+** ex_async_finish()
+**
+** Purpose:
+** 	Ends a request: drops its command, records its status and calls
+**	its completion routine.
+*/
+
+CS_STATIC CS_VOID
+ex_async_finish(EX_ASYNC *async, CS_RETCODE status)
+{
+	ex_async_unbind(async);
+
+	if (async->cmd != NULL)
+	{
+		if (ct_cmd_drop(async->cmd) != CS_SUCCEED)
+		{
+			ex_error("ex_async_finish: ct_cmd_drop() failed");
+			status = CS_FAIL;
+		}
+		async->cmd = NULL;
+	}
+	async->status = (status == CS_END_RESULTS) ? CS_SUCCEED : status;
+
+	if (async->donefunc != NULL)
+	{
+		(*async->donefunc)(async);
+	}
+
+	/*
+	** Once done is set the caller may reuse the structure, so it has
+	** to be the last thing touched.
+	*/
+	(CS_VOID)__sync_lock_test_and_set(&async->done, 1);
+}
+
+/*
+** ex_async_display_row()
+**
+** Purpose:
+** 	Default row routine: displays a row like ex_fetch_data() does.
+*/
+
+CS_STATIC CS_RETCODE CS_PUBLIC
+ex_async_display_row(EX_ASYNC *async, CS_INT numcols, CS_DATAFMT *datafmt,
+		     EX_COLUMN_DATA *coldata)
+{
+	EX_WRITER	*out = ex_writer_stdout();
+	CS_INT		disp_len;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		ex_writer_puts(out, coldata[i].value);
+		if (i != numcols - 1)
+		{
+			disp_len = ex_display_dlen(&datafmt[i]);
+			disp_len -= coldata[i].valuelen - 1;
+			ex_writer_pad(out, ' ', disp_len);
+		}
+	}
+	ex_writer_putc(out, '\n');
+
+	return CS_SUCCEED;
+}
@@ -0,0 +1,107 @@
+/*
+** exasync.h
+** ---------
+**
+** Description
+** -----------
+**	Defines and prototypes for the asynchronous Client-Library helpers
+**	in exasync.c.
+*/
+
+#ifndef EXASYNC_H
+#define EXASYNC_H
+
+/*
+** How long (in milliseconds) ex_async_wait() lets ct_poll() block
+** before it checks the request again.
+*/
+#define EX_ASYNC_POLL_MS	100
+
+/*
+** Request flags.
+*/
+#define EX_ASYNC_F_FETCH	0x1	/* fetch row results */
+
+typedef struct _ex_async EX_ASYNC;
+
+/*
+** Called for every row of a fetch request, with the columns bound as
+** null terminated strings as in ex_fetch_data(). Anything but
+** CS_SUCCEED cancels the request.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_ASYNC_ROW_FUNC)(
+	EX_ASYNC *async,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt,
+	EX_COLUMN_DATA *coldata
+	);
+
+/*
+** Called once a request has completed; async->status holds its result.
+*/
+typedef CS_VOID (CS_PUBLIC *EX_ASYNC_DONE_FUNC)(
+	EX_ASYNC *async
+	);
+
+/*
+** An asynchronous request. The caller owns the structure, which must
+** stay in place until the request is done. Only userdata may be
+** touched by the caller while the request is in flight.
+*/
+struct _ex_async
+{
+	CS_CONNECTION	*connection;
+	CS_COMMAND	*cmd;		/* NULL once the request is done */
+	CS_INT		flags;
+	CS_RETCODE	status;		/* result of the request */
+	CS_INT		rowcount;	/* rows fetched so far */
+	EX_ASYNC_ROW_FUNC rowfunc;
+	EX_ASYNC_DONE_FUNC donefunc;
+	CS_VOID		*userdata;
+
+	/*
+	** State of the results loop.
+	*/
+	CS_INT		restype;
+	CS_INT		count;
+	CS_INT		cancel;		/* type of the pending ct_cancel() */
+	CS_INT		numcols;
+	CS_DATAFMT	*datafmt;
+	EX_COLUMN_DATA	*coldata;
+	volatile CS_INT	done;
+};
+
+/* exasync.c */
+extern CS_RETCODE CS_PUBLIC ex_async_netio(
+	CS_CONNECTION *connection,
+	CS_INT netio
+	);
+extern CS_RETCODE CS_PUBLIC ex_async_execute_cmd(
+	EX_ASYNC *async,
+	CS_CONNECTION *connection,
+	CS_CHAR *cmdbuf,
+	EX_ASYNC_DONE_FUNC donefunc,
+	CS_VOID *userdata
+	);
+extern CS_RETCODE CS_PUBLIC ex_async_fetch_data(
+	EX_ASYNC *async,
+	CS_CONNECTION *connection,
+	CS_CHAR *cmdbuf,
+	EX_ASYNC_ROW_FUNC rowfunc,
+	EX_ASYNC_DONE_FUNC donefunc,
+	CS_VOID *userdata
+	);
+extern CS_BOOL CS_PUBLIC ex_async_done(
+	EX_ASYNC *async
+	);
+extern CS_RETCODE CS_PUBLIC ex_async_wait(
+	EX_ASYNC *async
+	);
+extern CS_RETCODE CS_PUBLIC ex_async_completion_cb(
+	CS_CONNECTION *connection,
+	CS_COMMAND *cmd,
+	CS_INT function,
+	CS_RETCODE status
+	);
+
+#endif /* EXASYNC_H */
@@ -0,0 +1,1028 @@
+/*
+** exblk.c
+** -------
+**
+** Description
+** -----------
+**	Bulk copy into and out of tables with Bulk-Library.
+**
+**	Loading rows one insert language command at a time costs a round
+**	trip, a parse and a logged row per row. A bulk copy sends rows in
+**	the bulk protocol, many at a time, and the server commits them in
+**	batches.
+**
+**	ex_blkin_begin() starts a bulk copy into a table over a connection
+**	logged in for bulk copy (ex_connect() logs every connection in that
+**	way). It binds one array of batchrows strings per column with
+**	blk_bind(), and rows are staged into those arrays from a columnar
+**	batch (ex_blkin_batch()), from CSV (ex_blkin_csv()), or a row at a
+**	time (ex_blkin_row()). Whenever the arrays are full they are sent
+**	with blk_rowxfer_mult(), and every commitrows rows the server is
+**	told to commit with blk_done(CS_BLK_BATCH). ex_blkin_end() sends
+**	the rest and ends the copy.
+**
+**	Staging every value as a string lets CSV and result rows share
+**	one layout; Bulk-Library converts the strings to the column types.
+**	Text and image values are bound like the others, so they are
+**	limited to EX_BLK_TEXTLEN bytes.
+**
+**	ex_blkout_begin() starts a bulk copy out of a table and binds its
+**	columns to the arrays of a columnar batch (see excolbatch.c), so
+**	ex_blkout_fetch() transfers rows straight into contiguous column
+**	buffers, without a language command, a plan or a result set on the
+**	server. ex_blk_unload() writes a whole table this way through a sink
+**	(see exsink.c), to a file or standard output.
+**
+** Routines Used
+** -------------
+**	blk_alloc, blk_init, blk_props, blk_describe, blk_bind,
+**	blk_rowxfer_mult, blk_done, blk_drop, ct_con_props
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctpublic.h>
+#include <bkpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
+#include "exblk.h"
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_blkin_send(
+	EX_BLKIN *blk
+	);
+CS_STATIC CS_RETCODE ex_blkin_next(
+	EX_BLKIN *blk
+	);
+CS_STATIC CS_RETCODE ex_blkin_value(
+	EX_BLKIN *blk,
+	CS_INT col,
+	CS_CHAR *value,
+	CS_INT len
+	);
+
+/*
+** ex_blkin_begin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts a bulk copy into a table and binds its staging arrays.
+**	The copy must be ended with ex_blkin_end(), even if this fails.
+**
+** Parameters:
+** 	blk		- Bulk copy to start.
+** 	connection	- Connection logged in for bulk copy, used for
+**			  nothing else until the copy ends.
+** 	table		- Table to load.
+** 	numcols		- Number of columns of the table.
+** 	batchrows	- Rows sent at a time, 0 for EX_BLK_ROWS.
+** 	commitrows	- Rows per committed batch, 0 for EX_BLK_COMMIT.
+**
+** Returns:
+** 	CS_SUCCEED, or the result of the failing Bulk-Library call.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkin_begin(EX_BLKIN *blk, CS_CONNECTION *connection, CS_CHAR *table,
+	       CS_INT numcols, CS_INT batchrows, CS_INT commitrows)
+{
+	CS_RETCODE	retcode;
+	CS_DATAFMT	datafmt;
+	CS_BOOL		array = CS_TRUE;
+	CS_INT		*widths;
+	CS_CHAR		*mem;
+	size_t		size;
+	CS_INT		i;
+
+	memset(blk, 0, sizeof (EX_BLKIN));
+	blk->numcols = numcols;
+	blk->batchrows = (batchrows > 0) ? batchrows : EX_BLK_ROWS;
+	blk->commitrows = (commitrows > 0) ? commitrows : EX_BLK_COMMIT;
+	blk->status = CS_FAIL;
+
+	if (numcols < 1)
+	{
+		ex_error("ex_blkin_begin: no columns");
+		return CS_FAIL;
+	}
+
+	if ((retcode = blk_alloc(connection, EX_BLK_VERSION, &blk->blkdesc))
+			!= CS_SUCCEED)
+	{
+		ex_error("ex_blkin_begin: blk_alloc() failed");
+		blk->blkdesc = NULL;
+		return retcode;
+	}
+	if ((retcode = blk_init(blk->blkdesc, CS_BLK_IN, table, CS_NULLTERM))
+			!= CS_SUCCEED)
+	{
+		ex_error("ex_blkin_begin: blk_init() failed");
+		return retcode;
+	}
+
+	/*
+	** Array binding sends batchrows rows per blk_rowxfer_mult().
+	*/
+	if ((retcode = blk_props(blk->blkdesc, CS_SET, BLK_ARRAY_INSERT, &array,
+			CS_UNUSED, NULL)) != CS_SUCCEED)
+	{
+		ex_error("ex_blkin_begin: blk_props(BLK_ARRAY_INSERT) failed");
+		return retcode;
+	}
+
+	/*
+	** Size each column's strings from its description, then carve the
+	** column descriptors and the value, length and indicator arrays of
+	** every column out of one allocation.
+	*/
+	widths = (CS_INT *)calloc(numcols, sizeof (CS_INT));
+	if (widths == NULL)
+	{
+		ex_error("ex_blkin_begin: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+	size = numcols * sizeof (EX_COLUMN_ARRAY);
+	for (i = 0; i < numcols; i++)
+	{
+		if ((retcode = blk_describe(blk->blkdesc, i + 1, &datafmt))
+				!= CS_SUCCEED)
+		{
+			ex_error("ex_blkin_begin: blk_describe() failed");
+			free(widths);
+			return retcode;
+		}
+		switch ((int)datafmt.datatype)
+		{
+		    case CS_TEXT_TYPE:
+		    case CS_IMAGE_TYPE:
+		    case CS_UNITEXT_TYPE:
+			widths[i] = EX_BLK_TEXTLEN + 1;
+			break;
+
+		    default:
+			widths[i] = MAX(ex_display_dlen(&datafmt), datafmt.maxlength) + 1;
+			break;
+		}
+		size += (size_t)blk->batchrows * (widths[i] + sizeof (CS_INT)
+				+ sizeof (CS_SMALLINT));
+	}
+
+	mem = (CS_CHAR *)malloc(size);
+	if (mem == NULL)
+	{
+		ex_error("ex_blkin_begin: malloc() failed");
+		free(widths);
+		return CS_MEM_ERROR;
+	}
+	blk->mem = mem;
+	blk->columns = (EX_COLUMN_ARRAY *)mem;
+	mem += numcols * sizeof (EX_COLUMN_ARRAY);
+	for (i = 0; i < numcols; i++)
+	{
+		blk->columns[i].valuelen = (CS_INT *)mem;
+		mem += blk->batchrows * sizeof (CS_INT);
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		blk->columns[i].indicator = (CS_SMALLINT *)mem;
+		mem += blk->batchrows * sizeof (CS_SMALLINT);
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		blk->columns[i].maxlength = widths[i];
+		blk->columns[i].value = mem;
+		mem += (size_t)blk->batchrows * widths[i];
+	}
+	free(widths);
+
+	for (i = 0; i < numcols; i++)
+	{
+		memset(&datafmt, 0, sizeof (datafmt));
+		datafmt.datatype = CS_CHAR_TYPE;
+		datafmt.format = CS_FMT_UNUSED;
+		datafmt.maxlength = blk->columns[i].maxlength;
+		datafmt.count = blk->batchrows;
+		if ((retcode = blk_bind(blk->blkdesc, i + 1, &datafmt,
+				blk->columns[i].value, blk->columns[i].valuelen,
+				blk->columns[i].indicator)) != CS_SUCCEED)
+		{
+			ex_error("ex_blkin_begin: blk_bind() failed");
+			return retcode;
+		}
+	}
+
+	blk->status = CS_SUCCEED;
+	return CS_SUCCEED;
+}
+
+/*
+** ex_blkin_row()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Stages one row, given as a string per column.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+** 	values		- numcols strings; a NULL pointer is a NULL value.
+** 	lengths		- numcols lengths, or NULL when the values are
+**			  null terminated.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a value is too long or sending failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkin_row(EX_BLKIN *blk, CS_CHAR **values, CS_INT *lengths)
+{
+	CS_INT		i;
+
+	for (i = 0; i < blk->numcols && blk->status == CS_SUCCEED; i++)
+	{
+		if (values[i] == NULL)
+		{
+			blk->status = ex_blkin_value(blk, i, NULL, 0);
+		}
+		else
+		{
+			blk->status = ex_blkin_value(blk, i, values[i],
+				(lengths == NULL) ? (CS_INT)strlen(values[i])
+						  : lengths[i]);
+		}
+	}
+	if (blk->status == CS_SUCCEED)
+	{
+		blk->status = ex_blkin_next(blk);
+	}
+	return blk->status;
+}
+
+/*
+** ex_blkin_batch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Stages the rows of the last fetch of a columnar batch, bound with
+**	text (see ex_colbatch_text()), whose columns are those of the
+**	table in order.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+** 	batch		- Fetched batch.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the batch doesn't match the table, a
+**	value is too long or sending failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkin_batch(EX_BLKIN *blk, EX_COLBATCH *batch)
+{
+	EX_COLUMN_ARRAY	*col;
+	CS_CHAR		*value;
+	CS_INT		row;
+	CS_INT		i;
+
+	if (batch->numcols != blk->numcols || !batch->withtext)
+	{
+		ex_error("ex_blkin_batch: batch doesn't match the table");
+		blk->status = CS_FAIL;
+		return CS_FAIL;
+	}
+
+	for (row = 0; row < batch->numrows && blk->status == CS_SUCCEED; row++)
+	{
+		for (i = 0; i < blk->numcols && blk->status == CS_SUCCEED; i++)
+		{
+			col = EX_COLBATCH_TEXT(batch, i);
+			if (col->indicator[row] == CS_NULLDATA)
+			{
+				blk->status = ex_blkin_value(blk, i, NULL, 0);
+			}
+			else
+			{
+				value = EX_ARRAY_VALUE(col, row);
+				blk->status = ex_blkin_value(blk, i, value,
+						(CS_INT)strlen(value));
+			}
+		}
+		if (blk->status == CS_SUCCEED)
+		{
+			blk->status = ex_blkin_next(blk);
+		}
+	}
+	return blk->status;
+}
+
+/*
+** ex_blkin_csv()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Stages every row of a CSV stream, as written by the csv sink
+**	(see exsink.c): RFC 4180 quoting, an empty field is NULL and ""
+**	is the empty string. Each record must have numcols fields.
+**	Values are parsed straight into the staging arrays.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+** 	fp		- CSV input, read to its end.
+** 	header		- CS_TRUE to skip the first record.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL on a malformed record, a value that is
+**	too long, a read error or a failure to send.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkin_csv(EX_BLKIN *blk, FILE *fp, CS_BOOL header)
+{
+	EX_COLUMN_ARRAY	*col = NULL;
+	CS_CHAR		*value = NULL;
+	CS_CHAR		msg[EX_BUFSIZE];
+	CS_BIGINT	line = 1;
+	CS_BOOL		quoted = CS_FALSE;	/* field started with a quote */
+	CS_BOOL		inquote = CS_FALSE;	/* inside the quotes */
+	CS_BOOL		skip = header;
+	CS_BOOL		empty = CS_TRUE;	/* nothing read of the record */
+	CS_INT		field = 0;
+	CS_INT		len = 0;
+	int		c;
+
+	while (blk->status == CS_SUCCEED)
+	{
+		c = getc(fp);
+
+		if (inquote)
+		{
+			if (c == EOF)
+			{
+				sprintf(msg, "ex_blkin_csv: line %lld: unterminated quote",
+					(long long)line);
+				ex_error(msg);
+				blk->status = CS_FAIL;
+				break;
+			}
+			if (c == '"')
+			{
+				c = getc(fp);
+				if (c != '"')
+				{
+					inquote = CS_FALSE;
+					(CS_VOID)ungetc(c, fp);
+					continue;
+				}
+			}
+			else if (c == '\n')
+			{
+				line++;
+			}
+		}
+		else if (c == ',' || c == '\n' || c == EOF)
+		{
+			if (c == EOF && empty)
+			{
+				break;
+			}
+			if (c == '\n')
+			{
+				line++;
+			}
+			if (c == '\n' && empty)
+			{
+				continue;
+			}
+
+			/*
+			** End of a field; at the end of a record, a full row.
+			*/
+			if (!skip)
+			{
+				if (field >= blk->numcols)
+				{
+					sprintf(msg, "ex_blkin_csv: line %lld: more than %d fields",
+						(long long)line - (c == '\n'), blk->numcols);
+					ex_error(msg);
+					blk->status = CS_FAIL;
+					break;
+				}
+				col = &blk->columns[field];
+				if (len == 0 && !quoted)
+				{
+					col->indicator[blk->staged] = CS_NULLDATA;
+					col->valuelen[blk->staged] = 0;
+				}
+				else
+				{
+					col->indicator[blk->staged] = CS_GOODDATA;
+					col->valuelen[blk->staged] = len;
+				}
+			}
+			field++;
+			len = 0;
+			quoted = CS_FALSE;
+			value = NULL;
+
+			if (c == ',')
+			{
+				empty = CS_FALSE;
+				continue;
+			}
+			if (!skip)
+			{
+				if (field != blk->numcols)
+				{
+					sprintf(msg, "ex_blkin_csv: line %lld: %d fields, not %d",
+						(long long)line - (c == '\n'), field,
+						blk->numcols);
+					ex_error(msg);
+					blk->status = CS_FAIL;
+					break;
+				}
+				blk->status = ex_blkin_next(blk);
+			}
+			skip = CS_FALSE;
+			field = 0;
+			empty = CS_TRUE;
+			if (c == EOF)
+			{
+				break;
+			}
+			continue;
+		}
+		else if (c == '"' && len == 0 && !quoted)
+		{
+			quoted = CS_TRUE;
+			inquote = CS_TRUE;
+			empty = CS_FALSE;
+			continue;
+		}
+		else if (c == '\r')
+		{
+			continue;
+		}
+
+		/*
+		** A character of the field's value.
+		*/
+		empty = CS_FALSE;
+		if (skip)
+		{
+			continue;
+		}
+		if (value == NULL)
+		{
+			if (field >= blk->numcols)
+			{
+				sprintf(msg, "ex_blkin_csv: line %lld: more than %d fields",
+					(long long)line, blk->numcols);
+				ex_error(msg);
+				blk->status = CS_FAIL;
+				break;
+			}
+			value = EX_ARRAY_VALUE(&blk->columns[field], blk->staged);
+		}
+		if (len >= blk->columns[field].maxlength - 1)
+		{
+			sprintf(msg, "ex_blkin_csv: line %lld: field %d is too long",
+				(long long)line, field + 1);
+			ex_error(msg);
+			blk->status = CS_FAIL;
+			break;
+		}
+		value[len++] = (CS_CHAR)c;
+	}
+
+	if (blk->status == CS_SUCCEED && ferror(fp))
+	{
+		ex_error("ex_blkin_csv: read error");
+		blk->status = CS_FAIL;
+	}
+	return blk->status;
+}
+
+/*
+** ex_blkin_end()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sends the staged rows and ends the bulk copy, committing what was
+**	sent since the last batch, or, if the copy failed, rolling it
+**	back. Frees what ex_blkin_begin() allocated.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+** 	status		- CS_SUCCEED to commit, anything else to cancel.
+** 	rows		- Rows committed by the copy, may be NULL.
+**
+** Returns:
+** 	CS_SUCCEED if every row was committed.
+**	Otherwise CS_FAIL, or the failing Bulk-Library result.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkin_end(EX_BLKIN *blk, CS_RETCODE status, CS_BIGINT *rows)
+{
+	CS_RETCODE	retcode = blk->status;
+	CS_INT		outrows = 0;
+
+	if (retcode == CS_SUCCEED && status != CS_SUCCEED)
+	{
+		retcode = status;
+	}
+	if (retcode == CS_SUCCEED && blk->staged > 0)
+	{
+		retcode = ex_blkin_send(blk);
+	}
+
+	if (blk->blkdesc != NULL)
+	{
+		if (blk_done(blk->blkdesc,
+				(retcode == CS_SUCCEED) ? CS_BLK_ALL : CS_BLK_CANCEL,
+				&outrows) != CS_SUCCEED)
+		{
+			ex_error("ex_blkin_end: blk_done() failed");
+			if (retcode == CS_SUCCEED)
+			{
+				retcode = CS_FAIL;
+			}
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			blk->rows += outrows;
+		}
+		if (blk_drop(blk->blkdesc) != CS_SUCCEED)
+		{
+			ex_error("ex_blkin_end: blk_drop() failed");
+		}
+		blk->blkdesc = NULL;
+	}
+
+	free(blk->mem);
+	blk->mem = NULL;
+	blk->columns = NULL;
+	blk->status = CS_FAIL;
+
+	if (rows != NULL)
+	{
+		*rows = blk->rows;
+	}
+	return retcode;
+}
+
+/*
+** ex_blk_load_csv()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Bulk copies a CSV file, with a header line, into a table with the
+**	default batch sizes.
+**
+** Parameters:
+** 	connection	- Connection logged in for bulk copy.
+** 	table		- Table to load.
+** 	numcols		- Number of columns of the table.
+** 	path		- CSV file.
+** 	rows		- Rows loaded.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file can't be read or the copy
+**	failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blk_load_csv(CS_CONNECTION *connection, CS_CHAR *table, CS_INT numcols,
+		CS_CHAR *path, CS_BIGINT *rows)
+{
+	EX_BLKIN	blk;
+	CS_RETCODE	retcode;
+	FILE		*fp;
+
+	*rows = 0;
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		ex_error("ex_blk_load_csv: can't open the file");
+		return CS_FAIL;
+	}
+
+	retcode = ex_blkin_begin(&blk, connection, table, numcols, 0, 0);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_blkin_csv(&blk, fp, CS_TRUE);
+	}
+	retcode = ex_blkin_end(&blk, retcode, rows);
+
+	(CS_VOID)fclose(fp);
+	return retcode;
+}
+
+/*
+** ex_blkout_begin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts a bulk copy out of a table, laying the batch out for its
+**	columns and binding them to its arrays. The copy must be ended
+**	with ex_blkout_end(), even if this fails.
+**
+** Parameters:
+** 	blk		- Bulk copy to start.
+** 	connection	- Connection logged in for bulk copy, used for
+**			  nothing else until the copy ends.
+** 	table		- Table to copy out.
+** 	numcols		- Number of columns of the table.
+** 	mode		- EX_BIND_CHAR or EX_BIND_NATIVE.
+** 	count		- Rows per transfer, as in ex_colbatch_bind().
+** 	batch		- Batch the rows are transferred into; it is bound
+**			  with text.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR, or the result of the failing call.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkout_begin(EX_BLKOUT *blk, CS_CONNECTION *connection, CS_CHAR *table,
+		CS_INT numcols, CS_INT mode, CS_INT count, EX_COLBATCH *batch)
+{
+	CS_RETCODE	retcode;
+	CS_DATAFMT	*fmts;
+	CS_INT		i;
+
+	memset(blk, 0, sizeof (EX_BLKOUT));
+	blk->batch = batch;
+
+	if (numcols < 1)
+	{
+		ex_error("ex_blkout_begin: no columns");
+		return CS_FAIL;
+	}
+
+	if ((retcode = blk_alloc(connection, EX_BLK_VERSION, &blk->blkdesc))
+			!= CS_SUCCEED)
+	{
+		ex_error("ex_blkout_begin: blk_alloc() failed");
+		blk->blkdesc = NULL;
+		return retcode;
+	}
+	if ((retcode = blk_init(blk->blkdesc, CS_BLK_OUT, table, CS_NULLTERM))
+			!= CS_SUCCEED)
+	{
+		ex_error("ex_blkout_begin: blk_init() failed");
+		return retcode;
+	}
+
+	fmts = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+	if (fmts == NULL)
+	{
+		ex_error("ex_blkout_begin: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		if ((retcode = blk_describe(blk->blkdesc, i + 1, &fmts[i]))
+				!= CS_SUCCEED)
+		{
+			ex_error("ex_blkout_begin: blk_describe() failed");
+			free(fmts);
+			return retcode;
+		}
+	}
+	retcode = ex_colbatch_shape(batch, numcols, fmts, mode, count, CS_TRUE);
+	free(fmts);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** ex_colbatch_text() has no command to find the context from.
+	*/
+	if (batch->context == NULL
+		&& ct_con_props(connection, CS_GET, CS_PARENT_HANDLE,
+			&batch->context, CS_UNUSED, NULL) != CS_SUCCEED)
+	{
+		ex_error("ex_blkout_begin: can't get the context");
+		batch->context = NULL;
+		return CS_FAIL;
+	}
+
+	for (i = 0; i < numcols; i++)
+	{
+		if ((retcode = blk_bind(blk->blkdesc, i + 1, &batch->datafmt[i],
+				batch->columns[i].value, batch->columns[i].valuelen,
+				batch->columns[i].indicator)) != CS_SUCCEED)
+		{
+			ex_error("ex_blkout_begin: blk_bind() failed");
+			return retcode;
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_blkout_fetch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Transfers the next rows of the table into the batch and converts
+**	the natively bound ones to text.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+**
+** Returns:
+** 	CS_SUCCEED with batch->numrows rows, CS_END_DATA once every row
+**	was transferred, or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkout_fetch(EX_BLKOUT *blk)
+{
+	EX_COLBATCH	*batch = blk->batch;
+	CS_RETCODE	retcode;
+	CS_INT		count;
+
+	batch->numrows = 0;
+	if (blk->done)
+	{
+		return CS_END_DATA;
+	}
+
+	count = batch->capacity;
+	retcode = blk_rowxfer_mult(blk->blkdesc, &count);
+	switch ((int)retcode)
+	{
+	    case CS_END_DATA:
+		/*
+		** The last call may still have transferred rows.
+		*/
+		blk->done = CS_TRUE;
+		if (count <= 0)
+		{
+			return CS_END_DATA;
+		}
+		break;
+
+	    case CS_SUCCEED:
+		break;
+
+	    default:
+		ex_error("ex_blkout_fetch: blk_rowxfer_mult() failed");
+		return CS_FAIL;
+	}
+
+	batch->numrows = count;
+	blk->rows += count;
+	return ex_colbatch_text(batch, NULL);
+}
+
+/*
+** ex_blkout_end()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Ends a bulk copy out. The batch is left to the caller.
+**
+** Parameters:
+** 	blk		- Bulk copy.
+** 	status		- CS_SUCCEED if every row was transferred,
+**			  anything else to cancel the copy.
+** 	rows		- Rows transferred, may be NULL.
+**
+** Returns:
+** 	status, or CS_FAIL if ending the copy failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blkout_end(EX_BLKOUT *blk, CS_RETCODE status, CS_BIGINT *rows)
+{
+	CS_RETCODE	retcode = status;
+	CS_INT		outrows = 0;
+
+	if (blk->blkdesc != NULL)
+	{
+		if (blk_done(blk->blkdesc,
+				(status == CS_SUCCEED) ? CS_BLK_ALL : CS_BLK_CANCEL,
+				&outrows) != CS_SUCCEED)
+		{
+			ex_error("ex_blkout_end: blk_done() failed");
+			retcode = CS_FAIL;
+		}
+		if (blk_drop(blk->blkdesc) != CS_SUCCEED)
+		{
+			ex_error("ex_blkout_end: blk_drop() failed");
+		}
+		blk->blkdesc = NULL;
+	}
+
+	if (rows != NULL)
+	{
+		*rows = blk->rows;
+	}
+	return retcode;
+}
+
+/*
+** ex_blk_unload()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Bulk copies a whole table out and writes it in a sink format.
+**
+** Parameters:
+** 	connection	- Connection logged in for bulk copy.
+** 	table		- Table to copy out.
+** 	numcols		- Number of columns of the table.
+** 	format		- EX_SINK_* format.
+** 	path		- File to write, created or truncated, or NULL for
+**			  standard output.
+** 	rows		- Rows written.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file can't be written or the copy
+**	failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_blk_unload(CS_CONNECTION *connection, CS_CHAR *table, CS_INT numcols,
+	      CS_INT format, CS_CHAR *path, CS_BIGINT *rows)
+{
+	EX_BLKOUT	blk;
+	EX_COLBATCH	batch;
+	EX_SINK		sink;
+	EX_WRITER	file;
+	EX_WRITER	*writer;
+	CS_RETCODE	retcode;
+	int		fd = -1;
+
+	*rows = 0;
+	if (path == NULL)
+	{
+		writer = ex_writer_stdout();
+	}
+	else
+	{
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || ex_writer_open(&file, fd, EX_WRITER_BUFSIZE)
+				!= CS_SUCCEED)
+		{
+			ex_error("ex_blk_unload: can't open the file");
+			if (fd >= 0)
+			{
+				(CS_VOID)close(fd);
+			}
+			return CS_FAIL;
+		}
+		writer = &file;
+	}
+
+	ex_colbatch_init(&batch);
+	retcode = ex_blkout_begin(&blk, connection, table, numcols,
+			EX_BIND_NATIVE, EX_FETCH_ROWS, &batch);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_sink_begin(&sink, format, writer, &batch);
+		while (retcode == CS_SUCCEED
+			&& (retcode = ex_blkout_fetch(&blk)) == CS_SUCCEED)
+		{
+			retcode = ex_sink_rows(&sink, &batch);
+		}
+		if (retcode == CS_END_DATA)
+		{
+			retcode = CS_SUCCEED;
+		}
+		if (ex_sink_end(&sink) != CS_SUCCEED && retcode == CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+	retcode = ex_blkout_end(&blk, retcode, rows);
+	ex_colbatch_free(&batch);
+
+	if (path != NULL)
+	{
+		if (ex_writer_close(&file) != CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+		(CS_VOID)close(fd);
+	}
+	return retcode;
+}
+
+/*
+** ex_blkin_next()
+**
+** Purpose:
+** 	Counts the row just staged, sending the arrays when they are full.
+*/
+
+CS_STATIC CS_RETCODE
+ex_blkin_next(EX_BLKIN *blk)
+{
+	blk->staged++;
+	if (blk->staged < blk->batchrows)
+	{
+		return CS_SUCCEED;
+	}
+	return ex_blkin_send(blk);
+}
+
+/*
+** ex_blkin_send()
+**
+** Purpose:
+** 	Sends the staged rows, and commits a batch once commitrows rows
+**	were sent since the last one.
+*/
+
+CS_STATIC CS_RETCODE
+ex_blkin_send(EX_BLKIN *blk)
+{
+	CS_INT		count = blk->staged;
+	CS_INT		outrows = 0;
+
+	if (blk_rowxfer_mult(blk->blkdesc, &count) != CS_SUCCEED)
+	{
+		ex_error("ex_blkin_send: blk_rowxfer_mult() failed");
+		return CS_FAIL;
+	}
+	blk->sent += blk->staged;
+	blk->staged = 0;
+
+	if (blk->sent >= blk->commitrows)
+	{
+		if (blk_done(blk->blkdesc, CS_BLK_BATCH, &outrows) != CS_SUCCEED)
+		{
+			ex_error("ex_blkin_send: blk_done(CS_BLK_BATCH) failed");
+			return CS_FAIL;
+		}
+		blk->rows += outrows;
+		blk->sent = 0;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ex_blkin_value()
+**
+** Purpose:
+** 	Copies a value into the staging arrays, at the row being staged.
+**	A NULL value is a NULL.
+*/
+
+CS_STATIC CS_RETCODE
+ex_blkin_value(EX_BLKIN *blk, CS_INT col, CS_CHAR *value, CS_INT len)
+{
+	EX_COLUMN_ARRAY	*column = &blk->columns[col];
+	CS_CHAR		msg[EX_BUFSIZE];
+
+	if (value == NULL)
+	{
+		column->indicator[blk->staged] = CS_NULLDATA;
+		column->valuelen[blk->staged] = 0;
+		return CS_SUCCEED;
+	}
+	if (len >= column->maxlength)
+	{
+		sprintf(msg, "ex_blkin_value: value of column %d is too long",
+			col + 1);
+		ex_error(msg);
+		return CS_FAIL;
+	}
+	memcpy(EX_ARRAY_VALUE(column, blk->staged), value, len);
+	column->indicator[blk->staged] = CS_GOODDATA;
+	column->valuelen[blk->staged] = len;
+	return CS_SUCCEED;
+}
@@ -0,0 +1,117 @@
+/*
+** exblk.h
+** -------
+**
+** Description
+** -----------
+**	Defines and prototypes for the bulk copy routines in exblk.c.
+*/
+
+#ifndef EXBLK_H
+#define EXBLK_H
+
+/*
+** Defaults of a bulk load: rows sent per blk_rowxfer_mult() and rows
+** per committed batch (blk_done(CS_BLK_BATCH)).
+*/
+#define EX_BLK_ROWS		1000
+#define EX_BLK_COMMIT		10000
+
+/*
+** Longest value a text or image column can be loaded with.
+*/
+#define EX_BLK_TEXTLEN		4096
+
+/*
+** A bulk copy into a table. Rows are staged column by column in
+** arrays of batchrows strings, all in one allocation, bound once with
+** blk_bind(); Bulk-Library converts them to the column types as they
+** are sent.
+*/
+typedef struct _ex_blkin
+{
+	CS_BLKDESC	*blkdesc;
+	CS_INT		numcols;
+	CS_INT		batchrows;	/* rows per blk_rowxfer_mult() */
+	CS_INT		commitrows;	/* rows per blk_done(CS_BLK_BATCH) */
+	CS_INT		staged;		/* rows in the arrays */
+	CS_INT		sent;		/* rows sent, not yet committed */
+	CS_BIGINT	rows;		/* rows committed */
+	EX_COLUMN_ARRAY	*columns;
+	CS_VOID		*mem;
+	CS_RETCODE	status;
+} EX_BLKIN;
+
+/*
+** A bulk copy out of a table, into the arrays of a columnar batch.
+*/
+typedef struct _ex_blkout
+{
+	CS_BLKDESC	*blkdesc;
+	EX_COLBATCH	*batch;
+	CS_BOOL		done;		/* the last rows were transferred */
+	CS_BIGINT	rows;		/* rows transferred */
+} EX_BLKOUT;
+
+/* exblk.c */
+extern CS_RETCODE CS_PUBLIC ex_blkin_begin(
+	EX_BLKIN *blk,
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_INT numcols,
+	CS_INT batchrows,
+	CS_INT commitrows
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkin_row(
+	EX_BLKIN *blk,
+	CS_CHAR **values,
+	CS_INT *lengths
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkin_batch(
+	EX_BLKIN *blk,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkin_csv(
+	EX_BLKIN *blk,
+	FILE *fp,
+	CS_BOOL header
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkin_end(
+	EX_BLKIN *blk,
+	CS_RETCODE status,
+	CS_BIGINT *rows
+	);
+extern CS_RETCODE CS_PUBLIC ex_blk_load_csv(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_INT numcols,
+	CS_CHAR *path,
+	CS_BIGINT *rows
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkout_begin(
+	EX_BLKOUT *blk,
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_INT numcols,
+	CS_INT mode,
+	CS_INT count,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkout_fetch(
+	EX_BLKOUT *blk
+	);
+extern CS_RETCODE CS_PUBLIC ex_blkout_end(
+	EX_BLKOUT *blk,
+	CS_RETCODE status,
+	CS_BIGINT *rows
+	);
+extern CS_RETCODE CS_PUBLIC ex_blk_unload(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_INT numcols,
+	CS_INT format,
+	CS_CHAR *path,
+	CS_BIGINT *rows
+	);
+
+#endif /* EXBLK_H */
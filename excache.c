@@ -0,0 +1,760 @@
+/*
+** excache.c
+** ---------
+**
+** Description
+** -----------
+**	Server-side result cache for language batches.
+**
+**	Results are stored as encoded row streams (EX_ROWBUF) keyed by the
+**	fingerprint key of the batch, that is the normalized text plus the
+**	literals that were stripped from it (see exfprint.c). The cache is
+**	an LRU bounded by the total bytes of its entries, every entry
+**	expires after a fixed time to live, and entries can be dropped
+**	explicitly through the cache_invalidate registered procedure.
+**
+**	The cache lock is a plain pthread mutex. It is never held across
+**	an Open Server call, since a client thread that blocks in network
+**	I/O while holding it would stall every other thread; entries are
+**	reference counted instead so they can be sent without the lock.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excache.h"
+#include "exqstats.h"
+
+/*****************************************************************************
+**
+** defines and globals used.
+**
+*****************************************************************************/
+
+#define EX_ALIGN8(_n)		(((_n) + 7) & ~7)
+
+/*
+** Row stream header, followed by the column formats.
+*/
+typedef struct _ex_rowhdr
+{
+	CS_INT		numcols;
+	CS_INT		numrows;
+} EX_ROWHDR;
+
+/*
+** Per value prefix in a row stream, followed by the value bytes.
+*/
+typedef struct _ex_rowcell
+{
+	CS_INT		valuelen;
+	CS_SMALLINT	indicator;
+	CS_SMALLINT	pad;
+} EX_ROWCELL;
+
+#define EX_ROWBUF_DATA(_numcols) \
+	(sizeof (EX_ROWHDR) + (_numcols) * sizeof (CS_DATAFMT))
+
+CS_STATIC pthread_mutex_t	Ex_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+CS_STATIC EX_CACHE_ENTRY	*Ex_cache_buckets[EX_CACHE_BUCKETS];
+CS_STATIC EX_CACHE_ENTRY	*Ex_cache_lru_head;	/* most recently used */
+CS_STATIC EX_CACHE_ENTRY	*Ex_cache_lru_tail;
+CS_STATIC CS_INT		Ex_cache_bytes;
+CS_STATIC CS_INT		Ex_cache_maxbytes = EX_CACHE_MAX_BYTES;
+CS_STATIC CS_INT		Ex_cache_ttl = EX_CACHE_TTL_SECS;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_rowbuf_grow(
+	EX_ROWBUF *rows,
+	CS_INT need
+	);
+CS_STATIC CS_VOID ex_cache_unlink(
+	EX_CACHE_ENTRY *entry
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC ex_cache_invalidate_rp(
+	SRV_PROC *sp
+	);
+
+/*****************************************************************************
+**
+** row stream functions
+**
+*****************************************************************************/
+
+/*
+** ex_rowbuf_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts an empty row stream for numcols columns. Every column must
+**	be described with ex_rowbuf_describe() before values are added.
+**
+** Parameters:
+** 	rows		- The row stream.
+** 	numcols		- Number of columns in each row.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_rowbuf_init(EX_ROWBUF *rows, CS_INT numcols)
+{
+	EX_ROWHDR	*hdr;
+
+	memset(rows, 0, sizeof (EX_ROWBUF));
+	if (ex_rowbuf_grow(rows, EX_ROWBUF_DATA(numcols) + EX_BUFSIZE) != CS_SUCCEED)
+	{
+		return CS_MEM_ERROR;
+	}
+	memset(rows->data, 0, EX_ROWBUF_DATA(numcols));
+
+	hdr = (EX_ROWHDR *)rows->data;
+	hdr->numcols = numcols;
+	rows->numcols = numcols;
+	rows->len = EX_ROWBUF_DATA(numcols);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_rowbuf_describe()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets the format of column item (1 based), as it will be passed to
+**	srv_describe().
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if item is out of range.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_rowbuf_describe(EX_ROWBUF *rows, CS_INT item, CS_DATAFMT *fmt)
+{
+	CS_DATAFMT	*fmts;
+
+	if (item < 1 || item > rows->numcols)
+	{
+		ex_error("ex_rowbuf_describe: column out of range");
+		return CS_FAIL;
+	}
+
+	fmts = (CS_DATAFMT *)(rows->data + sizeof (EX_ROWHDR));
+	fmts[item - 1] = *fmt;
+	fmts[item - 1].locale = NULL;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_rowbuf_add()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends the value of the next column of the current row. Adding
+**	the last column of a row completes the row.
+**
+** Parameters:
+** 	rows		- The row stream.
+** 	value		- The value, in the datatype of the column.
+** 	valuelen	- Length of the value in bytes.
+** 	indicator	- CS_NULLDATA for a NULL value.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_rowbuf_add(EX_ROWBUF *rows, CS_VOID *value, CS_INT valuelen,
+	      CS_SMALLINT indicator)
+{
+	EX_ROWCELL	*cell;
+
+	if (indicator == CS_NULLDATA || valuelen < 0)
+	{
+		valuelen = 0;
+	}
+
+	if (ex_rowbuf_grow(rows, sizeof (EX_ROWCELL) + EX_ALIGN8(valuelen))
+		!= CS_SUCCEED)
+	{
+		return CS_MEM_ERROR;
+	}
+
+	cell = (EX_ROWCELL *)(rows->data + rows->len);
+	cell->valuelen = valuelen;
+	cell->indicator = indicator;
+	cell->pad = 0;
+	if (valuelen > 0)
+	{
+		memcpy(cell + 1, value, valuelen);
+	}
+	rows->len += sizeof (EX_ROWCELL) + EX_ALIGN8(valuelen);
+
+	if (++rows->curcol == rows->numcols)
+	{
+		rows->curcol = 0;
+		rows->numrows++;
+		((EX_ROWHDR *)rows->data)->numrows = rows->numrows;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_rowbuf_free()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Releases the memory of a row stream.
+*/
+
+CS_VOID CS_PUBLIC
+ex_rowbuf_free(EX_ROWBUF *rows)
+{
+	free(rows->data);
+	memset(rows, 0, sizeof (EX_ROWBUF));
+}
+
+/*
+** ex_rowbuf_send()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sends an encoded row stream to a client, followed by the final
+**	done with the row count. The values are bound in place, so the
+**	stream must stay untouched until this returns. The rows are
+**	charged to the batch the client thread is running, if any.
+**
+** Parameters:
+** 	sp		- The client thread.
+** 	data		- The encoded row stream.
+** 	len		- Length of the stream in bytes.
+**
+** Returns:
+** 	CS_SUCCEED or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_rowbuf_send(SRV_PROC *sp, CS_BYTE *data, CS_INT len)
+{
+	EX_ROWHDR	*hdr;
+	EX_ROWCELL	*cell;
+	CS_DATAFMT	*fmts;
+	CS_BYTE		*p;
+	CS_INT		row;
+	CS_INT		col;
+
+	hdr = (EX_ROWHDR *)data;
+	fmts = (CS_DATAFMT *)(data + sizeof (EX_ROWHDR));
+
+	for (col = 0; col < hdr->numcols; col++)
+	{
+		if (srv_describe(sp, col + 1, &fmts[col]) != CS_SUCCEED)
+		{
+			ex_error("ex_rowbuf_send: srv_describe() failed");
+			return CS_FAIL;
+		}
+	}
+
+	p = data + EX_ROWBUF_DATA(hdr->numcols);
+	for (row = 0; row < hdr->numrows; row++)
+	{
+		for (col = 0; col < hdr->numcols; col++)
+		{
+			cell = (EX_ROWCELL *)p;
+			if (srv_bind(sp, CS_SET, SRV_ROWDATA, col + 1, &fmts[col],
+					(CS_BYTE *)(cell + 1), &cell->valuelen,
+					&cell->indicator) != CS_SUCCEED)
+			{
+				ex_error("ex_rowbuf_send: srv_bind() failed");
+				return CS_FAIL;
+			}
+			p += sizeof (EX_ROWCELL) + EX_ALIGN8(cell->valuelen);
+		}
+
+		if (srv_xferdata(sp, CS_SET, SRV_ROWDATA) != CS_SUCCEED)
+		{
+			ex_error("ex_rowbuf_send: srv_xferdata() failed");
+			return CS_FAIL;
+		}
+	}
+
+	if (p != data + len)
+	{
+		ex_error("ex_rowbuf_send: row stream is corrupt");
+		return CS_FAIL;
+	}
+	ex_qstats_rows(sp, hdr->numrows);
+
+	return srv_senddone(sp, SRV_DONE_COUNT | SRV_DONE_FINAL,
+			CS_TRAN_COMPLETED, hdr->numrows);
+}
+
+/*
+** ex_rowbuf_grow()
+**
+** Purpose:
+** 	Makes room for need more bytes in a row stream.
+*/
+
+CS_STATIC CS_RETCODE
+ex_rowbuf_grow(EX_ROWBUF *rows, CS_INT need)
+{
+	CS_BYTE		*data;
+	CS_INT		size;
+
+	if (rows->len + need <= rows->size)
+	{
+		return CS_SUCCEED;
+	}
+
+	size = (rows->size > 0) ? rows->size : EX_BUFSIZE;
+	while (size < rows->len + need)
+	{
+		size *= 2;
+	}
+
+	data = (CS_BYTE *)realloc(rows->data, size);
+	if (data == NULL)
+	{
+		ex_error("ex_rowbuf_grow: realloc() failed");
+		return CS_MEM_ERROR;
+	}
+	rows->data = data;
+	rows->size = size;
+
+	return CS_SUCCEED;
+}
+
+/*****************************************************************************
+**
+** cache functions
+**
+*****************************************************************************/
+
+/*
+** ex_cache_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Empties the cache and sets its limits.
+**
+** Parameters:
+** 	maxbytes	- Upper bound on the bytes held by all entries.
+** 	ttl		- Time to live of an entry in seconds.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cache_init(CS_INT maxbytes, CS_INT ttl)
+{
+	(CS_VOID)ex_cache_invalidate(NULL);
+
+	pthread_mutex_lock(&Ex_cache_lock);
+	Ex_cache_maxbytes = maxbytes;
+	Ex_cache_ttl = ttl;
+	pthread_mutex_unlock(&Ex_cache_lock);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_cache_get()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Looks up the cached results of a batch. A hit must be given back
+**	with ex_cache_release() once its value has been sent.
+**
+** Parameters:
+** 	fp		- Fingerprint of the batch.
+**
+** Returns:
+** 	The entry, or NULL on a miss.
+*/
+
+EX_CACHE_ENTRY * CS_PUBLIC
+ex_cache_get(EX_FPRINT *fp)
+{
+	EX_CACHE_ENTRY	*entry;
+
+	pthread_mutex_lock(&Ex_cache_lock);
+
+	for (entry = Ex_cache_buckets[fp->keyhash % EX_CACHE_BUCKETS];
+		entry != NULL; entry = entry->hash_next)
+	{
+		if (entry->keyhash == fp->keyhash && entry->keylen == fp->keylen
+			&& memcmp(entry->key, fp->key, fp->keylen) == 0)
+		{
+			break;
+		}
+	}
+
+	if (entry != NULL && entry->expires <= time(NULL))
+	{
+		ex_cache_unlink(entry);
+		entry = NULL;
+	}
+
+	if (entry != NULL)
+	{
+		/*
+		** Move the entry to the front of the LRU list.
+		*/
+		if (entry != Ex_cache_lru_head)
+		{
+			entry->lru_prev->lru_next = entry->lru_next;
+			if (entry->lru_next != NULL)
+			{
+				entry->lru_next->lru_prev = entry->lru_prev;
+			}
+			else
+			{
+				Ex_cache_lru_tail = entry->lru_prev;
+			}
+			entry->lru_prev = NULL;
+			entry->lru_next = Ex_cache_lru_head;
+			Ex_cache_lru_head->lru_prev = entry;
+			Ex_cache_lru_head = entry;
+		}
+		entry->refcount++;
+	}
+
+	pthread_mutex_unlock(&Ex_cache_lock);
+
+	return entry;
+}
+
+/*
+** ex_cache_release()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Gives back an entry returned by ex_cache_get().
+*/
+
+CS_VOID CS_PUBLIC
+ex_cache_release(EX_CACHE_ENTRY *entry)
+{
+	CS_BOOL		drop;
+
+	pthread_mutex_lock(&Ex_cache_lock);
+	drop = (--entry->refcount == 0 && !entry->linked);
+	pthread_mutex_unlock(&Ex_cache_lock);
+
+	if (drop)
+	{
+		free(entry);
+	}
+}
+
+/*
+** ex_cache_put()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Stores the results of a batch, replacing any entry with the same
+**	key, and evicts least recently used entries until the cache is
+**	back within its byte limit. Results that are too large to be worth
+**	caching are silently not stored.
+**
+** Parameters:
+** 	fp		- Fingerprint of the batch.
+** 	value		- The encoded row stream.
+** 	valuelen	- Length of the row stream.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cache_put(EX_FPRINT *fp, CS_BYTE *value, CS_INT valuelen)
+{
+	EX_CACHE_ENTRY	*entry;
+	EX_CACHE_ENTRY	*old;
+	EX_CACHE_ENTRY	**bucket;
+	CS_INT		size;
+
+	size = EX_ALIGN8(sizeof (EX_CACHE_ENTRY)) + EX_ALIGN8(valuelen)
+		+ fp->keylen + 1;
+	if (size > EX_CACHE_MAX_ENTRY(Ex_cache_maxbytes))
+	{
+		return CS_SUCCEED;
+	}
+
+	/*
+	** The value goes right after the entry, where it stays 8-byte
+	** aligned for ex_rowbuf_send(), and the key after the value.
+	*/
+	entry = (EX_CACHE_ENTRY *)malloc(size);
+	if (entry == NULL)
+	{
+		ex_error("ex_cache_put: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	memset(entry, 0, sizeof (EX_CACHE_ENTRY));
+	entry->value = (CS_BYTE *)entry + EX_ALIGN8(sizeof (EX_CACHE_ENTRY));
+	entry->key = (CS_CHAR *)entry->value + EX_ALIGN8(valuelen);
+	memcpy(entry->value, value, valuelen);
+	memcpy(entry->key, fp->key, fp->keylen);
+	entry->key[fp->keylen] = '\0';
+	entry->valuelen = valuelen;
+	entry->keylen = fp->keylen;
+	entry->keyhash = fp->keyhash;
+	entry->hash = fp->hash;
+	entry->size = size;
+	entry->linked = CS_TRUE;
+
+	pthread_mutex_lock(&Ex_cache_lock);
+
+	entry->expires = time(NULL) + Ex_cache_ttl;
+
+	bucket = &Ex_cache_buckets[fp->keyhash % EX_CACHE_BUCKETS];
+	for (old = *bucket; old != NULL; old = old->hash_next)
+	{
+		if (old->keyhash == fp->keyhash && old->keylen == fp->keylen
+			&& memcmp(old->key, fp->key, fp->keylen) == 0)
+		{
+			ex_cache_unlink(old);
+			break;
+		}
+	}
+
+	entry->hash_next = *bucket;
+	*bucket = entry;
+
+	entry->lru_next = Ex_cache_lru_head;
+	if (Ex_cache_lru_head != NULL)
+	{
+		Ex_cache_lru_head->lru_prev = entry;
+	}
+	Ex_cache_lru_head = entry;
+	if (Ex_cache_lru_tail == NULL)
+	{
+		Ex_cache_lru_tail = entry;
+	}
+	Ex_cache_bytes += size;
+
+	while (Ex_cache_bytes > Ex_cache_maxbytes && Ex_cache_lru_tail != entry)
+	{
+		ex_cache_unlink(Ex_cache_lru_tail);
+	}
+
+	pthread_mutex_unlock(&Ex_cache_lock);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_cache_invalidate()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Drops every entry whose normalized text contains match, or all
+**	entries if match is NULL or empty.
+**
+** Parameters:
+** 	match		- Text to look for, typically a table name.
+**
+** Returns:
+** 	The number of entries dropped.
+*/
+
+CS_INT CS_PUBLIC
+ex_cache_invalidate(CS_CHAR *match)
+{
+	EX_CACHE_ENTRY	*entry;
+	EX_CACHE_ENTRY	*next;
+	CS_INT		count = 0;
+
+	pthread_mutex_lock(&Ex_cache_lock);
+	for (entry = Ex_cache_lru_head; entry != NULL; entry = next)
+	{
+		next = entry->lru_next;
+		if (match == NULL || *match == '\0'
+			|| strstr(entry->key, match) != NULL)
+		{
+			ex_cache_unlink(entry);
+			count++;
+		}
+	}
+	pthread_mutex_unlock(&Ex_cache_lock);
+
+	return count;
+}
+
+/*
+** ex_cache_regproc()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Registers the cache_invalidate procedure. It takes one optional
+**	parameter, @match; see ex_cache_invalidate(). Called from the
+**	SRV_START handler, like stop_regproc().
+**
+** Returns:
+** 	CS_SUCCEED or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cache_regproc(SRV_SERVER *server)
+{
+	CS_INT		info;
+	SRV_PROC	*sproc;
+
+	sproc = srv_createproc(server);
+	if (sproc == NULL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regdefine(sproc, EX_CACHE_REGPROC, CS_NULLTERM,
+		ex_cache_invalidate_rp) == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regparam(sproc, "@match", CS_NULLTERM, CS_CHAR_TYPE,
+		0, (CS_BYTE *)"") == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regcreate(sproc, &info) == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	(CS_VOID)srv_termproc(sproc);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_cache_invalidate_rp()
+**
+** Purpose:
+** 	Handler of the cache_invalidate registered procedure. The done
+**	sent back carries the number of entries dropped.
+*/
+
+CS_STATIC CS_RETCODE CS_PUBLIC
+ex_cache_invalidate_rp(SRV_PROC *sp)
+{
+	CS_DATAFMT	fmt;
+	CS_CHAR		match[CS_MAX_CHAR + 1];
+	CS_INT		matchlen = 0;
+	CS_SMALLINT	indicator = CS_GOODDATA;
+	CS_INT		count;
+
+	if (srv_numparams(sp) > 0)
+	{
+		if (srv_descfmt(sp, CS_GET, SRV_RPCDATA, 1, &fmt) != CS_SUCCEED)
+		{
+			(CS_VOID)srv_senddone(sp, SRV_DONE_ERROR | SRV_DONE_FINAL,
+				CS_TRAN_COMPLETED, 0);
+			return CS_FAIL;
+		}
+		fmt.datatype = CS_CHAR_TYPE;
+		fmt.format = CS_FMT_UNUSED;
+		fmt.maxlength = CS_MAX_CHAR;
+		if (srv_bind(sp, CS_GET, SRV_RPCDATA, 1, &fmt, (CS_BYTE *)match,
+			&matchlen, &indicator) != CS_SUCCEED
+			|| srv_xferdata(sp, CS_GET, SRV_RPCDATA) != CS_SUCCEED)
+		{
+			(CS_VOID)srv_senddone(sp, SRV_DONE_ERROR | SRV_DONE_FINAL,
+				CS_TRAN_COMPLETED, 0);
+			return CS_FAIL;
+		}
+	}
+	if (indicator == CS_NULLDATA)
+	{
+		matchlen = 0;
+	}
+	match[matchlen] = '\0';
+
+	count = ex_cache_invalidate(match);
+
+	return srv_senddone(sp, SRV_DONE_COUNT | SRV_DONE_FINAL,
+			CS_TRAN_COMPLETED, count);
+}
+
+/*
+** ex_cache_unlink()
+**
+** Purpose:
+** 	Removes an entry from the cache. The entry is freed right away
+**	unless a client thread is still sending it. Called with the cache
+**	lock held.
+*/
+
+CS_STATIC CS_VOID
+ex_cache_unlink(EX_CACHE_ENTRY *entry)
+{
+	EX_CACHE_ENTRY	**pp;
+
+	for (pp = &Ex_cache_buckets[entry->keyhash % EX_CACHE_BUCKETS];
+		*pp != entry; pp = &(*pp)->hash_next)
+	{
+		;
+	}
+	*pp = entry->hash_next;
+
+	if (entry->lru_prev != NULL)
+	{
+		entry->lru_prev->lru_next = entry->lru_next;
+	}
+	else
+	{
+		Ex_cache_lru_head = entry->lru_next;
+	}
+	if (entry->lru_next != NULL)
+	{
+		entry->lru_next->lru_prev = entry->lru_prev;
+	}
+	else
+	{
+		Ex_cache_lru_tail = entry->lru_prev;
+	}
+
+	Ex_cache_bytes -= entry->size;
+	entry->linked = CS_FALSE;
+	if (entry->refcount == 0)
+	{
+		free(entry);
+	}
+}
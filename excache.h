@@ -0,0 +1,119 @@
+/*
+** excache.h
+** ---------
+**
+** Description
+** -----------
+**	Defines and prototypes for the server-side result cache and the
+**	encoded row streams it stores (excache.c).
+*/
+
+#ifndef EXCACHE_H
+#define EXCACHE_H
+
+#include <time.h>
+#include "exfprint.h"
+
+/*
+** Default cache limits.
+*/
+#define EX_CACHE_MAX_BYTES	(16 * 1024 * 1024)
+#define EX_CACHE_TTL_SECS	5
+#define EX_CACHE_BUCKETS	4096
+
+/*
+** Results larger than this fraction of the cache are never stored.
+*/
+#define EX_CACHE_MAX_ENTRY(_max)	((_max) / 8)
+
+/*
+** Name of the registered procedure that invalidates cache entries.
+*/
+#define EX_CACHE_REGPROC	"cache_invalidate"
+
+/*
+** An encoded row stream: a header with the column and row counts, the
+** CS_DATAFMT of each column, then for each row and column the value
+** length and indicator followed by the value bytes. Everything is kept
+** 8-byte aligned so a stream can be handed to srv_bind() in place.
+*/
+typedef struct _ex_rowbuf
+{
+	CS_BYTE		*data;
+	CS_INT		len;		/* bytes used */
+	CS_INT		size;		/* bytes allocated */
+	CS_INT		numcols;
+	CS_INT		numrows;
+	CS_INT		curcol;		/* next column of the current row */
+} EX_ROWBUF;
+
+/*
+** A cache entry. Entries handed out by ex_cache_get() stay valid until
+** they are given back with ex_cache_release(), even if they are evicted
+** in the meantime.
+*/
+typedef struct _ex_cache_entry EX_CACHE_ENTRY;
+struct _ex_cache_entry
+{
+	EX_CACHE_ENTRY	*lru_prev;
+	EX_CACHE_ENTRY	*lru_next;
+	EX_CACHE_ENTRY	*hash_next;
+	CS_UBIGINT	keyhash;
+	CS_UBIGINT	hash;		/* fingerprint hash */
+	time_t		expires;
+	CS_INT		refcount;
+	CS_BOOL		linked;		/* still in the cache */
+	CS_INT		size;		/* bytes charged to the cache */
+	CS_INT		keylen;
+	CS_INT		valuelen;
+	CS_CHAR		*key;
+	CS_BYTE		*value;
+};
+
+/* excache.c */
+extern CS_RETCODE CS_PUBLIC ex_rowbuf_init(
+	EX_ROWBUF *rows,
+	CS_INT numcols
+	);
+extern CS_RETCODE CS_PUBLIC ex_rowbuf_describe(
+	EX_ROWBUF *rows,
+	CS_INT item,
+	CS_DATAFMT *fmt
+	);
+extern CS_RETCODE CS_PUBLIC ex_rowbuf_add(
+	EX_ROWBUF *rows,
+	CS_VOID *value,
+	CS_INT valuelen,
+	CS_SMALLINT indicator
+	);
+extern CS_VOID CS_PUBLIC ex_rowbuf_free(
+	EX_ROWBUF *rows
+	);
+extern CS_RETCODE CS_PUBLIC ex_rowbuf_send(
+	SRV_PROC *sp,
+	CS_BYTE *data,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC ex_cache_init(
+	CS_INT maxbytes,
+	CS_INT ttl
+	);
+extern EX_CACHE_ENTRY * CS_PUBLIC ex_cache_get(
+	EX_FPRINT *fp
+	);
+extern CS_VOID CS_PUBLIC ex_cache_release(
+	EX_CACHE_ENTRY *entry
+	);
+extern CS_RETCODE CS_PUBLIC ex_cache_put(
+	EX_FPRINT *fp,
+	CS_BYTE *value,
+	CS_INT valuelen
+	);
+extern CS_INT CS_PUBLIC ex_cache_invalidate(
+	CS_CHAR *match
+	);
+extern CS_RETCODE CS_PUBLIC ex_cache_regproc(
+	SRV_SERVER *server
+	);
+
+#endif /* EXCACHE_H */
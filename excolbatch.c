@@ -0,0 +1,586 @@
+/*
+** excolbatch.c
+** ------------
+**
+** Description
+** -----------
+**	Columnar result batches.
+**
+**	ex_colbatch_bind() describes the current result set of a command
+**	and binds its columns to arrays of up to count rows, as
+**	ex_bind_array() used to, but the whole batch is a single
+**	allocation: the CS_DATAFMTs, the EX_COLUMN_ARRAY descriptors and,
+**	per column, a contiguous array of lengths, of indicators and of
+**	values. When the next result set has the same shape the batch is
+**	only bound again; when it doesn't, the arrays are laid out again
+**	in the same allocation if it is large enough. Reading result sets
+**	of the same shape, as ex_handle_results() and the export code do,
+**	then allocates nothing.
+**
+**	The batch is the unit the rest of the code consumes rows in:
+**	ex_fetch_data() displays it, and the writers of later modules
+**	read its columns directly.
+**
+** Routines Used
+** -------------
+**	ct_res_info, ct_describe, ct_bind, ct_fetch, cs_convert
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+
+/*
+** Rounds _n up to a multiple of EX_COLBATCH_ALIGN.
+*/
+#define EX_COLBATCH_ROUND(_n) \
+	(((size_t)(_n) + EX_COLBATCH_ALIGN - 1) & ~((size_t)EX_COLBATCH_ALIGN - 1))
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_VOID ex_colbatch_format(
+	CS_DATAFMT *datafmt,
+	CS_INT mode
+	);
+CS_STATIC CS_BOOL ex_colbatch_same(
+	CS_DATAFMT *a,
+	CS_DATAFMT *b
+	);
+CS_STATIC CS_INT ex_colbatch_textlen(
+	CS_DATAFMT *datafmt
+	);
+CS_STATIC size_t ex_colbatch_colsize(
+	CS_INT capacity,
+	CS_INT maxlength
+	);
+CS_STATIC CS_RETCODE ex_colbatch_layout(
+	EX_COLBATCH *batch,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt,
+	CS_INT count
+	);
+CS_STATIC CS_CHAR *ex_colbatch_carve(
+	EX_COLUMN_ARRAY *col,
+	CS_CHAR *mem,
+	CS_INT capacity,
+	CS_INT maxlength
+	);
+
+/*
+** ex_colbatch_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up an empty batch.
+*/
+
+CS_VOID CS_PUBLIC
+ex_colbatch_init(EX_COLBATCH *batch)
+{
+	memset(batch, 0, sizeof (EX_COLBATCH));
+}
+
+/*
+** ex_colbatch_bind()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Describes the current result set of cmd and binds its columns to
+**	the arrays of the batch, reusing the layout of the previous result
+**	set when the shape is the same.
+**
+** Parameters:
+** 	batch		- The batch.
+** 	cmd		- Command with a fetchable result set.
+** 	mode		- EX_BIND_CHAR or EX_BIND_NATIVE.
+** 	count		- Rows per fetch; lowered so that the arrays take at
+**			  most EX_FETCH_MAXBYTES.
+** 	withtext	- CS_TRUE to also have string arrays for the natively
+**			  bound columns (see ex_colbatch_text()).
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR, or the result of the CT-Lib call that
+**	failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_colbatch_bind(EX_COLBATCH *batch, CS_COMMAND *cmd, CS_INT mode,
+		 CS_INT count, CS_BOOL withtext)
+{
+	CS_RETCODE	retcode;
+	CS_INT		numcols;
+	CS_DATAFMT	fmt;
+	CS_DATAFMT	*fmts = NULL;
+	CS_BOOL		same;
+	CS_INT		i;
+
+	retcode = ct_res_info(cmd, CS_NUMDATA, &numcols, CS_UNUSED, NULL);
+	if (retcode != CS_SUCCEED || numcols <= 0)
+	{
+		ex_error("ex_colbatch_bind: ct_res_info() failed");
+		return CS_FAIL;
+	}
+
+	/*
+	** Describe the columns. When the shape may be the same, they are
+	** described straight into the batch and compared with what it
+	** held; otherwise into a scratch array for the new layout.
+	*/
+	same = (batch->mem != NULL && numcols == batch->numcols
+		&& mode == batch->mode && withtext == batch->withtext);
+	if (!same)
+	{
+		fmts = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+		if (fmts == NULL)
+		{
+			ex_error("ex_colbatch_bind: malloc() failed");
+			return CS_MEM_ERROR;
+		}
+	}
+
+	for (i = 0; i < numcols; i++)
+	{
+		if ((retcode = ct_describe(cmd, (i + 1), &fmt)) != CS_SUCCEED)
+		{
+			ex_error("ex_colbatch_bind: ct_describe() failed");
+			free(fmts);
+			return retcode;
+		}
+		ex_colbatch_format(&fmt, mode);
+
+		if (same)
+		{
+			same = ex_colbatch_same(&fmt, &batch->datafmt[i]);
+			fmt.count = batch->capacity;
+			batch->datafmt[i] = fmt;
+		}
+		if (!same && fmts == NULL)
+		{
+			/*
+			** The shape changed part way; keep what was
+			** described so far.
+			*/
+			fmts = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+			if (fmts == NULL)
+			{
+				ex_error("ex_colbatch_bind: malloc() failed");
+				batch->numcols = 0;
+				return CS_MEM_ERROR;
+			}
+			memcpy(fmts, batch->datafmt, i * sizeof (CS_DATAFMT));
+		}
+		if (fmts != NULL)
+		{
+			fmts[i] = fmt;
+		}
+	}
+
+	/*
+	** Same shape and the same count asked for, which the layout may
+	** have lowered: the names may differ, which only matters to the
+	** string formats.
+	*/
+	if (same && count == batch->requested)
+	{
+		for (i = 0; withtext && i < numcols; i++)
+		{
+			memcpy(batch->textfmt[i].name, batch->datafmt[i].name,
+				sizeof (batch->textfmt[i].name));
+			batch->textfmt[i].namelen = batch->datafmt[i].namelen;
+		}
+	}
+	else
+	{
+		if (fmts == NULL)
+		{
+			fmts = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+			if (fmts == NULL)
+			{
+				ex_error("ex_colbatch_bind: malloc() failed");
+				return CS_MEM_ERROR;
+			}
+			memcpy(fmts, batch->datafmt, numcols * sizeof (CS_DATAFMT));
+		}
+		batch->mode = mode;
+		batch->withtext = withtext;
+		retcode = ex_colbatch_layout(batch, numcols, fmts, count);
+		free(fmts);
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+
+	batch->numrows = 0;
+	for (i = 0; i < numcols; i++)
+	{
+		retcode = ct_bind(cmd, (i + 1), &batch->datafmt[i],
+				batch->columns[i].value, batch->columns[i].valuelen,
+				batch->columns[i].indicator);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_colbatch_bind: ct_bind() failed");
+			return retcode;
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_colbatch_shape()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Lays the batch out for columns described by something other than
+**	a CT-Lib result set, such as Bulk-Library, without binding them.
+**	The caller binds the arrays of batch->columns with the formats of
+**	batch->datafmt, fills the batch and sets batch->numrows. To convert
+**	them with ex_colbatch_text(), batch->context must be set.
+**
+** Parameters:
+** 	batch		- The batch.
+** 	numcols		- Number of columns.
+** 	datafmt		- numcols described formats.
+** 	mode		- EX_BIND_CHAR or EX_BIND_NATIVE.
+** 	count		- Rows per fill, lowered as in ex_colbatch_bind().
+** 	withtext	- CS_TRUE to also have string arrays.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_colbatch_shape(EX_COLBATCH *batch, CS_INT numcols, CS_DATAFMT *datafmt,
+		  CS_INT mode, CS_INT count, CS_BOOL withtext)
+{
+	CS_DATAFMT	*fmts;
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	fmts = (CS_DATAFMT *)malloc(numcols * sizeof (CS_DATAFMT));
+	if (fmts == NULL)
+	{
+		ex_error("ex_colbatch_shape: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	for (i = 0; i < numcols; i++)
+	{
+		fmts[i] = datafmt[i];
+		ex_colbatch_format(&fmts[i], mode);
+	}
+
+	batch->mode = mode;
+	batch->withtext = withtext;
+	retcode = ex_colbatch_layout(batch, numcols, fmts, count);
+	free(fmts);
+
+	return retcode;
+}
+
+/*
+** ex_colbatch_fetch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Fetches the next rows of the result set into the batch.
+**
+** Returns:
+** 	The result of ct_fetch(). batch->numrows is the number of good
+**	rows; on CS_ROW_FAIL the failed row, which ends the fetch, isn't
+**	counted.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_colbatch_fetch(EX_COLBATCH *batch, CS_COMMAND *cmd)
+{
+	CS_RETCODE	retcode;
+	CS_INT		rows_read = 0;
+
+	retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED, &rows_read);
+	if (retcode == CS_ROW_FAIL && rows_read > 0)
+	{
+		rows_read--;
+	}
+	batch->numrows = (retcode == CS_SUCCEED || retcode == CS_ROW_FAIL)
+			? rows_read : 0;
+
+	return retcode;
+}
+
+/*
+** ex_colbatch_text()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Converts the rows of the natively bound columns to their string
+**	arrays; see ex_convert_array(). The batch must have been bound
+**	withtext.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the context can't be found or a value
+**	doesn't fit in its string array.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_colbatch_text(EX_COLBATCH *batch, CS_COMMAND *cmd)
+{
+	CS_CONNECTION	*connection;
+	CS_INT		i;
+
+	if (batch->context == NULL)
+	{
+		if (ct_cmd_props(cmd, CS_GET, CS_PARENT_HANDLE, &connection,
+				CS_UNUSED, NULL) != CS_SUCCEED
+			|| ct_con_props(connection, CS_GET, CS_PARENT_HANDLE,
+				&batch->context, CS_UNUSED, NULL) != CS_SUCCEED)
+		{
+			ex_error("ex_colbatch_text: can't get the context");
+			batch->context = NULL;
+			return CS_FAIL;
+		}
+	}
+
+	for (i = 0; i < batch->numcols; i++)
+	{
+		if (batch->datafmt[i].datatype != CS_CHAR_TYPE)
+		{
+			if (ex_convert_array(batch->context, &batch->datafmt[i],
+					&batch->columns[i], &batch->textfmt[i],
+					&batch->text[i], batch->numrows) != CS_SUCCEED)
+			{
+				return CS_FAIL;
+			}
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_colbatch_free()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Frees the allocation of a batch, leaving it empty.
+*/
+
+CS_VOID CS_PUBLIC
+ex_colbatch_free(EX_COLBATCH *batch)
+{
+	free(batch->mem);
+	ex_colbatch_init(batch);
+}
+
+/*
+** ex_colbatch_format()
+**
+** Purpose:
+** 	Turns a described format into the one the column is bound with:
+**	as is for fixed width types in EX_BIND_NATIVE mode, otherwise a
+**	null terminated string long enough for any value.
+*/
+
+CS_STATIC CS_VOID
+ex_colbatch_format(CS_DATAFMT *datafmt, CS_INT mode)
+{
+	if (mode == EX_BIND_NATIVE && ex_native_type(datafmt->datatype))
+	{
+		datafmt->format = CS_FMT_UNUSED;
+	}
+	else
+	{
+		datafmt->maxlength = ex_display_dlen(datafmt) + 1;
+		datafmt->datatype = CS_CHAR_TYPE;
+		datafmt->format = CS_FMT_NULLTERM;
+	}
+}
+
+/*
+** ex_colbatch_same()
+**
+** Purpose:
+** 	Tells whether two bound formats need the same arrays.
+*/
+
+CS_STATIC CS_BOOL
+ex_colbatch_same(CS_DATAFMT *a, CS_DATAFMT *b)
+{
+	return (a->datatype == b->datatype && a->maxlength == b->maxlength
+		&& a->format == b->format && a->precision == b->precision
+		&& a->scale == b->scale) ? CS_TRUE : CS_FALSE;
+}
+
+/*
+** ex_colbatch_textlen()
+**
+** Purpose:
+** 	Length of the string array of a bound column: none for string
+**	columns, which are their own text.
+*/
+
+CS_STATIC CS_INT
+ex_colbatch_textlen(CS_DATAFMT *datafmt)
+{
+	return (datafmt->datatype == CS_CHAR_TYPE) ? 0
+		: ex_display_dlen(datafmt) + 1;
+}
+
+/*
+** ex_colbatch_colsize()
+**
+** Purpose:
+** 	Bytes taken by the arrays of one column.
+*/
+
+CS_STATIC size_t
+ex_colbatch_colsize(CS_INT capacity, CS_INT maxlength)
+{
+	return EX_COLBATCH_ROUND(capacity * sizeof (CS_INT))
+		+ EX_COLBATCH_ROUND(capacity * sizeof (CS_SMALLINT))
+		+ EX_COLBATCH_ROUND((size_t)capacity * maxlength);
+}
+
+/*
+** ex_colbatch_layout()
+**
+** Purpose:
+** 	Lays the batch out for numcols columns of the given bound formats
+**	and count rows, growing the allocation if it is too small.
+*/
+
+CS_STATIC CS_RETCODE
+ex_colbatch_layout(EX_COLBATCH *batch, CS_INT numcols, CS_DATAFMT *datafmt,
+		   CS_INT count)
+{
+	size_t		rowbytes = 0;
+	size_t		size;
+	CS_INT		ntables;
+	CS_INT		textlen;
+	CS_CHAR		*mem;
+	CS_INT		i;
+
+	for (i = 0; i < numcols; i++)
+	{
+		rowbytes += datafmt[i].maxlength + sizeof (CS_INT)
+				+ sizeof (CS_SMALLINT);
+		if (batch->withtext)
+		{
+			rowbytes += ex_colbatch_textlen(&datafmt[i])
+				+ sizeof (CS_INT) + sizeof (CS_SMALLINT);
+		}
+	}
+	batch->requested = count;
+	count = MAX(1, MIN(count, (CS_INT)(EX_FETCH_MAXBYTES / MAX(rowbytes, 1))));
+
+	ntables = batch->withtext ? 2 : 1;
+	size = ntables * (EX_COLBATCH_ROUND(numcols * sizeof (CS_DATAFMT))
+		+ EX_COLBATCH_ROUND(numcols * sizeof (EX_COLUMN_ARRAY)));
+	for (i = 0; i < numcols; i++)
+	{
+		size += ex_colbatch_colsize(count, datafmt[i].maxlength);
+		if (batch->withtext)
+		{
+			size += ex_colbatch_colsize(count,
+					ex_colbatch_textlen(&datafmt[i]));
+		}
+	}
+
+	if (size > batch->memsize)
+	{
+		free(batch->mem);
+		batch->memsize = 0;
+		batch->numcols = 0;
+		if ((batch->mem = malloc(size)) == NULL)
+		{
+			ex_error("ex_colbatch_layout: malloc() failed");
+			return CS_MEM_ERROR;
+		}
+		batch->memsize = size;
+		batch->allocs++;
+	}
+
+	mem = (CS_CHAR *)batch->mem;
+	batch->numcols = numcols;
+	batch->capacity = count;
+	batch->numrows = 0;
+
+	batch->datafmt = (CS_DATAFMT *)mem;
+	mem += EX_COLBATCH_ROUND(numcols * sizeof (CS_DATAFMT));
+	batch->columns = (EX_COLUMN_ARRAY *)mem;
+	mem += EX_COLBATCH_ROUND(numcols * sizeof (EX_COLUMN_ARRAY));
+	batch->textfmt = NULL;
+	batch->text = NULL;
+	if (batch->withtext)
+	{
+		batch->textfmt = (CS_DATAFMT *)mem;
+		mem += EX_COLBATCH_ROUND(numcols * sizeof (CS_DATAFMT));
+		batch->text = (EX_COLUMN_ARRAY *)mem;
+		mem += EX_COLBATCH_ROUND(numcols * sizeof (EX_COLUMN_ARRAY));
+	}
+
+	for (i = 0; i < numcols; i++)
+	{
+		batch->datafmt[i] = datafmt[i];
+		batch->datafmt[i].count = count;
+		mem = ex_colbatch_carve(&batch->columns[i], mem, count,
+				datafmt[i].maxlength);
+
+		if (batch->withtext)
+		{
+			textlen = ex_colbatch_textlen(&datafmt[i]);
+			batch->textfmt[i] = datafmt[i];
+			if (textlen > 0)
+			{
+				batch->textfmt[i].datatype = CS_CHAR_TYPE;
+				batch->textfmt[i].format = CS_FMT_NULLTERM;
+				batch->textfmt[i].maxlength = textlen;
+				batch->textfmt[i].count = 1;
+			}
+			mem = ex_colbatch_carve(&batch->text[i], mem, count, textlen);
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_colbatch_carve()
+**
+** Purpose:
+** 	Points the arrays of a column at mem and returns the memory that
+**	follows them.
+*/
+
+CS_STATIC CS_CHAR *
+ex_colbatch_carve(EX_COLUMN_ARRAY *col, CS_CHAR *mem, CS_INT capacity,
+		  CS_INT maxlength)
+{
+	col->maxlength = maxlength;
+	col->valuelen = (CS_INT *)mem;
+	mem += EX_COLBATCH_ROUND(capacity * sizeof (CS_INT));
+	col->indicator = (CS_SMALLINT *)mem;
+	mem += EX_COLBATCH_ROUND(capacity * sizeof (CS_SMALLINT));
+	col->value = mem;
+	mem += EX_COLBATCH_ROUND((size_t)capacity * maxlength);
+
+	return mem;
+}
@@ -0,0 +1,87 @@
+/*
+** excolbatch.h
+** ------------
+**
+** Description
+** -----------
+**	Defines and prototypes for the columnar result batches in
+**	excolbatch.c.
+*/
+
+#ifndef EXCOLBATCH_H
+#define EXCOLBATCH_H
+
+/*
+** Alignment of every array in the allocation of a batch.
+*/
+#define EX_COLBATCH_ALIGN	8
+
+/*
+** Rows of a result set, bound column by column. The formats, the
+** column descriptors and the value, length and indicator arrays of
+** every column all live in one allocation (mem), which is kept when
+** the batch is bound to the next result set and only grows when that
+** result set needs more room, so reading result sets of the same
+** shape allocates nothing.
+**
+** With text, each column also has an array of null terminated strings
+** (text[i]) that ex_colbatch_text() fills from natively bound columns;
+** the text of a string column is its bound array.
+*/
+struct _ex_colbatch
+{
+	CS_INT		numcols;
+	CS_INT		capacity;	/* rows per fetch */
+	CS_INT		requested;	/* rows asked for, before the cap */
+	CS_INT		numrows;	/* rows of the last fetch */
+	CS_INT		mode;		/* EX_BIND_CHAR or EX_BIND_NATIVE */
+	CS_BOOL		withtext;
+	CS_DATAFMT	*datafmt;	/* numcols bound formats */
+	CS_DATAFMT	*textfmt;	/* numcols string formats, or NULL */
+	EX_COLUMN_ARRAY	*columns;	/* numcols bound arrays */
+	EX_COLUMN_ARRAY	*text;		/* numcols string arrays, or NULL */
+	CS_CONTEXT	*context;	/* for cs_convert(), looked up once */
+	CS_VOID		*mem;
+	size_t		memsize;
+	CS_INT		allocs;		/* times mem was (re)allocated */
+};
+
+/*
+** String form of column _i, for display and the like.
+*/
+#define EX_COLBATCH_TEXT(_b, _i) \
+	(((_b)->datafmt[_i].datatype == CS_CHAR_TYPE) \
+		? &(_b)->columns[_i] : &(_b)->text[_i])
+
+/* excolbatch.c */
+extern CS_VOID CS_PUBLIC ex_colbatch_init(
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_colbatch_bind(
+	EX_COLBATCH *batch,
+	CS_COMMAND *cmd,
+	CS_INT mode,
+	CS_INT count,
+	CS_BOOL withtext
+	);
+extern CS_RETCODE CS_PUBLIC ex_colbatch_shape(
+	EX_COLBATCH *batch,
+	CS_INT numcols,
+	CS_DATAFMT *datafmt,
+	CS_INT mode,
+	CS_INT count,
+	CS_BOOL withtext
+	);
+extern CS_RETCODE CS_PUBLIC ex_colbatch_fetch(
+	EX_COLBATCH *batch,
+	CS_COMMAND *cmd
+	);
+extern CS_RETCODE CS_PUBLIC ex_colbatch_text(
+	EX_COLBATCH *batch,
+	CS_COMMAND *cmd
+	);
+extern CS_VOID CS_PUBLIC ex_colbatch_free(
+	EX_COLBATCH *batch
+	);
+
+#endif /* EXCOLBATCH_H */
@@ -0,0 +1,551 @@
+/*
+** excoro.cpp
+** ----------
+**
+** Description
+** -----------
+**	C++20 coroutine layer over the asynchronous requests of exasync.c.
+**
+**	A query is written as straight-line code,
+**
+**		if (co_await conn.execute("use sampledb") != CS_SUCCEED) ...
+**		ex::Cursor cursor = conn.query("select * from sampletext");
+**		while ((ret = co_await cursor.next_batch()) == CS_SUCCEED) ...
+**
+**	and each co_await suspends the coroutine while its request is in
+**	flight. Underneath it is the same completion driven state machine
+**	as ex_async_fetch_data(): the awaiter starts the request, the
+**	Scheduler polls the CS_DEFER_IO connection until the request has
+**	got as far as the awaiter needs, and then resumes the coroutine.
+**	One thread can run a coroutine per connection this way.
+**
+** Routines Used
+** -------------
+**	ct_poll, ct_con_props, poll
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <utility>
+#include <poll.h>
+
+extern "C" {
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+}
+#include "excoro.h"
+
+namespace ex {
+
+/*
+** ex::error()
+**
+** Purpose:
+** 	ex_error() for string literals.
+*/
+
+static void
+error(const char *msg)
+{
+	ex_error(const_cast<char *>(msg));
+}
+
+/*
+** Task::promise_type::unhandled_exception()
+**
+** Purpose:
+** 	The example code doesn't throw; an exception escaping from a
+**	coroutine (std::bad_alloc) makes the Task fail.
+*/
+
+void
+Task::promise_type::unhandled_exception()
+{
+	error("ex::Task: unhandled exception in coroutine");
+	retcode = CS_FAIL;
+}
+
+/*
+** Scheduler::spawn()
+**
+** Purpose:
+** 	Takes ownership of a Task and queues it to be started by run().
+*/
+
+void
+Scheduler::spawn(Task task)
+{
+	runnable.push_back(task.h);
+	tasks.push_back(std::move(task));
+}
+
+/*
+** Scheduler::run()
+**
+** Purpose:
+** 	Resumes runnable coroutines until each of them is suspended on a
+**	request, then polls the connections of the waiting ones and makes
+**	those whose requests are ready runnable again. When no connection
+**	made progress it blocks in block() until one may have.
+**
+** Returns:
+** 	CS_SUCCEED once every spawned Task has returned (whatever the
+**	Tasks themselves returned), or CS_FAIL if ct_poll() failed.
+*/
+
+CS_RETCODE
+Scheduler::run()
+{
+	std::vector<Waiter *>	still;
+	bool			progress;
+
+	for (;;)
+	{
+		while (!runnable.empty())
+		{
+			std::coroutine_handle<> h = runnable.front();
+
+			runnable.pop_front();
+			h.resume();
+		}
+
+		if (waiting.empty())
+		{
+			break;
+		}
+
+		progress = false;
+		still.clear();
+		for (Waiter *w : waiting)
+		{
+			if (poll(w) != CS_SUCCEED)
+			{
+				return CS_FAIL;
+			}
+			if (w->ready())
+			{
+				runnable.push_back(w->handle);
+				progress = true;
+			}
+			else
+			{
+				still.push_back(w);
+			}
+		}
+		waiting.swap(still);
+
+		if (!progress && block() != CS_SUCCEED)
+		{
+			return CS_FAIL;
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** Scheduler::poll()
+**
+** Purpose:
+** 	Lets the request a coroutine waits on make progress: polls its
+**	connection until the awaiter is ready or nothing more completes
+**	without waiting.
+*/
+
+CS_RETCODE
+Scheduler::poll(Waiter *w)
+{
+	CS_CONNECTION	*compconn;
+	CS_COMMAND	*compcmd;
+	CS_INT		compid;
+	CS_RETCODE	compstatus;
+	CS_RETCODE	retcode;
+
+	do
+	{
+		retcode = ct_poll(NULL, w->conn->connection, 0, &compconn,
+				&compcmd, &compid, &compstatus);
+	} while (retcode == CS_SUCCEED && !w->ready());
+
+	if (retcode != CS_SUCCEED && retcode != CS_TIMED_OUT
+		&& retcode != CS_QUIET)
+	{
+		error("ex::Scheduler::poll: ct_poll() failed");
+		return CS_FAIL;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** Scheduler::block()
+**
+** Purpose:
+** 	Waits up to a tick for a socket of the waiting connections to
+**	become readable. Client-Library may also hold data in its own
+**	buffers, which is why run() polls every waiting connection again
+**	after the tick whether or not its socket was reported.
+*/
+
+CS_RETCODE
+Scheduler::block()
+{
+	std::vector<struct pollfd>	fds;
+	struct pollfd			pfd;
+
+	for (Waiter *w : waiting)
+	{
+		if (w->conn->fd >= 0)
+		{
+			pfd.fd = w->conn->fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			fds.push_back(pfd);
+		}
+	}
+
+	if (::poll(fds.data(), fds.size(), tickms) < 0 && errno != EINTR)
+	{
+		error("ex::Scheduler::block: poll() failed");
+		return CS_FAIL;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** Connection::Connection()
+**
+** Purpose:
+** 	Switches a connection to CS_DEFER_IO and looks up its socket;
+**	check status() before using it.
+*/
+
+Connection::Connection(Scheduler &sched, CS_CONNECTION *connection)
+	: sched(sched), connection(connection), fd(-1)
+{
+	CS_INT		endpoint;
+
+	retcode = ex_async_netio(connection, CS_DEFER_IO);
+	if (retcode == CS_SUCCEED && ct_con_props(connection, CS_GET,
+			CS_ENDPOINT, &endpoint, CS_UNUSED, NULL) == CS_SUCCEED)
+	{
+		fd = endpoint;
+	}
+}
+
+/*
+** Connection::~Connection()
+**
+** Purpose:
+** 	Switches the connection back to CS_SYNC_IO.
+*/
+
+Connection::~Connection()
+{
+	if (retcode == CS_SUCCEED)
+	{
+		(CS_VOID)ex_async_netio(connection, CS_SYNC_IO);
+	}
+}
+
+/*
+** ExecuteAwaiter
+**
+** Purpose:
+** 	co_await conn.execute(): await_ready() sends the command, which
+**	only completes right away on error; otherwise the coroutine waits
+**	until the results loop is done.
+*/
+
+ExecuteAwaiter::ExecuteAwaiter(Connection &conn, std::string sql)
+	: sql(std::move(sql))
+{
+	this->conn = &conn;
+	memset(&async, 0, sizeof (async));
+}
+
+bool
+ExecuteAwaiter::await_ready()
+{
+	return ex_async_execute_cmd(&async, conn->connection, sql.data(),
+			NULL, NULL) != CS_PENDING;
+}
+
+void
+ExecuteAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+	handle = h;
+	conn->sched.wait(this);
+}
+
+/*
+** BatchAwaiter
+**
+** Purpose:
+** 	co_await cursor.next_batch(): the first one sends the query. The
+**	coroutine is resumed once a full batch is buffered or the query
+**	is done, and then gets the batch.
+*/
+
+BatchAwaiter::BatchAwaiter(Cursor &cursor)
+	: cursor(cursor)
+{
+	conn = &cursor.conn;
+}
+
+bool
+BatchAwaiter::ready()
+{
+	return (CS_INT)cursor.buffer.size() >= cursor.batchsize
+		|| ex_async_done(&cursor.async);
+}
+
+bool
+BatchAwaiter::await_ready()
+{
+	if (!cursor.started)
+	{
+		cursor.started = true;
+		(CS_VOID)ex_async_fetch_data(&cursor.async, conn->connection,
+				cursor.sql.data(), Cursor::on_row, NULL, &cursor);
+	}
+	return ready();
+}
+
+void
+BatchAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+	handle = h;
+	conn->sched.wait(this);
+}
+
+CS_RETCODE
+BatchAwaiter::await_resume()
+{
+	cursor.rows.clear();
+	while (!cursor.buffer.empty()
+		&& (CS_INT)cursor.rows.size() < cursor.batchsize)
+	{
+		cursor.rows.push_back(std::move(cursor.buffer.front()));
+		cursor.buffer.pop_front();
+	}
+
+	if (!cursor.rows.empty())
+	{
+		return CS_SUCCEED;
+	}
+	return (cursor.async.status == CS_SUCCEED) ? CS_END_DATA
+		: cursor.async.status;
+}
+
+/*
+** Cursor::Cursor()
+**
+** Purpose:
+** 	A cursor over the rows of sql on conn; nothing is sent yet.
+*/
+
+Cursor::Cursor(Connection &conn, std::string sql, CS_INT batchsize)
+	: conn(conn), sql(std::move(sql)),
+	  batchsize((batchsize > 0) ? batchsize : EX_CORO_BATCH)
+{
+	memset(&async, 0, sizeof (async));
+}
+
+/*
+** Cursor::~Cursor()
+**
+** Purpose:
+** 	Cancels the rest of the rows if the query is still in flight, and
+**	waits for the cancel to complete so that the connection can run
+**	the next request.
+*/
+
+Cursor::~Cursor()
+{
+	if (started && !ex_async_done(&async))
+	{
+		closing = true;
+		(CS_VOID)ex_async_wait(&async);
+	}
+}
+
+/*
+** Cursor::on_row()
+**
+** Purpose:
+** 	Row routine of the query: buffers the row for next_batch(), or
+**	cancels the query if the cursor is being closed.
+*/
+
+CS_RETCODE CS_PUBLIC
+Cursor::on_row(EX_ASYNC *async, CS_INT numcols, CS_DATAFMT *datafmt,
+	       EX_COLUMN_DATA *coldata)
+{
+	Cursor		*cursor = static_cast<Cursor *>(async->userdata);
+	Row		row;
+	CS_INT		i;
+
+	if (cursor->closing)
+	{
+		return CS_FAIL;
+	}
+
+	if (cursor->names.empty())
+	{
+		for (i = 0; i < numcols; i++)
+		{
+			cursor->names.emplace_back(datafmt[i].name,
+				(datafmt[i].namelen > 0) ? datafmt[i].namelen : 0);
+		}
+	}
+
+	row.reserve(numcols);
+	for (i = 0; i < numcols; i++)
+	{
+		if (coldata[i].indicator == CS_NULLDATA)
+		{
+			row.emplace_back();
+		}
+		else
+		{
+			row.emplace_back(coldata[i].value);
+		}
+	}
+	cursor->buffer.push_back(std::move(row));
+
+	return CS_SUCCEED;
+}
+
+/*
+** workload()
+**
+** Purpose:
+** 	One connection of ex_coro_workload(): runs the query queries times
+**	and reads all of its rows.
+*/
+
+struct WorkloadStats
+{
+	CS_INT		requests = 0;
+	CS_INT		errors = 0;
+	CS_BIGINT	rows = 0;
+};
+
+static Task
+workload(Connection &conn, std::string sql, CS_INT queries,
+	 WorkloadStats &stats)
+{
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	for (i = 0; i < queries; i++)
+	{
+		Cursor cursor = conn.query(sql);
+
+		while ((retcode = co_await cursor.next_batch()) == CS_SUCCEED)
+		{
+			stats.rows += cursor.batch().size();
+		}
+
+		stats.requests++;
+		if (retcode != CS_END_DATA)
+		{
+			stats.errors++;
+		}
+	}
+
+	co_return (stats.errors == 0) ? CS_SUCCEED : CS_FAIL;
+}
+
+} /* namespace ex */
+
+/*
+** ex_coro_workload()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs the query in cmdbuf queries times on each of the connections,
+**	with a coroutine per connection on one Scheduler; the coroutine
+**	counterpart of running the query through ex_evloop_run().
+**
+** Parameters:
+** 	connections	- Idle connections; they are back in CS_SYNC_IO when
+**			  the routine returns, unless it failed.
+** 	nconns		- Number of connections.
+** 	cmdbuf		- The query.
+** 	queries		- Queries per connection.
+** 	requests	- Set to the number of queries run.
+** 	errors		- Set to the number of queries that failed.
+** 	rows		- Set to the number of rows fetched.
+**
+** Returns:
+** 	CS_SUCCEED, CS_MEM_ERROR, or CS_FAIL if a connection couldn't be
+**	switched to CS_DEFER_IO or ct_poll() failed; the connections must
+**	then be closed by the caller.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_coro_workload(CS_CONNECTION **connections, CS_INT nconns, CS_CHAR *cmdbuf,
+		 CS_INT queries, CS_INT *requests, CS_INT *errors,
+		 CS_BIGINT *rows)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		i;
+
+	*requests = 0;
+	*errors = 0;
+	*rows = 0;
+
+	try
+	{
+		std::vector<ex::WorkloadStats>			stats(nconns);
+		std::vector<std::unique_ptr<ex::Connection>>	conns;
+
+		/*
+		** Declared last so that it, and the coroutines it owns, go
+		** away before the connections and counters they use.
+		*/
+		ex::Scheduler					sched;
+
+		for (i = 0; i < nconns && retcode == CS_SUCCEED; i++)
+		{
+			conns.push_back(std::make_unique<ex::Connection>(sched,
+					connections[i]));
+			retcode = conns.back()->status();
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+
+		for (i = 0; i < nconns; i++)
+		{
+			sched.spawn(ex::workload(*conns[i], cmdbuf, queries,
+					stats[i]));
+		}
+		retcode = sched.run();
+
+		for (i = 0; i < nconns; i++)
+		{
+			*requests += stats[i].requests;
+			*errors += stats[i].errors;
+			*rows += stats[i].rows;
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		ex_error(const_cast<char *>("ex_coro_workload: out of memory"));
+		return CS_MEM_ERROR;
+	}
+
+	return retcode;
+}
@@ -0,0 +1,332 @@
+/*
+** excoro.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the C++20 coroutine layer in excoro.cpp.
+**	The classes are only visible to C++; C code reaches the layer
+**	through the ex_coro_* routines. Include ctpublic.h, example.h and
+**	exutils.h first, as for the other example headers.
+*/
+
+#ifndef EXCORO_H
+#define EXCORO_H
+
+/*
+** Rows returned by one Cursor::next_batch() unless the cursor was
+** opened with another batch size.
+*/
+#define EX_CORO_BATCH	100
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* excoro.cpp */
+extern CS_RETCODE CS_PUBLIC ex_coro_workload(
+	CS_CONNECTION **connections,
+	CS_INT nconns,
+	CS_CHAR *cmdbuf,
+	CS_INT queries,
+	CS_INT *requests,
+	CS_INT *errors,
+	CS_BIGINT *rows
+	);
+
+#ifdef __cplusplus
+}
+
+#include <coroutine>
+#include <deque>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "exasync.h"
+}
+
+namespace ex {
+
+class Scheduler;
+class Connection;
+class Cursor;
+
+/*
+** A row of a Cursor, each column converted to a string as in
+** ex_fetch_data(). NULL columns are empty strings.
+*/
+typedef std::vector<std::string> Row;
+
+/*
+** A coroutine returning a CS_RETCODE. It doesn't run until it is
+** awaited by another Task, which it resumes when it returns, or handed
+** to Scheduler::spawn().
+*/
+class Task
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> handle_type;
+
+	struct final_awaiter
+	{
+		bool await_ready() noexcept { return false; }
+		std::coroutine_handle<> await_suspend(handle_type h) noexcept
+		{
+			std::coroutine_handle<> next = h.promise().continuation;
+
+			return next ? next : std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+	struct promise_type
+	{
+		CS_RETCODE		retcode = CS_FAIL;
+		std::coroutine_handle<>	continuation;
+
+		Task get_return_object()
+		{
+			return Task(handle_type::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		final_awaiter final_suspend() noexcept { return {}; }
+		void return_value(CS_RETCODE r) { retcode = r; }
+		void unhandled_exception();
+	};
+
+	Task(Task &&other) noexcept : h(other.h) { other.h = nullptr; }
+	Task(const Task &) = delete;
+	Task &operator=(const Task &) = delete;
+	~Task()
+	{
+		if (h)
+		{
+			h.destroy();
+		}
+	}
+
+	bool await_ready() noexcept { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+	{
+		h.promise().continuation = caller;
+		return h;
+	}
+	CS_RETCODE await_resume() noexcept { return h.promise().retcode; }
+
+	/*
+	** Whether the coroutine has returned, and what it returned.
+	*/
+	bool done() const { return h.done(); }
+	CS_RETCODE retcode() const { return h.promise().retcode; }
+
+private:
+	friend class Scheduler;
+
+	explicit Task(handle_type handle) : h(handle) {}
+
+	handle_type	h;
+};
+
+/*
+** A coroutine suspended on a request of a connection. The scheduler
+** polls the connection until ready() and then resumes the coroutine.
+*/
+struct Waiter
+{
+	Connection		*conn = nullptr;
+	std::coroutine_handle<>	handle;
+
+	virtual bool ready() = 0;
+
+protected:
+	~Waiter() = default;
+};
+
+/*
+** Runs Tasks on one thread. Their requests go out on CS_DEFER_IO
+** connections; the scheduler polls only the connections a coroutine is
+** waiting on, waits for their sockets (CS_ENDPOINT) to become readable
+** when none of them can make progress, and resumes each coroutine once
+** its request has got as far as it asked for.
+*/
+class Scheduler
+{
+public:
+	explicit Scheduler(CS_INT tickms = EX_ASYNC_POLL_MS) : tickms(tickms) {}
+	Scheduler(const Scheduler &) = delete;
+	Scheduler &operator=(const Scheduler &) = delete;
+
+	/*
+	** Hands a Task to the scheduler, which starts it from run().
+	*/
+	void spawn(Task task);
+
+	/*
+	** Runs until every spawned Task has returned. Returns CS_FAIL if
+	** ct_poll() failed; coroutines that were still waiting are then
+	** left suspended and their connections must be closed.
+	*/
+	CS_RETCODE run();
+
+	/*
+	** Called by the awaiters: suspends w->handle until w->ready().
+	*/
+	void wait(Waiter *w) { waiting.push_back(w); }
+
+private:
+	CS_RETCODE poll(Waiter *w);
+	CS_RETCODE block();
+
+	CS_INT				tickms;
+	std::vector<Task>		tasks;
+	std::deque<std::coroutine_handle<>> runnable;
+	std::vector<Waiter *>		waiting;
+};
+
+/*
+** Awaiter of Connection::execute().
+*/
+class ExecuteAwaiter final : public Waiter
+{
+public:
+	ExecuteAwaiter(Connection &conn, std::string sql);
+	ExecuteAwaiter(const ExecuteAwaiter &) = delete;
+
+	bool ready() override { return ex_async_done(&async); }
+	bool await_ready();
+	void await_suspend(std::coroutine_handle<> h);
+	CS_RETCODE await_resume() { return async.status; }
+
+private:
+	std::string	sql;
+	EX_ASYNC	async;
+};
+
+/*
+** Awaiter of Cursor::next_batch().
+*/
+class BatchAwaiter final : public Waiter
+{
+public:
+	explicit BatchAwaiter(Cursor &cursor);
+
+	bool ready() override;
+	bool await_ready();
+	void await_suspend(std::coroutine_handle<> h);
+	CS_RETCODE await_resume();
+
+private:
+	Cursor		&cursor;
+};
+
+/*
+** A Client-Library connection used from coroutines. It is switched
+** to CS_DEFER_IO for the lifetime of the object and back to CS_SYNC_IO
+** afterwards. Like any connection it runs one request at a time.
+*/
+class Connection
+{
+public:
+	Connection(Scheduler &sched, CS_CONNECTION *connection);
+	Connection(const Connection &) = delete;
+	Connection &operator=(const Connection &) = delete;
+	~Connection();
+
+	/*
+	** CS_SUCCEED if the connection could be switched to CS_DEFER_IO.
+	*/
+	CS_RETCODE status() const { return retcode; }
+
+	/*
+	** co_await conn.execute(sql) runs a command that returns no rows
+	** (ex_execute_cmd()) and returns its status.
+	*/
+	ExecuteAwaiter execute(std::string sql)
+	{
+		return ExecuteAwaiter(*this, std::move(sql));
+	}
+
+	/*
+	** Opens a Cursor over the rows of a query; the query is sent on
+	** the first next_batch().
+	*/
+	Cursor query(std::string sql, CS_INT batchsize = EX_CORO_BATCH);
+
+private:
+	friend class Scheduler;
+	friend class ExecuteAwaiter;
+	friend class BatchAwaiter;
+	friend class Cursor;
+
+	Scheduler	&sched;
+	CS_CONNECTION	*connection;
+	int		fd;		/* CS_ENDPOINT, -1 if unknown */
+	CS_RETCODE	retcode;
+};
+
+/*
+** The rows of a query, read a batch at a time:
+**
+**	while ((ret = co_await cursor.next_batch()) == CS_SUCCEED)
+**		for (const ex::Row &row : cursor.batch())
+**			...
+**
+** next_batch() returns CS_END_DATA after the last batch, or the
+** failure code of the query. The connection is only polled while a
+** coroutine waits on the cursor, so at most a batch (plus what one
+** ct_poll() delivers) is buffered ahead of the reader. A cursor that
+** is destroyed before the end of its rows cancels them, blocking on
+** the connection until Client-Library is done with it.
+*/
+class Cursor
+{
+public:
+	Cursor(Connection &conn, std::string sql, CS_INT batchsize);
+	Cursor(const Cursor &) = delete;
+	Cursor &operator=(const Cursor &) = delete;
+	~Cursor();
+
+	BatchAwaiter next_batch() { return BatchAwaiter(*this); }
+
+	/*
+	** The batch returned by the last next_batch(), and the names of
+	** the columns.
+	*/
+	const std::vector<Row> &batch() const { return rows; }
+	const std::vector<std::string> &columns() const { return names; }
+
+	/*
+	** Rows fetched so far.
+	*/
+	CS_INT rowcount() const { return async.rowcount; }
+
+private:
+	friend class BatchAwaiter;
+
+	static CS_RETCODE CS_PUBLIC on_row(EX_ASYNC *async, CS_INT numcols,
+			CS_DATAFMT *datafmt, EX_COLUMN_DATA *coldata);
+
+	Connection			&conn;
+	std::string			sql;
+	CS_INT				batchsize;
+	bool				started = false;
+	bool				closing = false;
+	EX_ASYNC			async;
+	std::deque<Row>			buffer;
+	std::vector<Row>		rows;
+	std::vector<std::string>	names;
+};
+
+inline Cursor
+Connection::query(std::string sql, CS_INT batchsize)
+{
+	return Cursor(*this, std::move(sql), batchsize);
+}
+
+} /* namespace ex */
+
+#endif /* __cplusplus */
+
+#endif /* EXCORO_H */
@@ -0,0 +1,545 @@
+/*
+** excursor.c
+** ----------
+**
+** Description
+** -----------
+**	Scrollable cursor reader.
+**
+**	Paging through a query by running it again with a new offset
+**	makes the server redo the query for every page. A scrollable
+**	cursor is declared and opened once; ct_scroll_fetch() then moves
+**	it to the first, last, next or previous rows, or to an absolute
+**	or relative row number, and returns CS_CURSOR_ROWS rows from
+**	there in one round trip.
+**
+**	ex_cursor_open() declares a read only, insensitive scrollable
+**	cursor, sets CS_CURSOR_ROWS to the page size plus prefetch pages
+**	more, opens it and binds its columns to a columnar batch (see
+**	excolbatch.c) of that many rows. ex_cursor_fetch() takes the same
+**	scroll types as ct_scroll_fetch(), counted in pages for CS_NEXT
+**	and CS_PREV, and returns where the page is in the batch. A page
+**	that lies in the rows fetched last is served from them; only
+**	other pages cost a round trip, which fetches the window forward
+**	from the page, or, when moving back, so that the window ends with
+**	the page. Since the row numbers are kept, a reader can also pick
+**	up again from an absolute row.
+**
+**	ex_cursor_walk() runs a list of moves (CT_SCROLL_INDEX) and writes
+**	each page through a sink (see exsink.c).
+**
+** Routines Used
+** -------------
+**	ct_cmd_alloc, ct_cursor, ct_send, ct_results, ct_scroll_fetch,
+**	ct_cancel, ct_cmd_drop
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
+#include "excursor.h"
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_cursor_scroll(
+	EX_CURSOR *cursor,
+	CS_INT scrolltype,
+	CS_INT offset,
+	CS_INT base,
+	CS_INT page
+	);
+CS_STATIC CS_RETCODE ex_cursor_results(
+	CS_COMMAND *cmd
+	);
+
+/*
+** ex_cursor_open()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Declares and opens a scrollable cursor on a query and binds its
+**	columns. The cursor must be closed with ex_cursor_close(), even
+**	if this fails.
+**
+** Parameters:
+** 	cursor		- Cursor to open.
+** 	connection	- Connection the cursor lives on.
+** 	name		- Cursor name.
+** 	query		- Select statement.
+** 	pagerows	- Rows per page, 0 for EX_CURSOR_PAGE.
+** 	prefetch	- Pages fetched beyond the page asked for.
+** 	mode		- EX_BIND_CHAR or EX_BIND_NATIVE.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the cursor can't be opened or a window
+**	of its rows doesn't fit in EX_FETCH_MAXBYTES.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cursor_open(EX_CURSOR *cursor, CS_CONNECTION *connection, CS_CHAR *name,
+	       CS_CHAR *query, CS_INT pagerows, CS_INT prefetch, CS_INT mode)
+{
+	CS_RETCODE	retcode;
+	CS_INT		restype;
+
+	memset(cursor, 0, sizeof (EX_CURSOR));
+	ex_colbatch_init(&cursor->batch);
+	cursor->pagerows = (pagerows > 0) ? pagerows : EX_CURSOR_PAGE;
+	cursor->window = cursor->pagerows * (1 + MAX(prefetch, 0));
+	cursor->base = 1;
+	cursor->page = -cursor->pagerows;
+	strncpy(cursor->name, name, sizeof (cursor->name) - 1);
+
+	if ((retcode = ct_cmd_alloc(connection, &cursor->cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_cursor_open: ct_cmd_alloc() failed");
+		cursor->cmd = NULL;
+		return retcode;
+	}
+
+	/*
+	** Declare, size and open the cursor in one round trip.
+	*/
+	retcode = ct_cursor(cursor->cmd, CS_CURSOR_DECLARE, cursor->name,
+			CS_NULLTERM, query, CS_NULLTERM,
+			CS_SCROLL_INSENSITIVE | CS_READ_ONLY);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_cursor_open: ct_cursor(declare) failed");
+		return retcode;
+	}
+	retcode = ct_cursor(cursor->cmd, CS_CURSOR_ROWS, NULL, CS_UNUSED,
+			NULL, CS_UNUSED, cursor->window);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_cursor_open: ct_cursor(rows) failed");
+		return retcode;
+	}
+	retcode = ct_cursor(cursor->cmd, CS_CURSOR_OPEN, NULL, CS_UNUSED,
+			NULL, CS_UNUSED, CS_UNUSED);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_cursor_open: ct_cursor(open) failed");
+		return retcode;
+	}
+	if ((retcode = ct_send(cursor->cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_cursor_open: ct_send() failed");
+		return retcode;
+	}
+
+	/*
+	** The rows of the cursor stay pending after its result set comes
+	** back, for ct_scroll_fetch().
+	*/
+	while ((retcode = ct_results(cursor->cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    case CS_CURSOR_RESULT:
+			cursor->open = CS_TRUE;
+			retcode = ex_colbatch_bind(&cursor->batch, cursor->cmd,
+					mode, cursor->window, CS_TRUE);
+			if (retcode != CS_SUCCEED)
+			{
+				return retcode;
+			}
+			if (cursor->batch.capacity < cursor->window)
+			{
+				ex_error("ex_cursor_open: page and prefetch too large for the rows");
+				return CS_FAIL;
+			}
+			return CS_SUCCEED;
+
+		    default:
+			ex_error("ex_cursor_open: opening the cursor failed");
+			return CS_FAIL;
+		}
+	}
+
+	ex_error("ex_cursor_open: no cursor result");
+	return CS_FAIL;
+}
+
+/*
+** ex_cursor_fetch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Moves to a page and returns where it is in cursor->batch, going
+**	to the server only if the page isn't in the rows fetched last.
+**
+** Parameters:
+** 	cursor		- Open cursor.
+** 	scrolltype	- CS_FIRST, CS_LAST, CS_NEXT or CS_PREV (a page
+**			  on or back), CS_ABSOLUTE (offset is the row
+**			  number, negative from the end) or CS_RELATIVE
+**			  (offset rows on or back).
+** 	offset		- Row offset of CS_ABSOLUTE and CS_RELATIVE.
+** 	first		- Batch row of the page's first row.
+** 	count		- Rows of the page, fewer at the end.
+**
+** Returns:
+** 	CS_SUCCEED, CS_END_DATA if there is no row there, or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cursor_fetch(EX_CURSOR *cursor, CS_INT scrolltype, CS_INT offset,
+		CS_INT *first, CS_INT *count)
+{
+	CS_RETCODE	retcode;
+	CS_INT		cached = cursor->batch.numrows;
+	CS_INT		target;		/* window row of the page */
+	CS_INT		start;
+	CS_BOOL		known = CS_TRUE;
+
+	*first = 0;
+	*count = 0;
+	if (!cursor->open)
+	{
+		ex_error("ex_cursor_fetch: cursor isn't open");
+		return CS_FAIL;
+	}
+
+	switch ((int)scrolltype)
+	{
+	    case CS_FIRST:
+		known = (cursor->base > 0);
+		target = 1 - cursor->base;
+		break;
+
+	    case CS_NEXT:
+		target = cursor->page + cursor->pagerows;
+		break;
+
+	    case CS_PREV:
+		target = cursor->page - cursor->pagerows;
+		break;
+
+	    case CS_RELATIVE:
+		target = cursor->page + offset;
+		break;
+
+	    case CS_ABSOLUTE:
+		known = (cursor->base > 0 && offset > 0);
+		target = offset - cursor->base;
+		break;
+
+	    case CS_LAST:
+		known = CS_FALSE;
+		target = 0;
+		break;
+
+	    default:
+		ex_error("ex_cursor_fetch: unknown scroll type");
+		return CS_FAIL;
+	}
+
+	if (known)
+	{
+		/*
+		** The page is in the window, or the window reached the last
+		** row and the page starts in it.
+		*/
+		if (target >= 0 && target < cached
+			&& (target + cursor->pagerows <= cached
+				|| cached < cursor->window))
+		{
+			cursor->page = target;
+			cursor->hits++;
+			*first = target;
+			*count = MIN(cursor->pagerows, cached - target);
+			return CS_SUCCEED;
+		}
+
+		/*
+		** No rows before the first or, past a short window, after
+		** the last.
+		*/
+		if ((cursor->base > 0 && cursor->base + target < 1)
+			|| (cached > 0 && cached < cursor->window
+				&& target >= cached))
+		{
+			return CS_END_DATA;
+		}
+	}
+
+	/*
+	** One round trip. With the row numbers known the window is
+	** fetched by absolute row number, ending with the page when moving
+	** back so that the pages before it come with it.
+	*/
+	if (known && cursor->base > 0)
+	{
+		start = cursor->base + target;
+		if (target < cursor->page)
+		{
+			start = MAX(1, start - (cursor->window - cursor->pagerows));
+		}
+		retcode = ex_cursor_scroll(cursor, CS_ABSOLUTE, start, start,
+				cursor->base + target - start);
+	}
+	else if (scrolltype == CS_FIRST || scrolltype == CS_LAST
+		|| scrolltype == CS_ABSOLUTE)
+	{
+		start = 0;
+		if (scrolltype == CS_FIRST)
+		{
+			start = 1;
+		}
+		else if (scrolltype == CS_ABSOLUTE && offset > 0)
+		{
+			start = offset;
+		}
+		retcode = ex_cursor_scroll(cursor, scrolltype, offset, start, 0);
+	}
+	else
+	{
+		retcode = ex_cursor_scroll(cursor, CS_RELATIVE, target, 0, 0);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** CS_LAST fetches the last window; the page is its end.
+	*/
+	cached = cursor->batch.numrows;
+	if (scrolltype == CS_LAST)
+	{
+		cursor->page = MAX(0, cached - cursor->pagerows);
+	}
+	if (cursor->page < 0 || cursor->page >= cached)
+	{
+		return CS_END_DATA;
+	}
+	*first = cursor->page;
+	*count = MIN(cursor->pagerows, cached - cursor->page);
+	return CS_SUCCEED;
+}
+
+/*
+** ex_cursor_walk()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs a list of moves on a cursor and writes every page, after a
+**	single header, in a sink format. In EX_SINK_TEXT each page is
+**	preceded by the move; moves without rows are only reported.
+**
+** Parameters:
+** 	cursor		- Open cursor.
+** 	moves		- Moves: scroll type and, for CS_ABSOLUTE and
+**			  CS_RELATIVE, the offset.
+** 	nmoves		- Number of moves.
+** 	format		- EX_SINK_* format.
+** 	writer		- Where the pages go.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a fetch or the writer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cursor_walk(EX_CURSOR *cursor, CT_SCROLL_INDEX *moves, CS_INT nmoves,
+	       CS_INT format, EX_WRITER *writer)
+{
+	EX_SINK		sink;
+	CS_RETCODE	retcode;
+	CS_INT		first;
+	CS_INT		count;
+	CS_INT		i;
+
+	if ((retcode = ex_sink_begin(&sink, format, writer, &cursor->batch))
+			!= CS_SUCCEED)
+	{
+		(CS_VOID)ex_sink_end(&sink);
+		return retcode;
+	}
+
+	for (i = 0; i < nmoves && retcode == CS_SUCCEED; i++)
+	{
+		retcode = ex_cursor_fetch(cursor, moves[i].scrolltype,
+				moves[i].index, &first, &count);
+		if (retcode == CS_END_DATA)
+		{
+			if (format == EX_SINK_TEXT)
+			{
+				ex_writer_printf(writer, "\nMove %d: no rows.\n",
+					i + 1);
+			}
+			retcode = CS_SUCCEED;
+			continue;
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			break;
+		}
+		if (format == EX_SINK_TEXT)
+		{
+			ex_writer_printf(writer, "\nMove %d: %d rows from row %d.\n",
+				i + 1, count, (cursor->base > 0)
+					? cursor->base + first : 0);
+		}
+		retcode = ex_sink_range(&sink, &cursor->batch, first, count);
+	}
+
+	if (ex_sink_end(&sink) != CS_SUCCEED && retcode == CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+	return retcode;
+}
+
+/*
+** ex_cursor_close()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Closes and deallocates the cursor, and frees its batch and
+**	command.
+**
+** Parameters:
+** 	cursor		- Cursor, opened or not.
+** 	status		- Result of the use of the cursor; if it isn't
+**			  CS_SUCCEED the command is cancelled instead.
+**
+** Returns:
+** 	status, or the failure of closing the cursor.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_cursor_close(EX_CURSOR *cursor, CS_RETCODE status)
+{
+	CS_RETCODE	retcode = status;
+
+	if (cursor->cmd == NULL)
+	{
+		ex_colbatch_free(&cursor->batch);
+		return retcode;
+	}
+
+	/*
+	** Leave the pending rows, then close and deallocate the cursor.
+	*/
+	if (cursor->open && status == CS_SUCCEED)
+	{
+		if (ct_cancel(NULL, cursor->cmd, CS_CANCEL_CURRENT) != CS_SUCCEED
+			|| ex_cursor_results(cursor->cmd) != CS_SUCCEED
+			|| ct_cursor(cursor->cmd, CS_CURSOR_CLOSE, NULL, CS_UNUSED,
+				NULL, CS_UNUSED, CS_DEALLOC) != CS_SUCCEED
+			|| ct_send(cursor->cmd) != CS_SUCCEED
+			|| ex_cursor_results(cursor->cmd) != CS_SUCCEED)
+		{
+			ex_error("ex_cursor_close: closing the cursor failed");
+			retcode = CS_FAIL;
+		}
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		(CS_VOID)ct_cancel(NULL, cursor->cmd, CS_CANCEL_ALL);
+	}
+
+	(CS_VOID)ct_cmd_drop(cursor->cmd);
+	cursor->cmd = NULL;
+	cursor->open = CS_FALSE;
+	ex_colbatch_free(&cursor->batch);
+
+	return retcode;
+}
+
+/*
+** ex_cursor_scroll()
+**
+** Purpose:
+** 	Fetches a window with ct_scroll_fetch() and converts it to text.
+**	base and page are the row number of its first row (0 if unknown)
+**	and the window row of the page.
+*/
+
+CS_STATIC CS_RETCODE
+ex_cursor_scroll(EX_CURSOR *cursor, CS_INT scrolltype, CS_INT offset,
+		 CS_INT base, CS_INT page)
+{
+	CS_RETCODE	retcode;
+	CS_INT		rows_read = 0;
+
+	cursor->fetches++;
+	retcode = ct_scroll_fetch(cursor->cmd, scrolltype, offset, CS_TRUE,
+			&rows_read);
+
+	switch ((int)retcode)
+	{
+	    case CS_SUCCEED:
+	    case CS_END_DATA:
+		break;
+
+	    case CS_CURSOR_BEFORE_FIRST:
+	    case CS_CURSOR_AFTER_LAST:
+		rows_read = 0;
+		break;
+
+	    default:
+		ex_error("ex_cursor_scroll: ct_scroll_fetch() failed");
+		cursor->batch.numrows = 0;
+		return CS_FAIL;
+	}
+
+	cursor->batch.numrows = rows_read;
+	cursor->base = base;
+	cursor->page = page;
+
+	return ex_colbatch_text(&cursor->batch, cursor->cmd);
+}
+
+/*
+** ex_cursor_results()
+**
+** Purpose:
+** 	Reads the results of a cursor command to their end.
+*/
+
+CS_STATIC CS_RETCODE
+ex_cursor_results(CS_COMMAND *cmd)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_INT		restype;
+
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		if (restype == CS_CMD_FAIL)
+		{
+			query_code = CS_FAIL;
+		}
+		else if (restype != CS_CMD_SUCCEED && restype != CS_CMD_DONE)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+		}
+	}
+	if (retcode != CS_END_RESULTS)
+	{
+		query_code = CS_FAIL;
+	}
+	return query_code;
+}
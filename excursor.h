@@ -0,0 +1,75 @@
+/*
+** excursor.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the scrollable cursor reader in
+**	excursor.c. excolbatch.h must be included first.
+*/
+
+#ifndef EXCURSOR_H
+#define EXCURSOR_H
+
+/*
+** Default rows per page, and pages fetched ahead of the one asked for.
+*/
+#define EX_CURSOR_PAGE		20
+#define EX_CURSOR_PREFETCH	2
+
+/*
+** Largest number of rows per page.
+*/
+#define EX_CURSOR_MAX_PAGE	1000
+
+/*
+** A read only, insensitive scrollable cursor read a page at a time.
+** Each round trip fetches a window of CS_CURSOR_ROWS rows, the page
+** and prefetch pages more, into a columnar batch; pages inside the
+** window are then served without going to the server.
+*/
+typedef struct _ex_cursor
+{
+	CS_COMMAND	*cmd;
+	CS_CHAR		name[CS_MAX_NAME];
+	EX_COLBATCH	batch;		/* the window */
+	CS_INT		pagerows;
+	CS_INT		window;		/* CS_CURSOR_ROWS */
+	CS_INT		base;		/* row number of window row 0, 0 if
+					** unknown (after CS_LAST) */
+	CS_INT		page;		/* window row of the current page */
+	CS_BOOL		open;
+	CS_INT		fetches;	/* ct_scroll_fetch() round trips */
+	CS_INT		hits;		/* pages served from the window */
+} EX_CURSOR;
+
+/* excursor.c */
+extern CS_RETCODE CS_PUBLIC ex_cursor_open(
+	EX_CURSOR *cursor,
+	CS_CONNECTION *connection,
+	CS_CHAR *name,
+	CS_CHAR *query,
+	CS_INT pagerows,
+	CS_INT prefetch,
+	CS_INT mode
+	);
+extern CS_RETCODE CS_PUBLIC ex_cursor_fetch(
+	EX_CURSOR *cursor,
+	CS_INT scrolltype,
+	CS_INT offset,
+	CS_INT *first,
+	CS_INT *count
+	);
+extern CS_RETCODE CS_PUBLIC ex_cursor_walk(
+	EX_CURSOR *cursor,
+	CT_SCROLL_INDEX *moves,
+	CS_INT nmoves,
+	CS_INT format,
+	EX_WRITER *writer
+	);
+extern CS_RETCODE CS_PUBLIC ex_cursor_close(
+	EX_CURSOR *cursor,
+	CS_RETCODE status
+	);
+
+#endif /* EXCURSOR_H */
@@ -0,0 +1,389 @@
+/*
+** exevloop.c
+** ----------
+**
+** Description
+** -----------
+**	Readiness-based event loop over many Client-Library connections.
+**
+**	Every connection added to the loop is switched to CS_DEFER_IO, so
+**	its pending calls only make progress when ct_poll() is called for
+**	it. The loop asks Client-Library for the socket of each connection
+**	(CS_ENDPOINT), waits for any of them to become readable with
+**	epoll_wait(), and only then polls that connection; the completion
+**	callback runs the request's results loop (see exasync.c), which
+**	issues the next call. One thread serves all connections this way.
+**
+**	Client-Library may already hold the data of the next call in its
+**	own buffers when a call completes, in which case the socket does
+**	not become readable again. A connection is therefore polled until
+**	it reports nothing more to do, and every busy connection is polled
+**	once per tick regardless of readiness. Connections without an
+**	endpoint are always polled that way, and when epoll can't be used
+**	at all the loop falls back to ct_poll() on the whole context.
+**
+** Routines Used
+** -------------
+**	epoll_create1, epoll_ctl, epoll_wait, ct_poll, ct_con_props
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exevloop.h"
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_evloop_poll(
+	EX_EVCONN *evconn
+	);
+CS_STATIC CS_VOID ex_evloop_complete(
+	EX_EVCONN *evconn
+	);
+
+/*
+** ex_evloop_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up an empty loop. If epoll isn't available the loop still
+**	works, using ct_poll() alone.
+**
+** Parameters:
+** 	loop		- The loop.
+** 	context		- The context of the connections that will be added.
+**
+** Returns:
+** 	CS_SUCCEED
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_evloop_init(EX_EVLOOP *loop, CS_CONTEXT *context)
+{
+	memset(loop, 0, sizeof (EX_EVLOOP));
+	loop->context = context;
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0)
+	{
+		ex_error("ex_evloop_init: epoll_create1() failed, using ct_poll()");
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_evloop_add()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Adds an idle connection to the loop and switches it to
+**	CS_DEFER_IO.
+**
+** Parameters:
+** 	loop		- The loop.
+** 	evconn		- State of the connection in the loop, owned by the
+**			  caller until ex_evloop_cleanup().
+** 	connection	- The connection.
+** 	next		- Routine that starts the connection's requests.
+** 	userdata	- Stored in evconn->userdata.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the loop is full or the I/O mode
+**	can't be set.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_evloop_add(EX_EVLOOP *loop, EX_EVCONN *evconn, CS_CONNECTION *connection,
+	      EX_EVLOOP_FUNC next, CS_VOID *userdata)
+{
+	struct epoll_event	event;
+	CS_INT			fd;
+
+	if (loop->nconns == EX_EVLOOP_MAX_CONNS)
+	{
+		ex_error("ex_evloop_add: too many connections");
+		return CS_FAIL;
+	}
+
+	memset(evconn, 0, sizeof (EX_EVCONN));
+	evconn->connection = connection;
+	evconn->next = next;
+	evconn->userdata = userdata;
+	evconn->fd = -1;
+
+	if (ex_async_netio(connection, CS_DEFER_IO) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	if (loop->epfd >= 0 && ct_con_props(connection, CS_GET, CS_ENDPOINT,
+			&fd, CS_UNUSED, NULL) == CS_SUCCEED && fd >= 0)
+	{
+		memset(&event, 0, sizeof (event));
+		event.events = EPOLLIN;
+		event.data.ptr = evconn;
+		if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event) == 0)
+		{
+			evconn->fd = fd;
+		}
+		else
+		{
+			ex_error("ex_evloop_add: epoll_ctl() failed, polling the connection");
+		}
+	}
+
+	loop->conns[loop->nconns++] = evconn;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_evloop_run()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs the loop until every connection has run out of work. The
+**	requests completed and failed on each connection are counted in
+**	its EX_EVCONN.
+**
+** Parameters:
+** 	loop		- The loop.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if ct_poll() failed; connections that are
+**	still busy then have to be closed by the caller.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_evloop_run(EX_EVLOOP *loop)
+{
+	struct epoll_event	events[EX_EVLOOP_MAX_EVENTS];
+	EX_EVCONN		*evconn;
+	CS_CONNECTION		*compconn;
+	CS_COMMAND		*compcmd;
+	CS_INT			compid;
+	CS_RETCODE		compstatus;
+	CS_RETCODE		retcode;
+	CS_INT			active;
+	CS_INT			i;
+	int			n;
+
+	for (;;)
+	{
+		/*
+		** Give every idle connection its next request.
+		*/
+		active = 0;
+		for (i = 0; i < loop->nconns; i++)
+		{
+			evconn = loop->conns[i];
+			while (!evconn->finished && !evconn->busy)
+			{
+				retcode = (*evconn->next)(evconn);
+				if (retcode != CS_SUCCEED)
+				{
+					if (retcode != CS_END_DATA)
+					{
+						evconn->errors++;
+					}
+					evconn->finished = CS_TRUE;
+					break;
+				}
+				if (ex_async_done(&evconn->async))
+				{
+					ex_evloop_complete(evconn);
+					continue;
+				}
+				evconn->busy = CS_TRUE;
+				if (ex_evloop_poll(evconn) != CS_SUCCEED)
+				{
+					return CS_FAIL;
+				}
+			}
+			if (evconn->busy)
+			{
+				active++;
+			}
+		}
+		if (active == 0)
+		{
+			break;
+		}
+
+		/*
+		** Wait for a connection to become readable, and poll it.
+		*/
+		if (loop->epfd >= 0)
+		{
+			n = epoll_wait(loop->epfd, events, EX_EVLOOP_MAX_EVENTS,
+					EX_EVLOOP_TICK_MS);
+			if (n < 0 && errno != EINTR)
+			{
+				ex_error("ex_evloop_run: epoll_wait() failed, using ct_poll()");
+				(CS_VOID)close(loop->epfd);
+				loop->epfd = -1;
+				continue;
+			}
+
+			for (i = 0; i < n; i++)
+			{
+				evconn = (EX_EVCONN *)events[i].data.ptr;
+				if (evconn->busy && ex_evloop_poll(evconn) != CS_SUCCEED)
+				{
+					return CS_FAIL;
+				}
+			}
+
+			/*
+			** On a tick, or for connections epoll doesn't watch,
+			** poll without waiting for readiness.
+			*/
+			for (i = 0; i < loop->nconns; i++)
+			{
+				evconn = loop->conns[i];
+				if (evconn->busy && (n <= 0 || evconn->fd < 0)
+					&& ex_evloop_poll(evconn) != CS_SUCCEED)
+				{
+					return CS_FAIL;
+				}
+			}
+		}
+		else
+		{
+			retcode = ct_poll(loop->context, NULL, EX_EVLOOP_TICK_MS,
+					&compconn, &compcmd, &compid, &compstatus);
+			if (retcode != CS_SUCCEED && retcode != CS_TIMED_OUT
+				&& retcode != CS_QUIET)
+			{
+				ex_error("ex_evloop_run: ct_poll() failed");
+				return CS_FAIL;
+			}
+		}
+
+		/*
+		** Collect the requests that have completed.
+		*/
+		for (i = 0; i < loop->nconns; i++)
+		{
+			evconn = loop->conns[i];
+			if (evconn->busy && ex_async_done(&evconn->async))
+			{
+				ex_evloop_complete(evconn);
+			}
+		}
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_evloop_cleanup()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Takes every connection out of the loop and switches it back to
+**	CS_SYNC_IO. The connections themselves are left to the caller.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a connection still had a request in
+**	flight and was left in CS_DEFER_IO.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_evloop_cleanup(EX_EVLOOP *loop)
+{
+	EX_EVCONN	*evconn;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		i;
+
+	for (i = 0; i < loop->nconns; i++)
+	{
+		evconn = loop->conns[i];
+		if (loop->epfd >= 0 && evconn->fd >= 0)
+		{
+			(CS_VOID)epoll_ctl(loop->epfd, EPOLL_CTL_DEL, evconn->fd, NULL);
+		}
+		if (evconn->busy
+			|| ex_async_netio(evconn->connection, CS_SYNC_IO) != CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+
+	if (loop->epfd >= 0)
+	{
+		(CS_VOID)close(loop->epfd);
+	}
+	loop->epfd = -1;
+	loop->nconns = 0;
+
+	return retcode;
+}
+
+/*
+** ex_evloop_poll()
+**
+** Purpose:
+** 	Lets a busy connection make progress: polls it until its request
+**	is done or nothing more completes without waiting.
+*/
+
+CS_STATIC CS_RETCODE
+ex_evloop_poll(EX_EVCONN *evconn)
+{
+	CS_CONNECTION	*compconn;
+	CS_COMMAND	*compcmd;
+	CS_INT		compid;
+	CS_RETCODE	compstatus;
+	CS_RETCODE	retcode;
+
+	do
+	{
+		retcode = ct_poll(NULL, evconn->connection, 0, &compconn,
+				&compcmd, &compid, &compstatus);
+	} while (retcode == CS_SUCCEED && !ex_async_done(&evconn->async));
+
+	if (retcode != CS_SUCCEED && retcode != CS_TIMED_OUT
+		&& retcode != CS_QUIET)
+	{
+		ex_error("ex_evloop_poll: ct_poll() failed");
+		return CS_FAIL;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_evloop_complete()
+**
+** Purpose:
+** 	Counts a completed request and marks its connection idle.
+*/
+
+CS_STATIC CS_VOID
+ex_evloop_complete(EX_EVCONN *evconn)
+{
+	evconn->busy = CS_FALSE;
+	evconn->requests++;
+	if (evconn->async.status != CS_SUCCEED)
+	{
+		evconn->errors++;
+	}
+}
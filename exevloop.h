@@ -0,0 +1,77 @@
+/*
+** exevloop.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the connection event loop in exevloop.c.
+*/
+
+#ifndef EXEVLOOP_H
+#define EXEVLOOP_H
+
+#include "exasync.h"
+
+/*
+** Upper bound on the connections of one loop, the number of events
+** taken from epoll_wait() at a time, and how long (in milliseconds) the
+** loop waits for readiness before it polls every busy connection.
+*/
+#define EX_EVLOOP_MAX_CONNS	1024
+#define EX_EVLOOP_MAX_EVENTS	64
+#define EX_EVLOOP_TICK_MS	50
+
+typedef struct _ex_evconn EX_EVCONN;
+
+/*
+** Called whenever a connection of the loop is idle. It starts the next
+** request on evconn->async with ex_async_execute_cmd() or
+** ex_async_fetch_data() and returns CS_SUCCEED, whatever the request
+** itself returned. It returns CS_END_DATA when the connection has no
+** more work; any other value is an error that ends the connection.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_EVLOOP_FUNC)(
+	EX_EVCONN *evconn
+	);
+
+struct _ex_evconn
+{
+	CS_CONNECTION	*connection;
+	int		fd;		/* CS_ENDPOINT, -1 if unknown */
+	CS_BOOL		busy;		/* a request is in flight */
+	CS_BOOL		finished;	/* next() has no more work */
+	EX_ASYNC	async;
+	EX_EVLOOP_FUNC	next;
+	CS_VOID		*userdata;
+	CS_INT		requests;	/* requests completed */
+	CS_INT		errors;		/* requests that failed */
+};
+
+typedef struct _ex_evloop
+{
+	CS_CONTEXT	*context;
+	int		epfd;		/* -1 when falling back to ct_poll() */
+	CS_INT		nconns;
+	EX_EVCONN	*conns[EX_EVLOOP_MAX_CONNS];
+} EX_EVLOOP;
+
+/* exevloop.c */
+extern CS_RETCODE CS_PUBLIC ex_evloop_init(
+	EX_EVLOOP *loop,
+	CS_CONTEXT *context
+	);
+extern CS_RETCODE CS_PUBLIC ex_evloop_add(
+	EX_EVLOOP *loop,
+	EX_EVCONN *evconn,
+	CS_CONNECTION *connection,
+	EX_EVLOOP_FUNC next,
+	CS_VOID *userdata
+	);
+extern CS_RETCODE CS_PUBLIC ex_evloop_run(
+	EX_EVLOOP *loop
+	);
+extern CS_RETCODE CS_PUBLIC ex_evloop_cleanup(
+	EX_EVLOOP *loop
+	);
+
+#endif /* EXEVLOOP_H */
@@ -0,0 +1,1113 @@
+/*
+** exexport.c
+** ----------
+**
+** Description
+** -----------
+**	Binary columnar export in the Arrow IPC file format.
+**
+**	Result sets are written to a file laid out as described in
+**	exexport.h: a schema built from what ct_describe() returned, then
+**	per fetch a record batch whose body holds, per column, the
+**	validity bitmap, offsets and value buffers of an Arrow array,
+**	aligned, so that an Arrow reader can open the file, or map it and
+**	use the buffers in place instead of parsing text.
+**
+**	The message metadata and the footer are flatbuffers, which the
+**	EX_FB routines below build front to back: a table is laid out
+**	with room for its fields, and whatever it points to is appended
+**	after it, so that every offset points forward as flatbuffers
+**	require. A record batch's metadata has the same size whatever its
+**	values, so room for it is left before the body is written and it
+**	is filled in afterwards.
+**
+**	The file is written through a shared mapping that is grown as
+**	needed. Fixed width columns, bound natively in the fetch batch
+**	(see excolbatch.c), are copied into the mapping with one memcpy()
+**	per column and batch; other columns are packed from their text.
+**
+** Routines Used
+** -------------
+**	ct_cmd_alloc, ct_command, ct_send, ct_results, ct_cancel,
+**	ct_cmd_drop, mmap, ftruncate
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+#include "exexport.h"
+
+/*
+** Rounds _n up to a multiple of EX_EXPORT_ALIGN.
+*/
+#define EX_EXPORT_ROUND(_n) \
+	(((size_t)(_n) + EX_EXPORT_ALIGN - 1) & ~((size_t)EX_EXPORT_ALIGN - 1))
+
+/*
+** Arrow flatbuffer enums used here: the MessageHeader and Type union
+** members, and the FloatingPoint precisions.
+*/
+#define EX_FB_HEADER_SCHEMA	1
+#define EX_FB_HEADER_BATCH	3
+#define EX_FB_TYPE_INT		2
+#define EX_FB_TYPE_FLOAT	3
+#define EX_FB_TYPE_UTF8		5
+#define EX_FB_FLOAT_SINGLE	1
+#define EX_FB_FLOAT_DOUBLE	2
+
+/*
+** A flatbuffer being built. Positions are byte offsets into buf;
+** failed is set, and nothing more is stored, once buf can't grow.
+*/
+typedef struct _ex_fb
+{
+	unsigned char	*buf;
+	size_t		len;
+	size_t		size;
+	CS_BOOL		failed;
+} EX_FB;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_export_reserve(
+	EX_EXPORT *exp,
+	size_t len
+	);
+CS_STATIC CS_INT ex_export_type(
+	CS_DATAFMT *datafmt,
+	CS_INT *width
+	);
+CS_STATIC size_t ex_export_validity(
+	CS_CHAR *out,
+	EX_COLUMN_ARRAY *col,
+	CS_INT rows,
+	CS_BIGINT *nullcount
+	);
+CS_STATIC CS_RETCODE ex_export_message(
+	EX_EXPORT *exp,
+	EX_FB *fb,
+	size_t at,
+	size_t metalen
+	);
+CS_STATIC size_t ex_export_schema(
+	EX_FB *fb,
+	EX_EXPORT *exp
+	);
+CS_STATIC CS_VOID ex_export_batchmsg(
+	EX_FB *fb,
+	EX_EXPORT *exp,
+	CS_INT rows,
+	CS_BIGINT bodylen
+	);
+CS_STATIC size_t ex_fb_alloc(
+	EX_FB *fb,
+	size_t n,
+	size_t align
+	);
+CS_STATIC CS_VOID ex_fb_put(
+	EX_FB *fb,
+	size_t pos,
+	CS_UBIGINT value,
+	CS_INT n
+	);
+CS_STATIC CS_VOID ex_fb_ref(
+	EX_FB *fb,
+	size_t at,
+	size_t target
+	);
+CS_STATIC size_t ex_fb_table(
+	EX_FB *fb,
+	CS_INT nfields,
+	CS_INT *sizes,
+	size_t *fieldpos
+	);
+CS_STATIC size_t ex_fb_vector(
+	EX_FB *fb,
+	CS_INT count,
+	CS_INT elemsize,
+	CS_INT align
+	);
+CS_STATIC size_t ex_fb_string(
+	EX_FB *fb,
+	CS_CHAR *str
+	);
+
+/*
+** ex_export_open()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Creates, or truncates, an export file.
+**
+** Returns:
+** 	CS_SUCCEED or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_export_open(EX_EXPORT *exp, CS_CHAR *path)
+{
+	memset(exp, 0, sizeof (EX_EXPORT));
+	exp->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (exp->fd < 0)
+	{
+		ex_error("ex_export_open: open() failed");
+		return CS_FAIL;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_export_begin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts a result set bound into batch. The first one writes the
+**	file magic and the schema message; the following ones must have
+**	the same columns, since a file has one schema.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file can't grow or the result set
+**	doesn't match the schema.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_export_begin(EX_EXPORT *exp, EX_COLBATCH *batch)
+{
+	EX_EXPORT_FIELD		*field;
+	CS_DATAFMT		*fmt;
+	EX_FB			fb;
+	CS_RETCODE		retcode;
+	CS_INT			width;
+	CS_INT			i;
+
+	if (exp->numcols > 0)
+	{
+		if (batch->numcols != exp->numcols)
+		{
+			ex_error("ex_export_begin: result set doesn't match the schema");
+			return CS_FAIL;
+		}
+		for (i = 0; i < batch->numcols; i++)
+		{
+			if (ex_export_type(&batch->datafmt[i], &width)
+				!= exp->fields[i].type)
+			{
+				ex_error("ex_export_begin: result set doesn't match the schema");
+				return CS_FAIL;
+			}
+		}
+		return CS_SUCCEED;
+	}
+
+	exp->fields = (EX_EXPORT_FIELD *)calloc(batch->numcols,
+			sizeof (EX_EXPORT_FIELD));
+	exp->nodes = (CS_BIGINT *)calloc(2 * batch->numcols,
+			sizeof (CS_BIGINT));
+	exp->buffers = (CS_BIGINT *)calloc(2 * 3 * batch->numcols,
+			sizeof (CS_BIGINT));
+	if (exp->fields == NULL || exp->nodes == NULL || exp->buffers == NULL)
+	{
+		ex_error("ex_export_begin: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	exp->nbuffers = 0;
+	for (i = 0; i < batch->numcols; i++)
+	{
+		field = &exp->fields[i];
+		fmt = &batch->datafmt[i];
+		strncpy(field->name, fmt->name, EX_EXPORT_NAMELEN - 1);
+		field->type = ex_export_type(fmt, &field->width);
+		field->nullable = (fmt->status & CS_CANNULL) ? CS_TRUE : CS_FALSE;
+		exp->nbuffers += (field->type == EX_EXPORT_UTF8) ? 3 : 2;
+	}
+	exp->numcols = batch->numcols;
+
+	/*
+	** The magic, padded to 8 bytes, then the schema message.
+	*/
+	if (ex_export_reserve(exp, 8) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	memset(exp->map, 0, 8);
+	memcpy(exp->map, EX_EXPORT_MAGIC, strlen(EX_EXPORT_MAGIC));
+	exp->used = 8;
+
+	memset(&fb, 0, sizeof (fb));
+	ex_export_batchmsg(&fb, exp, -1, 0);
+	retcode = ex_export_message(exp, &fb, exp->used,
+			EX_EXPORT_ROUND(exp->used + 8 + fb.len) - exp->used);
+	if (retcode == CS_SUCCEED)
+	{
+		exp->used = EX_EXPORT_ROUND(exp->used + 8 + fb.len);
+	}
+	free(fb.buf);
+
+	return retcode;
+}
+
+/*
+** ex_export_rows()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends the rows of the last fetch into batch as a record batch.
+**	Columns that aren't fixed width are taken from their text, so
+**	ex_colbatch_text() must have been called.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the file can't grow.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_export_rows(EX_EXPORT *exp, EX_COLBATCH *batch)
+{
+	EX_EXPORT_FIELD		*field;
+	EX_EXPORT_BLOCK		*blocks;
+	EX_COLUMN_ARRAY		*col;
+	EX_FB			fb;
+	CS_CHAR			*body;
+	CS_CHAR			*value;
+	CS_INT			*offsets;
+	CS_BIGINT		*nodes = exp->nodes;
+	CS_BIGINT		*bufs = exp->buffers;
+	CS_INT			rows = batch->numrows;
+	CS_RETCODE		retcode;
+	size_t			metalen;
+	size_t			size;
+	size_t			off;
+	size_t			len;
+	CS_INT			r;
+	CS_INT			i;
+
+	if (rows == 0)
+	{
+		return CS_SUCCEED;
+	}
+
+	if (exp->batches == exp->maxblocks)
+	{
+		size = MAX(2 * exp->maxblocks, 64);
+		blocks = (EX_EXPORT_BLOCK *)realloc(exp->blocks,
+				size * sizeof (EX_EXPORT_BLOCK));
+		if (blocks == NULL)
+		{
+			ex_error("ex_export_rows: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		exp->blocks = blocks;
+		exp->maxblocks = size;
+	}
+
+	/*
+	** The metadata of a batch has the same size whatever its values,
+	** so it is measured with zeros and filled in once the body is
+	** written.
+	*/
+	memset(&fb, 0, sizeof (fb));
+	memset(nodes, 0, 2 * exp->numcols * sizeof (CS_BIGINT));
+	memset(bufs, 0, 2 * exp->nbuffers * sizeof (CS_BIGINT));
+	ex_export_batchmsg(&fb, exp, rows, 0);
+	metalen = EX_EXPORT_ROUND(exp->used + 8 + fb.len) - exp->used;
+	free(fb.buf);
+
+	/*
+	** Reserve for the worst case: every bitmap present and every
+	** string as long as its column allows.
+	*/
+	size = metalen;
+	for (i = 0; i < exp->numcols; i++)
+	{
+		field = &exp->fields[i];
+		size += EX_EXPORT_ROUND((rows + 7) / 8);
+		if (field->type == EX_EXPORT_UTF8)
+		{
+			col = EX_COLBATCH_TEXT(batch, i);
+			size += EX_EXPORT_ROUND((rows + 1) * sizeof (CS_INT));
+			size += EX_EXPORT_ROUND((size_t)rows * col->maxlength);
+		}
+		else
+		{
+			size += EX_EXPORT_ROUND((size_t)rows * field->width);
+		}
+	}
+	if (ex_export_reserve(exp, exp->used + size) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	body = exp->map + exp->used + metalen;
+	off = 0;
+	for (i = 0; i < exp->numcols; i++)
+	{
+		field = &exp->fields[i];
+		nodes[2 * i] = rows;
+
+		/*
+		** The bitmap is written in any case and dropped again when
+		** there are no NULLs.
+		*/
+		col = (field->type == EX_EXPORT_UTF8) ? EX_COLBATCH_TEXT(batch, i)
+			: &batch->columns[i];
+		len = ex_export_validity(body + off, col, rows, &nodes[2 * i + 1]);
+		bufs[0] = off;
+		if (nodes[2 * i + 1] > 0)
+		{
+			bufs[1] = len;
+			off += EX_EXPORT_ROUND(len);
+		}
+		bufs += 2;
+
+		if (field->type != EX_EXPORT_UTF8)
+		{
+			/*
+			** The bound array is already an Arrow value buffer.
+			*/
+			bufs[0] = off;
+			bufs[1] = (CS_BIGINT)rows * field->width;
+			memcpy(body + off, col->value, bufs[1]);
+			off += EX_EXPORT_ROUND(bufs[1]);
+			bufs += 2;
+			continue;
+		}
+
+		bufs[0] = off;
+		bufs[1] = (rows + 1) * sizeof (CS_INT);
+		offsets = (CS_INT *)(body + off);
+		off += EX_EXPORT_ROUND(bufs[1]);
+		bufs += 2;
+
+		bufs[0] = off;
+		offsets[0] = 0;
+		for (r = 0; r < rows; r++)
+		{
+			len = 0;
+			if (col->indicator[r] != CS_NULLDATA)
+			{
+				value = EX_ARRAY_VALUE(col, r);
+				len = strlen(value);
+				memcpy(body + off + offsets[r], value, len);
+			}
+			offsets[r + 1] = offsets[r] + len;
+		}
+		bufs[1] = offsets[rows];
+		off += EX_EXPORT_ROUND(bufs[1]);
+		bufs += 2;
+	}
+
+	memset(&fb, 0, sizeof (fb));
+	ex_export_batchmsg(&fb, exp, rows, off);
+	retcode = ex_export_message(exp, &fb, exp->used, metalen);
+	free(fb.buf);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	exp->blocks[exp->batches].offset = exp->used;
+	exp->blocks[exp->batches].metalen = metalen;
+	exp->blocks[exp->batches].bodylen = off;
+	exp->used += metalen + off;
+	exp->batches++;
+	exp->rows += rows;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_export_close()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Ends the file with the end of stream marker and the footer, which
+**	indexes the schema and record batches, cuts the file to what was
+**	written and closes it. A file without a schema gets no footer.
+**
+** Returns:
+** 	status, or CS_FAIL if the file couldn't be finished.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_export_close(EX_EXPORT *exp, CS_RETCODE status)
+{
+	EX_FB		fb;
+	CS_INT		sizes[4] = { 2, 4, 4, 4 };
+	size_t		fields[4];
+	size_t		footer;
+	size_t		vec;
+	size_t		at;
+	CS_BIGINT	i;
+
+	if (exp->map != NULL && exp->numcols > 0)
+	{
+		/*
+		** Footer { version, schema, dictionaries, recordBatches },
+		** the record batches as Block structs of 24 bytes.
+		*/
+		memset(&fb, 0, sizeof (fb));
+		(CS_VOID)ex_fb_alloc(&fb, 4, 4);
+		footer = ex_fb_table(&fb, 4, sizes, fields);
+		ex_fb_ref(&fb, 0, footer);
+		ex_fb_put(&fb, fields[0], EX_EXPORT_VERSION, 2);
+		ex_fb_ref(&fb, fields[1], ex_export_schema(&fb, exp));
+		ex_fb_ref(&fb, fields[2], ex_fb_vector(&fb, 0, 24, 8));
+		vec = ex_fb_vector(&fb, (CS_INT)exp->batches, 24, 8);
+		ex_fb_ref(&fb, fields[3], vec);
+		for (i = 0; i < exp->batches; i++)
+		{
+			at = vec + 4 + i * 24;
+			ex_fb_put(&fb, at, exp->blocks[i].offset, 8);
+			ex_fb_put(&fb, at + 8, exp->blocks[i].metalen, 4);
+			ex_fb_put(&fb, at + 16, exp->blocks[i].bodylen, 8);
+		}
+
+		if (fb.failed || ex_export_reserve(exp, exp->used + 8 + fb.len
+				+ 4 + strlen(EX_EXPORT_MAGIC)) != CS_SUCCEED)
+		{
+			ex_error("ex_export_close: the footer couldn't be written");
+			status = CS_FAIL;
+		}
+		else
+		{
+			/*
+			** End of stream: the continuation marker and a zero
+			** length.
+			*/
+			at = exp->used;
+			memset(exp->map + at, 0xff, 4);
+			memset(exp->map + at + 4, 0, 4);
+			memcpy(exp->map + at + 8, fb.buf, fb.len);
+			at += 8 + fb.len;
+			exp->map[at] = (CS_CHAR)(fb.len & 0xff);
+			exp->map[at + 1] = (CS_CHAR)((fb.len >> 8) & 0xff);
+			exp->map[at + 2] = (CS_CHAR)((fb.len >> 16) & 0xff);
+			exp->map[at + 3] = (CS_CHAR)((fb.len >> 24) & 0xff);
+			memcpy(exp->map + at + 4, EX_EXPORT_MAGIC,
+				strlen(EX_EXPORT_MAGIC));
+			exp->used = at + 4 + strlen(EX_EXPORT_MAGIC);
+		}
+		free(fb.buf);
+	}
+
+	if (exp->map != NULL)
+	{
+		if (munmap(exp->map, exp->mapsize) != 0)
+		{
+			ex_error("ex_export_close: munmap() failed");
+			status = CS_FAIL;
+		}
+		exp->map = NULL;
+	}
+	if (exp->fd >= 0)
+	{
+		if (ftruncate(exp->fd, exp->used) != 0)
+		{
+			ex_error("ex_export_close: ftruncate() failed");
+			status = CS_FAIL;
+		}
+		close(exp->fd);
+		exp->fd = -1;
+	}
+	free(exp->fields);
+	free(exp->nodes);
+	free(exp->buffers);
+	free(exp->blocks);
+	exp->fields = NULL;
+	exp->nodes = NULL;
+	exp->buffers = NULL;
+	exp->blocks = NULL;
+
+	return status;
+}
+
+/*
+** ex_export_query()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs a language command and exports its row results to path,
+**	EX_FETCH_ROWS rows per record batch, fixed width columns bound
+**	natively.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+** 	cmdbuf		- The command.
+** 	path		- Export file, created or truncated.
+** 	rows		- Set to the number of rows exported, may be NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the command or the export failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_export_query(CS_CONNECTION *connection, CS_CHAR *cmdbuf, CS_CHAR *path,
+		CS_BIGINT *rows)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_INT		restype;
+	CS_COMMAND	*cmd;
+	EX_COLBATCH	batch;
+	EX_EXPORT	exp;
+
+	if (ex_export_open(&exp, path) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_export_query: ct_cmd_alloc() failed");
+		return ex_export_close(&exp, retcode);
+	}
+	if ((retcode = ct_command(cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM,
+			CS_UNUSED)) != CS_SUCCEED
+		|| (retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_export_query: sending the command failed");
+		(CS_VOID)ct_cmd_drop(cmd);
+		return ex_export_close(&exp, retcode);
+	}
+
+	ex_colbatch_init(&batch);
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			if (ex_colbatch_bind(&batch, cmd, EX_BIND_NATIVE,
+					EX_FETCH_ROWS, CS_TRUE) != CS_SUCCEED
+				|| ex_export_begin(&exp, &batch) != CS_SUCCEED)
+			{
+				query_code = CS_FAIL;
+				break;
+			}
+			while ((retcode = ex_colbatch_fetch(&batch, cmd)) == CS_SUCCEED
+				|| retcode == CS_ROW_FAIL)
+			{
+				if (retcode == CS_ROW_FAIL)
+				{
+					ex_error("ex_export_query: row not fetched");
+				}
+				if (ex_colbatch_text(&batch, cmd) != CS_SUCCEED
+					|| ex_export_rows(&exp, &batch) != CS_SUCCEED)
+				{
+					query_code = CS_FAIL;
+					break;
+				}
+			}
+			if (query_code == CS_SUCCEED && retcode != CS_END_DATA)
+			{
+				ex_error("ex_export_query: ct_fetch() failed");
+				query_code = CS_FAIL;
+			}
+			break;
+
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    case CS_STATUS_RESULT:
+		    case CS_PARAM_RESULT:
+		    case CS_COMPUTE_RESULT:
+			/*
+			** Not part of the export.
+			*/
+			if (ct_cancel(NULL, cmd, CS_CANCEL_CURRENT) != CS_SUCCEED)
+			{
+				query_code = CS_FAIL;
+			}
+			break;
+
+		    default:
+			ex_error("ex_export_query: command failed");
+			query_code = CS_FAIL;
+			break;
+		}
+		if (query_code == CS_FAIL)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+			break;
+		}
+	}
+	ex_colbatch_free(&batch);
+
+	if (query_code == CS_SUCCEED && retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_export_query: ct_results() failed");
+		query_code = CS_FAIL;
+	}
+	if (ct_cmd_drop(cmd) != CS_SUCCEED)
+	{
+		query_code = CS_FAIL;
+	}
+
+	if (rows != NULL)
+	{
+		*rows = exp.rows;
+	}
+	return ex_export_close(&exp, query_code);
+}
+
+/*
+** ex_export_reserve()
+**
+** Purpose:
+** 	Makes sure the file, and its mapping, are at least len bytes,
+**	growing them by at least EX_EXPORT_GROW or doubling them.
+*/
+
+CS_STATIC CS_RETCODE
+ex_export_reserve(EX_EXPORT *exp, size_t len)
+{
+	size_t		size;
+	CS_CHAR		*map;
+
+	if (len <= exp->mapsize)
+	{
+		return CS_SUCCEED;
+	}
+
+	size = MAX(exp->mapsize * 2, exp->mapsize + EX_EXPORT_GROW);
+	size = MAX(size, len);
+	if (ftruncate(exp->fd, size) != 0)
+	{
+		ex_error("ex_export_reserve: ftruncate() failed");
+		return CS_FAIL;
+	}
+
+	/*
+	** What was written stays in the file, so the old mapping can go
+	** before the new one is made.
+	*/
+	if (exp->map != NULL)
+	{
+		(CS_VOID)munmap(exp->map, exp->mapsize);
+		exp->map = NULL;
+		exp->mapsize = 0;
+	}
+	map = (CS_CHAR *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			exp->fd, 0);
+	if (map == (CS_CHAR *)MAP_FAILED)
+	{
+		ex_error("ex_export_reserve: mmap() failed");
+		return CS_FAIL;
+	}
+	exp->map = map;
+	exp->mapsize = size;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_export_type()
+**
+** Purpose:
+** 	Export type and value width of a bound column: its own for the
+**	fixed width types bound natively, UTF8 for the rest.
+*/
+
+CS_STATIC CS_INT
+ex_export_type(CS_DATAFMT *datafmt, CS_INT *width)
+{
+	CS_INT		type;
+
+	switch ((int)datafmt->datatype)
+	{
+	    case CS_TINYINT_TYPE:
+	    case CS_BIT_TYPE:		type = EX_EXPORT_UINT8; *width = 1; break;
+	    case CS_SMALLINT_TYPE:	type = EX_EXPORT_INT16; *width = 2; break;
+	    case CS_INT_TYPE:		type = EX_EXPORT_INT32; *width = 4; break;
+	    case CS_BIGINT_TYPE:	type = EX_EXPORT_INT64; *width = 8; break;
+	    case CS_USMALLINT_TYPE:	type = EX_EXPORT_UINT16; *width = 2; break;
+	    case CS_UINT_TYPE:		type = EX_EXPORT_UINT32; *width = 4; break;
+	    case CS_UBIGINT_TYPE:	type = EX_EXPORT_UINT64; *width = 8; break;
+	    case CS_REAL_TYPE:		type = EX_EXPORT_FLOAT32; *width = 4; break;
+	    case CS_FLOAT_TYPE:		type = EX_EXPORT_FLOAT64; *width = 8; break;
+	    default:			type = EX_EXPORT_UTF8; *width = 0; break;
+	}
+
+	/*
+	** The bound array must hold the values back to back to be copied
+	** as a whole.
+	*/
+	if (type != EX_EXPORT_UTF8 && datafmt->maxlength != *width)
+	{
+		type = EX_EXPORT_UTF8;
+		*width = 0;
+	}
+
+	return type;
+}
+
+/*
+** ex_export_validity()
+**
+** Purpose:
+** 	Builds the validity bitmap of a column into out and counts its
+**	NULLs. Returns the bitmap length in bytes.
+*/
+
+CS_STATIC size_t
+ex_export_validity(CS_CHAR *out, EX_COLUMN_ARRAY *col, CS_INT rows,
+		   CS_BIGINT *nullcount)
+{
+	unsigned char	*bits = (unsigned char *)out;
+	size_t		len = (rows + 7) / 8;
+	CS_INT		r;
+
+	memset(bits, 0, len);
+	*nullcount = 0;
+	for (r = 0; r < rows; r++)
+	{
+		if (col->indicator[r] == CS_NULLDATA)
+		{
+			(*nullcount)++;
+		}
+		else
+		{
+			bits[r >> 3] |= (unsigned char)(1 << (r & 7));
+		}
+	}
+
+	return len;
+}
+
+/*
+** ex_export_message()
+**
+** Purpose:
+** 	Writes the framing and metadata of a message at offset at of the
+**	file: the continuation marker, the metadata length, the built
+**	flatbuffer and zeros up to metalen bytes, which the caller has
+**	reserved.
+*/
+
+CS_STATIC CS_RETCODE
+ex_export_message(EX_EXPORT *exp, EX_FB *fb, size_t at, size_t metalen)
+{
+	CS_UINT		len = (CS_UINT)(metalen - 8);
+
+	if (fb->failed || 8 + fb->len > metalen)
+	{
+		ex_error("ex_export_message: building the metadata failed");
+		return CS_FAIL;
+	}
+	if (ex_export_reserve(exp, at + metalen) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+
+	memset(exp->map + at, 0xff, 4);
+	exp->map[at + 4] = (CS_CHAR)(len & 0xff);
+	exp->map[at + 5] = (CS_CHAR)((len >> 8) & 0xff);
+	exp->map[at + 6] = (CS_CHAR)((len >> 16) & 0xff);
+	exp->map[at + 7] = (CS_CHAR)((len >> 24) & 0xff);
+	memcpy(exp->map + at + 8, fb->buf, fb->len);
+	memset(exp->map + at + 8 + fb->len, 0, metalen - 8 - fb->len);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_export_schema()
+**
+** Purpose:
+** 	Appends the Schema table of the export to a flatbuffer and
+**	returns its position: Schema { endianness, fields }, and for
+**	each column Field { name, nullable, type_type, type, dictionary,
+**	children } with an Int, FloatingPoint or Utf8 type and no
+**	children.
+*/
+
+CS_STATIC size_t
+ex_export_schema(EX_FB *fb, EX_EXPORT *exp)
+{
+	EX_EXPORT_FIELD	*field;
+	CS_INT		sizes[6] = { 4, 1, 1, 4, 0, 4 };
+	CS_INT		schemasizes[2] = { 2, 4 };
+	CS_INT		intsizes[2] = { 4, 1 };
+	CS_INT		floatsizes[1] = { 2 };
+	CS_INT		one = 1;
+	size_t		schemafields[2];
+	size_t		fields[6];
+	size_t		type[2];
+	size_t		schema;
+	size_t		vec;
+	size_t		pos;
+	CS_INT		i;
+
+	schema = ex_fb_table(fb, 2, schemasizes, schemafields);
+	ex_fb_put(fb, schemafields[0], (*(char *)&one == 1) ? 0 : 1, 2);
+	vec = ex_fb_vector(fb, exp->numcols, 4, 4);
+	ex_fb_ref(fb, schemafields[1], vec);
+
+	for (i = 0; i < exp->numcols; i++)
+	{
+		field = &exp->fields[i];
+		pos = ex_fb_table(fb, 6, sizes, fields);
+		ex_fb_ref(fb, vec + 4 + 4 * i, pos);
+		ex_fb_ref(fb, fields[0], ex_fb_string(fb, field->name));
+		ex_fb_put(fb, fields[1], field->nullable ? 1 : 0, 1);
+
+		switch ((int)field->type)
+		{
+		    case EX_EXPORT_FLOAT32:
+		    case EX_EXPORT_FLOAT64:
+			ex_fb_put(fb, fields[2], EX_FB_TYPE_FLOAT, 1);
+			pos = ex_fb_table(fb, 1, floatsizes, type);
+			ex_fb_put(fb, type[0], (field->type == EX_EXPORT_FLOAT32)
+				? EX_FB_FLOAT_SINGLE : EX_FB_FLOAT_DOUBLE, 2);
+			break;
+
+		    case EX_EXPORT_UTF8:
+			ex_fb_put(fb, fields[2], EX_FB_TYPE_UTF8, 1);
+			pos = ex_fb_table(fb, 0, NULL, type);
+			break;
+
+		    default:
+			ex_fb_put(fb, fields[2], EX_FB_TYPE_INT, 1);
+			pos = ex_fb_table(fb, 2, intsizes, type);
+			ex_fb_put(fb, type[0], 8 * field->width, 4);
+			ex_fb_put(fb, type[1], (field->type == EX_EXPORT_INT16
+				|| field->type == EX_EXPORT_INT32
+				|| field->type == EX_EXPORT_INT64) ? 1 : 0, 1);
+			break;
+		}
+		ex_fb_ref(fb, fields[3], pos);
+		ex_fb_ref(fb, fields[5], ex_fb_vector(fb, 0, 4, 4));
+	}
+
+	return schema;
+}
+
+/*
+** ex_export_batchmsg()
+**
+** Purpose:
+** 	Builds the metadata of a record batch message from the node and
+**	buffer arrays of the export: Message { version, header_type,
+**	header, bodyLength } with RecordBatch { length, nodes, buffers }
+**	as its header. A Schema message is built the same way by
+**	ex_export_begin(), with rows < 0.
+*/
+
+CS_STATIC CS_VOID
+ex_export_batchmsg(EX_FB *fb, EX_EXPORT *exp, CS_INT rows, CS_BIGINT bodylen)
+{
+	CS_INT		msgsizes[4] = { 2, 1, 4, 8 };
+	CS_INT		batchsizes[3] = { 8, 4, 4 };
+	size_t		msgfields[4];
+	size_t		batchfields[3];
+	size_t		msg;
+	size_t		pos;
+	CS_INT		i;
+
+	(CS_VOID)ex_fb_alloc(fb, 4, 4);
+	msg = ex_fb_table(fb, 4, msgsizes, msgfields);
+	ex_fb_ref(fb, 0, msg);
+	ex_fb_put(fb, msgfields[0], EX_EXPORT_VERSION, 2);
+	ex_fb_put(fb, msgfields[3], bodylen, 8);
+
+	if (rows < 0)
+	{
+		ex_fb_put(fb, msgfields[1], EX_FB_HEADER_SCHEMA, 1);
+		ex_fb_ref(fb, msgfields[2], ex_export_schema(fb, exp));
+		return;
+	}
+
+	ex_fb_put(fb, msgfields[1], EX_FB_HEADER_BATCH, 1);
+	pos = ex_fb_table(fb, 3, batchsizes, batchfields);
+	ex_fb_ref(fb, msgfields[2], pos);
+	ex_fb_put(fb, batchfields[0], rows, 8);
+
+	/*
+	** FieldNode and Buffer are both structs of two longs.
+	*/
+	pos = ex_fb_vector(fb, exp->numcols, 16, 8);
+	ex_fb_ref(fb, batchfields[1], pos);
+	for (i = 0; i < 2 * exp->numcols; i++)
+	{
+		ex_fb_put(fb, pos + 4 + 8 * i, exp->nodes[i], 8);
+	}
+	pos = ex_fb_vector(fb, exp->nbuffers, 16, 8);
+	ex_fb_ref(fb, batchfields[2], pos);
+	for (i = 0; i < 2 * exp->nbuffers; i++)
+	{
+		ex_fb_put(fb, pos + 4 + 8 * i, exp->buffers[i], 8);
+	}
+}
+
+/*
+** ex_fb_alloc()
+**
+** Purpose:
+** 	Appends n zero bytes to a flatbuffer, aligned to align bytes
+**	from its start, and returns their position.
+*/
+
+CS_STATIC size_t
+ex_fb_alloc(EX_FB *fb, size_t n, size_t align)
+{
+	unsigned char	*buf;
+	size_t		pos;
+	size_t		size;
+
+	pos = (fb->len + align - 1) & ~(align - 1);
+	if (!fb->failed && pos + n > fb->size)
+	{
+		size = MAX(2 * fb->size, MAX(pos + n, 1024));
+		if ((buf = (unsigned char *)realloc(fb->buf, size)) == NULL)
+		{
+			ex_error("ex_fb_alloc: realloc() failed");
+			fb->failed = CS_TRUE;
+		}
+		else
+		{
+			fb->buf = buf;
+			fb->size = size;
+		}
+	}
+	if (!fb->failed)
+	{
+		memset(fb->buf + fb->len, 0, pos + n - fb->len);
+	}
+	fb->len = pos + n;
+
+	return pos;
+}
+
+/*
+** ex_fb_put()
+**
+** Purpose:
+** 	Stores an n byte little endian scalar, as flatbuffers keep them.
+*/
+
+CS_STATIC CS_VOID
+ex_fb_put(EX_FB *fb, size_t pos, CS_UBIGINT value, CS_INT n)
+{
+	CS_INT		i;
+
+	for (i = 0; !fb->failed && i < n; i++)
+	{
+		fb->buf[pos + i] = (unsigned char)(value >> (8 * i));
+	}
+}
+
+/*
+** ex_fb_ref()
+**
+** Purpose:
+** 	Points the offset field at at to target, which lies after it.
+*/
+
+CS_STATIC CS_VOID
+ex_fb_ref(EX_FB *fb, size_t at, size_t target)
+{
+	ex_fb_put(fb, at, (CS_UBIGINT)(target - at), 4);
+}
+
+/*
+** ex_fb_table()
+**
+** Purpose:
+** 	Appends a table whose fields are sizes[i] bytes each, 0 for a
+**	field left out, preceded by its vtable. Sets fieldpos[i] to the
+**	position of each field and returns the position of the table.
+*/
+
+CS_STATIC size_t
+ex_fb_table(EX_FB *fb, CS_INT nfields, CS_INT *sizes, size_t *fieldpos)
+{
+	size_t		vtable;
+	size_t		table;
+	CS_INT		i;
+
+	vtable = ex_fb_alloc(fb, 4 + 2 * nfields, 2);
+	table = ex_fb_alloc(fb, 4, 8);
+	for (i = 0; i < nfields; i++)
+	{
+		fieldpos[i] = (sizes[i] > 0) ? ex_fb_alloc(fb, sizes[i], sizes[i])
+				: 0;
+	}
+
+	ex_fb_put(fb, vtable, 4 + 2 * nfields, 2);
+	ex_fb_put(fb, vtable + 2, fb->len - table, 2);
+	for (i = 0; i < nfields; i++)
+	{
+		ex_fb_put(fb, vtable + 4 + 2 * i,
+			(fieldpos[i] > 0) ? fieldpos[i] - table : 0, 2);
+	}
+	ex_fb_put(fb, table, (CS_UBIGINT)(table - vtable), 4);
+
+	return table;
+}
+
+/*
+** ex_fb_vector()
+**
+** Purpose:
+** 	Appends a vector of count elements of elemsize bytes, the
+**	elements aligned to align bytes, and returns the position of its
+**	length; the elements follow it.
+*/
+
+CS_STATIC size_t
+ex_fb_vector(EX_FB *fb, CS_INT count, CS_INT elemsize, CS_INT align)
+{
+	size_t		pos;
+
+	while ((fb->len + 4) % align != 0)
+	{
+		(CS_VOID)ex_fb_alloc(fb, 1, 1);
+	}
+	pos = ex_fb_alloc(fb, 4 + (size_t)count * elemsize, 4);
+	ex_fb_put(fb, pos, count, 4);
+
+	return pos;
+}
+
+/*
+** ex_fb_string()
+**
+** Purpose:
+** 	Appends a string and returns its position.
+*/
+
+CS_STATIC size_t
+ex_fb_string(EX_FB *fb, CS_CHAR *str)
+{
+	size_t		len = strlen(str);
+	size_t		pos;
+
+	pos = ex_fb_alloc(fb, 4 + len + 1, 4);
+	ex_fb_put(fb, pos, len, 4);
+	if (!fb->failed)
+	{
+		memcpy(fb->buf + pos + 4, str, len);
+	}
+
+	return pos;
+}
@@ -0,0 +1,134 @@
+/*
+** exexport.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the Arrow IPC file export in
+**	exexport.c.
+*/
+
+#ifndef EXEXPORT_H
+#define EXEXPORT_H
+
+/*
+** Every message, and so every record batch body, starts at a multiple
+** of EX_EXPORT_ALIGN bytes from the start of the file, and every
+** buffer at a multiple of it from the start of its body, as Arrow
+** recommends. The file grows EX_EXPORT_GROW bytes at a time at least.
+*/
+#define EX_EXPORT_ALIGN		64
+#define EX_EXPORT_GROW		(16 * 1024 * 1024)
+
+/*
+** Arrow IPC file framing: the magic that opens and closes the file
+** (padded to 8 bytes at the start), the continuation marker before
+** each message, and the metadata version written (V5).
+*/
+#define EX_EXPORT_MAGIC		"ARROW1"
+#define EX_EXPORT_CONTINUE	0xFFFFFFFF
+#define EX_EXPORT_VERSION	4
+#define EX_EXPORT_NAMELEN	256
+
+/*
+** Column types, each an Arrow type of the same memory layout. Fixed
+** width values are stored as CT-Lib fetched them (tinyint is
+** unsigned, bit is one byte a value); everything else is stored as
+** the UTF-8 text ex_fetch_data() would display.
+*/
+#define EX_EXPORT_UINT8		1	/* Arrow UInt8: tinyint, bit */
+#define EX_EXPORT_INT16		2	/* Arrow Int16: smallint */
+#define EX_EXPORT_INT32		3	/* Arrow Int32: int */
+#define EX_EXPORT_INT64		4	/* Arrow Int64: bigint */
+#define EX_EXPORT_UINT16	5	/* Arrow UInt16: unsigned smallint */
+#define EX_EXPORT_UINT32	6	/* Arrow UInt32: unsigned int */
+#define EX_EXPORT_UINT64	7	/* Arrow UInt64: unsigned bigint */
+#define EX_EXPORT_FLOAT32	8	/* Arrow Float32: real */
+#define EX_EXPORT_FLOAT64	9	/* Arrow Float64: float */
+#define EX_EXPORT_UTF8		10	/* Arrow Utf8: everything else */
+
+/*
+** File layout, the Arrow IPC file format:
+**
+**	"ARROW1" and two bytes of padding
+**	a Schema message
+**	a RecordBatch message per fetch
+**	the end of stream marker
+**	the Footer, its length as an int32, and "ARROW1"
+**
+** A message is the continuation marker, the length of its flatbuffer
+** metadata as an int32, the metadata, padding, and the body. The body
+** of a record batch holds the buffers of an Arrow array per column: a
+** validity bitmap (empty when the column has no NULLs), then for fixed
+** width types the values, for UTF8 rows + 1 int32 offsets and the
+** data. Values are in host byte order, which the schema records, so a
+** reader can map the file and use the buffers where they are.
+*/
+
+/*
+** A column of the schema.
+*/
+typedef struct _ex_export_field
+{
+	CS_CHAR		name[EX_EXPORT_NAMELEN];	/* null terminated */
+	CS_INT		type;		/* EX_EXPORT_* */
+	CS_INT		width;		/* bytes a value, 0 for UTF8 */
+	CS_BOOL		nullable;
+} EX_EXPORT_FIELD;
+
+/*
+** Where a record batch is in the file, for the footer.
+*/
+typedef struct _ex_export_block
+{
+	CS_BIGINT	offset;		/* of the message */
+	CS_INT		metalen;	/* prefix, metadata and padding */
+	CS_BIGINT	bodylen;
+} EX_EXPORT_BLOCK;
+
+/*
+** An export file being written. The file is mapped and the buffers
+** are copied into the mapping straight from the fetch batch.
+*/
+typedef struct _ex_export
+{
+	int		fd;
+	CS_CHAR		*map;
+	size_t		mapsize;
+	size_t		used;		/* bytes of the file written */
+	CS_INT		numcols;	/* 0 until the schema is written */
+	EX_EXPORT_FIELD	*fields;
+	CS_BIGINT	*nodes;		/* length and null count a column */
+	CS_BIGINT	*buffers;	/* offset and length a buffer */
+	CS_INT		nbuffers;
+	EX_EXPORT_BLOCK	*blocks;
+	CS_BIGINT	maxblocks;
+	CS_BIGINT	batches;
+	CS_BIGINT	rows;
+} EX_EXPORT;
+
+/* exexport.c */
+extern CS_RETCODE CS_PUBLIC ex_export_open(
+	EX_EXPORT *exp,
+	CS_CHAR *path
+	);
+extern CS_RETCODE CS_PUBLIC ex_export_begin(
+	EX_EXPORT *exp,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_export_rows(
+	EX_EXPORT *exp,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_export_close(
+	EX_EXPORT *exp,
+	CS_RETCODE status
+	);
+extern CS_RETCODE CS_PUBLIC ex_export_query(
+	CS_CONNECTION *connection,
+	CS_CHAR *cmdbuf,
+	CS_CHAR *path,
+	CS_BIGINT *rows
+	);
+
+#endif /* EXEXPORT_H */
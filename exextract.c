@@ -0,0 +1,659 @@
+/*
+** exextract.c
+** -----------
+**
+** Description
+** -----------
+**	Parallel, range partitioned table extraction.
+**
+**	Selecting a whole table over one connection is bounded by what a
+**	single connection, and a single server engine, can deliver.
+**	ex_extract_table() probes the smallest and largest value of an
+**	integer key column, splits that range into one partition per
+**	connection and selects each partition on its own connection and
+**	native thread, fetching EX_FETCH_ROWS rows at a time into a
+**	columnar batch (see excolbatch.c).
+**
+**	All partitions write to one sink (see exsink.c). Each thread
+**	formats its rows into a writer in memory and hands whole fetches
+**	to the shared writer, so rows of different partitions never mix
+**	within a line. Unordered, a partition's rows go out as they are
+**	fetched. Ordered, each partition is also selected in key order
+**	and held back until the partitions before it are done, so the
+**	output is in key order; later partitions are then buffered in
+**	memory while they wait their turn.
+**
+**	The first partition also takes the rows whose key is NULL, or
+**	below the probed range, and the last those above it, so rows
+**	inserted after the probe are not missed.
+**
+** Routines Used
+** -------------
+**	ct_cmd_alloc, ct_command, ct_send, ct_results, ct_bind, ct_fetch,
+**	ct_cancel, ct_cmd_drop, pthread_create, pthread_join
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
+#include "exextract.h"
+
+/*
+** State shared by the partitions of an extraction.
+*/
+typedef struct _ex_extract
+{
+	pthread_mutex_t	lock;
+	pthread_cond_t	turn_done;
+	CS_INT		turn;		/* ordered: partition writing now */
+	CS_BOOL		ordered;
+	CS_INT		format;
+	EX_WRITER	*writer;
+} EX_EXTRACT;
+
+/*
+** One partition and its thread.
+*/
+typedef struct _ex_extract_part
+{
+	EX_EXTRACT	*ext;
+	CS_INT		part;
+	CS_CONNECTION	*connection;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	EX_WRITER	out;		/* in memory */
+	pthread_t	thread;
+	CS_RETCODE	status;
+	CS_BIGINT	rows;
+	CS_BIGINT	usecs;
+} EX_EXTRACT_PART;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_extract_probe(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_CHAR *keycol,
+	CS_BIGINT *lo,
+	CS_BIGINT *hi,
+	CS_BOOL *empty
+	);
+CS_STATIC CS_RETCODE ex_extract_header(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_INT format,
+	EX_WRITER *writer
+	);
+CS_STATIC CS_VOID *ex_extract_worker(
+	CS_VOID *arg
+	);
+CS_STATIC CS_RETCODE ex_extract_fetch(
+	EX_EXTRACT_PART *p,
+	CS_COMMAND *cmd,
+	EX_COLBATCH *batch
+	);
+CS_STATIC CS_VOID ex_extract_emit(
+	EX_EXTRACT_PART *p,
+	CS_BOOL last
+	);
+
+/*
+** ex_extract_table()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Selects every row of a table, in nparts key ranges selected at
+**	the same time on as many connections and threads, and writes
+**	them to one writer in the given format.
+**
+** Parameters:
+** 	connections	- nparts connections, each used by one thread
+**			  only while the extraction runs.
+** 	nparts		- Number of partitions, 1 to EX_EXTRACT_MAX_PARTS;
+**			  fewer are used when the key range is smaller.
+** 	table		- Table name, qualified as needed.
+** 	keycol		- Integer column to split the table on.
+** 	format		- EX_SINK_* format of the output.
+** 	writer		- Where the output goes; used by all threads, so
+**			  it must be shared (see ex_writer_stdout()).
+** 	ordered		- CS_TRUE to write the rows in key order.
+** 	stats		- Filled in, may be NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the probe or a partition failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_extract_table(CS_CONNECTION **connections, CS_INT nparts, CS_CHAR *table,
+		 CS_CHAR *keycol, CS_INT format, EX_WRITER *writer,
+		 CS_BOOL ordered, EX_EXTRACT_STATS *stats)
+{
+	EX_EXTRACT	ext;
+	EX_EXTRACT_PART	*parts;
+	CS_RETCODE	retcode;
+	CS_BIGINT	lo = 0;
+	CS_BIGINT	hi = 0;
+	CS_BIGINT	span;
+	CS_BIGINT	step;
+	CS_BIGINT	rem;
+	CS_BIGINT	bound;
+	CS_BIGINT	next;
+	CS_BIGINT	start;
+	CS_BOOL		empty;
+	CS_INT		started;
+	CS_INT		i;
+
+	if (nparts < 1 || nparts > EX_EXTRACT_MAX_PARTS)
+	{
+		ex_error("ex_extract_table: partition count out of range");
+		return CS_FAIL;
+	}
+
+	start = ex_usecs();
+	if (stats != NULL)
+	{
+		memset(stats, 0, sizeof (EX_EXTRACT_STATS));
+	}
+	retcode = ex_extract_probe(connections[0], table, keycol, &lo, &hi, &empty);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** The header goes out before any partition runs, so that it comes
+	** first whichever partition writes first; the partitions leave it
+	** out.
+	*/
+	retcode = ex_extract_header(connections[0], table, format, writer);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	/*
+	** Split [lo, hi] into nparts ranges that differ in size by one at
+	** most; a table without keys is one partition.
+	*/
+	span = empty ? 1 : hi - lo + 1;
+	if (span < nparts)
+	{
+		nparts = (CS_INT)span;
+	}
+	step = span / nparts;
+	rem = span % nparts;
+
+	parts = (EX_EXTRACT_PART *)calloc(nparts, sizeof (EX_EXTRACT_PART));
+	if (parts == NULL)
+	{
+		ex_error("ex_extract_table: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	memset(&ext, 0, sizeof (ext));
+	pthread_mutex_init(&ext.lock, NULL);
+	pthread_cond_init(&ext.turn_done, NULL);
+	ext.ordered = ordered;
+	ext.format = format;
+	ext.writer = writer;
+
+	bound = lo;
+	for (i = 0; i < nparts; i++)
+	{
+		next = bound + step + ((i < rem) ? 1 : 0);
+		parts[i].ext = &ext;
+		parts[i].part = i;
+		parts[i].connection = connections[i];
+
+		if (nparts == 1)
+		{
+			sprintf(parts[i].cmdbuf, "select * from %s", table);
+		}
+		else if (i == 0)
+		{
+			sprintf(parts[i].cmdbuf,
+				"select * from %s where %s < %lld or %s is null",
+				table, keycol, (long long)next, keycol);
+		}
+		else if (i == nparts - 1)
+		{
+			sprintf(parts[i].cmdbuf, "select * from %s where %s >= %lld",
+				table, keycol, (long long)bound);
+		}
+		else
+		{
+			sprintf(parts[i].cmdbuf,
+				"select * from %s where %s >= %lld and %s < %lld",
+				table, keycol, (long long)bound, keycol,
+				(long long)next);
+		}
+		if (ordered)
+		{
+			strcat(parts[i].cmdbuf, " order by ");
+			strcat(parts[i].cmdbuf, keycol);
+		}
+		bound = next;
+	}
+
+	/*
+	** Run the partitions.
+	*/
+	for (started = 0; started < nparts; started++)
+	{
+		if (ex_writer_open(&parts[started].out, -1, EX_WRITER_BUFSIZE)
+				!= CS_SUCCEED
+			|| pthread_create(&parts[started].thread, NULL,
+				ex_extract_worker, &parts[started]) != 0)
+		{
+			ex_error("ex_extract_table: can't start a partition");
+			ex_writer_close(&parts[started].out);
+			retcode = CS_FAIL;
+			break;
+		}
+	}
+
+	/*
+	** If a thread couldn't be started, the ones after it never take
+	** their turn; let the running ones finish anyway.
+	*/
+	if (started < nparts)
+	{
+		pthread_mutex_lock(&ext.lock);
+		ext.ordered = CS_FALSE;
+		pthread_cond_broadcast(&ext.turn_done);
+		pthread_mutex_unlock(&ext.lock);
+	}
+
+	for (i = 0; i < started; i++)
+	{
+		(CS_VOID)pthread_join(parts[i].thread, NULL);
+		ex_writer_close(&parts[i].out);
+		if (parts[i].status != CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+	if (ex_writer_flush(writer) != CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+
+	if (stats != NULL)
+	{
+		stats->nparts = nparts;
+		stats->lo = lo;
+		stats->hi = hi;
+		for (i = 0; i < started; i++)
+		{
+			stats->rows += parts[i].rows;
+			stats->partrows[i] = parts[i].rows;
+			stats->parttime[i] = parts[i].usecs;
+		}
+		stats->elapsed = ex_usecs() - start;
+	}
+
+	pthread_cond_destroy(&ext.turn_done);
+	pthread_mutex_destroy(&ext.lock);
+	free(parts);
+
+	return retcode;
+}
+
+/*
+** ex_extract_probe()
+**
+** Purpose:
+** 	Gets the smallest and largest key of the table. empty is set
+**	when the table has no non-NULL key.
+*/
+
+CS_STATIC CS_RETCODE
+ex_extract_probe(CS_CONNECTION *connection, CS_CHAR *table, CS_CHAR *keycol,
+		 CS_BIGINT *lo, CS_BIGINT *hi, CS_BOOL *empty)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_COMMAND	*cmd;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	CS_DATAFMT	datafmt;
+	CS_SMALLINT	loind = CS_NULLDATA;
+	CS_SMALLINT	hiind = CS_NULLDATA;
+	CS_INT		restype;
+	CS_INT		rows_read;
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_extract_probe: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	sprintf(cmdbuf, "select min(%s), max(%s) from %s", keycol, keycol, table);
+	if ((retcode = ct_command(cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM,
+			CS_UNUSED)) != CS_SUCCEED
+		|| (retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_extract_probe: sending the probe failed");
+		(CS_VOID)ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	memset(&datafmt, 0, sizeof (datafmt));
+	datafmt.datatype = CS_BIGINT_TYPE;
+	datafmt.format = CS_FMT_UNUSED;
+	datafmt.maxlength = sizeof (CS_BIGINT);
+	datafmt.count = 1;
+
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			if (ct_bind(cmd, 1, &datafmt, lo, NULL, &loind) != CS_SUCCEED
+				|| ct_bind(cmd, 2, &datafmt, hi, NULL, &hiind)
+					!= CS_SUCCEED)
+			{
+				ex_error("ex_extract_probe: ct_bind() failed");
+				query_code = CS_FAIL;
+				break;
+			}
+			while ((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED,
+					CS_UNUSED, &rows_read)) == CS_SUCCEED)
+			{
+				continue;
+			}
+			if (retcode != CS_END_DATA)
+			{
+				ex_error("ex_extract_probe: ct_fetch() failed");
+				query_code = CS_FAIL;
+			}
+			break;
+
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    default:
+			ex_error("ex_extract_probe: the probe failed");
+			query_code = CS_FAIL;
+			break;
+		}
+		if (query_code == CS_FAIL)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+			break;
+		}
+	}
+	if (query_code == CS_SUCCEED && retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_extract_probe: ct_results() failed");
+		query_code = CS_FAIL;
+	}
+	if (ct_cmd_drop(cmd) != CS_SUCCEED)
+	{
+		query_code = CS_FAIL;
+	}
+
+	*empty = (loind == CS_NULLDATA || hiind == CS_NULLDATA) ? CS_TRUE : CS_FALSE;
+	return query_code;
+}
+
+/*
+** ex_extract_header()
+**
+** Purpose:
+** 	Writes the header of the output format for the columns of the
+**	table, which a select of no rows describes.
+*/
+
+CS_STATIC CS_RETCODE
+ex_extract_header(CS_CONNECTION *connection, CS_CHAR *table, CS_INT format,
+		  EX_WRITER *writer)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_COMMAND	*cmd;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	CS_INT		restype;
+	EX_COLBATCH	batch;
+	EX_SINK		sink;
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_extract_header: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	sprintf(cmdbuf, "select * from %s where 1 = 0", table);
+	if ((retcode = ct_command(cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM,
+			CS_UNUSED)) != CS_SUCCEED
+		|| (retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_extract_header: sending the select failed");
+		(CS_VOID)ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	ex_colbatch_init(&batch);
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			if (ex_colbatch_bind(&batch, cmd, EX_BIND_NATIVE, 1,
+					CS_TRUE) != CS_SUCCEED
+				|| ex_sink_begin(&sink, format, writer, &batch)
+					!= CS_SUCCEED)
+			{
+				query_code = CS_FAIL;
+			}
+			else if (ex_sink_end(&sink) != CS_SUCCEED)
+			{
+				query_code = CS_FAIL;
+			}
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+			break;
+
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    default:
+			ex_error("ex_extract_header: the select failed");
+			query_code = CS_FAIL;
+			break;
+		}
+		if (query_code == CS_FAIL)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+			break;
+		}
+	}
+	if (query_code == CS_SUCCEED && retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_extract_header: ct_results() failed");
+		query_code = CS_FAIL;
+	}
+	if (ct_cmd_drop(cmd) != CS_SUCCEED)
+	{
+		query_code = CS_FAIL;
+	}
+	ex_colbatch_free(&batch);
+
+	return query_code;
+}
+
+/*
+** ex_extract_worker()
+**
+** Purpose:
+** 	Thread routine of a partition: selects it and writes its rows.
+*/
+
+CS_STATIC CS_VOID *
+ex_extract_worker(CS_VOID *arg)
+{
+	EX_EXTRACT_PART	*p = (EX_EXTRACT_PART *)arg;
+	CS_COMMAND	*cmd = NULL;
+	CS_RETCODE	retcode;
+	CS_INT		restype;
+	CS_BIGINT	start;
+	EX_COLBATCH	batch;
+
+	start = ex_usecs();
+	ex_colbatch_init(&batch);
+	p->status = CS_SUCCEED;
+
+	if ((retcode = ct_cmd_alloc(p->connection, &cmd)) != CS_SUCCEED
+		|| (retcode = ct_command(cmd, CS_LANG_CMD, p->cmdbuf,
+			CS_NULLTERM, CS_UNUSED)) != CS_SUCCEED
+		|| (retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_extract_worker: sending the select failed");
+		p->status = CS_FAIL;
+	}
+
+	while (p->status == CS_SUCCEED
+		&& (retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			p->status = ex_extract_fetch(p, cmd, &batch);
+			break;
+
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    default:
+			ex_error("ex_extract_worker: the select failed");
+			p->status = CS_FAIL;
+			break;
+		}
+	}
+	if (p->status == CS_SUCCEED && retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_extract_worker: ct_results() failed");
+		p->status = CS_FAIL;
+	}
+	if (cmd != NULL)
+	{
+		if (p->status != CS_SUCCEED)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+		}
+		(CS_VOID)ct_cmd_drop(cmd);
+	}
+	ex_colbatch_free(&batch);
+
+	/*
+	** Write what is left, and in ordered mode pass the turn on, even
+	** when the partition failed.
+	*/
+	ex_extract_emit(p, CS_TRUE);
+	p->usecs = ex_usecs() - start;
+
+	return NULL;
+}
+
+/*
+** ex_extract_fetch()
+**
+** Purpose:
+** 	Fetches a row result of a partition, formatting each fetch into
+**	the partition's writer and handing it on.
+*/
+
+CS_STATIC CS_RETCODE
+ex_extract_fetch(EX_EXTRACT_PART *p, CS_COMMAND *cmd, EX_COLBATCH *batch)
+{
+	CS_RETCODE	retcode;
+	EX_SINK		sink;
+
+	retcode = ex_colbatch_bind(batch, cmd, EX_BIND_NATIVE, EX_FETCH_ROWS,
+			CS_TRUE);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+	/*
+	** The header was written by ex_extract_table().
+	*/
+	if ((retcode = ex_sink_begin_body(&sink, p->ext->format, &p->out,
+			batch)) != CS_SUCCEED)
+	{
+		ex_sink_end(&sink);
+		return retcode;
+	}
+
+	while ((retcode = ex_colbatch_fetch(batch, cmd)) == CS_SUCCEED
+		|| retcode == CS_ROW_FAIL)
+	{
+		if (retcode == CS_ROW_FAIL)
+		{
+			ex_sink_row_failed(&sink, (CS_INT)(p->rows + batch->numrows + 1));
+		}
+		if (ex_colbatch_text(batch, cmd) != CS_SUCCEED
+			|| ex_sink_rows(&sink, batch) != CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+			break;
+		}
+		p->rows += batch->numrows;
+		ex_extract_emit(p, CS_FALSE);
+	}
+	ex_sink_end(&sink);
+
+	if (retcode != CS_END_DATA)
+	{
+		ex_error("ex_extract_fetch: ct_fetch() failed");
+		return CS_FAIL;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ex_extract_emit()
+**
+** Purpose:
+** 	Hands what a partition has formatted to the shared writer, if it
+**	may write now. With last, waits for its turn in ordered mode and
+**	then gives the turn to the next partition.
+*/
+
+CS_STATIC CS_VOID
+ex_extract_emit(EX_EXTRACT_PART *p, CS_BOOL last)
+{
+	EX_EXTRACT	*ext = p->ext;
+
+	pthread_mutex_lock(&ext->lock);
+	while (last && ext->ordered && ext->turn != p->part)
+	{
+		pthread_cond_wait(&ext->turn_done, &ext->lock);
+	}
+	if ((!ext->ordered || ext->turn == p->part) && p->out.len > 0)
+	{
+		if (ex_writer_write(ext->writer, p->out.buf, p->out.len)
+				!= CS_SUCCEED)
+		{
+			p->status = CS_FAIL;
+		}
+		p->out.len = 0;
+	}
+	if (last && ext->ordered)
+	{
+		ext->turn++;
+		pthread_cond_broadcast(&ext->turn_done);
+	}
+	pthread_mutex_unlock(&ext->lock);
+}
@@ -0,0 +1,46 @@
+/*
+** exextract.h
+** -----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the parallel table extraction in
+**	exextract.c.
+*/
+
+#ifndef EXEXTRACT_H
+#define EXEXTRACT_H
+
+/*
+** Most partitions, and so connections and threads, of an extraction.
+*/
+#define EX_EXTRACT_MAX_PARTS	64
+
+/*
+** What an extraction did, per partition and in total. Times are in
+** microseconds.
+*/
+typedef struct _ex_extract_stats
+{
+	CS_INT		nparts;
+	CS_BIGINT	lo;		/* key range probed */
+	CS_BIGINT	hi;
+	CS_BIGINT	rows;
+	CS_BIGINT	elapsed;
+	CS_BIGINT	partrows[EX_EXTRACT_MAX_PARTS];
+	CS_BIGINT	parttime[EX_EXTRACT_MAX_PARTS];
+} EX_EXTRACT_STATS;
+
+/* exextract.c */
+extern CS_RETCODE CS_PUBLIC ex_extract_table(
+	CS_CONNECTION **connections,
+	CS_INT nparts,
+	CS_CHAR *table,
+	CS_CHAR *keycol,
+	CS_INT format,
+	EX_WRITER *writer,
+	CS_BOOL ordered,
+	EX_EXTRACT_STATS *stats
+	);
+
+#endif /* EXEXTRACT_H */
@@ -0,0 +1,252 @@
+/*
+** exfprint.c
+** ----------
+**
+** Description
+** -----------
+**	Query fingerprinting for language batches.
+**
+**	ex_fprint_compute() normalizes a batch in a single pass: string
+**	literals ('...' and "..."), numeric literals (including hex and
+**	exponent forms) are replaced by '?', comments are dropped and runs
+**	of whitespace collapse to one blank. Identifiers and keywords keep
+**	their case, since object names may be case sensitive on the server.
+**	The literals that were stripped are kept alongside the normalized
+**	text so callers can tell apart batches that only differ in them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exfprint.h"
+
+/*
+** 64-bit FNV-1a prime; the offset basis is EX_FPRINT_HASH_INIT.
+*/
+#define EX_FNV_PRIME	0x100000001b3ULL
+
+#define EX_IS_IDENT(c)	(isalnum((unsigned char)(c)) || (c) == '_' \
+			 || (c) == '#' || (c) == '@' || (c) == '$')
+
+/*
+** ex_fprint_compute()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Computes the fingerprint of a language batch. All of the strings
+**	in fp point into buf.
+**
+** Parameters:
+** 	cmd		- The language batch.
+** 	len		- Length of the batch in bytes.
+** 	buf		- Work buffer of at least EX_FPRINT_BUFLEN(len) bytes.
+** 	buflen		- Size of buf.
+** 	fp		- The fingerprint to fill in.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if buf is too small.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_fprint_compute(CS_CHAR *cmd, CS_INT len, CS_CHAR *buf, CS_INT buflen,
+		  EX_FPRINT *fp)
+{
+	CS_CHAR		*lit;
+	CS_INT		o = 0;
+	CS_INT		l = 0;
+	CS_INT		i = 0;
+	CS_INT		start;
+	CS_BOOL		space = CS_FALSE;
+	CS_BOOL		hex;
+	CS_CHAR		c;
+	CS_CHAR		q;
+
+	if (buflen < EX_FPRINT_BUFLEN(len))
+	{
+		ex_error("ex_fprint_compute: work buffer too small");
+		return CS_FAIL;
+	}
+
+	/*
+	** The normalized text never grows, so the literals are staged
+	** behind the room reserved for it and moved down at the end.
+	*/
+	lit = buf + len + 1;
+	fp->nliterals = 0;
+
+	while (i < len)
+	{
+		c = cmd[i];
+
+		if (isspace((unsigned char)c))
+		{
+			space = CS_TRUE;
+			i++;
+			continue;
+		}
+
+		if (c == '-' && (i + 1) < len && cmd[i + 1] == '-')
+		{
+			while (i < len && cmd[i] != '\n')
+			{
+				i++;
+			}
+			space = CS_TRUE;
+			continue;
+		}
+
+		if (c == '/' && (i + 1) < len && cmd[i + 1] == '*')
+		{
+			for (i += 2; i < len; i++)
+			{
+				if (cmd[i] == '*' && (i + 1) < len && cmd[i + 1] == '/')
+				{
+					i += 2;
+					break;
+				}
+			}
+			space = CS_TRUE;
+			continue;
+		}
+
+		if (space && o > 0)
+		{
+			buf[o++] = ' ';
+		}
+		space = CS_FALSE;
+
+		start = i;
+		if (c == '\'' || c == '"')
+		{
+			/*
+			** A doubled quote inside the string is an escaped quote.
+			*/
+			q = c;
+			for (i++; i < len; i++)
+			{
+				if (cmd[i] == q)
+				{
+					if ((i + 1) < len && cmd[i + 1] == q)
+					{
+						i++;
+						continue;
+					}
+					i++;
+					break;
+				}
+			}
+		}
+		else if ((isdigit((unsigned char)c) || (c == '.' && (i + 1) < len
+				&& isdigit((unsigned char)cmd[i + 1])))
+			&& (o == 0 || !EX_IS_IDENT(buf[o - 1])))
+		{
+			hex = (c == '0' && (i + 1) < len
+				&& (cmd[i + 1] == 'x' || cmd[i + 1] == 'X'));
+			for (i++; i < len; i++)
+			{
+				c = cmd[i];
+				if (isalnum((unsigned char)c) || c == '.')
+				{
+					continue;
+				}
+				if (!hex && (c == '+' || c == '-')
+					&& (cmd[i - 1] == 'e' || cmd[i - 1] == 'E'))
+				{
+					continue;
+				}
+				break;
+			}
+		}
+		else
+		{
+			buf[o++] = c;
+			i++;
+			continue;
+		}
+
+		buf[o++] = '?';
+		lit[l++] = '\0';
+		memcpy(lit + l, cmd + start, i - start);
+		l += i - start;
+		fp->nliterals++;
+	}
+
+	/*
+	** The '\0' in front of the first literal terminates the text;
+	** without literals the final terminator does.
+	*/
+	memmove(buf + o, lit, l);
+	buf[o + l] = '\0';
+
+	fp->text = buf;
+	fp->textlen = o;
+	fp->key = buf;
+	fp->keylen = o + l;
+	fp->hash = ex_fprint_hash(fp->text, fp->textlen);
+	fp->keyhash = ex_fprint_hash(fp->key, fp->keylen);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_fprint_hash()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	64-bit FNV-1a hash of a byte string.
+**
+** Parameters:
+** 	data		- The bytes to hash.
+** 	len		- Number of bytes.
+**
+** Returns:
+** 	The hash value.
+*/
+
+CS_UBIGINT CS_PUBLIC
+ex_fprint_hash(CS_CHAR *data, CS_INT len)
+{
+	return ex_fprint_hash_more(EX_FPRINT_HASH_INIT, data, len);
+}
+
+/*
+** ex_fprint_hash_more()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Continues a hash with more bytes, for data that comes in pieces:
+**	hashing a string in pieces, starting from EX_FPRINT_HASH_INIT,
+**	gives the ex_fprint_hash() of the whole.
+**
+** Parameters:
+** 	h		- Hash of the bytes so far.
+** 	data		- The next bytes.
+** 	len		- Number of bytes.
+**
+** Returns:
+** 	The hash value.
+*/
+
+CS_UBIGINT CS_PUBLIC
+ex_fprint_hash_more(CS_UBIGINT h, CS_CHAR *data, CS_INT len)
+{
+	CS_INT		i;
+
+	for (i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)data[i];
+		h *= EX_FNV_PRIME;
+	}
+	return h;
+}
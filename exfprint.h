@@ -0,0 +1,66 @@
+/*
+** exfprint.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the query fingerprinting routines in
+**	exfprint.c.
+*/
+
+#ifndef EXFPRINT_H
+#define EXFPRINT_H
+
+/*
+** Size of the work buffer ex_fprint_compute() needs for a batch of
+** _len bytes.
+*/
+#define EX_FPRINT_BUFLEN(_len)	(3 * (_len) + 3)
+
+/*
+** The fingerprint of a language batch.
+**
+** text is the batch with every string and numeric literal replaced by
+** '?', comments dropped and whitespace runs collapsed to one blank.
+** hash identifies text, so all batches that differ only in their
+** literals share it.
+**
+** key is text followed, for each literal in order, by a '\0' and the
+** literal itself; keyhash identifies key. Two batches with the same
+** key return the same results.
+*/
+typedef struct _ex_fprint
+{
+	CS_CHAR		*text;		/* normalized text, null terminated */
+	CS_INT		textlen;
+	CS_CHAR		*key;		/* starts with text */
+	CS_INT		keylen;
+	CS_INT		nliterals;
+	CS_UBIGINT	hash;		/* hash of text */
+	CS_UBIGINT	keyhash;	/* hash of key */
+} EX_FPRINT;
+
+/*
+** Hash of no bytes, the 64-bit FNV-1a offset basis.
+*/
+#define EX_FPRINT_HASH_INIT	0xcbf29ce484222325ULL
+
+/* exfprint.c */
+extern CS_RETCODE CS_PUBLIC ex_fprint_compute(
+	CS_CHAR *cmd,
+	CS_INT len,
+	CS_CHAR *buf,
+	CS_INT buflen,
+	EX_FPRINT *fp
+	);
+extern CS_UBIGINT CS_PUBLIC ex_fprint_hash(
+	CS_CHAR *data,
+	CS_INT len
+	);
+extern CS_UBIGINT CS_PUBLIC ex_fprint_hash_more(
+	CS_UBIGINT h,
+	CS_CHAR *data,
+	CS_INT len
+	);
+
+#endif /* EXFPRINT_H */
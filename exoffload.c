@@ -0,0 +1,386 @@
+/*
+** exoffload.c
+** -----------
+**
+** Description
+** -----------
+**	Native thread pool for CPU-heavy handler work.
+**
+**	Open Server threads are scheduled cooperatively, so a handler that
+**	spends a long time computing (parsing a huge batch, compressing,
+**	hashing) holds up every other client thread. ex_offload_run()
+**	instead queues the work for a pool of native pthreads and puts the
+**	client thread to sleep with srv_sleep() until a pool thread wakes
+**	it with srv_wakeup(), so other client threads keep running.
+**
+**	A wakeup is lost if it arrives before the client thread is actually
+**	asleep. The client thread therefore marks the job as sleeping before
+**	calling srv_sleep() and clears the mark once it is awake again, and
+**	the pool thread keeps repeating srv_wakeup() until the mark is gone.
+**	Jobs are reference counted, so neither side frees a job the other
+**	one still looks at. The pool lock is never held across srv_sleep()
+**	or srv_wakeup().
+**
+** Routines Used
+** -------------
+**	pthread_create, srv_sleep, srv_wakeup
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exprefork.h"
+#include "exoffload.h"
+
+/*****************************************************************************
+**
+** defines and globals used.
+**
+*****************************************************************************/
+
+/*
+** How long (in microseconds) a pool thread waits for a sleeping client
+** thread to acknowledge a wakeup before sending it again.
+*/
+#define EX_OFFLOAD_REWAKE_USECS	1000
+
+typedef struct _ex_offload_job EX_OFFLOAD_JOB;
+struct _ex_offload_job
+{
+	EX_OFFLOAD_JOB	*next;
+	EX_OFFLOAD_FUNC	func;
+	CS_VOID		*arg;
+	CS_RETCODE	retcode;
+	CS_BIGINT	submitted;	/* ex_usecs() */
+	CS_INT		refcount;
+	CS_BOOL		done;
+	CS_BOOL		sleeping;	/* client thread is in srv_sleep() */
+};
+
+CS_STATIC pthread_mutex_t	Ex_offload_lock = PTHREAD_MUTEX_INITIALIZER;
+CS_STATIC pthread_cond_t	Ex_offload_work = PTHREAD_COND_INITIALIZER;
+CS_STATIC pthread_cond_t	Ex_offload_ack = PTHREAD_COND_INITIALIZER;
+CS_STATIC pthread_t		Ex_offload_threads[EX_OFFLOAD_MAX_THREADS];
+CS_STATIC EX_OFFLOAD_JOB	*Ex_offload_head;
+CS_STATIC EX_OFFLOAD_JOB	*Ex_offload_tail;
+CS_STATIC CS_BOOL		Ex_offload_stopping;
+CS_STATIC EX_OFFLOAD_STATS	Ex_offload_metrics;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_VOID *ex_offload_thread(
+	CS_VOID *unused
+	);
+CS_STATIC CS_VOID ex_offload_release(
+	EX_OFFLOAD_JOB *job
+	);
+
+/*
+** ex_offload_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts the pool threads. Called once, from the SRV_START handler.
+**
+** Parameters:
+** 	nthreads	- Number of pool threads, 1 to
+**			  EX_OFFLOAD_MAX_THREADS.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if no thread could be started.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_offload_init(CS_INT nthreads)
+{
+	CS_INT		i;
+
+	if (nthreads < 1 || nthreads > EX_OFFLOAD_MAX_THREADS)
+	{
+		ex_error("ex_offload_init: thread count out of range");
+		return CS_FAIL;
+	}
+
+	pthread_mutex_lock(&Ex_offload_lock);
+	Ex_offload_stopping = CS_FALSE;
+	for (i = Ex_offload_metrics.threads; i < nthreads; i++)
+	{
+		if (pthread_create(&Ex_offload_threads[i], NULL,
+				ex_offload_thread, NULL) != 0)
+		{
+			ex_error("ex_offload_init: pthread_create() failed");
+			break;
+		}
+		Ex_offload_metrics.threads++;
+	}
+	i = Ex_offload_metrics.threads;
+	pthread_mutex_unlock(&Ex_offload_lock);
+
+	return (i > 0) ? CS_SUCCEED : CS_FAIL;
+}
+
+/*
+** ex_offload_shutdown()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Lets the pool threads finish the queued jobs and waits for them
+**	to exit. Called after srv_run() has returned.
+*/
+
+CS_VOID CS_PUBLIC
+ex_offload_shutdown(CS_VOID)
+{
+	CS_INT		nthreads;
+	CS_INT		i;
+
+	pthread_mutex_lock(&Ex_offload_lock);
+	Ex_offload_stopping = CS_TRUE;
+	nthreads = Ex_offload_metrics.threads;
+	pthread_cond_broadcast(&Ex_offload_work);
+	pthread_mutex_unlock(&Ex_offload_lock);
+
+	for (i = 0; i < nthreads; i++)
+	{
+		(CS_VOID)pthread_join(Ex_offload_threads[i], NULL);
+	}
+
+	pthread_mutex_lock(&Ex_offload_lock);
+	Ex_offload_metrics.threads = 0;
+	pthread_mutex_unlock(&Ex_offload_lock);
+}
+
+/*
+** ex_offload_run()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs func(arg) on a pool thread while the calling client thread
+**	sleeps. When the pool isn't running or its queue is full, func is
+**	run on the calling thread instead.
+**
+** Parameters:
+** 	sp		- The calling client thread.
+** 	func		- The work to run.
+** 	arg		- Argument for func; it must stay valid until this
+**			  returns.
+**
+** Returns:
+** 	The return code of func, or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_offload_run(SRV_PROC *sp, EX_OFFLOAD_FUNC func, CS_VOID *arg)
+{
+	EX_OFFLOAD_JOB	*job;
+	CS_RETCODE	retcode;
+	CS_INT		info;
+
+	job = (EX_OFFLOAD_JOB *)malloc(sizeof (EX_OFFLOAD_JOB));
+	if (job == NULL)
+	{
+		ex_error("ex_offload_run: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	memset(job, 0, sizeof (EX_OFFLOAD_JOB));
+	job->func = func;
+	job->arg = arg;
+	job->refcount = 2;
+	job->submitted = ex_usecs();
+
+	pthread_mutex_lock(&Ex_offload_lock);
+
+	if (Ex_offload_metrics.threads == 0 || Ex_offload_stopping
+		|| Ex_offload_metrics.depth >= EX_OFFLOAD_MAX_QUEUE)
+	{
+		pthread_mutex_unlock(&Ex_offload_lock);
+		free(job);
+		return (*func)(arg);
+	}
+
+	if (Ex_offload_tail != NULL)
+	{
+		Ex_offload_tail->next = job;
+	}
+	else
+	{
+		Ex_offload_head = job;
+	}
+	Ex_offload_tail = job;
+	if (++Ex_offload_metrics.depth > Ex_offload_metrics.maxdepth)
+	{
+		Ex_offload_metrics.maxdepth = Ex_offload_metrics.depth;
+	}
+	pthread_cond_signal(&Ex_offload_work);
+
+	while (!job->done)
+	{
+		job->sleeping = CS_TRUE;
+		pthread_mutex_unlock(&Ex_offload_lock);
+
+		if (srv_sleep((CS_VOID *)job, "ex_offload", 0, &info,
+				NULL, NULL) == CS_FAIL)
+		{
+			/*
+			** The job can't be abandoned, since arg belongs to
+			** the caller. Let other threads run and look again.
+			*/
+			(CS_VOID)srv_yield();
+		}
+
+		pthread_mutex_lock(&Ex_offload_lock);
+		job->sleeping = CS_FALSE;
+		pthread_cond_broadcast(&Ex_offload_ack);
+	}
+	retcode = job->retcode;
+
+	pthread_mutex_unlock(&Ex_offload_lock);
+	ex_offload_release(job);
+
+	return retcode;
+}
+
+/*
+** ex_offload_stats()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Takes a snapshot of the pool metrics.
+*/
+
+CS_VOID CS_PUBLIC
+ex_offload_stats(EX_OFFLOAD_STATS *stats)
+{
+	pthread_mutex_lock(&Ex_offload_lock);
+	*stats = Ex_offload_metrics;
+	pthread_mutex_unlock(&Ex_offload_lock);
+}
+
+/*
+** ex_offload_thread()
+**
+** Purpose:
+** 	Body of a pool thread: runs queued jobs and wakes up their client
+**	threads until the pool is shut down.
+*/
+
+CS_STATIC CS_VOID *
+ex_offload_thread(CS_VOID *unused)
+{
+	EX_OFFLOAD_JOB	*job;
+	struct timespec	deadline;
+	CS_BIGINT	started;
+	CS_BIGINT	wait;
+	CS_BIGINT	run;
+
+	pthread_mutex_lock(&Ex_offload_lock);
+
+	for (;;)
+	{
+		while (Ex_offload_head == NULL && !Ex_offload_stopping)
+		{
+			pthread_cond_wait(&Ex_offload_work, &Ex_offload_lock);
+		}
+		if (Ex_offload_head == NULL)
+		{
+			break;
+		}
+
+		job = Ex_offload_head;
+		Ex_offload_head = job->next;
+		if (Ex_offload_head == NULL)
+		{
+			Ex_offload_tail = NULL;
+		}
+		Ex_offload_metrics.depth--;
+		pthread_mutex_unlock(&Ex_offload_lock);
+
+		started = ex_usecs();
+		wait = started - job->submitted;
+		job->retcode = (*job->func)(job->arg);
+		run = ex_usecs() - started;
+
+		EX_STATS_ADD(offloads, 1);
+		EX_STATS_ADD(offloadwait, wait);
+
+		pthread_mutex_lock(&Ex_offload_lock);
+		Ex_offload_metrics.jobs++;
+		Ex_offload_metrics.totalwait += wait;
+		if (wait > Ex_offload_metrics.maxwait)
+		{
+			Ex_offload_metrics.maxwait = wait;
+		}
+		Ex_offload_metrics.totalrun += run;
+
+		/*
+		** Wake the client thread up, again and again if it went to
+		** sleep just after an earlier wakeup was sent.
+		*/
+		job->done = CS_TRUE;
+		while (job->sleeping)
+		{
+			pthread_mutex_unlock(&Ex_offload_lock);
+			(CS_VOID)srv_wakeup((CS_VOID *)job, SRV_M_WAKE_INTR,
+				NULL, NULL);
+			pthread_mutex_lock(&Ex_offload_lock);
+
+			if (job->sleeping)
+			{
+				(CS_VOID)clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_nsec += EX_OFFLOAD_REWAKE_USECS * 1000;
+				if (deadline.tv_nsec >= 1000000000)
+				{
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+				(CS_VOID)pthread_cond_timedwait(&Ex_offload_ack,
+					&Ex_offload_lock, &deadline);
+			}
+		}
+
+		pthread_mutex_unlock(&Ex_offload_lock);
+		ex_offload_release(job);
+		pthread_mutex_lock(&Ex_offload_lock);
+	}
+
+	pthread_mutex_unlock(&Ex_offload_lock);
+
+	return NULL;
+}
+
+/*
+** ex_offload_release()
+**
+** Purpose:
+** 	Drops one reference to a job and frees it with the last one.
+*/
+
+CS_STATIC CS_VOID
+ex_offload_release(EX_OFFLOAD_JOB *job)
+{
+	CS_BOOL		drop;
+
+	pthread_mutex_lock(&Ex_offload_lock);
+	drop = (--job->refcount == 0);
+	pthread_mutex_unlock(&Ex_offload_lock);
+
+	if (drop)
+	{
+		free(job);
+	}
+}
@@ -0,0 +1,64 @@
+/*
+** exoffload.h
+** -----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the offload worker pool in exoffload.c.
+*/
+
+#ifndef EXOFFLOAD_H
+#define EXOFFLOAD_H
+
+/*
+** Default number of native worker threads and the bound on queued jobs.
+*/
+#define EX_OFFLOAD_THREADS	4
+#define EX_OFFLOAD_MAX_THREADS	64
+#define EX_OFFLOAD_MAX_QUEUE	1024
+
+/*
+** Language batches at least this long are fingerprinted on the pool
+** rather than on the client thread.
+*/
+#define EX_OFFLOAD_MIN_BYTES	(64 * 1024)
+
+/*
+** Work run on a pool thread. It must not call Client-Library or
+** Server-Library.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_OFFLOAD_FUNC)(CS_VOID *arg);
+
+/*
+** Pool metrics, as returned by ex_offload_stats(). Times are in
+** microseconds; the wait time of a job runs from its submission until
+** a pool thread picks it up.
+*/
+typedef struct _ex_offload_stats
+{
+	CS_INT		threads;
+	CS_INT		depth;		/* jobs queued right now */
+	CS_INT		maxdepth;
+	CS_BIGINT	jobs;		/* jobs completed */
+	CS_BIGINT	totalwait;
+	CS_BIGINT	maxwait;
+	CS_BIGINT	totalrun;
+} EX_OFFLOAD_STATS;
+
+/* exoffload.c */
+extern CS_RETCODE CS_PUBLIC ex_offload_init(
+	CS_INT nthreads
+	);
+extern CS_VOID CS_PUBLIC ex_offload_shutdown(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC ex_offload_run(
+	SRV_PROC *sp,
+	EX_OFFLOAD_FUNC func,
+	CS_VOID *arg
+	);
+extern CS_VOID CS_PUBLIC ex_offload_stats(
+	EX_OFFLOAD_STATS *stats
+	);
+
+#endif /* EXOFFLOAD_H */
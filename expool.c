@@ -0,0 +1,655 @@
+/*
+** expool.c
+** --------
+**
+** Description
+** -----------
+**	Client-Library connection pool.
+**
+**	ex_connect() allocates a connection, sets its properties and logs
+**	in, which costs a full TDS login round trip. The pool keeps
+**	connections open after use instead, keyed by server, user name and
+**	application name, and hands them out again on the next checkout
+**	for the same key. A connection that is checked back in is reset to
+**	the state of a fresh login (no open transaction, default set
+**	options, the database it started out in); a connection checked out
+**	from the pool is only validated from its Client-Library status, so
+**	a checkout of a warm connection doesn't touch the network.
+**
+**	The password isn't part of the key: a pooled connection is handed
+**	to any caller that asks for the same server, user and application.
+**
+**	The pool lock is never held across a Client-Library call.
+**
+** Routines Used
+** -------------
+**	ex_connect, ex_con_cleanup, ex_execute_cmd, ex_stmt_release,
+**	ct_con_props, ct_options
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exstmt.h"
+#include "expool.h"
+
+/*****************************************************************************
+**
+** defines and globals used.
+**
+*****************************************************************************/
+
+/*
+** A pooled connection. A slot is reserved (used) before its connection
+** is opened, so the per-key cap holds while the login is in progress.
+*/
+typedef struct _ex_pool_conn
+{
+	CS_CONNECTION	*connection;
+	CS_BOOL		used;		/* slot is taken */
+	CS_BOOL		inuse;		/* checked out */
+	time_t		lastused;
+	CS_CHAR		dbname[CS_MAX_NAME + 1];	/* database at login */
+} EX_POOL_CONN;
+
+typedef struct _ex_pool_key
+{
+	CS_CHAR		server[CS_MAX_NAME + 1];
+	CS_CHAR		username[CS_MAX_NAME + 1];
+	CS_CHAR		appname[CS_MAX_NAME + 1];
+	EX_POOL_CONN	conns[EX_POOL_MAX_PER_KEY];
+} EX_POOL_KEY;
+
+CS_STATIC pthread_mutex_t	Ex_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+CS_STATIC CS_CONTEXT		*Ex_pool_context;
+CS_STATIC CS_INT		Ex_pool_maxperkey = EX_POOL_MAX_PER_KEY;
+CS_STATIC EX_POOL_KEY		Ex_pool_keys[EX_POOL_MAX_KEYS];
+CS_STATIC CS_INT		Ex_pool_nkeys;
+CS_STATIC EX_POOL_STATS		Ex_pool_counters;
+
+#define EX_POOL_STR(_s)		(((_s) != NULL) ? (_s) : "")
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC EX_POOL_KEY *ex_pool_key(
+	CS_CHAR *appname,
+	CS_CHAR *username,
+	CS_CHAR *server
+	);
+CS_STATIC EX_POOL_CONN *ex_pool_find(
+	CS_CONNECTION *connection
+	);
+CS_STATIC CS_BOOL ex_pool_alive(
+	EX_POOL_CONN *pc
+	);
+CS_STATIC CS_RETCODE ex_pool_close(
+	EX_POOL_CONN *pc,
+	CS_RETCODE status
+	);
+CS_STATIC CS_RETCODE ex_pool_dbname(
+	CS_CONNECTION *connection,
+	CS_CHAR *dbname
+	);
+
+/*
+** ex_pool_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up the pool for connections of the given context.
+**
+** Parameters:
+** 	context		- The Client-Library context new connections are
+**			  allocated from.
+** 	maxperkey	- Connections kept per key, 1 to
+**			  EX_POOL_MAX_PER_KEY.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if maxperkey is out of range.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_pool_init(CS_CONTEXT *context, CS_INT maxperkey)
+{
+	if (maxperkey < 1 || maxperkey > EX_POOL_MAX_PER_KEY)
+	{
+		ex_error("ex_pool_init: connections per key out of range");
+		return CS_FAIL;
+	}
+
+	pthread_mutex_lock(&Ex_pool_lock);
+	Ex_pool_context = context;
+	Ex_pool_maxperkey = maxperkey;
+	pthread_mutex_unlock(&Ex_pool_lock);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_pool_checkout()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Hands out a connection for the given server, user and application,
+**	reusing an idle pooled one when there is a live one, and logging
+**	in a new one through ex_connect() otherwise. Takes the same
+**	arguments as ex_connect(), minus the context.
+**
+** Parameters:
+** 	connection	- Set to the connection.
+** 	appname		- Application name, may be NULL.
+** 	username	- User name, may be NULL.
+** 	password	- Password, may be NULL.
+** 	server		- Server name, NULL for DSQUERY.
+**
+** Returns:
+** 	CS_SUCCEED, or the result of ex_connect().
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_pool_checkout(CS_CONNECTION **connection, CS_CHAR *appname,
+		 CS_CHAR *username, CS_CHAR *password, CS_CHAR *server)
+{
+	EX_POOL_KEY	*key;
+	EX_POOL_CONN	*pc;
+	EX_POOL_CONN	*freeslot = NULL;
+	CS_RETCODE	retcode;
+	CS_INT		nused = 0;
+	CS_INT		i;
+
+	*connection = NULL;
+
+	pthread_mutex_lock(&Ex_pool_lock);
+	Ex_pool_counters.checkouts++;
+	key = ex_pool_key(appname, username, server);
+
+	while (key != NULL)
+	{
+		pc = NULL;
+		freeslot = NULL;
+		nused = 0;
+		for (i = 0; i < EX_POOL_MAX_PER_KEY; i++)
+		{
+			if (!key->conns[i].used)
+			{
+				freeslot = (freeslot != NULL) ? freeslot : &key->conns[i];
+				continue;
+			}
+			nused++;
+			if (!key->conns[i].inuse && key->conns[i].connection != NULL)
+			{
+				pc = &key->conns[i];
+				break;
+			}
+		}
+
+		if (pc == NULL)
+		{
+			break;
+		}
+
+		/*
+		** Take the idle connection and make sure it's still good.
+		*/
+		pc->inuse = CS_TRUE;
+		Ex_pool_counters.idle--;
+		pthread_mutex_unlock(&Ex_pool_lock);
+
+		if (ex_pool_alive(pc))
+		{
+			pthread_mutex_lock(&Ex_pool_lock);
+			Ex_pool_counters.reused++;
+			pthread_mutex_unlock(&Ex_pool_lock);
+
+			*connection = pc->connection;
+			return CS_SUCCEED;
+		}
+
+		(CS_VOID)ex_pool_close(pc, CS_FAIL);
+		pthread_mutex_lock(&Ex_pool_lock);
+	}
+
+	/*
+	** Nothing idle: reserve a slot if the key is below its cap, or
+	** else hand out a connection that isn't pooled.
+	*/
+	pc = NULL;
+	if (key != NULL && nused < Ex_pool_maxperkey && freeslot != NULL)
+	{
+		pc = freeslot;
+		memset(pc, 0, sizeof (EX_POOL_CONN));
+		pc->used = CS_TRUE;
+		pc->inuse = CS_TRUE;
+	}
+	Ex_pool_counters.opened++;
+	pthread_mutex_unlock(&Ex_pool_lock);
+
+	retcode = ex_connect(Ex_pool_context, connection, appname, username,
+			password, server);
+
+	if (retcode == CS_SUCCEED && pc != NULL)
+	{
+		retcode = ex_pool_dbname(*connection, pc->dbname);
+		if (retcode != CS_SUCCEED)
+		{
+			(CS_VOID)ex_con_cleanup(*connection, retcode);
+			*connection = NULL;
+		}
+	}
+
+	if (pc != NULL)
+	{
+		pthread_mutex_lock(&Ex_pool_lock);
+		if (retcode == CS_SUCCEED)
+		{
+			pc->connection = *connection;
+		}
+		else
+		{
+			pc->used = CS_FALSE;
+		}
+		pthread_mutex_unlock(&Ex_pool_lock);
+	}
+
+	return retcode;
+}
+
+/*
+** ex_pool_checkin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Gives back a connection from ex_pool_checkout(). Pooled
+**	connections are reset and kept for the next checkout; connections
+**	that aren't pooled, that failed, or that can't be reset are closed
+**	like ex_con_cleanup() would.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	status		- CS_SUCCEED unless the caller saw the connection
+**			  fail; anything else closes it.
+**
+** Returns:
+** 	CS_SUCCEED, or the result of closing the connection.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_pool_checkin(CS_CONNECTION *connection, CS_RETCODE status)
+{
+	EX_POOL_CONN	*pc;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	CS_RETCODE	retcode;
+
+	pthread_mutex_lock(&Ex_pool_lock);
+	pc = ex_pool_find(connection);
+	pthread_mutex_unlock(&Ex_pool_lock);
+
+	if (pc == NULL)
+	{
+		pthread_mutex_lock(&Ex_pool_lock);
+		Ex_pool_counters.closed++;
+		pthread_mutex_unlock(&Ex_pool_lock);
+
+		return ex_con_cleanup(connection, status);
+	}
+
+	if (status != CS_SUCCEED)
+	{
+		return ex_pool_close(pc, status);
+	}
+
+	/*
+	** Throw away whatever results are still pending, then undo any
+	** session state the caller may have changed, text limits
+	** (ex_text_unlimit()) included.
+	*/
+	retcode = ct_cancel(connection, NULL, CS_CANCEL_ALL);
+	if (retcode == CS_SUCCEED)
+	{
+		/*
+		** The next borrower may be in another database, where
+		** the prepared statements would refer to the wrong
+		** objects.
+		*/
+		retcode = ex_stmt_release(connection, CS_SUCCEED);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(cmdbuf, EX_POOL_RESET_CMD, pc->dbname);
+		retcode = ex_execute_cmd(connection, cmdbuf);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ct_options(connection, CS_CLEAR, CS_OPT_TEXTSIZE,
+				NULL, CS_UNUSED, NULL);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ct_con_props(connection, CS_CLEAR, CS_TEXTLIMIT,
+				NULL, CS_UNUSED, NULL);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_pool_checkin: reset failed, closing the connection");
+		return ex_pool_close(pc, retcode);
+	}
+
+	pthread_mutex_lock(&Ex_pool_lock);
+	pc->lastused = time(NULL);
+	pc->inuse = CS_FALSE;
+	Ex_pool_counters.idle++;
+	pthread_mutex_unlock(&Ex_pool_lock);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_pool_drain()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Closes every idle pooled connection. Must be called before the
+**	context is cleaned up; connections still checked out are left to
+**	their owners.
+**
+** Parameters:
+** 	status		- Passed on to ex_con_cleanup().
+**
+** Returns:
+** 	CS_SUCCEED, or the first failure from closing a connection.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_pool_drain(CS_RETCODE status)
+{
+	EX_POOL_CONN	*pc;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_RETCODE	ret;
+	CS_INT		k;
+	CS_INT		i;
+
+	for (k = 0; k < EX_POOL_MAX_KEYS; k++)
+	{
+		for (i = 0; i < EX_POOL_MAX_PER_KEY; i++)
+		{
+			pc = &Ex_pool_keys[k].conns[i];
+
+			pthread_mutex_lock(&Ex_pool_lock);
+			if (!pc->used || pc->inuse || pc->connection == NULL)
+			{
+				pthread_mutex_unlock(&Ex_pool_lock);
+				continue;
+			}
+			pc->inuse = CS_TRUE;
+			Ex_pool_counters.idle--;
+			pthread_mutex_unlock(&Ex_pool_lock);
+
+			ret = ex_pool_close(pc, status);
+			if (retcode == CS_SUCCEED)
+			{
+				retcode = ret;
+			}
+		}
+	}
+
+	return retcode;
+}
+
+/*
+** ex_pool_stats()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Takes a snapshot of the pool counters.
+*/
+
+CS_VOID CS_PUBLIC
+ex_pool_stats(EX_POOL_STATS *stats)
+{
+	pthread_mutex_lock(&Ex_pool_lock);
+	*stats = Ex_pool_counters;
+	pthread_mutex_unlock(&Ex_pool_lock);
+}
+
+/*
+** ex_pool_key()
+**
+** Purpose:
+** 	Finds or adds the key of a server, user and application. Called
+**	with the pool lock held.
+**
+** Returns:
+** 	The key, or NULL if the key table is full or a name is too long.
+*/
+
+CS_STATIC EX_POOL_KEY *
+ex_pool_key(CS_CHAR *appname, CS_CHAR *username, CS_CHAR *server)
+{
+	EX_POOL_KEY	*key;
+	CS_INT		i;
+
+	appname = EX_POOL_STR(appname);
+	username = EX_POOL_STR(username);
+	server = EX_POOL_STR(server);
+
+	for (i = 0; i < Ex_pool_nkeys; i++)
+	{
+		key = &Ex_pool_keys[i];
+		if (strcmp(key->server, server) == 0
+			&& strcmp(key->username, username) == 0
+			&& strcmp(key->appname, appname) == 0)
+		{
+			return key;
+		}
+	}
+
+	if (Ex_pool_nkeys == EX_POOL_MAX_KEYS || strlen(server) > CS_MAX_NAME
+		|| strlen(username) > CS_MAX_NAME || strlen(appname) > CS_MAX_NAME)
+	{
+		return NULL;
+	}
+
+	key = &Ex_pool_keys[Ex_pool_nkeys++];
+	(CS_VOID)strcpy(key->server, server);
+	(CS_VOID)strcpy(key->username, username);
+	(CS_VOID)strcpy(key->appname, appname);
+
+	return key;
+}
+
+/*
+** ex_pool_find()
+**
+** Purpose:
+** 	Finds the slot of a pooled connection. Called with the pool lock
+**	held.
+**
+** Returns:
+** 	The slot, or NULL if the connection isn't pooled.
+*/
+
+CS_STATIC EX_POOL_CONN *
+ex_pool_find(CS_CONNECTION *connection)
+{
+	CS_INT		k;
+	CS_INT		i;
+
+	for (k = 0; k < Ex_pool_nkeys; k++)
+	{
+		for (i = 0; i < EX_POOL_MAX_PER_KEY; i++)
+		{
+			if (Ex_pool_keys[k].conns[i].used
+				&& Ex_pool_keys[k].conns[i].connection == connection)
+			{
+				return &Ex_pool_keys[k].conns[i];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*
+** ex_pool_alive()
+**
+** Purpose:
+** 	Cheap validation of an idle connection: it must not have been idle
+**	for too long, and Client-Library must still consider it connected.
+**	Nothing is sent to the server.
+*/
+
+CS_STATIC CS_BOOL
+ex_pool_alive(EX_POOL_CONN *pc)
+{
+	CS_INT		status;
+
+	if (time(NULL) - pc->lastused > EX_POOL_MAX_IDLE)
+	{
+		return CS_FALSE;
+	}
+
+	if (ct_con_props(pc->connection, CS_GET, CS_CON_STATUS, &status,
+			CS_UNUSED, NULL) != CS_SUCCEED)
+	{
+		return CS_FALSE;
+	}
+
+	return ((status & CS_CONSTAT_CONNECTED) != 0
+		&& (status & CS_CONSTAT_DEAD) == 0) ? CS_TRUE : CS_FALSE;
+}
+
+/*
+** ex_pool_close()
+**
+** Purpose:
+** 	Closes a pooled connection owned by the caller and frees its slot.
+*/
+
+CS_STATIC CS_RETCODE
+ex_pool_close(EX_POOL_CONN *pc, CS_RETCODE status)
+{
+	CS_CONNECTION	*connection = pc->connection;
+
+	pthread_mutex_lock(&Ex_pool_lock);
+	pc->connection = NULL;
+	pc->used = CS_FALSE;
+	Ex_pool_counters.closed++;
+	pthread_mutex_unlock(&Ex_pool_lock);
+
+	return ex_con_cleanup(connection, status);
+}
+
+/*
+** ex_pool_dbname()
+**
+** Purpose:
+** 	Gets the current database of a new connection, so it can be
+**	restored on checkin.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	dbname		- Buffer of CS_MAX_NAME + 1 bytes.
+**
+** Returns:
+** 	CS_SUCCEED or a Client-Library failure code.
+*/
+
+CS_STATIC CS_RETCODE
+ex_pool_dbname(CS_CONNECTION *connection, CS_CHAR *dbname)
+{
+	CS_COMMAND	*cmd;
+	CS_DATAFMT	fmt;
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_INT		restype;
+	CS_INT		count;
+
+	dbname[0] = '\0';
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_pool_dbname: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	if ((retcode = ct_command(cmd, CS_LANG_CMD, "select db_name()",
+			CS_NULLTERM, CS_UNUSED)) != CS_SUCCEED
+		|| (retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_pool_dbname: sending the query failed");
+		(CS_VOID)ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			memset(&fmt, 0, sizeof (fmt));
+			fmt.datatype = CS_CHAR_TYPE;
+			fmt.format = CS_FMT_NULLTERM;
+			fmt.maxlength = CS_MAX_NAME + 1;
+			fmt.count = 1;
+			if (ct_bind(cmd, 1, &fmt, dbname, NULL, NULL) != CS_SUCCEED)
+			{
+				query_code = CS_FAIL;
+				(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+				break;
+			}
+			while ((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED,
+					CS_UNUSED, &count)) == CS_SUCCEED)
+			{
+				;
+			}
+			if (retcode != CS_END_DATA)
+			{
+				query_code = CS_FAIL;
+			}
+			break;
+
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    default:
+			query_code = CS_FAIL;
+			break;
+		}
+	}
+
+	if (retcode != CS_END_RESULTS)
+	{
+		query_code = CS_FAIL;
+		(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+	}
+	(CS_VOID)ct_cmd_drop(cmd);
+
+	if (query_code == CS_SUCCEED && dbname[0] == '\0')
+	{
+		query_code = CS_FAIL;
+	}
+	if (query_code != CS_SUCCEED)
+	{
+		ex_error("ex_pool_dbname: select db_name() failed");
+	}
+
+	return query_code;
+}
@@ -0,0 +1,73 @@
+/*
+** expool.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the Client-Library connection pool in
+**	expool.c.
+*/
+
+#ifndef EXPOOL_H
+#define EXPOOL_H
+
+/*
+** Pool limits. Connections beyond EX_POOL_MAX_PER_KEY for a key are
+** still handed out, but closed again on checkin. Idle connections older
+** than EX_POOL_MAX_IDLE seconds are closed on checkout rather than
+** trusted, since the server may have dropped them.
+*/
+#define EX_POOL_MAX_KEYS	16
+#define EX_POOL_MAX_PER_KEY	8
+#define EX_POOL_MAX_IDLE	300
+
+/*
+** Batch run on checkin to put a connection back into the state of a
+** fresh login. The format argument is the database the connection
+** started out in.
+*/
+#define EX_POOL_RESET_CMD \
+	"if @@trancount > 0 rollback tran\n" \
+	"set chained off\n" \
+	"set rowcount 0\n" \
+	"set textsize 0\n" \
+	"set nocount off\n" \
+	"set transaction isolation level 1\n" \
+	"use %s\n"
+
+/*
+** Pool counters, as returned by ex_pool_stats().
+*/
+typedef struct _ex_pool_stats
+{
+	CS_INT		checkouts;
+	CS_INT		reused;		/* checkouts served by an idle connection */
+	CS_INT		opened;
+	CS_INT		closed;
+	CS_INT		idle;		/* connections idle right now */
+} EX_POOL_STATS;
+
+/* expool.c */
+extern CS_RETCODE CS_PUBLIC ex_pool_init(
+	CS_CONTEXT *context,
+	CS_INT maxperkey
+	);
+extern CS_RETCODE CS_PUBLIC ex_pool_checkout(
+	CS_CONNECTION **connection,
+	CS_CHAR *appname,
+	CS_CHAR *username,
+	CS_CHAR *password,
+	CS_CHAR *server
+	);
+extern CS_RETCODE CS_PUBLIC ex_pool_checkin(
+	CS_CONNECTION *connection,
+	CS_RETCODE status
+	);
+extern CS_RETCODE CS_PUBLIC ex_pool_drain(
+	CS_RETCODE status
+	);
+extern CS_VOID CS_PUBLIC ex_pool_stats(
+	EX_POOL_STATS *stats
+	);
+
+#endif /* EXPOOL_H */
@@ -0,0 +1,441 @@
+/*
+** exprefork.c
+** -----------
+**
+** Description
+** -----------
+**	Pre-fork supervisor for the srv_sleep_sig_11 Open Server.
+**
+**	Open Server scheduling in a single process is driven by the one
+**	srv_run() thread, so a busy or crashing handler affects every client
+**	of that process. ex_prefork_run() instead forks N worker processes,
+**	each of which initializes Client-Library and Server-Library on its
+**	own and runs srv_run() on its own interfaces file entry. The
+**	supervisor restarts workers that crash (for instance with the
+**	srv_sleep() SIGSEGV this program demonstrates) and periodically
+**	reports the counters that the workers keep in shared memory.
+**
+** Routines Used
+** -------------
+**	fork, waitpid, mmap, kill
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include <ossample.h>
+#include "example.h"
+#include "exutils.h"
+#include "exprefork.h"
+#include "exoffload.h"
+#include "srv_sleep_sig_11.h"
+
+/*****************************************************************************
+**
+** globals used.
+**
+*****************************************************************************/
+
+/*
+** Counters of this process when not running as a pre-fork worker.
+*/
+CS_STATIC EX_WORKER_STATS	Ex_local_stats;
+
+EX_WORKER_STATS	*Ex_stats = &Ex_local_stats;
+CS_CHAR		*Ex_srvname = SERVER_NAME;
+
+/*
+** Set from the supervisor's SIGTERM/SIGINT handler.
+*/
+CS_STATIC volatile sig_atomic_t	Ex_prefork_stopping = 0;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_VOID ex_prefork_sighandler(
+	int sig
+	);
+CS_STATIC CS_VOID ex_prefork_sigchld(
+	int sig
+	);
+CS_STATIC pid_t ex_prefork_spawn(
+	EX_WORKER_STATS *slots,
+	CS_INT slot
+	);
+CS_STATIC int ex_prefork_worker(
+	EX_WORKER_STATS *slots,
+	CS_INT slot
+	);
+CS_STATIC CS_VOID ex_prefork_report(
+	EX_WORKER_STATS *slots,
+	CS_INT nworkers
+	);
+
+/*
+** ex_prefork_run()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Runs the pre-fork supervisor. It forks nworkers Open Server worker
+**	processes and then waits for them, restarting any worker that exits
+**	abnormally. A worker that exits with EX_EXIT_SUCCEED (for example
+**	after the stop_srv registered procedure ran) is not restarted. On
+**	SIGTERM or SIGINT the supervisor forwards SIGTERM to all workers and
+**	returns once they have exited.
+**
+**	This must be called before ex_init(); the supervisor itself never
+**	touches Client-Library or Server-Library.
+**
+** Parameters:
+** 	nworkers	- Number of worker processes, 1 to
+**			  EX_PREFORK_MAX_WORKERS.
+**
+** Returns:
+** 	CS_SUCCEED if all workers were started and exited cleanly.
+**	CS_FAIL otherwise.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_prefork_run(CS_INT nworkers)
+{
+	EX_WORKER_STATS		*slots;
+	pid_t			pid;
+	time_t			started[EX_PREFORK_MAX_WORKERS];
+	time_t			restart_at[EX_PREFORK_MAX_WORKERS];
+	time_t			now;
+	time_t			next_report;
+	struct sigaction	sa;
+	CS_INT			running = 0;
+	CS_INT			pending = 0;
+	CS_INT			i;
+	CS_BOOL			signalled = CS_FALSE;
+	CS_RETCODE		retcode = CS_SUCCEED;
+	int			status;
+
+	if (nworkers < 1 || nworkers > EX_PREFORK_MAX_WORKERS)
+	{
+		ex_error("ex_prefork_run: worker count out of range");
+		return CS_FAIL;
+	}
+
+	/*
+	** The stats slots are shared with the workers, so they survive
+	** a worker crash and can be read by the supervisor at any time.
+	*/
+	slots = (EX_WORKER_STATS *)mmap(NULL,
+			nworkers * sizeof (EX_WORKER_STATS),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (slots == (EX_WORKER_STATS *)MAP_FAILED)
+	{
+		ex_error("ex_prefork_run: mmap() failed");
+		return CS_FAIL;
+	}
+	memset(slots, 0, nworkers * sizeof (EX_WORKER_STATS));
+
+	memset(&sa, 0, sizeof (sa));
+	sa.sa_handler = ex_prefork_sighandler;
+	sigemptyset(&sa.sa_mask);
+	(CS_VOID)sigaction(SIGTERM, &sa, NULL);
+	(CS_VOID)sigaction(SIGINT, &sa, NULL);
+	sa.sa_handler = ex_prefork_sigchld;
+	(CS_VOID)sigaction(SIGCHLD, &sa, NULL);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		started[i] = time(NULL);
+		restart_at[i] = 0;
+		if (ex_prefork_spawn(slots, i) < 0)
+		{
+			ex_error("ex_prefork_run: fork() failed");
+			retcode = CS_FAIL;
+			Ex_prefork_stopping = 1;
+			break;
+		}
+		running++;
+	}
+
+	fprintf(stdout, "Supervisor %d started %d of %d workers.\n",
+		(int)getpid(), running, nworkers);
+	fflush(stdout);
+
+	next_report = time(NULL) + EX_PREFORK_REPORT_SECS;
+	while (running > 0 || (pending > 0 && !Ex_prefork_stopping))
+	{
+		/*
+		** Reap every worker that has exited since the last pass.
+		*/
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		{
+			for (i = 0; i < nworkers; i++)
+			{
+				if (slots[i].pid == (CS_INT)pid)
+				{
+					break;
+				}
+			}
+			if (i == nworkers)
+			{
+				continue;
+			}
+			slots[i].pid = 0;
+			running--;
+
+			if (WIFEXITED(status) && WEXITSTATUS(status) == EX_EXIT_SUCCEED)
+			{
+				fprintf(stdout, "Worker %d (pid %d) exited.\n",
+					i + 1, (int)pid);
+				continue;
+			}
+
+			if (WIFSIGNALED(status))
+			{
+				fprintf(stdout, "Worker %d (pid %d) died on signal %d.\n",
+					i + 1, (int)pid, WTERMSIG(status));
+			}
+			else
+			{
+				fprintf(stdout, "Worker %d (pid %d) failed with status %d.\n",
+					i + 1, (int)pid, WEXITSTATUS(status));
+			}
+			fflush(stdout);
+
+			if (Ex_prefork_stopping)
+			{
+				continue;
+			}
+
+			/*
+			** Schedule the restart, backing off if the worker
+			** didn't stay up for long.
+			*/
+			now = time(NULL);
+			restart_at[i] = now;
+			if (now - started[i] < EX_PREFORK_MIN_UPTIME)
+			{
+				restart_at[i] += EX_PREFORK_MIN_UPTIME;
+			}
+			pending++;
+		}
+
+		if (Ex_prefork_stopping && !signalled)
+		{
+			for (i = 0; i < nworkers; i++)
+			{
+				if (slots[i].pid != 0)
+				{
+					(CS_VOID)kill((pid_t)slots[i].pid, SIGTERM);
+				}
+			}
+			signalled = CS_TRUE;
+		}
+
+		now = time(NULL);
+		for (i = 0; i < nworkers && pending > 0 && !Ex_prefork_stopping; i++)
+		{
+			if (restart_at[i] == 0 || restart_at[i] > now)
+			{
+				continue;
+			}
+			/*
+			** A restart that can't fork is tried again later;
+			** the slot stays pending until a worker is running
+			** in it.
+			*/
+			if (ex_prefork_spawn(slots, i) < 0)
+			{
+				ex_error("ex_prefork_run: fork() failed on restart, retrying");
+				restart_at[i] = now + EX_PREFORK_MIN_UPTIME;
+				continue;
+			}
+			restart_at[i] = 0;
+			pending--;
+			started[i] = now;
+			slots[i].restarts++;
+			running++;
+		}
+
+		if (now >= next_report)
+		{
+			ex_prefork_report(slots, nworkers);
+			next_report = now + EX_PREFORK_REPORT_SECS;
+		}
+
+		/*
+		** sleep() returns early when a signal arrives, SIGCHLD
+		** included, so a worker that exits is normally reaped at
+		** once; one that exits just before the sleep waits out
+		** the second.
+		*/
+		(CS_VOID)sleep(1);
+	}
+
+	ex_prefork_report(slots, nworkers);
+	(CS_VOID)munmap(slots, nworkers * sizeof (EX_WORKER_STATS));
+
+	return retcode;
+}
+
+/*
+** ex_prefork_sighandler()
+**
+** Purpose:
+** 	Records that the supervisor was asked to stop.
+*/
+
+CS_STATIC CS_VOID
+ex_prefork_sighandler(int sig)
+{
+	Ex_prefork_stopping = 1;
+}
+
+/*
+** ex_prefork_sigchld()
+**
+** Purpose:
+** 	Does nothing; being installed is what makes a worker's exit
+**	interrupt the supervisor's sleep().
+*/
+
+CS_STATIC CS_VOID
+ex_prefork_sigchld(int sig)
+{
+}
+
+/*
+** ex_prefork_spawn()
+**
+** Purpose:
+** 	Forks the worker for the given slot. The child never returns from
+**	this function.
+**
+** Returns:
+** 	The pid of the worker, or -1 if fork() failed.
+*/
+
+CS_STATIC pid_t
+ex_prefork_spawn(EX_WORKER_STATS *slots, CS_INT slot)
+{
+	pid_t		pid;
+
+	/*
+	** Don't let the child inherit unwritten stdio buffers.
+	*/
+	fflush(stdout);
+	fflush(stderr);
+
+	pid = fork();
+	if (pid == 0)
+	{
+		exit(ex_prefork_worker(slots, slot));
+	}
+	if (pid > 0)
+	{
+		slots[slot].pid = (CS_INT)pid;
+	}
+	return pid;
+}
+
+/*
+** ex_prefork_worker()
+**
+** Purpose:
+** 	Body of a worker process. Initializes Client-Library and
+**	Server-Library for the listener "<SERVER_NAME>_<slot + 1>" and
+**	runs the Open Server on the calling thread until it is stopped.
+**
+** Returns:
+** 	The exit status for the worker process.
+*/
+
+CS_STATIC int
+ex_prefork_worker(EX_WORKER_STATS *slots, CS_INT slot)
+{
+	CS_CONTEXT	*context;
+	SRV_SERVER	*server = NULL;
+	CS_RETCODE	retcode;
+	CS_CHAR		srvname[CS_MAX_NAME];
+
+	(CS_VOID)signal(SIGTERM, SIG_DFL);
+	(CS_VOID)signal(SIGINT, SIG_DFL);
+	(CS_VOID)signal(SIGCHLD, SIG_DFL);
+
+	snprintf(srvname, sizeof (srvname), "%s_%d", SERVER_NAME, slot + 1);
+	Ex_srvname = srvname;
+	Ex_stats = &slots[slot];
+
+	retcode = ex_init(&context, &server);
+	if (retcode != CS_SUCCEED || server == NULL)
+	{
+		ex_error("ex_prefork_worker: ex_init failed");
+		return EX_EXIT_FAIL;
+	}
+
+	retcode = srv_run(server);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_prefork_worker: srv_run failed");
+	}
+	ex_offload_shutdown();
+
+	retcode = ex_ctx_cleanup(context, retcode);
+
+	return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
+}
+
+/*
+** ex_prefork_report()
+**
+** Purpose:
+** 	Prints the counters of each worker and their sum to stdout.
+*/
+
+CS_STATIC CS_VOID
+ex_prefork_report(EX_WORKER_STATS *slots, CS_INT nworkers)
+{
+	EX_WORKER_STATS	total;
+	CS_INT		i;
+
+	memset(&total, 0, sizeof (total));
+
+	fprintf(stdout, "\n%-8s %-8s %-8s %-12s %-12s %-16s %-10s %-12s %-12s %-10s %-14s\n",
+		"worker", "pid", "restarts", "connects", "langcmds",
+		"langbytes", "errors", "cachehits", "cachemisses",
+		"offloads", "offloadwait");
+	for (i = 0; i < nworkers; i++)
+	{
+		fprintf(stdout, "%-8d %-8d %-8d %-12lld %-12lld %-16lld %-10lld %-12lld %-12lld %-10lld %-14lld\n",
+			i + 1, slots[i].pid, slots[i].restarts,
+			(long long)slots[i].connects, (long long)slots[i].langcmds,
+			(long long)slots[i].langbytes, (long long)slots[i].errors,
+			(long long)slots[i].cachehits, (long long)slots[i].cachemisses,
+			(long long)slots[i].offloads, (long long)slots[i].offloadwait);
+
+		total.restarts += slots[i].restarts;
+		total.connects += slots[i].connects;
+		total.langcmds += slots[i].langcmds;
+		total.langbytes += slots[i].langbytes;
+		total.errors += slots[i].errors;
+		total.cachehits += slots[i].cachehits;
+		total.cachemisses += slots[i].cachemisses;
+		total.offloads += slots[i].offloads;
+		total.offloadwait += slots[i].offloadwait;
+	}
+	fprintf(stdout, "%-8s %-8s %-8d %-12lld %-12lld %-16lld %-10lld %-12lld %-12lld %-10lld %-14lld\n",
+		"total", "", total.restarts,
+		(long long)total.connects, (long long)total.langcmds,
+		(long long)total.langbytes, (long long)total.errors,
+		(long long)total.cachehits, (long long)total.cachemisses,
+		(long long)total.offloads, (long long)total.offloadwait);
+	fflush(stdout);
+}
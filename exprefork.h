@@ -0,0 +1,75 @@
+/*
+** exprefork.h
+** -----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the pre-fork supervisor in exprefork.c.
+**
+**	In pre-fork mode the parent process never initializes Client-Library
+**	or Server-Library. It forks one worker per listener, and each worker
+**	runs srv_init()/srv_run() against its own interfaces file entry,
+**	named "<SERVER_NAME>_<n>" (n counting from 1). Crashed workers are
+**	restarted, and the per-worker counters below are kept in a shared
+**	mapping so the supervisor can aggregate them.
+*/
+
+#ifndef EXPREFORK_H
+#define EXPREFORK_H
+
+/*
+** Upper bound on the number of worker processes.
+*/
+#define EX_PREFORK_MAX_WORKERS	64
+
+/*
+** How often (in seconds) the supervisor reports the aggregated metrics.
+*/
+#define EX_PREFORK_REPORT_SECS	60
+
+/*
+** A worker that dies sooner than this many seconds after it was
+** started is restarted only after the same delay, so a listener that
+** crashes on startup doesn't spin the supervisor.
+*/
+#define EX_PREFORK_MIN_UPTIME	2
+
+/*
+** Counters kept by each worker process. The supervisor owns the
+** restarts and pid fields; everything else is only written by the
+** worker through EX_STATS_ADD().
+*/
+typedef struct _ex_worker_stats
+{
+	CS_INT		pid;		/* current worker pid, 0 if none */
+	CS_INT		restarts;	/* times the supervisor restarted it */
+	CS_BIGINT	connects;	/* SRV_CONNECT events handled */
+	CS_BIGINT	langcmds;	/* SRV_LANGUAGE events handled */
+	CS_BIGINT	langbytes;	/* bytes of language text received */
+	CS_BIGINT	errors;		/* done-errors sent to clients */
+	CS_BIGINT	cachehits;	/* batches answered from the cache */
+	CS_BIGINT	cachemisses;	/* cacheable batches that missed */
+	CS_BIGINT	offloads;	/* jobs run on the offload pool */
+	CS_BIGINT	offloadwait;	/* usecs those jobs spent queued */
+} EX_WORKER_STATS;
+
+/*
+** Stats slot of the current process. Outside pre-fork mode this points
+** at a process-local structure, so the handlers can always update it.
+*/
+extern EX_WORKER_STATS	*Ex_stats;
+
+#define EX_STATS_ADD(_field, _n) \
+	(CS_VOID)__sync_fetch_and_add(&Ex_stats->_field, (_n))
+
+/*
+** Name of the Open Server listener used by srv_init() in this process.
+*/
+extern CS_CHAR		*Ex_srvname;
+
+/* exprefork.c */
+extern CS_RETCODE CS_PUBLIC ex_prefork_run(
+	CS_INT nworkers
+	);
+
+#endif /* EXPREFORK_H */
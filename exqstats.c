@@ -0,0 +1,469 @@
+/*
+** exqstats.c
+** ----------
+**
+** Description
+** -----------
+**	Per-fingerprint statistics of language batches.
+**
+**	The language handler times every batch and charges its latency,
+**	the rows sent back for it and its length to the fingerprint of the
+**	batch (see exfprint.c), so thousands of distinct batches that only
+**	differ in their literals add up under one entry. The table has a
+**	fixed number of slots and is never shrunk; once it is full, new
+**	fingerprints are counted under a single catch-all entry.
+**
+**	The query_stats registered procedure returns the entries with the
+**	largest total latency. As in excache.c the table lock is never held
+**	across an Open Server call.
+**
+** Routines Used
+** -------------
+**	srv_thread_props
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excache.h"
+#include "exqstats.h"
+
+/*****************************************************************************
+**
+** defines and globals used.
+**
+*****************************************************************************/
+
+/*
+** Hash value used for the catch-all entry. Fingerprint hashes of 0 are
+** moved to 1 so that 0 can mark a free slot.
+*/
+#define EX_QSTATS_OTHER_HASH	((CS_UBIGINT)1)
+
+CS_STATIC pthread_mutex_t	Ex_qstats_lock = PTHREAD_MUTEX_INITIALIZER;
+CS_STATIC EX_QSTATS_ENTRY	Ex_qstats[EX_QSTATS_MAX];
+CS_STATIC EX_QSTATS_ENTRY	Ex_qstats_other;
+CS_STATIC CS_INT		Ex_qstats_used;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC EX_QSTATS_ENTRY *ex_qstats_slot(
+	EX_FPRINT *fp
+	);
+CS_STATIC CS_VOID ex_qstats_insert(
+	EX_QSTATS_ENTRY *top,
+	CS_INT *count,
+	CS_INT ntop,
+	EX_QSTATS_ENTRY *entry
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC ex_qstats_rp(
+	SRV_PROC *sp
+	);
+
+/*
+** ex_qstats_begin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts timing a batch and makes it the current batch of the
+**	client thread until ex_qstats_end() is called.
+**
+** Parameters:
+** 	sp		- The client thread.
+** 	query		- The batch to time.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+ex_qstats_begin(SRV_PROC *sp, EX_QSTATS_QUERY *query)
+{
+	query->rows = 0;
+	query->start = ex_usecs();
+
+	(CS_VOID)srv_thread_props(sp, CS_SET, SRV_T_USERDATA,
+		(CS_VOID *)&query, sizeof (query), NULL);
+}
+
+/*
+** ex_qstats_rows()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Charges rows sent to a client to the batch it is running. Does
+**	nothing when no batch is being timed, as in a registered procedure.
+**
+** Parameters:
+** 	sp		- The client thread.
+** 	rows		- Number of rows sent.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+ex_qstats_rows(SRV_PROC *sp, CS_INT rows)
+{
+	EX_QSTATS_QUERY	*query = NULL;
+
+	if (srv_thread_props(sp, CS_GET, SRV_T_USERDATA, (CS_VOID *)&query,
+			sizeof (query), NULL) == CS_SUCCEED && query != NULL)
+	{
+		query->rows += rows;
+	}
+}
+
+/*
+** ex_qstats_end()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Stops timing a batch and adds it to the counters of its
+**	fingerprint.
+**
+** Parameters:
+** 	sp		- The client thread.
+** 	query		- The batch passed to ex_qstats_begin().
+** 	fp		- Fingerprint of the batch.
+** 	bytes		- Length of the batch.
+**
+** Returns:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+ex_qstats_end(SRV_PROC *sp, EX_QSTATS_QUERY *query, EX_FPRINT *fp,
+	      CS_INT bytes)
+{
+	EX_QSTATS_ENTRY	*entry;
+	EX_QSTATS_QUERY	*none = NULL;
+	CS_BIGINT	usecs;
+
+	usecs = ex_usecs() - query->start;
+
+	(CS_VOID)srv_thread_props(sp, CS_SET, SRV_T_USERDATA,
+		(CS_VOID *)&none, sizeof (none), NULL);
+
+	pthread_mutex_lock(&Ex_qstats_lock);
+
+	entry = ex_qstats_slot(fp);
+	entry->calls++;
+	entry->totalusecs += usecs;
+	if (usecs > entry->maxusecs)
+	{
+		entry->maxusecs = usecs;
+	}
+	entry->rows += query->rows;
+	entry->bytes += bytes;
+
+	pthread_mutex_unlock(&Ex_qstats_lock);
+}
+
+/*
+** ex_qstats_top()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Copies out the entries with the largest total latency, largest
+**	first.
+**
+** Parameters:
+** 	top		- Array of at least ntop entries to fill in.
+** 	ntop		- Number of entries wanted.
+**
+** Returns:
+** 	The number of entries copied.
+*/
+
+CS_INT CS_PUBLIC
+ex_qstats_top(EX_QSTATS_ENTRY *top, CS_INT ntop)
+{
+	CS_INT		count = 0;
+	CS_INT		i;
+
+	pthread_mutex_lock(&Ex_qstats_lock);
+
+	for (i = 0; i < EX_QSTATS_MAX; i++)
+	{
+		if (Ex_qstats[i].hash != 0)
+		{
+			ex_qstats_insert(top, &count, ntop, &Ex_qstats[i]);
+		}
+	}
+	if (Ex_qstats_other.calls > 0)
+	{
+		ex_qstats_insert(top, &count, ntop, &Ex_qstats_other);
+	}
+
+	pthread_mutex_unlock(&Ex_qstats_lock);
+
+	return count;
+}
+
+/*
+** ex_qstats_regproc()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Registers the query_stats procedure. It takes one optional
+**	parameter, @top, the number of fingerprints to return. Called from
+**	the SRV_START handler, like stop_regproc().
+**
+** Returns:
+** 	CS_SUCCEED or CS_FAIL.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_qstats_regproc(SRV_SERVER *server)
+{
+	CS_INT		info;
+	CS_INT		deftop = EX_QSTATS_TOPN;
+	SRV_PROC	*sproc;
+
+	sproc = srv_createproc(server);
+	if (sproc == NULL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regdefine(sproc, EX_QSTATS_REGPROC, CS_NULLTERM,
+		ex_qstats_rp) == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regparam(sproc, "@top", CS_NULLTERM, CS_INT_TYPE,
+		sizeof (deftop), (CS_BYTE *)&deftop) == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	if (srv_regcreate(sproc, &info) == CS_FAIL)
+	{
+		return CS_FAIL;
+	}
+
+	(CS_VOID)srv_termproc(sproc);
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_qstats_slot()
+**
+** Purpose:
+** 	Finds or claims the entry of a fingerprint, using linear probing.
+**	Called with the table lock held.
+*/
+
+CS_STATIC EX_QSTATS_ENTRY *
+ex_qstats_slot(EX_FPRINT *fp)
+{
+	EX_QSTATS_ENTRY	*entry;
+	CS_UBIGINT	hash;
+	CS_INT		i;
+	CS_INT		n;
+
+	hash = (fp->hash != 0) ? fp->hash : EX_QSTATS_OTHER_HASH;
+
+	for (i = hash % EX_QSTATS_MAX, n = 0; n < EX_QSTATS_MAX;
+		i = (i + 1) % EX_QSTATS_MAX, n++)
+	{
+		entry = &Ex_qstats[i];
+		if (entry->hash == hash)
+		{
+			return entry;
+		}
+		if (entry->hash == 0)
+		{
+			break;
+		}
+	}
+
+	/*
+	** Keep a fifth of the table free so probe runs stay short.
+	*/
+	if (n == EX_QSTATS_MAX || Ex_qstats_used >= EX_QSTATS_MAX - EX_QSTATS_MAX / 5)
+	{
+		if (Ex_qstats_other.textlen == 0)
+		{
+			(CS_VOID)strcpy(Ex_qstats_other.text, EX_QSTATS_OTHER);
+			Ex_qstats_other.textlen = strlen(EX_QSTATS_OTHER);
+		}
+		return &Ex_qstats_other;
+	}
+
+	entry->hash = hash;
+	entry->textlen = MIN(fp->textlen, EX_QSTATS_TEXTLEN);
+	memcpy(entry->text, fp->text, entry->textlen);
+	entry->text[entry->textlen] = '\0';
+	Ex_qstats_used++;
+
+	return entry;
+}
+
+/*
+** ex_qstats_insert()
+**
+** Purpose:
+** 	Inserts a copy of entry into the sorted top array if it ranks
+**	among the first ntop.
+*/
+
+CS_STATIC CS_VOID
+ex_qstats_insert(EX_QSTATS_ENTRY *top, CS_INT *count, CS_INT ntop,
+		 EX_QSTATS_ENTRY *entry)
+{
+	CS_INT		i;
+
+	if (*count == ntop && entry->totalusecs <= top[ntop - 1].totalusecs)
+	{
+		return;
+	}
+
+	for (i = MIN(*count, ntop - 1); i > 0
+		&& top[i - 1].totalusecs < entry->totalusecs; i--)
+	{
+		top[i] = top[i - 1];
+	}
+	top[i] = *entry;
+
+	if (*count < ntop)
+	{
+		(*count)++;
+	}
+}
+
+/*
+** ex_qstats_rp()
+**
+** Purpose:
+** 	Handler of the query_stats registered procedure. Sends one row
+**	per fingerprint: the normalized text, the number of calls, the
+**	total, average and maximum latency in microseconds, and the rows
+**	and bytes of all its calls.
+*/
+
+CS_STATIC CS_RETCODE CS_PUBLIC
+ex_qstats_rp(SRV_PROC *sp)
+{
+	CS_STATIC CS_CHAR	*colnames[] = { "calls", "total_usecs",
+				   "avg_usecs", "max_usecs", "rows", "bytes" };
+	EX_QSTATS_ENTRY	*top;
+	EX_ROWBUF	rows;
+	CS_DATAFMT	fmt;
+	CS_BIGINT	values[6];
+	CS_INT		ntop = EX_QSTATS_TOPN;
+	CS_INT		outlen;
+	CS_SMALLINT	indicator = CS_GOODDATA;
+	CS_INT		count;
+	CS_INT		i;
+	CS_INT		j;
+	CS_RETCODE	retcode;
+
+	if (srv_numparams(sp) > 0)
+	{
+		memset(&fmt, 0, sizeof (fmt));
+		fmt.datatype = CS_INT_TYPE;
+		fmt.maxlength = sizeof (ntop);
+		if (srv_bind(sp, CS_GET, SRV_RPCDATA, 1, &fmt, (CS_BYTE *)&ntop,
+			&outlen, &indicator) != CS_SUCCEED
+			|| srv_xferdata(sp, CS_GET, SRV_RPCDATA) != CS_SUCCEED)
+		{
+			(CS_VOID)srv_senddone(sp, SRV_DONE_ERROR | SRV_DONE_FINAL,
+				CS_TRAN_COMPLETED, 0);
+			return CS_FAIL;
+		}
+	}
+	if (indicator == CS_NULLDATA || ntop < 1)
+	{
+		ntop = EX_QSTATS_TOPN;
+	}
+	ntop = MIN(ntop, EX_QSTATS_MAX + 1);
+
+	top = (EX_QSTATS_ENTRY *)malloc(ntop * sizeof (EX_QSTATS_ENTRY));
+	if (top == NULL)
+	{
+		ex_error("ex_qstats_rp: malloc() failed");
+		(CS_VOID)srv_senddone(sp, SRV_DONE_ERROR | SRV_DONE_FINAL,
+			CS_TRAN_COMPLETED, 0);
+		return CS_FAIL;
+	}
+	count = ex_qstats_top(top, ntop);
+
+	/*
+	** Build the result set as a row stream and send it like a cached
+	** select.
+	*/
+	retcode = ex_rowbuf_init(&rows, 7);
+
+	memset(&fmt, 0, sizeof (fmt));
+	(CS_VOID)strcpy(fmt.name, "fingerprint");
+	fmt.namelen = strlen(fmt.name);
+	fmt.datatype = CS_CHAR_TYPE;
+	fmt.format = CS_FMT_UNUSED;
+	fmt.maxlength = EX_QSTATS_TEXTLEN;
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_rowbuf_describe(&rows, 1, &fmt);
+	}
+
+	for (j = 0; j < 6 && retcode == CS_SUCCEED; j++)
+	{
+		memset(&fmt, 0, sizeof (fmt));
+		(CS_VOID)strcpy(fmt.name, colnames[j]);
+		fmt.namelen = strlen(fmt.name);
+		fmt.datatype = CS_BIGINT_TYPE;
+		fmt.maxlength = sizeof (CS_BIGINT);
+		retcode = ex_rowbuf_describe(&rows, j + 2, &fmt);
+	}
+
+	for (i = 0; i < count && retcode == CS_SUCCEED; i++)
+	{
+		values[0] = top[i].calls;
+		values[1] = top[i].totalusecs;
+		values[2] = top[i].totalusecs / MAX(top[i].calls, 1);
+		values[3] = top[i].maxusecs;
+		values[4] = top[i].rows;
+		values[5] = top[i].bytes;
+
+		retcode = ex_rowbuf_add(&rows, top[i].text, top[i].textlen,
+				CS_GOODDATA);
+		for (j = 0; j < 6 && retcode == CS_SUCCEED; j++)
+		{
+			retcode = ex_rowbuf_add(&rows, &values[j],
+					sizeof (CS_BIGINT), CS_GOODDATA);
+		}
+	}
+	free(top);
+
+	if (retcode != CS_SUCCEED)
+	{
+		ex_rowbuf_free(&rows);
+		(CS_VOID)srv_senddone(sp, SRV_DONE_ERROR | SRV_DONE_FINAL,
+			CS_TRAN_COMPLETED, 0);
+		return retcode;
+	}
+
+	retcode = ex_rowbuf_send(sp, rows.data, rows.len);
+	ex_rowbuf_free(&rows);
+
+	return retcode;
+}
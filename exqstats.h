@@ -0,0 +1,85 @@
+/*
+** exqstats.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the per-fingerprint query statistics
+**	kept by exqstats.c.
+*/
+
+#ifndef EXQSTATS_H
+#define EXQSTATS_H
+
+#include "exfprint.h"
+
+/*
+** Number of distinct fingerprints tracked. Batches with a fingerprint
+** that doesn't fit any more are counted under EX_QSTATS_OTHER.
+*/
+#define EX_QSTATS_MAX		1024
+
+/*
+** Bytes of normalized text kept for each fingerprint.
+*/
+#define EX_QSTATS_TEXTLEN	255
+
+#define EX_QSTATS_OTHER		"<other>"
+
+/*
+** Name of the registered procedure that reports the top fingerprints,
+** and the number of rows it returns when @top isn't given.
+*/
+#define EX_QSTATS_REGPROC	"query_stats"
+#define EX_QSTATS_TOPN		10
+
+/*
+** Counters of one fingerprint.
+*/
+typedef struct _ex_qstats_entry
+{
+	CS_UBIGINT	hash;		/* fingerprint hash, 0 if unused */
+	CS_BIGINT	calls;
+	CS_BIGINT	totalusecs;	/* summed latency */
+	CS_BIGINT	maxusecs;	/* worst latency */
+	CS_BIGINT	rows;		/* rows sent back */
+	CS_BIGINT	bytes;		/* bytes of language text received */
+	CS_INT		textlen;
+	CS_CHAR		text[EX_QSTATS_TEXTLEN + 1];
+} EX_QSTATS_ENTRY;
+
+/*
+** A batch being timed. It lives on the stack of the language handler
+** and is reachable from the client thread while the batch runs, so the
+** code that sends rows can charge them to it.
+*/
+typedef struct _ex_qstats_query
+{
+	CS_BIGINT	start;		/* ex_usecs() */
+	CS_BIGINT	rows;
+} EX_QSTATS_QUERY;
+
+/* exqstats.c */
+extern CS_VOID CS_PUBLIC ex_qstats_begin(
+	SRV_PROC *sp,
+	EX_QSTATS_QUERY *query
+	);
+extern CS_VOID CS_PUBLIC ex_qstats_rows(
+	SRV_PROC *sp,
+	CS_INT rows
+	);
+extern CS_VOID CS_PUBLIC ex_qstats_end(
+	SRV_PROC *sp,
+	EX_QSTATS_QUERY *query,
+	EX_FPRINT *fp,
+	CS_INT bytes
+	);
+extern CS_INT CS_PUBLIC ex_qstats_top(
+	EX_QSTATS_ENTRY *top,
+	CS_INT ntop
+	);
+extern CS_RETCODE CS_PUBLIC ex_qstats_regproc(
+	SRV_SERVER *server
+	);
+
+#endif /* EXQSTATS_H */
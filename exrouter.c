@@ -0,0 +1,365 @@
+/*
+** exrouter.c
+** ----------
+**
+** Description
+** -----------
+**	Language command router used by lang_handler().
+**
+**	The leading words of each language batch are matched against a
+**	trie over a small case-folded alphabet (letters, digits, '_' and
+**	a single "whitespace" symbol that matches any run of blanks). The
+**	batch is walked in place, one byte at a time, so classifying a
+**	batch never copies or lowercases it, and the cost depends only on
+**	the length of the longest matching route, not on the number of
+**	routes.
+**
+**	The trie is built by ex_router_init() and ex_router_register()
+**	from the SRV_START handler, before any client thread runs, and is
+**	read-only afterwards; lookups therefore need no locking.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exrouter.h"
+
+/*****************************************************************************
+**
+** defines and globals used.
+**
+*****************************************************************************/
+
+/*
+** Trie alphabet: a-z, 0-9, '_' and whitespace.
+*/
+#define EX_SYM_DIGIT		26
+#define EX_SYM_UNDERSCORE	36
+#define EX_SYM_SPACE		37
+#define EX_ROUTER_SYMBOLS	38
+
+#define EX_IS_SPACE(c)	((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+typedef struct _ex_trie_node
+{
+	CS_SMALLINT	child[EX_ROUTER_SYMBOLS];	/* 0 means no child */
+	CS_SMALLINT	route;				/* -1 if no route ends here */
+} EX_TRIE_NODE;
+
+CS_STATIC EX_TRIE_NODE	Ex_nodes[EX_ROUTER_MAX_NODES];
+CS_STATIC CS_INT	Ex_numnodes;
+CS_STATIC EX_ROUTE	Ex_routes[EX_ROUTER_MAX_ROUTES];
+CS_STATIC CS_INT	Ex_numroutes;
+CS_STATIC EX_ROUTE	Ex_default_route;
+
+/*
+** Byte to trie symbol map, -1 for bytes that can't be part of a route.
+** Whitespace is handled separately since runs of it collapse.
+*/
+CS_STATIC signed char	Ex_symbol[256];
+
+/*
+** Leading T-SQL keywords routed to the keyword handler.
+*/
+CS_STATIC CS_CHAR *Ex_keywords[] =
+{
+	"select", "insert", "update", "delete", "exec", "execute",
+	"use", "set", "declare", "if", "while", "print", "begin",
+	"commit", "rollback", "save", "create", "drop", "alter",
+	"truncate", "grant", "revoke", "dump", "load", "waitfor",
+	"checkpoint", "dbcc", "readtext", "writetext",
+	NULL
+};
+
+/*
+** Log Transfer Language verbs routed to the LTL handler.
+*/
+CS_STATIC CS_CHAR *Ex_ltl_verbs[] =
+{
+	"connect source", "get maintenance user", "get truncation",
+	"distribute",
+	NULL
+};
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_router_insert(
+	CS_CHAR *name,
+	CS_INT routeclass,
+	CS_INT flags,
+	EX_ROUTE_FUNC handler
+	);
+
+/*
+** ex_router_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	(Re)builds the routing trie with the built-in T-SQL keywords and
+**	LTL verbs. Registered commands must be added with
+**	ex_router_register() afterwards.
+**
+** Parameters:
+** 	keyword_handler	- Handler for batches starting with a keyword.
+** 	ltl_handler	- Handler for LTL commands.
+** 	default_handler	- Handler for anything else.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the trie is too small.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_router_init(EX_ROUTE_FUNC keyword_handler, EX_ROUTE_FUNC ltl_handler,
+	       EX_ROUTE_FUNC default_handler)
+{
+	CS_INT		i;
+	CS_RETCODE	retcode = CS_SUCCEED;
+
+	memset(Ex_symbol, -1, sizeof (Ex_symbol));
+	for (i = 0; i < 26; i++)
+	{
+		Ex_symbol['a' + i] = (signed char)i;
+		Ex_symbol['A' + i] = (signed char)i;
+	}
+	for (i = 0; i < 10; i++)
+	{
+		Ex_symbol['0' + i] = (signed char)(EX_SYM_DIGIT + i);
+	}
+	Ex_symbol['_'] = EX_SYM_UNDERSCORE;
+
+	memset(Ex_nodes, 0, sizeof (EX_TRIE_NODE));
+	Ex_nodes[0].route = -1;
+	Ex_numnodes = 1;
+	Ex_numroutes = 0;
+
+	Ex_default_route.name = NULL;
+	Ex_default_route.routeclass = EX_ROUTE_DEFAULT;
+	Ex_default_route.flags = 0;
+	Ex_default_route.handler = default_handler;
+
+	for (i = 0; retcode == CS_SUCCEED && Ex_keywords[i] != NULL; i++)
+	{
+		retcode = ex_router_insert(Ex_keywords[i], EX_ROUTE_KEYWORD, 0,
+				keyword_handler);
+	}
+	for (i = 0; retcode == CS_SUCCEED && Ex_ltl_verbs[i] != NULL; i++)
+	{
+		retcode = ex_router_insert(Ex_ltl_verbs[i], EX_ROUTE_LTL, 0,
+				ltl_handler);
+	}
+
+	return retcode;
+}
+
+/*
+** ex_router_register()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Adds a command route. Words in name are matched case-insensitively
+**	and any single blank in name matches a run of whitespace. Unless
+**	EX_ROUTE_F_PREFIX is given, the match must end at a word boundary.
+**	Registering a name that already has a route replaces that route.
+**
+**	Must only be called before client threads run, normally from the
+**	SRV_START handler.
+**
+** Parameters:
+** 	name		- Command text; must stay valid while the router
+**			  is in use.
+** 	flags		- EX_ROUTE_F_xxx.
+** 	handler		- Handler for the command.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if name can't be routed or the trie is full.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_router_register(CS_CHAR *name, CS_INT flags, EX_ROUTE_FUNC handler)
+{
+	return ex_router_insert(name, EX_ROUTE_COMMAND, flags, handler);
+}
+
+/*
+** ex_router_lookup()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Finds the longest route matching the start of a batch. Leading
+**	whitespace is skipped.
+**
+** Parameters:
+** 	cmd		- The language batch.
+** 	len		- Length of the batch in bytes.
+**
+** Returns:
+** 	The matching route, or the default route.
+*/
+
+EX_ROUTE * CS_PUBLIC
+ex_router_lookup(CS_CHAR *cmd, CS_INT len)
+{
+	EX_ROUTE	*best = &Ex_default_route;
+	EX_ROUTE	*route;
+	CS_INT		node = 0;
+	CS_INT		i = 0;
+	CS_INT		sym;
+	unsigned char	c;
+
+	while (i < len && EX_IS_SPACE(cmd[i]))
+	{
+		i++;
+	}
+
+	while (i < len)
+	{
+		c = (unsigned char)cmd[i];
+		if (EX_IS_SPACE(c))
+		{
+			sym = EX_SYM_SPACE;
+			while (i < len && EX_IS_SPACE(cmd[i]))
+			{
+				i++;
+			}
+		}
+		else
+		{
+			sym = Ex_symbol[c];
+			i++;
+		}
+
+		if (sym < 0 || Ex_nodes[node].child[sym] == 0)
+		{
+			break;
+		}
+		node = Ex_nodes[node].child[sym];
+
+		if (Ex_nodes[node].route >= 0)
+		{
+			route = &Ex_routes[Ex_nodes[node].route];
+			if ((route->flags & EX_ROUTE_F_PREFIX) || i == len
+				|| Ex_symbol[(unsigned char)cmd[i]] < 0)
+			{
+				best = route;
+			}
+		}
+	}
+
+	return best;
+}
+
+/*
+** ex_router_dispatch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Routes a language batch to its handler.
+**
+** Parameters:
+** 	sp		- The client thread.
+** 	cmd		- The language batch, null terminated.
+** 	len		- Length of the batch in bytes.
+** 	arg		- Passed on to the handler.
+**
+** Returns:
+** 	Whatever the handler returned.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_router_dispatch(SRV_PROC *sp, CS_CHAR *cmd, CS_INT len, CS_VOID *arg)
+{
+	EX_ROUTE	*route;
+
+	route = ex_router_lookup(cmd, len);
+	return (*route->handler)(sp, cmd, len, route, arg);
+}
+
+/*
+** ex_router_insert()
+**
+** Purpose:
+** 	Adds name to the trie and points its final node at a route.
+*/
+
+CS_STATIC CS_RETCODE
+ex_router_insert(CS_CHAR *name, CS_INT routeclass, CS_INT flags,
+		 EX_ROUTE_FUNC handler)
+{
+	CS_INT		node = 0;
+	CS_INT		sym;
+	CS_INT		r;
+	CS_CHAR		*p;
+
+	if (handler == NULL || name == NULL || *name == '\0')
+	{
+		ex_error("ex_router_insert: bad route");
+		return CS_FAIL;
+	}
+
+	for (p = name; *p != '\0'; p++)
+	{
+		if (EX_IS_SPACE(*p))
+		{
+			while (EX_IS_SPACE(p[1]))
+			{
+				p++;
+			}
+			sym = EX_SYM_SPACE;
+		}
+		else
+		{
+			sym = Ex_symbol[(unsigned char)*p];
+		}
+
+		if (sym < 0)
+		{
+			ex_error("ex_router_insert: route name has an unroutable character");
+			return CS_FAIL;
+		}
+
+		if (Ex_nodes[node].child[sym] == 0)
+		{
+			if (Ex_numnodes == EX_ROUTER_MAX_NODES)
+			{
+				ex_error("ex_router_insert: routing trie is full");
+				return CS_FAIL;
+			}
+			memset(&Ex_nodes[Ex_numnodes], 0, sizeof (EX_TRIE_NODE));
+			Ex_nodes[Ex_numnodes].route = -1;
+			Ex_nodes[node].child[sym] = (CS_SMALLINT)Ex_numnodes++;
+		}
+		node = Ex_nodes[node].child[sym];
+	}
+
+	r = Ex_nodes[node].route;
+	if (r < 0)
+	{
+		if (Ex_numroutes == EX_ROUTER_MAX_ROUTES)
+		{
+			ex_error("ex_router_insert: too many routes");
+			return CS_FAIL;
+		}
+		r = Ex_numroutes++;
+		Ex_nodes[node].route = (CS_SMALLINT)r;
+	}
+
+	Ex_routes[r].name = name;
+	Ex_routes[r].routeclass = routeclass;
+	Ex_routes[r].flags = flags;
+	Ex_routes[r].handler = handler;
+
+	return CS_SUCCEED;
+}
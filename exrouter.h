@@ -0,0 +1,84 @@
+/*
+** exrouter.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the language command router in
+**	exrouter.c.
+**
+**	The router classifies the start of a language batch (T-SQL
+**	keywords, LTL verbs and registered command prefixes) with a trie
+**	that is built once, at SRV_START time, and hands the batch to the
+**	handler registered for the match.
+*/
+
+#ifndef EXROUTER_H
+#define EXROUTER_H
+
+/*
+** Route classes.
+*/
+#define EX_ROUTE_DEFAULT	0	/* nothing matched */
+#define EX_ROUTE_KEYWORD	1	/* leading T-SQL keyword */
+#define EX_ROUTE_LTL		2	/* Log Transfer Language verb */
+#define EX_ROUTE_COMMAND	3	/* registered command */
+
+/*
+** Route flags.
+*/
+#define EX_ROUTE_F_PREFIX	0x1	/* match without a word boundary */
+
+/*
+** Limits of the routing trie.
+*/
+#define EX_ROUTER_MAX_ROUTES	128
+#define EX_ROUTER_MAX_NODES	1024
+
+typedef struct _ex_route EX_ROUTE;
+
+/*
+** A route handler gets the whole batch (null terminated, len bytes
+** long), the route that matched and the argument given to
+** ex_router_dispatch(). It is responsible for sending the final done
+** to the client.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_ROUTE_FUNC)(
+	SRV_PROC *sp,
+	CS_CHAR *cmd,
+	CS_INT len,
+	EX_ROUTE *route,
+	CS_VOID *arg
+	);
+
+struct _ex_route
+{
+	CS_CHAR		*name;		/* matched text, NULL for default */
+	CS_INT		routeclass;	/* EX_ROUTE_xxx */
+	CS_INT		flags;		/* EX_ROUTE_F_xxx */
+	EX_ROUTE_FUNC	handler;
+};
+
+/* exrouter.c */
+extern CS_RETCODE CS_PUBLIC ex_router_init(
+	EX_ROUTE_FUNC keyword_handler,
+	EX_ROUTE_FUNC ltl_handler,
+	EX_ROUTE_FUNC default_handler
+	);
+extern CS_RETCODE CS_PUBLIC ex_router_register(
+	CS_CHAR *name,
+	CS_INT flags,
+	EX_ROUTE_FUNC handler
+	);
+extern EX_ROUTE * CS_PUBLIC ex_router_lookup(
+	CS_CHAR *cmd,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC ex_router_dispatch(
+	SRV_PROC *sp,
+	CS_CHAR *cmd,
+	CS_INT len,
+	CS_VOID *arg
+	);
+
+#endif /* EXROUTER_H */
@@ -0,0 +1,816 @@
+/*
+** exsink.c
+** --------
+**
+** Description
+** -----------
+**	Result set output formats.
+**
+**	ex_fetch_data() used to have one output, padded columns sized by
+**	ex_display_dlen(), meant for a terminal. An EX_SINK writes the
+**	rows of a columnar batch (see excolbatch.c) through a buffered
+**	writer (see exwriter.c) in one of several formats:
+**
+**	EX_SINK_TEXT	the padded display, as before.
+**	EX_SINK_CSV	RFC 4180: a header line of column names, fields
+**			separated by commas and quoted when they contain
+**			a comma, a quote or a line break, quotes doubled.
+**			NULL is an empty field, the empty string "".
+**	EX_SINK_TSV	a header line, fields separated by tabs, with
+**			tab, line feed, carriage return and backslash
+**			escaped by a backslash; NULL is \N.
+**	EX_SINK_NDJSON	one JSON object per row and line, keyed by column
+**			name. Numeric columns bound natively are written
+**			as JSON numbers, everything else as strings; NULL
+**			is null.
+**
+**	The machine readable formats need no padding, so nothing is
+**	computed per result set beyond what ex_sink_begin() does once.
+**	ex_sink_set_default() picks the format of ex_fetch_data() and
+**	ex_handle_results() at runtime.
+**
+** Routines Used
+** -------------
+**	none from Client-Library
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
+
+/*
+** Format of ex_fetch_data().
+*/
+CS_STATIC CS_INT	Ex_sink_default = EX_SINK_TEXT;
+
+/*
+** Format names for ex_sink_lookup().
+*/
+CS_STATIC struct
+{
+	CS_CHAR		*name;
+	CS_INT		format;
+} Ex_sink_names[] =
+{
+	{ "text",	EX_SINK_TEXT },
+	{ "csv",	EX_SINK_CSV },
+	{ "tsv",	EX_SINK_TSV },
+	{ "ndjson",	EX_SINK_NDJSON },
+	{ "json",	EX_SINK_NDJSON },
+};
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_sink_start(
+	EX_SINK *sink,
+	CS_INT format,
+	EX_WRITER *writer,
+	EX_COLBATCH *batch,
+	CS_BOOL header
+	);
+CS_STATIC CS_VOID ex_sink_text(
+	EX_SINK *sink,
+	EX_COLBATCH *batch,
+	CS_INT first,
+	CS_INT count
+	);
+CS_STATIC CS_VOID ex_sink_delimited(
+	EX_SINK *sink,
+	EX_COLBATCH *batch,
+	CS_INT first,
+	CS_INT count
+	);
+CS_STATIC CS_VOID ex_sink_ndjson(
+	EX_SINK *sink,
+	EX_COLBATCH *batch,
+	CS_INT first,
+	CS_INT count
+	);
+CS_STATIC CS_VOID ex_sink_csv_field(
+	EX_WRITER *out,
+	CS_CHAR *value,
+	CS_INT len
+	);
+CS_STATIC CS_VOID ex_sink_tsv_field(
+	EX_WRITER *out,
+	CS_CHAR *value,
+	CS_INT len
+	);
+CS_STATIC CS_VOID ex_sink_json_string(
+	EX_WRITER *out,
+	CS_CHAR *value,
+	CS_INT len
+	);
+CS_STATIC CS_BOOL ex_sink_json_number(
+	CS_CHAR *value
+	);
+CS_STATIC CS_BOOL ex_sink_numeric_type(
+	CS_INT datatype
+	);
+CS_STATIC CS_RETCODE ex_sink_keys(
+	EX_SINK *sink,
+	EX_COLBATCH *batch
+	);
+
+/*
+** ex_sink_lookup()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Finds a format by name: text, csv, tsv, ndjson (or json).
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL for an unknown name.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_lookup(CS_CHAR *name, CS_INT *format)
+{
+	CS_INT		i;
+
+	for (i = 0; i < (CS_INT)(sizeof (Ex_sink_names) / sizeof (Ex_sink_names[0])); i++)
+	{
+		if (strcmp(name, Ex_sink_names[i].name) == 0)
+		{
+			*format = Ex_sink_names[i].format;
+			return CS_SUCCEED;
+		}
+	}
+
+	return CS_FAIL;
+}
+
+/*
+** ex_sink_set_default()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets the format of ex_fetch_data() and ex_handle_results(). The
+**	result type banners and row counts of ex_handle_results() are
+**	only written in EX_SINK_TEXT.
+*/
+
+CS_VOID CS_PUBLIC
+ex_sink_set_default(CS_INT format)
+{
+	Ex_sink_default = format;
+}
+
+/*
+** ex_sink_default()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Returns the format set by ex_sink_set_default().
+*/
+
+CS_INT CS_PUBLIC
+ex_sink_default(CS_VOID)
+{
+	return Ex_sink_default;
+}
+
+/*
+** ex_sink_begin()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Starts the output of a result set bound into batch, which must
+**	have been bound with text (see ex_colbatch_bind()), and writes
+**	its header, if the format has one.
+**
+** Parameters:
+** 	sink		- The sink.
+** 	format		- One of the EX_SINK_* formats.
+** 	writer		- Where the output goes.
+** 	batch		- The bound batch.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_begin(EX_SINK *sink, CS_INT format, EX_WRITER *writer,
+	      EX_COLBATCH *batch)
+{
+	return ex_sink_start(sink, format, writer, batch, CS_TRUE);
+}
+
+/*
+** ex_sink_begin_body()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Like ex_sink_begin(), but writes no header: for output that
+**	continues a result set whose header was written elsewhere, such
+**	as a partition of ex_extract_table().
+**
+** Parameters:
+** 	sink		- The sink.
+** 	format		- One of the EX_SINK_* formats.
+** 	writer		- Where the output goes.
+** 	batch		- The bound batch.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_begin_body(EX_SINK *sink, CS_INT format, EX_WRITER *writer,
+		   EX_COLBATCH *batch)
+{
+	return ex_sink_start(sink, format, writer, batch, CS_FALSE);
+}
+
+/*
+** ex_sink_start()
+**
+** Purpose:
+** 	Does the work of ex_sink_begin() and ex_sink_begin_body(),
+**	writing the header only if header is CS_TRUE.
+*/
+
+CS_STATIC CS_RETCODE
+ex_sink_start(EX_SINK *sink, CS_INT format, EX_WRITER *writer,
+	      EX_COLBATCH *batch, CS_BOOL header)
+{
+	CS_INT		i;
+
+	memset(sink, 0, sizeof (EX_SINK));
+	sink->format = format;
+	sink->writer = writer;
+	sink->numcols = batch->numcols;
+
+	switch ((int)format)
+	{
+	    case EX_SINK_TEXT:
+		sink->width = (CS_INT *)malloc(batch->numcols * sizeof (CS_INT));
+		if (sink->width == NULL)
+		{
+			ex_error("ex_sink_begin: malloc() failed");
+			return CS_MEM_ERROR;
+		}
+		for (i = 0; i < batch->numcols; i++)
+		{
+			sink->width[i] = ex_display_dlen(&batch->textfmt[i]);
+		}
+		if (header)
+		{
+			ex_write_header(writer, batch->numcols, batch->textfmt);
+		}
+		break;
+
+	    case EX_SINK_CSV:
+	    case EX_SINK_TSV:
+		if (!header)
+		{
+			break;
+		}
+		for (i = 0; i < batch->numcols; i++)
+		{
+			if (i > 0)
+			{
+				ex_writer_putc(writer,
+					(format == EX_SINK_CSV) ? ',' : '\t');
+			}
+			if (format == EX_SINK_CSV)
+			{
+				ex_sink_csv_field(writer, batch->textfmt[i].name,
+					strlen(batch->textfmt[i].name));
+			}
+			else
+			{
+				ex_sink_tsv_field(writer, batch->textfmt[i].name,
+					strlen(batch->textfmt[i].name));
+			}
+		}
+		ex_writer_putc(writer, '\n');
+		break;
+
+	    case EX_SINK_NDJSON:
+		return ex_sink_keys(sink, batch);
+
+	    default:
+		ex_error("ex_sink_begin: unknown format");
+		return CS_FAIL;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_sink_rows()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Writes the batch->numrows rows of the last fetch. The natively
+**	bound columns must have been converted with ex_colbatch_text().
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL once the writer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_rows(EX_SINK *sink, EX_COLBATCH *batch)
+{
+	return ex_sink_range(sink, batch, 0, batch->numrows);
+}
+
+/*
+** ex_sink_range()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Writes count rows of the batch from row first on, such as a page
+**	of a scrollable cursor's window (see excursor.c).
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL once the writer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_range(EX_SINK *sink, EX_COLBATCH *batch, CS_INT first, CS_INT count)
+{
+	switch ((int)sink->format)
+	{
+	    case EX_SINK_TEXT:
+		ex_sink_text(sink, batch, first, count);
+		break;
+
+	    case EX_SINK_CSV:
+	    case EX_SINK_TSV:
+		ex_sink_delimited(sink, batch, first, count);
+		break;
+
+	    case EX_SINK_NDJSON:
+		ex_sink_ndjson(sink, batch, first, count);
+		break;
+	}
+	sink->rows += count;
+
+	return sink->writer->status;
+}
+
+/*
+** ex_sink_row_failed()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Reports a row that couldn't be fetched: in the output for
+**	EX_SINK_TEXT, on EX_ERROR_OUT otherwise, so that the output
+**	stays parseable.
+*/
+
+CS_VOID CS_PUBLIC
+ex_sink_row_failed(EX_SINK *sink, CS_INT row)
+{
+	if (sink->format == EX_SINK_TEXT)
+	{
+		ex_writer_printf(sink->writer, "Error on row %d.\n", row);
+	}
+	else
+	{
+		fprintf(EX_ERROR_OUT, "Error on row %d.\n", row);
+	}
+}
+
+/*
+** ex_sink_end()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Ends a result set: flushes the writer and frees what
+**	ex_sink_begin() allocated.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if the writer failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sink_end(EX_SINK *sink)
+{
+	CS_RETCODE	retcode;
+
+	retcode = ex_writer_flush(sink->writer);
+	free(sink->width);
+	free(sink->keys);
+	free(sink->keyoff);
+	free(sink->number);
+	sink->width = NULL;
+	sink->keys = NULL;
+	sink->keyoff = NULL;
+	sink->number = NULL;
+
+	return retcode;
+}
+
+/*
+** ex_sink_text()
+**
+** Purpose:
+** 	Writes rows padded to the display width of their columns.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_text(EX_SINK *sink, EX_COLBATCH *batch, CS_INT first,
+	     CS_INT count)
+{
+	EX_WRITER	*out = sink->writer;
+	EX_COLUMN_ARRAY	*text;
+	CS_INT		row;
+	CS_INT		i;
+
+	for (row = first; row < first + count; row++)
+	{
+		for (i = 0; i < batch->numcols; i++)
+		{
+			text = EX_COLBATCH_TEXT(batch, i);
+			ex_writer_puts(out, EX_ARRAY_VALUE(text, row));
+
+			/*
+			** If not last column, pad up to the next one.
+			*/
+			if (i != batch->numcols - 1)
+			{
+				ex_writer_pad(out, ' ',
+					sink->width[i] - (text->valuelen[row] - 1));
+			}
+		}
+		ex_writer_putc(out, '\n');
+	}
+}
+
+/*
+** ex_sink_delimited()
+**
+** Purpose:
+** 	Writes rows as CSV or TSV.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_delimited(EX_SINK *sink, EX_COLBATCH *batch, CS_INT first,
+		  CS_INT count)
+{
+	EX_WRITER	*out = sink->writer;
+	EX_COLUMN_ARRAY	*text;
+	CS_CHAR		*value;
+	CS_INT		row;
+	CS_INT		i;
+
+	for (row = first; row < first + count; row++)
+	{
+		for (i = 0; i < batch->numcols; i++)
+		{
+			text = EX_COLBATCH_TEXT(batch, i);
+			value = EX_ARRAY_VALUE(text, row);
+
+			if (sink->format == EX_SINK_CSV)
+			{
+				if (i > 0)
+				{
+					ex_writer_putc(out, ',');
+				}
+				if (text->indicator[row] != CS_NULLDATA)
+				{
+					ex_sink_csv_field(out, value, strlen(value));
+				}
+			}
+			else
+			{
+				if (i > 0)
+				{
+					ex_writer_putc(out, '\t');
+				}
+				if (text->indicator[row] == CS_NULLDATA)
+				{
+					ex_writer_write(out, "\\N", 2);
+				}
+				else
+				{
+					ex_sink_tsv_field(out, value, strlen(value));
+				}
+			}
+		}
+		ex_writer_putc(out, '\n');
+	}
+}
+
+/*
+** ex_sink_ndjson()
+**
+** Purpose:
+** 	Writes rows as JSON objects, one per line.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_ndjson(EX_SINK *sink, EX_COLBATCH *batch, CS_INT first,
+	       CS_INT count)
+{
+	EX_WRITER	*out = sink->writer;
+	EX_COLUMN_ARRAY	*text;
+	CS_CHAR		*value;
+	CS_INT		row;
+	CS_INT		i;
+
+	for (row = first; row < first + count; row++)
+	{
+		for (i = 0; i < batch->numcols; i++)
+		{
+			text = EX_COLBATCH_TEXT(batch, i);
+			value = EX_ARRAY_VALUE(text, row);
+
+			ex_writer_write(out, sink->keys + sink->keyoff[i],
+				sink->keyoff[i + 1] - sink->keyoff[i]);
+			if (text->indicator[row] == CS_NULLDATA)
+			{
+				ex_writer_write(out, "null", 4);
+			}
+			else if (sink->number[i] && ex_sink_json_number(value))
+			{
+				ex_writer_puts(out, value);
+			}
+			else
+			{
+				ex_sink_json_string(out, value, strlen(value));
+			}
+		}
+		ex_writer_write(out, "}\n", 2);
+	}
+}
+
+/*
+** ex_sink_csv_field()
+**
+** Purpose:
+** 	Writes a CSV field, quoted if it has to be or is empty.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_csv_field(EX_WRITER *out, CS_CHAR *value, CS_INT len)
+{
+	CS_CHAR		*quote;
+	CS_INT		n;
+
+	if (len > 0 && strcspn(value, ",\"\r\n") == (size_t)len)
+	{
+		ex_writer_write(out, value, len);
+		return;
+	}
+
+	ex_writer_putc(out, '"');
+	while (len > 0)
+	{
+		quote = memchr(value, '"', len);
+		n = (quote == NULL) ? len : (CS_INT)(quote - value) + 1;
+		ex_writer_write(out, value, n);
+		if (quote != NULL)
+		{
+			ex_writer_putc(out, '"');
+		}
+		value += n;
+		len -= n;
+	}
+	ex_writer_putc(out, '"');
+}
+
+/*
+** ex_sink_tsv_field()
+**
+** Purpose:
+** 	Writes a TSV field with its tabs, line breaks and backslashes
+**	escaped.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_tsv_field(EX_WRITER *out, CS_CHAR *value, CS_INT len)
+{
+	CS_INT		n;
+	CS_CHAR		esc[2];
+
+	esc[0] = '\\';
+	while (len > 0)
+	{
+		n = strcspn(value, "\t\n\r\\");
+		if (n > len)
+		{
+			n = len;
+		}
+		ex_writer_write(out, value, n);
+		if (n == len)
+		{
+			break;
+		}
+		switch (value[n])
+		{
+		    case '\t':	esc[1] = 't'; break;
+		    case '\n':	esc[1] = 'n'; break;
+		    case '\r':	esc[1] = 'r'; break;
+		    default:	esc[1] = '\\'; break;
+		}
+		ex_writer_write(out, esc, 2);
+		value += n + 1;
+		len -= n + 1;
+	}
+}
+
+/*
+** ex_sink_json_string()
+**
+** Purpose:
+** 	Writes a JSON string: quotes, backslashes and control characters
+**	escaped, other bytes as they are.
+*/
+
+CS_STATIC CS_VOID
+ex_sink_json_string(EX_WRITER *out, CS_CHAR *value, CS_INT len)
+{
+	CS_INT		start = 0;
+	CS_INT		i;
+	unsigned char	c;
+	CS_CHAR		esc[8];
+
+	ex_writer_putc(out, '"');
+	for (i = 0; i < len; i++)
+	{
+		c = (unsigned char)value[i];
+		if (c >= 0x20 && c != '"' && c != '\\')
+		{
+			continue;
+		}
+
+		ex_writer_write(out, value + start, i - start);
+		start = i + 1;
+		switch (c)
+		{
+		    case '"':	ex_writer_write(out, "\\\"", 2); break;
+		    case '\\':	ex_writer_write(out, "\\\\", 2); break;
+		    case '\n':	ex_writer_write(out, "\\n", 2); break;
+		    case '\r':	ex_writer_write(out, "\\r", 2); break;
+		    case '\t':	ex_writer_write(out, "\\t", 2); break;
+		    default:
+			sprintf(esc, "\\u%04x", c);
+			ex_writer_write(out, esc, 6);
+			break;
+		}
+	}
+	ex_writer_write(out, value + start, len - start);
+	ex_writer_putc(out, '"');
+}
+
+/*
+** ex_sink_json_number()
+**
+** Purpose:
+** 	Tells whether the text of a numeric column is a valid JSON number;
+**	conversions can give forms that aren't, like "Inf" or ".5".
+*/
+
+CS_STATIC CS_BOOL
+ex_sink_json_number(CS_CHAR *value)
+{
+	CS_CHAR		*p = value;
+
+	if (*p == '-')
+	{
+		p++;
+	}
+	if (*p < '0' || *p > '9' || (*p == '0' && p[1] >= '0' && p[1] <= '9'))
+	{
+		return CS_FALSE;
+	}
+	while (*p >= '0' && *p <= '9')
+	{
+		p++;
+	}
+	if (*p == '.')
+	{
+		p++;
+		if (*p < '0' || *p > '9')
+		{
+			return CS_FALSE;
+		}
+		while (*p >= '0' && *p <= '9')
+		{
+			p++;
+		}
+	}
+	if (*p == 'e' || *p == 'E')
+	{
+		p++;
+		if (*p == '+' || *p == '-')
+		{
+			p++;
+		}
+		if (*p < '0' || *p > '9')
+		{
+			return CS_FALSE;
+		}
+		while (*p >= '0' && *p <= '9')
+		{
+			p++;
+		}
+	}
+
+	return (*p == '\0') ? CS_TRUE : CS_FALSE;
+}
+
+/*
+** ex_sink_numeric_type()
+**
+** Purpose:
+** 	Tells whether a bound datatype is written as a JSON number.
+*/
+
+CS_STATIC CS_BOOL
+ex_sink_numeric_type(CS_INT datatype)
+{
+	switch ((int)datatype)
+	{
+	    case CS_TINYINT_TYPE:
+	    case CS_SMALLINT_TYPE:
+	    case CS_INT_TYPE:
+	    case CS_BIGINT_TYPE:
+	    case CS_USMALLINT_TYPE:
+	    case CS_UINT_TYPE:
+	    case CS_UBIGINT_TYPE:
+	    case CS_REAL_TYPE:
+	    case CS_FLOAT_TYPE:
+	    case CS_MONEY_TYPE:
+	    case CS_MONEY4_TYPE:
+	    case CS_NUMERIC_TYPE:
+	    case CS_DECIMAL_TYPE:
+		return CS_TRUE;
+
+	    default:
+		return CS_FALSE;
+	}
+}
+
+/*
+** ex_sink_keys()
+**
+** Purpose:
+** 	Builds the JSON text that goes before each value of a row: the
+**	opening brace or a comma, and the quoted column name with its
+**	colon.
+*/
+
+CS_STATIC CS_RETCODE
+ex_sink_keys(EX_SINK *sink, EX_COLBATCH *batch)
+{
+	EX_WRITER	keys;
+	CS_INT		i;
+
+	sink->keyoff = (CS_INT *)malloc((batch->numcols + 1) * sizeof (CS_INT));
+	sink->number = (CS_BOOL *)malloc(batch->numcols * sizeof (CS_BOOL));
+	if (sink->keyoff == NULL || sink->number == NULL
+		|| ex_writer_open(&keys, -1, EX_BUFSIZE) != CS_SUCCEED)
+	{
+		ex_error("ex_sink_keys: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	/*
+	** The keys are built in a writer in memory, whose buffer is then
+	** kept.
+	*/
+	for (i = 0; i < batch->numcols; i++)
+	{
+		sink->keyoff[i] = keys.len;
+		ex_writer_putc(&keys, (i == 0) ? '{' : ',');
+		ex_sink_json_string(&keys, batch->textfmt[i].name,
+			strlen(batch->textfmt[i].name));
+		ex_writer_putc(&keys, ':');
+		sink->number[i] = ex_sink_numeric_type(batch->datafmt[i].datatype);
+	}
+	sink->keyoff[batch->numcols] = keys.len;
+	sink->keys = keys.buf;
+
+	return keys.status;
+}
@@ -0,0 +1,81 @@
+/*
+** exsink.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the result set output formats in
+**	exsink.c.
+*/
+
+#ifndef EXSINK_H
+#define EXSINK_H
+
+/*
+** Output formats. EX_SINK_TEXT is the padded, aligned display of
+** ex_display_header(); the others are for other programs to read.
+*/
+#define EX_SINK_TEXT		0
+#define EX_SINK_CSV		1	/* RFC 4180, header line */
+#define EX_SINK_TSV		2	/* backslash escapes, \N for NULL */
+#define EX_SINK_NDJSON		3	/* one JSON object per row */
+
+/*
+** Writes the rows of a result set, a batch at a time, in one format.
+** Whatever depends only on the columns (display widths, quoted JSON
+** keys) is worked out once in ex_sink_begin().
+*/
+typedef struct _ex_sink
+{
+	CS_INT		format;
+	EX_WRITER	*writer;
+	CS_INT		numcols;
+	CS_INT		*width;		/* EX_SINK_TEXT: display widths */
+	CS_CHAR		*keys;		/* EX_SINK_NDJSON: "{\"a\":" ",\"b\":" ... */
+	CS_INT		*keyoff;	/* numcols + 1 offsets into keys */
+	CS_BOOL		*number;	/* EX_SINK_NDJSON: unquoted values */
+	CS_BIGINT	rows;
+} EX_SINK;
+
+/* exsink.c */
+extern CS_RETCODE CS_PUBLIC ex_sink_lookup(
+	CS_CHAR *name,
+	CS_INT *format
+	);
+extern CS_VOID CS_PUBLIC ex_sink_set_default(
+	CS_INT format
+	);
+extern CS_INT CS_PUBLIC ex_sink_default(
+	CS_VOID
+	);
+extern CS_RETCODE CS_PUBLIC ex_sink_begin(
+	EX_SINK *sink,
+	CS_INT format,
+	EX_WRITER *writer,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_sink_begin_body(
+	EX_SINK *sink,
+	CS_INT format,
+	EX_WRITER *writer,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_sink_rows(
+	EX_SINK *sink,
+	EX_COLBATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_sink_range(
+	EX_SINK *sink,
+	EX_COLBATCH *batch,
+	CS_INT first,
+	CS_INT count
+	);
+extern CS_VOID CS_PUBLIC ex_sink_row_failed(
+	EX_SINK *sink,
+	CS_INT row
+	);
+extern CS_RETCODE CS_PUBLIC ex_sink_end(
+	EX_SINK *sink
+	);
+
+#endif /* EXSINK_H */
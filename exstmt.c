@@ -0,0 +1,444 @@
+/*
+** exstmt.c
+** --------
+**
+** Description
+** -----------
+**	Per-connection cache of prepared (dynamic SQL) statements.
+**
+**	ex_stmt_execute() looks the statement text up in the cache of its
+**	connection. The first time a text is seen it is prepared on the
+**	server with ct_dynamic(CS_PREPARE) under a generated id; after
+**	that only ct_dynamic(CS_EXECUTE) and the ct_param() values are
+**	sent, so the server doesn't parse and compile the statement
+**	again. The least recently used statement is deallocated on the
+**	server when the cache is full.
+**
+**	The cache hangs off the CS_USERDATA property of the connection
+**	and is freed by ex_stmt_release(), which ex_con_cleanup() calls.
+**	A prepared statement refers to the objects of the database it was
+**	prepared in, so ex_use_db(), ex_create_db() and ex_pool_checkin()
+**	release the cache too, before the database can change. A
+**	connection is only ever used by one thread at a time, so the
+**	cache needs no locking.
+**
+** Routines Used
+** -------------
+**	ct_dynamic, ct_param, ct_send, ct_results, ct_cancel, ct_con_props
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exfprint.h"
+#include "exstmt.h"
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC EX_STMT_CACHE *ex_stmt_cache(
+	CS_CONNECTION *connection,
+	CS_BOOL create
+	);
+CS_STATIC CS_RETCODE ex_stmt_prepare(
+	CS_CONNECTION *connection,
+	CS_COMMAND *cmd,
+	EX_STMT_CACHE *cache,
+	CS_CHAR *text,
+	CS_UBIGINT hash,
+	EX_STMT **stmtp
+	);
+CS_STATIC CS_RETCODE ex_stmt_dealloc(
+	CS_CONNECTION *connection,
+	EX_STMT *stmt
+	);
+CS_STATIC CS_RETCODE ex_stmt_results(
+	CS_COMMAND *cmd
+	);
+
+/*
+** ex_stmt_execute()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Executes a statement as a prepared statement, preparing it first
+**	if it isn't in the cache of the connection. The results are left
+**	pending on the returned command, to be processed with ct_results()
+**	as for a language command.
+**
+** Parameters:
+** 	connection	- The connection; it must have no results pending.
+** 	text		- The statement, with a "?" for each parameter.
+** 	nparams		- Number of parameters.
+** 	params		- The parameter values, NULL if nparams is 0.
+** 	cmd		- Set to the command the statement was sent on; the
+**			  caller drops it with ct_cmd_drop().
+**
+** Returns:
+** 	CS_SUCCEED, or the result of the CT-Lib call that failed (*cmd
+**	is NULL then).
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_stmt_execute(CS_CONNECTION *connection, CS_CHAR *text, CS_INT nparams,
+		EX_STMT_PARAM *params, CS_COMMAND **cmd)
+{
+	EX_STMT_CACHE	*cache;
+	EX_STMT		*stmt = NULL;
+	CS_UBIGINT	hash;
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	*cmd = NULL;
+
+	if ((cache = ex_stmt_cache(connection, CS_TRUE)) == NULL)
+	{
+		return CS_MEM_ERROR;
+	}
+
+	hash = ex_fprint_hash(text, strlen(text));
+	cache->clock++;
+	for (i = 0; i < EX_STMT_CACHE_SIZE; i++)
+	{
+		if (cache->stmts[i].used && cache->stmts[i].hash == hash
+			&& strcmp(cache->stmts[i].text, text) == 0)
+		{
+			stmt = &cache->stmts[i];
+			break;
+		}
+	}
+
+	if ((retcode = ct_cmd_alloc(connection, cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_execute: ct_cmd_alloc() failed");
+		*cmd = NULL;
+		return retcode;
+	}
+
+	if (stmt != NULL)
+	{
+		cache->hits++;
+	}
+	else
+	{
+		cache->misses++;
+		retcode = ex_stmt_prepare(connection, *cmd, cache, text, hash,
+				&stmt);
+		if (retcode != CS_SUCCEED)
+		{
+			(CS_VOID)ct_cmd_drop(*cmd);
+			*cmd = NULL;
+			return retcode;
+		}
+	}
+	stmt->lastuse = cache->clock;
+
+	retcode = ct_dynamic(*cmd, CS_EXECUTE, stmt->id, CS_NULLTERM, NULL,
+			CS_UNUSED);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_execute: ct_dynamic(CS_EXECUTE) failed");
+	}
+	for (i = 0; i < nparams && retcode == CS_SUCCEED; i++)
+	{
+		retcode = ct_param(*cmd, &params[i].datafmt, params[i].data,
+				params[i].datalen, params[i].indicator);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_stmt_execute: ct_param() failed");
+		}
+	}
+	if (retcode == CS_SUCCEED && (retcode = ct_send(*cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_execute: ct_send() failed");
+	}
+
+	if (retcode != CS_SUCCEED)
+	{
+		(CS_VOID)ct_cmd_drop(*cmd);
+		*cmd = NULL;
+	}
+	return retcode;
+}
+
+/*
+** ex_stmt_release()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Frees the statement cache of a connection that is about to be
+**	closed or to change database. When the connection is healthy the
+**	statements are also deallocated on the server; otherwise they go
+**	away with the connection. The next ex_stmt_execute() starts a new
+**	cache.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	status		- Status of the last interaction with the
+**			  connection, as for ex_con_cleanup().
+**
+** Returns:
+** 	CS_SUCCEED, or the result of a deallocation that failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_stmt_release(CS_CONNECTION *connection, CS_RETCODE status)
+{
+	EX_STMT_CACHE	*cache;
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_RETCODE	ret;
+	CS_VOID		*none = NULL;
+	CS_INT		i;
+
+	if ((cache = ex_stmt_cache(connection, CS_FALSE)) == NULL)
+	{
+		return CS_SUCCEED;
+	}
+
+	for (i = 0; i < EX_STMT_CACHE_SIZE; i++)
+	{
+		if (!cache->stmts[i].used)
+		{
+			continue;
+		}
+		if (status == CS_SUCCEED && retcode == CS_SUCCEED)
+		{
+			ret = ex_stmt_dealloc(connection, &cache->stmts[i]);
+			if (ret != CS_SUCCEED)
+			{
+				retcode = ret;
+			}
+		}
+		free(cache->stmts[i].text);
+	}
+
+	(CS_VOID)ct_con_props(connection, CS_SET, CS_USERDATA, &none,
+			CS_SIZEOF(none), NULL);
+	free(cache);
+
+	return retcode;
+}
+
+/*
+** ex_stmt_cache()
+**
+** Purpose:
+** 	Returns the statement cache of a connection, creating it if asked
+**	to. NULL if there is none.
+*/
+
+CS_STATIC EX_STMT_CACHE *
+ex_stmt_cache(CS_CONNECTION *connection, CS_BOOL create)
+{
+	EX_STMT_CACHE	*cache = NULL;
+
+	if (ct_con_props(connection, CS_GET, CS_USERDATA, &cache,
+			CS_SIZEOF(cache), NULL) != CS_SUCCEED)
+	{
+		cache = NULL;
+	}
+	if (cache != NULL || !create)
+	{
+		return cache;
+	}
+
+	if ((cache = (EX_STMT_CACHE *)calloc(1, sizeof (EX_STMT_CACHE))) == NULL)
+	{
+		ex_error("ex_stmt_cache: calloc() failed");
+		return NULL;
+	}
+	if (ct_con_props(connection, CS_SET, CS_USERDATA, &cache,
+			CS_SIZEOF(cache), NULL) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_cache: ct_con_props(CS_USERDATA) failed");
+		free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+/*
+** ex_stmt_prepare()
+**
+** Purpose:
+** 	Prepares text on the server on cmd, a command of connection, and
+**	adds it to the cache, deallocating the least recently used
+**	statement if the cache is full.
+*/
+
+CS_STATIC CS_RETCODE
+ex_stmt_prepare(CS_CONNECTION *connection, CS_COMMAND *cmd,
+		EX_STMT_CACHE *cache, CS_CHAR *text, CS_UBIGINT hash,
+		EX_STMT **stmtp)
+{
+	EX_STMT		*stmt = NULL;
+	CS_RETCODE	retcode;
+	CS_INT		i;
+
+	/*
+	** Take a free slot, or the one used the longest time ago.
+	*/
+	for (i = 0; i < EX_STMT_CACHE_SIZE; i++)
+	{
+		if (!cache->stmts[i].used)
+		{
+			stmt = &cache->stmts[i];
+			break;
+		}
+		if (stmt == NULL || cache->stmts[i].lastuse < stmt->lastuse)
+		{
+			stmt = &cache->stmts[i];
+		}
+	}
+
+	if (stmt->used)
+	{
+		cache->evictions++;
+		retcode = ex_stmt_dealloc(connection, stmt);
+		free(stmt->text);
+		stmt->used = CS_FALSE;
+		if (retcode != CS_SUCCEED)
+		{
+			return retcode;
+		}
+	}
+
+	memset(stmt, 0, sizeof (EX_STMT));
+	if ((stmt->text = strdup(text)) == NULL)
+	{
+		ex_error("ex_stmt_prepare: strdup() failed");
+		return CS_MEM_ERROR;
+	}
+	stmt->hash = hash;
+	sprintf(stmt->id, "%s%d", EX_STMT_ID_PREFIX, ++cache->nextid);
+
+	retcode = ct_dynamic(cmd, CS_PREPARE, stmt->id, CS_NULLTERM, text,
+			CS_NULLTERM);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_prepare: ct_dynamic(CS_PREPARE) failed");
+	}
+	else if ((retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_prepare: ct_send() failed");
+	}
+	else if ((retcode = ex_stmt_results(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_prepare: The following statement could not be prepared:");
+		ex_error(text);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		free(stmt->text);
+		stmt->text = NULL;
+		return retcode;
+	}
+
+	stmt->used = CS_TRUE;
+	*stmtp = stmt;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_stmt_dealloc()
+**
+** Purpose:
+** 	Deallocates a prepared statement on the server. The cache entry
+**	is left to the caller.
+*/
+
+CS_STATIC CS_RETCODE
+ex_stmt_dealloc(CS_CONNECTION *connection, EX_STMT *stmt)
+{
+	CS_COMMAND	*cmd;
+	CS_RETCODE	retcode;
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_dealloc: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	retcode = ct_dynamic(cmd, CS_DEALLOC, stmt->id, CS_NULLTERM, NULL,
+			CS_UNUSED);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_dealloc: ct_dynamic(CS_DEALLOC) failed");
+	}
+	else if ((retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_dealloc: ct_send() failed");
+	}
+	else if ((retcode = ex_stmt_results(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_dealloc: deallocation failed");
+	}
+
+	if (ct_cmd_drop(cmd) != CS_SUCCEED)
+	{
+		ex_error("ex_stmt_dealloc: ct_cmd_drop() failed");
+		retcode = CS_FAIL;
+	}
+
+	return retcode;
+}
+
+/*
+** ex_stmt_results()
+**
+** Purpose:
+** 	Processes the results of a prepare or deallocate, which return no
+**	rows, leaving the command ready for its next use.
+*/
+
+CS_STATIC CS_RETCODE
+ex_stmt_results(CS_COMMAND *cmd)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_INT		restype;
+
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_CMD_SUCCEED:
+		    case CS_CMD_DONE:
+			break;
+
+		    case CS_CMD_FAIL:
+			query_code = CS_FAIL;
+			break;
+
+		    default:
+			/*
+			** Nothing else is expected; throw it away.
+			*/
+			query_code = CS_FAIL;
+			if (ct_cancel(NULL, cmd, CS_CANCEL_CURRENT) != CS_SUCCEED)
+			{
+				ex_error("ex_stmt_results: ct_cancel() failed");
+				return CS_FAIL;
+			}
+			break;
+		}
+	}
+
+	if (retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_stmt_results: ct_results() failed");
+		return CS_FAIL;
+	}
+
+	return query_code;
+}
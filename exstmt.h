@@ -0,0 +1,76 @@
+/*
+** exstmt.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the prepared statement cache in
+**	exstmt.c.
+*/
+
+#ifndef EXSTMT_H
+#define EXSTMT_H
+
+/*
+** Number of prepared statements kept per connection. Preparing one
+** more deallocates the least recently used.
+*/
+#define EX_STMT_CACHE_SIZE	32
+
+/*
+** Prefix of the dynamic statement ids; a per connection sequence
+** number is appended.
+*/
+#define EX_STMT_ID_PREFIX	"exstmt"
+
+/*
+** A parameter of a prepared statement, in the order of its "?"
+** placeholder. Set indicator to CS_NULLDATA to send a NULL.
+*/
+typedef struct _ex_stmt_param
+{
+	CS_DATAFMT	datafmt;
+	CS_VOID		*data;
+	CS_INT		datalen;
+	CS_SMALLINT	indicator;
+} EX_STMT_PARAM;
+
+/*
+** A statement prepared on the server.
+*/
+typedef struct _ex_stmt
+{
+	CS_BOOL		used;
+	CS_UBIGINT	hash;		/* hash of text */
+	CS_CHAR		*text;
+	CS_CHAR		id[CS_MAX_NAME];
+	CS_INT		lastuse;	/* value of the cache clock */
+} EX_STMT;
+
+/*
+** The statements of one connection, kept in its CS_USERDATA.
+*/
+typedef struct _ex_stmt_cache
+{
+	CS_INT		clock;		/* bumped on every lookup */
+	CS_INT		nextid;
+	CS_INT		hits;
+	CS_INT		misses;
+	CS_INT		evictions;
+	EX_STMT		stmts[EX_STMT_CACHE_SIZE];
+} EX_STMT_CACHE;
+
+/* exstmt.c */
+extern CS_RETCODE CS_PUBLIC ex_stmt_execute(
+	CS_CONNECTION *connection,
+	CS_CHAR *text,
+	CS_INT nparams,
+	EX_STMT_PARAM *params,
+	CS_COMMAND **cmd
+	);
+extern CS_RETCODE CS_PUBLIC ex_stmt_release(
+	CS_CONNECTION *connection,
+	CS_RETCODE status
+	);
+
+#endif /* EXSTMT_H */
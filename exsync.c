@@ -0,0 +1,544 @@
+/*
+** exsync.c
+** --------
+**
+** Description
+** -----------
+**	Pipelined text sync.
+**
+**	Rewriting the text of many rows one after the other leaves each
+**	connection idle half of the time: the value of a row has to be
+**	read before it can be changed and sent back, and the next row is
+**	not read until the update is done. ex_sync_text() reads on one
+**	connection and updates on another, at the same time: a reader
+**	thread selects the rows one by one into a ring of window slots
+**	while the calling thread passes each read row through a routine
+**	of the caller's and sends it back, so row N+1 is read while the
+**	update of row N goes out. The reader stops when window rows are
+**	read and not yet updated, which bounds the memory held; window 1
+**	runs the stages in turn.
+**
+**	Each row is selected with a statement of its own, completed
+**	before the update of the row starts, so the reader never holds
+**	a lock the updater waits for. The keys are read first, in one
+**	query. Values move in chunks both ways (see extext.c).
+**
+** Routines Used
+** -------------
+**	ct_cmd_alloc, ct_command, ct_send, ct_results, ct_bind, ct_fetch,
+**	ct_get_data, ct_data_info, ct_send_data, ct_cancel, ct_cmd_drop,
+**	pthread_create, pthread_join
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exwriter.h"
+#include "extext.h"
+#include "exsync.h"
+
+/*
+** A row between the stages.
+*/
+typedef struct _ex_sync_slot
+{
+	CS_INT		key;
+	CS_IODESC	iodesc;
+	EX_WRITER	value;		/* in memory */
+} EX_SYNC_SLOT;
+
+/*
+** State shared by the reader thread and the updater.
+*/
+typedef struct _ex_sync
+{
+	pthread_mutex_t	lock;
+	pthread_cond_t	filled;		/* a slot was read, or reading ended */
+	pthread_cond_t	freed;		/* a slot was updated, or updating
+					** stopped */
+	EX_SYNC_SLOT	*slots;
+	CS_INT		window;
+	CS_INT		head;		/* slot to update next */
+	CS_INT		count;		/* slots read and not yet updated */
+	CS_BOOL		done;		/* the reader is finished */
+	CS_BOOL		stop;		/* the updater gave up */
+	CS_CONNECTION	*connection;	/* the reader's */
+	CS_CHAR		*table;
+	CS_CHAR		*keycol;
+	CS_CHAR		*textcol;
+	CS_INT		*keys;
+	CS_INT		nkeys;
+	CS_RETCODE	status;		/* the reader's */
+	EX_SYNC_STATS	*stats;
+} EX_SYNC;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_sync_keys(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_CHAR *keycol,
+	CS_INT **keys,
+	CS_INT *nkeys
+	);
+CS_STATIC CS_VOID *ex_sync_reader(
+	CS_VOID *arg
+	);
+CS_STATIC CS_RETCODE ex_sync_read(
+	EX_SYNC *sync,
+	CS_COMMAND *cmd,
+	EX_TEXT_READER *reader,
+	EX_SYNC_SLOT *slot
+	);
+
+/*
+** ex_sync_text()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Rewrites the text or image value of every row of a table through
+**	a routine, reading on one connection while updating on another.
+**	Rows whose value is null have no text pointer and are skipped.
+**
+** Parameters:
+** 	reader		- Connection the rows are read on, used by another
+**			  thread while the sync runs.
+** 	updater		- Connection the rows are updated on.
+** 	table		- Table name, qualified as needed.
+** 	keycol		- Integer column identifying the rows.
+** 	textcol		- Text or image column to rewrite.
+** 	window		- Most rows read and not yet updated, 1 to
+**			  EX_SYNC_MAX_WINDOW; EX_SYNC_WINDOW when 0 or less.
+** 	fn		- Routine rewriting a value, NULL to send it back
+**			  unchanged.
+** 	arg		- First argument of fn.
+** 	stats		- Filled in, may be NULL.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a row could not be read, rewritten or
+**	updated; the rows before it are updated.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_sync_text(CS_CONNECTION *reader, CS_CONNECTION *updater, CS_CHAR *table,
+	     CS_CHAR *keycol, CS_CHAR *textcol, CS_INT window, EX_SYNC_FN fn,
+	     CS_VOID *arg, EX_SYNC_STATS *stats)
+{
+	EX_SYNC		sync;
+	EX_SYNC_STATS	local;
+	EX_SYNC_SLOT	*slot;
+	EX_TEXT_WRITER	writer;
+	EX_TEXT_MEM	mem;
+	CS_COMMAND	*cmd = NULL;
+	CS_RETCODE	retcode;
+	pthread_t	thread;
+	CS_BIGINT	start;
+	CS_BIGINT	t;
+	CS_INT		opened;
+	CS_INT		i;
+
+	if (window <= 0)
+	{
+		window = EX_SYNC_WINDOW;
+	}
+	if (window > EX_SYNC_MAX_WINDOW)
+	{
+		ex_error("ex_sync_text: window out of range");
+		return CS_FAIL;
+	}
+
+	if (stats == NULL)
+	{
+		stats = &local;
+	}
+	memset(stats, 0, sizeof (EX_SYNC_STATS));
+	stats->window = window;
+	start = ex_usecs();
+
+	memset(&sync, 0, sizeof (sync));
+	sync.window = window;
+	sync.connection = reader;
+	sync.table = table;
+	sync.keycol = keycol;
+	sync.textcol = textcol;
+	sync.stats = stats;
+	sync.status = CS_SUCCEED;
+
+	retcode = ex_sync_keys(reader, table, keycol, &sync.keys, &sync.nkeys);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	sync.slots = (EX_SYNC_SLOT *)calloc(window, sizeof (EX_SYNC_SLOT));
+	if (sync.slots == NULL)
+	{
+		ex_error("ex_sync_text: calloc() failed");
+		free(sync.keys);
+		return CS_MEM_ERROR;
+	}
+	for (opened = 0; opened < window && retcode == CS_SUCCEED; opened++)
+	{
+		retcode = ex_writer_open(&sync.slots[opened].value, -1,
+				EX_TEXT_CHUNK);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_text_writer_init(&writer, EX_TEXT_CHUNK);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		if ((retcode = ct_cmd_alloc(updater, &cmd)) != CS_SUCCEED)
+		{
+			ex_error("ex_sync_text: ct_cmd_alloc() failed");
+			ex_text_writer_free(&writer);
+		}
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		for (i = 0; i < opened; i++)
+		{
+			ex_writer_close(&sync.slots[i].value);
+		}
+		free(sync.slots);
+		free(sync.keys);
+		return retcode;
+	}
+
+	pthread_mutex_init(&sync.lock, NULL);
+	pthread_cond_init(&sync.filled, NULL);
+	pthread_cond_init(&sync.freed, NULL);
+
+	if (pthread_create(&thread, NULL, ex_sync_reader, &sync) != 0)
+	{
+		ex_error("ex_sync_text: can't start the reader");
+		retcode = CS_FAIL;
+	}
+
+	/*
+	** Update the rows as the reader hands them over. A slot stays
+	** taken until its update is done.
+	*/
+	while (retcode == CS_SUCCEED)
+	{
+		t = ex_usecs();
+		pthread_mutex_lock(&sync.lock);
+		while (sync.count == 0 && !sync.done)
+		{
+			pthread_cond_wait(&sync.filled, &sync.lock);
+		}
+		if (sync.count == 0)
+		{
+			pthread_mutex_unlock(&sync.lock);
+			break;
+		}
+		slot = &sync.slots[sync.head];
+		pthread_mutex_unlock(&sync.lock);
+		stats->updatewait += ex_usecs() - t;
+
+		t = ex_usecs();
+		if (slot->iodesc.textptrlen == 0)
+		{
+			stats->skipped++;
+		}
+		else if (fn != NULL
+			&& (retcode = (*fn)(arg, slot->key, &slot->value))
+				!= CS_SUCCEED)
+		{
+			ex_error("ex_sync_text: the rewrite failed");
+		}
+		else
+		{
+			mem.data = (CS_BYTE *)slot->value.buf;
+			mem.len = slot->value.len;
+			mem.pos = 0;
+			retcode = ex_text_update(&writer, cmd, &slot->iodesc,
+					mem.len, ex_text_source_mem, &mem);
+			if (retcode == CS_SUCCEED)
+			{
+				stats->rows++;
+				stats->bytessent += writer.bytes;
+			}
+		}
+		stats->updatetime += ex_usecs() - t;
+
+		pthread_mutex_lock(&sync.lock);
+		if (retcode == CS_SUCCEED)
+		{
+			sync.head = (sync.head + 1) % sync.window;
+			sync.count--;
+		}
+		else
+		{
+			sync.stop = CS_TRUE;
+		}
+		pthread_cond_signal(&sync.freed);
+		pthread_mutex_unlock(&sync.lock);
+	}
+
+	if (retcode == CS_SUCCEED || sync.stop)
+	{
+		(CS_VOID)pthread_join(thread, NULL);
+		if (sync.status != CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+
+	(CS_VOID)ct_cmd_drop(cmd);
+	ex_text_writer_free(&writer);
+	for (i = 0; i < window; i++)
+	{
+		ex_writer_close(&sync.slots[i].value);
+	}
+	pthread_cond_destroy(&sync.freed);
+	pthread_cond_destroy(&sync.filled);
+	pthread_mutex_destroy(&sync.lock);
+	free(sync.slots);
+	free(sync.keys);
+
+	stats->elapsed = ex_usecs() - start;
+	return retcode;
+}
+
+/*
+** ex_sync_keys()
+**
+** Purpose:
+** 	Reads the non-null keys of a table, in order, into an array the
+**	caller frees.
+*/
+
+CS_STATIC CS_RETCODE
+ex_sync_keys(CS_CONNECTION *connection, CS_CHAR *table, CS_CHAR *keycol,
+	     CS_INT **keys, CS_INT *nkeys)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	status = CS_SUCCEED;
+	CS_COMMAND	*cmd;
+	CS_DATAFMT	fmt;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	CS_INT		*grown;
+	CS_INT		size = 0;
+	CS_INT		key;
+	CS_INT		res_type;
+	CS_INT		count;
+
+	*keys = NULL;
+	*nkeys = 0;
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_sync_keys: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	sprintf(cmdbuf, "select %s from %s where %s is not null order by %s",
+		keycol, table, keycol, keycol);
+	retcode = ct_command(cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM, CS_UNUSED);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ct_send(cmd);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_sync_keys: sending the query failed");
+		ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	memset(&fmt, 0, sizeof (fmt));
+	fmt.datatype = CS_INT_TYPE;
+	fmt.maxlength = sizeof (CS_INT);
+	fmt.count = 1;
+	fmt.format = CS_FMT_UNUSED;
+
+	while ((retcode = ct_results(cmd, &res_type)) == CS_SUCCEED)
+	{
+		switch ((int)res_type)
+		{
+		  case CS_ROW_RESULT:
+			if (ct_bind(cmd, 1, &fmt, &key, NULL, NULL) != CS_SUCCEED)
+			{
+				ex_error("ex_sync_keys: ct_bind() failed");
+				status = CS_FAIL;
+				(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+				break;
+			}
+			while (((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED,
+					CS_UNUSED, &count)) == CS_SUCCEED)
+				|| retcode == CS_ROW_FAIL)
+			{
+				if (retcode == CS_ROW_FAIL || status != CS_SUCCEED)
+				{
+					continue;
+				}
+				if (*nkeys == size)
+				{
+					size = (size == 0) ? 256 : size * 2;
+					grown = (CS_INT *)realloc(*keys,
+							size * sizeof (CS_INT));
+					if (grown == NULL)
+					{
+						ex_error("ex_sync_keys: realloc() failed");
+						status = CS_MEM_ERROR;
+						continue;
+					}
+					*keys = grown;
+				}
+				(*keys)[(*nkeys)++] = key;
+			}
+			if (retcode != CS_END_DATA)
+			{
+				ex_error("ex_sync_keys: ct_fetch() failed");
+				status = CS_FAIL;
+			}
+			break;
+
+		  case CS_CMD_FAIL:
+			ex_error("ex_sync_keys: ct_results() returned CS_CMD_FAIL");
+			status = CS_FAIL;
+			break;
+
+		  default:
+			break;
+		}
+	}
+	if (retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_sync_keys: ct_results() failed");
+		status = CS_FAIL;
+	}
+
+	ct_cmd_drop(cmd);
+	if (status != CS_SUCCEED)
+	{
+		free(*keys);
+		*keys = NULL;
+		*nkeys = 0;
+	}
+	return status;
+}
+
+/*
+** ex_sync_reader()
+**
+** Purpose:
+** 	Thread reading the rows into free slots, in key order, until all
+**	are read or the updater stops.
+*/
+
+CS_STATIC CS_VOID *
+ex_sync_reader(CS_VOID *arg)
+{
+	EX_SYNC		*sync = (EX_SYNC *)arg;
+	EX_SYNC_SLOT	*slot;
+	EX_TEXT_READER	reader;
+	CS_COMMAND	*cmd = NULL;
+	CS_BIGINT	t;
+	CS_INT		i;
+
+	memset(&reader, 0, sizeof (reader));
+	if (ct_cmd_alloc(sync->connection, &cmd) != CS_SUCCEED)
+	{
+		ex_error("ex_sync_reader: ct_cmd_alloc() failed");
+		sync->status = CS_FAIL;
+	}
+	else if (ex_text_reader_init(&reader, EX_TEXT_CHUNK) != CS_SUCCEED)
+	{
+		sync->status = CS_FAIL;
+	}
+
+	for (i = 0; i < sync->nkeys && sync->status == CS_SUCCEED; i++)
+	{
+		t = ex_usecs();
+		pthread_mutex_lock(&sync->lock);
+		while (sync->count == sync->window && !sync->stop)
+		{
+			pthread_cond_wait(&sync->freed, &sync->lock);
+		}
+		if (sync->stop)
+		{
+			pthread_mutex_unlock(&sync->lock);
+			break;
+		}
+		slot = &sync->slots[(sync->head + sync->count) % sync->window];
+		pthread_mutex_unlock(&sync->lock);
+		sync->stats->readwait += ex_usecs() - t;
+
+		t = ex_usecs();
+		slot->key = sync->keys[i];
+		sync->status = ex_sync_read(sync, cmd, &reader, slot);
+		sync->stats->readtime += ex_usecs() - t;
+		if (sync->status != CS_SUCCEED)
+		{
+			break;
+		}
+		sync->stats->bytesread += reader.bytes;
+
+		pthread_mutex_lock(&sync->lock);
+		sync->count++;
+		pthread_cond_signal(&sync->filled);
+		pthread_mutex_unlock(&sync->lock);
+	}
+
+	ex_text_reader_free(&reader);
+	if (cmd != NULL)
+	{
+		(CS_VOID)ct_cmd_drop(cmd);
+	}
+
+	pthread_mutex_lock(&sync->lock);
+	sync->done = CS_TRUE;
+	pthread_cond_signal(&sync->filled);
+	pthread_mutex_unlock(&sync->lock);
+
+	return NULL;
+}
+
+/*
+** ex_sync_read()
+**
+** Purpose:
+** 	Reads the value and descriptor of the row of a slot's key into
+**	the slot, and completes the select.
+*/
+
+CS_STATIC CS_RETCODE
+ex_sync_read(EX_SYNC *sync, CS_COMMAND *cmd, EX_TEXT_READER *reader,
+	     EX_SYNC_SLOT *slot)
+{
+	CS_RETCODE	retcode;
+	CS_CHAR		where[CS_MAX_NAME + 32];
+
+	sprintf(where, "%s = %d", sync->keycol, slot->key);
+	slot->value.len = 0;
+	memset(&slot->iodesc, 0, sizeof (CS_IODESC));
+
+	retcode = ex_text_locate(cmd, sync->table, sync->textcol, where);
+	if (retcode != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
+	retcode = ex_text_read(reader, cmd, 1, ex_text_sink_writer,
+			&slot->value);
+	if (retcode == CS_END_ITEM || retcode == CS_END_DATA)
+	{
+		retcode = ct_data_info(cmd, CS_GET, 1, &slot->iodesc);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_sync_read: ct_data_info() failed");
+		}
+	}
+	(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+
+	return retcode;
+}
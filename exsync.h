@@ -0,0 +1,64 @@
+/*
+** exsync.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the pipelined text sync in exsync.c.
+**	exwriter.h must be included first.
+*/
+
+#ifndef EXSYNC_H
+#define EXSYNC_H
+
+/*
+** Default and largest number of rows read ahead of the update going
+** out.
+*/
+#define EX_SYNC_WINDOW		4
+#define EX_SYNC_MAX_WINDOW	64
+
+/*
+** Rewrites the value of the row with the given key before it is sent
+** back; value is a writer in memory holding it, whose buf and len the
+** routine may change. Returns CS_SUCCEED, or anything else to stop.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_SYNC_FN)(
+	CS_VOID *arg,
+	CS_INT key,
+	EX_WRITER *value
+	);
+
+/*
+** What a sync did. Times are in microseconds; the read and update
+** times are summed over the rows, so with the stages overlapped they
+** add up to more than the elapsed time.
+*/
+typedef struct _ex_sync_stats
+{
+	CS_INT		window;
+	CS_BIGINT	rows;		/* values updated */
+	CS_BIGINT	skipped;	/* null values, without a text pointer */
+	CS_BIGINT	bytesread;
+	CS_BIGINT	bytessent;
+	CS_BIGINT	readtime;
+	CS_BIGINT	updatetime;
+	CS_BIGINT	readwait;	/* reader waiting for a free slot */
+	CS_BIGINT	updatewait;	/* updater waiting for a read row */
+	CS_BIGINT	elapsed;
+} EX_SYNC_STATS;
+
+/* exsync.c */
+extern CS_RETCODE CS_PUBLIC ex_sync_text(
+	CS_CONNECTION *reader,
+	CS_CONNECTION *updater,
+	CS_CHAR *table,
+	CS_CHAR *keycol,
+	CS_CHAR *textcol,
+	CS_INT window,
+	EX_SYNC_FN fn,
+	CS_VOID *arg,
+	EX_SYNC_STATS *stats
+	);
+
+#endif /* EXSYNC_H */
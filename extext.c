@@ -0,0 +1,909 @@
+/*
+** extext.c
+** --------
+**
+** Description
+** -----------
+**	Streaming text and image values.
+**
+**	A text or image value can be far larger than anything worth
+**	binding or holding in memory. ex_text_read() takes a column of
+**	the current row with ct_get_data(), a chunk at a time into one
+**	buffer of the reader, and hands each chunk to a sink as it comes:
+**	a writer (ex_text_sink_writer(), for a file or a pipe), a running
+**	hash (ex_text_sink_hash()) or a routine of the caller's. A value
+**	of any size then costs one buffer and one call per chunk.
+**
+**	Sending goes the same way round. ex_text_send() takes the length
+**	of the value up front, as ct_data_info() needs it, then pulls the
+**	data from a source a chunk at a time and sends each chunk with one
+**	ct_send_data(). A source either copies into the writer's buffer
+**	(ex_text_source_fd(), for a file or a pipe) or hands out its own
+**	memory (ex_text_source_mem()), which is then sent without a copy.
+**	The writer keeps the bytes, calls and time of the last value.
+**
+**	ex_text_upload() and ex_text_download() move a value between a
+**	file and a column of one row. An upload maps the file and sends
+**	slices of the mapping, so the file is never copied into the
+**	program; a download reserves the file at the length of the value
+**	and writes the chunks out in EX_TEXT_FILEBUF pieces.
+**
+**	The server cuts text and image values at its text size, and
+**	Client-Library at its text limit; ex_text_unlimit() lifts both on
+**	a connection.
+**
+** Routines Used
+** -------------
+**	ct_get_data, ct_send_data, ct_data_info, ct_options, ct_con_props,
+**	ct_command, ct_send, ct_results, ct_fetch, ct_cancel, mmap,
+**	posix_fallocate, ftruncate, unlink
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exwriter.h"
+#include "exfprint.h"
+#include "extext.h"
+
+/*
+** Argument of ex_text_sink_file(): the file a value is downloaded into.
+*/
+typedef struct _ex_text_file
+{
+	EX_WRITER	writer;
+	CS_COMMAND	*cmd;
+	CS_INT		item;
+	CS_BOOL		reserved;	/* file allocated at the value length */
+} EX_TEXT_FILE;
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_text_results(
+	CS_COMMAND *cmd
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC ex_text_sink_file(
+	CS_VOID *arg,
+	CS_BYTE *data,
+	CS_INT len
+	);
+
+/*
+** ex_text_unlimit()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Lets text and image values of up to EX_TEXT_MAXSIZE bytes through
+**	on a connection: sets the server's text size and the client's
+**	text limit.
+**
+** Parameters:
+** 	connection	- The connection.
+**
+** Returns:
+** 	CS_SUCCEED, or the result of the call that failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_unlimit(CS_CONNECTION *connection)
+{
+	CS_RETCODE	retcode;
+	CS_INT		size = EX_TEXT_MAXSIZE;
+	CS_INT		limit = CS_NO_LIMIT;
+
+	if ((retcode = ct_options(connection, CS_SET, CS_OPT_TEXTSIZE, &size,
+			CS_UNUSED, NULL)) != CS_SUCCEED)
+	{
+		ex_error("ex_text_unlimit: ct_options(CS_OPT_TEXTSIZE) failed");
+		return retcode;
+	}
+	if ((retcode = ct_con_props(connection, CS_SET, CS_TEXTLIMIT, &limit,
+			CS_UNUSED, NULL)) != CS_SUCCEED)
+	{
+		ex_error("ex_text_unlimit: ct_con_props(CS_TEXTLIMIT) failed");
+	}
+	return retcode;
+}
+
+/*
+** ex_text_reader_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up a reader and allocates its chunk buffer.
+**
+** Parameters:
+** 	reader		- The reader.
+** 	chunk		- Bytes per chunk, EX_TEXT_CHUNK when 0 or less.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_reader_init(EX_TEXT_READER *reader, CS_INT chunk)
+{
+	memset(reader, 0, sizeof (EX_TEXT_READER));
+	reader->chunk = (chunk > 0) ? chunk : EX_TEXT_CHUNK;
+
+	if ((reader->buf = (CS_BYTE *)malloc(reader->chunk)) == NULL)
+	{
+		ex_error("ex_text_reader_init: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ex_text_read()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Streams a column of the current row to a sink. The column must
+**	not be bound, nor be before a column already read with
+**	ct_get_data().
+**
+** Parameters:
+** 	reader		- The reader.
+** 	cmd		- Command with a fetched row.
+** 	item		- Column number.
+** 	sink		- Routine the chunks go to.
+** 	arg		- First argument of sink.
+**
+** Returns:
+** 	CS_END_ITEM, or CS_END_DATA if the column was the last one, as
+**	ct_get_data(); CS_FAIL if the sink stopped, or the failure of
+**	ct_get_data(). reader->bytes is the length of the value.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_read(EX_TEXT_READER *reader, CS_COMMAND *cmd, CS_INT item,
+	     EX_TEXT_SINK sink, CS_VOID *arg)
+{
+	CS_RETCODE	retcode;
+	CS_INT		len;
+
+	reader->bytes = 0;
+	reader->calls = 0;
+	do
+	{
+		len = 0;
+		retcode = ct_get_data(cmd, item, reader->buf, reader->chunk, &len);
+		reader->calls++;
+		if (retcode != CS_SUCCEED && retcode != CS_END_ITEM
+			&& retcode != CS_END_DATA)
+		{
+			ex_error("ex_text_read: ct_get_data() failed");
+			return retcode;
+		}
+		if (len > 0)
+		{
+			reader->bytes += len;
+			if ((*sink)(arg, reader->buf, len) != CS_SUCCEED)
+			{
+				ex_error("ex_text_read: the sink failed");
+				return CS_FAIL;
+			}
+		}
+	} while (retcode == CS_SUCCEED);
+
+	return retcode;
+}
+
+/*
+** ex_text_reader_free()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Frees the buffer of a reader.
+*/
+
+CS_VOID CS_PUBLIC
+ex_text_reader_free(EX_TEXT_READER *reader)
+{
+	free(reader->buf);
+	reader->buf = NULL;
+}
+
+/*
+** ex_text_writer_init()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up a writer and allocates its chunk buffer.
+**
+** Parameters:
+** 	writer		- The writer.
+** 	chunk		- Bytes per chunk, EX_TEXT_CHUNK when 0 or less.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_writer_init(EX_TEXT_WRITER *writer, CS_INT chunk)
+{
+	memset(writer, 0, sizeof (EX_TEXT_WRITER));
+	writer->chunk = (chunk > 0) ? chunk : EX_TEXT_CHUNK;
+
+	if ((writer->buf = (CS_BYTE *)malloc(writer->chunk)) == NULL)
+	{
+		ex_error("ex_text_writer_init: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ex_text_send()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sends a value of total bytes from a source. The command must have
+**	been initiated with ct_command(CS_SEND_DATA_CMD); the caller
+**	ct_send()s it and processes the results afterwards.
+**
+** Parameters:
+** 	writer		- The writer.
+** 	cmd		- The command.
+** 	iodesc		- Descriptor of the column, as ct_data_info(CS_GET)
+**			  gave it; its total_txtlen is set to total.
+** 	total		- Length of the value.
+** 	source		- Routine the chunks come from.
+** 	arg		- First argument of source.
+**
+** Returns:
+** 	CS_SUCCEED, CS_FAIL if the source failed or ended short of
+**	total, or the failure of ct_data_info() or ct_send_data().
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_send(EX_TEXT_WRITER *writer, CS_COMMAND *cmd, CS_IODESC *iodesc,
+	     CS_BIGINT total, EX_TEXT_SOURCE source, CS_VOID *arg)
+{
+	CS_RETCODE	retcode;
+	CS_BIGINT	start;
+	CS_BYTE		*data;
+	CS_INT		want;
+	CS_INT		len;
+	CS_CHAR		buf[EX_BUFSIZE];
+
+	writer->bytes = 0;
+	writer->calls = 0;
+	writer->usecs = 0;
+	if (total < 0 || total > EX_TEXT_MAXSIZE)
+	{
+		ex_error("ex_text_send: bad value length");
+		return CS_FAIL;
+	}
+
+	start = ex_usecs();
+	iodesc->total_txtlen = (CS_INT)total;
+	if ((retcode = ct_data_info(cmd, CS_SET, CS_UNUSED, iodesc)) != CS_SUCCEED)
+	{
+		ex_error("ex_text_send: ct_data_info() failed");
+		return retcode;
+	}
+
+	while (writer->bytes < total)
+	{
+		want = writer->chunk;
+		if (total - writer->bytes < want)
+		{
+			want = (CS_INT)(total - writer->bytes);
+		}
+
+		data = writer->buf;
+		len = 0;
+		retcode = (*source)(arg, writer->buf, want, &data, &len);
+		if (retcode == CS_END_DATA || (retcode == CS_SUCCEED && len <= 0))
+		{
+			sprintf(buf, "ex_text_send: the source ended after %lld of %lld bytes",
+				(long long)writer->bytes, (long long)total);
+			ex_error(buf);
+			return CS_FAIL;
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_text_send: the source failed");
+			return CS_FAIL;
+		}
+		if (len > want)
+		{
+			len = want;
+		}
+
+		if ((retcode = ct_send_data(cmd, data, len)) != CS_SUCCEED)
+		{
+			ex_error("ex_text_send: ct_send_data() failed");
+			return retcode;
+		}
+		writer->bytes += len;
+		writer->calls++;
+	}
+
+	writer->usecs = ex_usecs() - start;
+	return CS_SUCCEED;
+}
+
+/*
+** ex_text_update()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Replaces a text or image value: initiates a CS_SEND_DATA_CMD on
+**	cmd, sends total bytes from a source with ex_text_send() and
+**	processes the results, whose new text timestamp is discarded.
+**
+** Parameters:
+** 	writer		- The writer.
+** 	cmd		- An idle command.
+** 	iodesc		- Descriptor of the value, as ct_data_info(CS_GET)
+**			  gave it.
+** 	total		- Length of the new value.
+** 	source		- Routine the chunks come from.
+** 	arg		- First argument of source.
+**
+** Returns:
+** 	CS_SUCCEED, or a failure code.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_update(EX_TEXT_WRITER *writer, CS_COMMAND *cmd, CS_IODESC *iodesc,
+	       CS_BIGINT total, EX_TEXT_SOURCE source, CS_VOID *arg)
+{
+	CS_RETCODE	retcode;
+
+	retcode = ct_command(cmd, CS_SEND_DATA_CMD, NULL, CS_UNUSED,
+			CS_COLUMN_DATA);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_text_update: ct_command() failed");
+		return retcode;
+	}
+
+	iodesc->log_on_update = CS_TRUE;
+	retcode = ex_text_send(writer, cmd, iodesc, total, source, arg);
+	if (retcode == CS_SUCCEED)
+	{
+		if ((retcode = ct_send(cmd)) != CS_SUCCEED)
+		{
+			ex_error("ex_text_update: ct_send() failed");
+		}
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+		return retcode;
+	}
+	return ex_text_results(cmd);
+}
+
+/*
+** ex_text_writer_free()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Frees the buffer of a writer.
+*/
+
+CS_VOID CS_PUBLIC
+ex_text_writer_free(EX_TEXT_WRITER *writer)
+{
+	free(writer->buf);
+	writer->buf = NULL;
+}
+
+/*
+** ex_text_sink_writer()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Text sink writing the chunks through a writer, whose argument is
+**	the EX_WRITER. Chunks larger than the writer's buffer are written
+**	from where they are.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_sink_writer(CS_VOID *arg, CS_BYTE *data, CS_INT len)
+{
+	return ex_writer_write((EX_WRITER *)arg, (CS_CHAR *)data, len);
+}
+
+/*
+** ex_text_sink_hash()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Text sink hashing the chunks, whose argument is a CS_UBIGINT set
+**	to EX_FPRINT_HASH_INIT before the value; it ends up as the
+**	ex_fprint_hash() of the whole value.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_sink_hash(CS_VOID *arg, CS_BYTE *data, CS_INT len)
+{
+	CS_UBIGINT	*h = (CS_UBIGINT *)arg;
+
+	*h = ex_fprint_hash_more(*h, (CS_CHAR *)data, len);
+	return CS_SUCCEED;
+}
+
+/*
+** ex_text_source_mem()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Text source handing out a value held in memory, whose argument
+**	is an EX_TEXT_MEM. The chunks are sent from where they are.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_source_mem(CS_VOID *arg, CS_BYTE *buf, CS_INT buflen, CS_BYTE **data,
+		   CS_INT *outlen)
+{
+	EX_TEXT_MEM	*mem = (EX_TEXT_MEM *)arg;
+
+	if (mem->pos >= mem->len)
+	{
+		*outlen = 0;
+		return CS_END_DATA;
+	}
+
+	*data = mem->data + mem->pos;
+	*outlen = buflen;
+	if (mem->len - mem->pos < buflen)
+	{
+		*outlen = (CS_INT)(mem->len - mem->pos);
+	}
+	mem->pos += *outlen;
+	return CS_SUCCEED;
+}
+
+/*
+** ex_text_source_fd()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Text source reading a file or a pipe, whose argument points to
+**	the int file descriptor. Fills the chunk unless the input ends.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_source_fd(CS_VOID *arg, CS_BYTE *buf, CS_INT buflen, CS_BYTE **data,
+		  CS_INT *outlen)
+{
+	int		fd = *(int *)arg;
+	ssize_t		n;
+
+	*outlen = 0;
+	while (*outlen < buflen)
+	{
+		n = read(fd, buf + *outlen, buflen - *outlen);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n < 0)
+		{
+			ex_error("ex_text_source_fd: read() failed");
+			return CS_FAIL;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		*outlen += (CS_INT)n;
+	}
+	return (*outlen > 0) ? CS_SUCCEED : CS_END_DATA;
+}
+
+/*
+** ex_text_upload()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Replaces the text or image value of column in the one row of
+**	table matching where with the contents of a file. The file is
+**	mapped and sent from the mapping. The column must not be null,
+**	since a null value has no text pointer to update through.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	table		- The table.
+** 	column		- The text or image column.
+** 	where		- Search condition selecting the row.
+** 	path		- The file.
+** 	bytes		- Set to the bytes sent.
+**
+** Returns:
+** 	CS_SUCCEED, or a failure code.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_upload(CS_CONNECTION *connection, CS_CHAR *table, CS_CHAR *column,
+	       CS_CHAR *where, CS_CHAR *path, CS_BIGINT *bytes)
+{
+	CS_RETCODE	retcode;
+	CS_COMMAND	*cmd;
+	CS_IODESC	iodesc;
+	EX_TEXT_WRITER	writer;
+	EX_TEXT_MEM	mem;
+	CS_BYTE		dummy;
+	CS_INT		len;
+	struct stat	st;
+	int		fd;
+
+	*bytes = 0;
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		ex_error("ex_text_upload: open() failed");
+		return CS_FAIL;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size > EX_TEXT_MAXSIZE)
+	{
+		ex_error("ex_text_upload: the file is unreadable or too large");
+		close(fd);
+		return CS_FAIL;
+	}
+
+	/*
+	** Map the file; ct_send_data() then takes its slices in place.
+	** An empty file has nothing to map.
+	*/
+	memset(&mem, 0, sizeof (mem));
+	mem.len = st.st_size;
+	if (mem.len > 0)
+	{
+		mem.data = (CS_BYTE *)mmap(NULL, mem.len, PROT_READ, MAP_PRIVATE,
+				fd, 0);
+		if (mem.data == (CS_BYTE *)MAP_FAILED)
+		{
+			ex_error("ex_text_upload: mmap() failed");
+			close(fd);
+			return CS_FAIL;
+		}
+		(CS_VOID)madvise(mem.data, mem.len, MADV_SEQUENTIAL);
+	}
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_text_upload: ct_cmd_alloc() failed");
+	}
+	else
+	{
+		/*
+		** Get the descriptor of the value without its data: a
+		** ct_get_data() of no bytes makes it available.
+		*/
+		retcode = ex_text_locate(cmd, table, column, where);
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = ct_get_data(cmd, 1, &dummy, 0, &len);
+			if (retcode == CS_SUCCEED || retcode == CS_END_ITEM
+				|| retcode == CS_END_DATA)
+			{
+				retcode = ct_data_info(cmd, CS_GET, 1, &iodesc);
+				if (retcode != CS_SUCCEED)
+				{
+					ex_error("ex_text_upload: ct_data_info() failed");
+				}
+			}
+			else
+			{
+				ex_error("ex_text_upload: ct_get_data() failed");
+			}
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+		}
+
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = ex_text_writer_init(&writer, EX_TEXT_CHUNK);
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = ex_text_update(&writer, cmd, &iodesc, mem.len,
+					ex_text_source_mem, &mem);
+			*bytes = writer.bytes;
+			ex_text_writer_free(&writer);
+		}
+		(CS_VOID)ct_cmd_drop(cmd);
+	}
+
+	if (mem.len > 0)
+	{
+		(CS_VOID)munmap(mem.data, mem.len);
+	}
+	close(fd);
+	return retcode;
+}
+
+/*
+** ex_text_download()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Writes the text or image value of column in the one row of table
+**	matching where to a file, which it creates or truncates. A null
+**	value leaves the file empty; a download that fails removes it.
+**
+** Parameters:
+** 	connection	- The connection.
+** 	table		- The table.
+** 	column		- The text or image column.
+** 	where		- Search condition selecting the row.
+** 	path		- The file.
+** 	bytes		- Set to the bytes written.
+**
+** Returns:
+** 	CS_SUCCEED, or a failure code.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_download(CS_CONNECTION *connection, CS_CHAR *table, CS_CHAR *column,
+		 CS_CHAR *where, CS_CHAR *path, CS_BIGINT *bytes)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	ret;
+	CS_COMMAND	*cmd;
+	EX_TEXT_READER	reader;
+	EX_TEXT_FILE	file;
+	int		fd;
+
+	*bytes = 0;
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	{
+		ex_error("ex_text_download: open() failed");
+		return CS_FAIL;
+	}
+	memset(&file, 0, sizeof (file));
+	if ((retcode = ex_writer_open(&file.writer, fd, EX_TEXT_FILEBUF))
+		!= CS_SUCCEED)
+	{
+		close(fd);
+		(CS_VOID)unlink(path);
+		return retcode;
+	}
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_text_download: ct_cmd_alloc() failed");
+	}
+	else
+	{
+		retcode = ex_text_locate(cmd, table, column, where);
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = ex_text_reader_init(&reader, EX_TEXT_CHUNK);
+		}
+		if (retcode == CS_SUCCEED)
+		{
+			file.cmd = cmd;
+			file.item = 1;
+			retcode = ex_text_read(&reader, cmd, 1, ex_text_sink_file,
+					&file);
+			if (retcode == CS_END_ITEM || retcode == CS_END_DATA)
+			{
+				retcode = CS_SUCCEED;
+			}
+			ex_text_reader_free(&reader);
+		}
+		(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+		(CS_VOID)ct_cmd_drop(cmd);
+	}
+
+	/*
+	** Cut off what was reserved and not written. A part of the value
+	** is no use to anyone, so a failed download takes the file with
+	** it rather than leave it reserved at the full length.
+	*/
+	ret = ex_writer_close(&file.writer);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ret;
+	}
+	*bytes = file.writer.bytes;
+	if (retcode == CS_SUCCEED && ftruncate(fd, *bytes) != 0)
+	{
+		ex_error("ex_text_download: ftruncate() failed");
+		retcode = CS_FAIL;
+	}
+	close(fd);
+	if (retcode != CS_SUCCEED)
+	{
+		(CS_VOID)unlink(path);
+		*bytes = 0;
+	}
+	return retcode;
+}
+
+/*
+** ex_text_locate()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Selects column from the row of table matching where and fetches
+**	it, unbound, for ct_get_data(). The caller cancels the rest of
+**	the results once done with the value.
+**
+** Parameters:
+** 	cmd		- An idle command.
+** 	table		- The table.
+** 	column		- The column.
+** 	where		- Search condition selecting the row.
+**
+** Returns:
+** 	CS_SUCCEED with the row fetched, or CS_FAIL if there is none or
+**	the query failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_text_locate(CS_COMMAND *cmd, CS_CHAR *table, CS_CHAR *column,
+	       CS_CHAR *where)
+{
+	CS_RETCODE	retcode;
+	CS_INT		res_type;
+	CS_INT		count;
+	CS_CHAR		*query;
+
+	query = (CS_CHAR *)malloc(strlen(table) + strlen(column)
+			+ strlen(where) + 32);
+	if (query == NULL)
+	{
+		ex_error("ex_text_locate: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+	sprintf(query, "select %s from %s where %s", column, table, where);
+
+	retcode = ct_command(cmd, CS_LANG_CMD, query, CS_NULLTERM, CS_UNUSED);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ct_send(cmd);
+	}
+	free(query);
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_text_locate: sending the query failed");
+		return retcode;
+	}
+
+	while ((retcode = ct_results(cmd, &res_type)) == CS_SUCCEED)
+	{
+		if (res_type == CS_ROW_RESULT)
+		{
+			retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+					&count);
+			if (retcode == CS_SUCCEED)
+			{
+				return CS_SUCCEED;
+			}
+			break;
+		}
+		if (res_type == CS_CMD_FAIL)
+		{
+			break;
+		}
+	}
+
+	ex_error("ex_text_locate: no row matches");
+	(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+	return CS_FAIL;
+}
+
+/*
+** ex_text_results()
+**
+** Purpose:
+** 	Processes the results of a CS_SEND_DATA_CMD, discarding the new
+**	text timestamp it returns.
+*/
+
+CS_STATIC CS_RETCODE
+ex_text_results(CS_COMMAND *cmd)
+{
+	CS_RETCODE	retcode;
+	CS_RETCODE	status = CS_SUCCEED;
+	CS_INT		res_type;
+
+	while ((retcode = ct_results(cmd, &res_type)) == CS_SUCCEED)
+	{
+		switch ((int)res_type)
+		{
+		  case CS_PARAM_RESULT:
+		  case CS_STATUS_RESULT:
+		  case CS_ROW_RESULT:
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+			break;
+
+		  case CS_CMD_FAIL:
+			ex_error("ex_text_results: ct_results() returned CS_CMD_FAIL");
+			status = CS_FAIL;
+			break;
+
+		  default:
+			break;
+		}
+	}
+
+	if (retcode != CS_END_RESULTS)
+	{
+		ex_error("ex_text_results: ct_results() failed");
+		return retcode;
+	}
+	return status;
+}
+
+/*
+** ex_text_sink_file()
+**
+** Purpose:
+** 	Text sink of ex_text_download(). On the first chunk it reserves
+**	the file at the length of the value, which ct_data_info() knows
+**	by then, so the file is laid out once instead of growing with
+**	every write.
+*/
+
+CS_STATIC CS_RETCODE CS_PUBLIC
+ex_text_sink_file(CS_VOID *arg, CS_BYTE *data, CS_INT len)
+{
+	EX_TEXT_FILE	*file = (EX_TEXT_FILE *)arg;
+	CS_IODESC	iodesc;
+	int		err;
+
+	if (!file->reserved)
+	{
+		file->reserved = CS_TRUE;
+		if (ct_data_info(file->cmd, CS_GET, file->item, &iodesc)
+			== CS_SUCCEED && iodesc.total_txtlen > 0)
+		{
+			err = posix_fallocate(file->writer.fd, 0,
+					iodesc.total_txtlen);
+			if (err == ENOSPC)
+			{
+				ex_error("ex_text_sink_file: no space for the value");
+				return CS_FAIL;
+			}
+		}
+	}
+	return ex_writer_write(&file->writer, (CS_CHAR *)data, len);
+}
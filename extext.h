@@ -0,0 +1,177 @@
+/*
+** extext.h
+** --------
+**
+** Description
+** -----------
+**	Defines and prototypes for the streaming text and image routines
+**	in extext.c.
+*/
+
+#ifndef EXTEXT_H
+#define EXTEXT_H
+
+/*
+** Default chunk size of a streamed text or image value.
+*/
+#define EX_TEXT_CHUNK		(64 * 1024)
+
+/*
+** Buffer of the file a value is downloaded into: chunks are written
+** out this many bytes at a time.
+*/
+#define EX_TEXT_FILEBUF		(1024 * 1024)
+
+/*
+** Largest text or image value the server sends when the limits are
+** lifted with ex_text_unlimit().
+*/
+#define EX_TEXT_MAXSIZE		0x7fffffff
+
+/*
+** Receives the chunks of a value in order. Returns CS_SUCCEED to go on,
+** anything else to stop.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_TEXT_SINK)(
+	CS_VOID *arg,
+	CS_BYTE *data,
+	CS_INT len
+	);
+
+/*
+** Supplies the data of a value being sent, up to buflen bytes a call:
+** either copies them into buf or points *data at its own memory, and
+** sets *outlen. Returns CS_SUCCEED, CS_END_DATA when it has no more, or
+** CS_FAIL.
+*/
+typedef CS_RETCODE (CS_PUBLIC *EX_TEXT_SOURCE)(
+	CS_VOID *arg,
+	CS_BYTE *buf,
+	CS_INT buflen,
+	CS_BYTE **data,
+	CS_INT *outlen
+	);
+
+/*
+** Reads text and image columns a chunk at a time into one buffer.
+*/
+typedef struct _ex_text_reader
+{
+	CS_BYTE		*buf;
+	CS_INT		chunk;		/* bytes per ct_get_data() */
+	CS_BIGINT	bytes;		/* of the last value */
+	CS_INT		calls;		/* ct_get_data() calls of the last value */
+} EX_TEXT_READER;
+
+/*
+** Sends text and image values a chunk at a time.
+*/
+typedef struct _ex_text_writer
+{
+	CS_BYTE		*buf;
+	CS_INT		chunk;		/* bytes per ct_send_data() */
+	CS_BIGINT	bytes;		/* of the last value */
+	CS_INT		calls;		/* ct_send_data() calls of the last value */
+	CS_BIGINT	usecs;		/* time spent sending the last value */
+} EX_TEXT_WRITER;
+
+/*
+** Argument of ex_text_source_mem(): a value held in memory.
+*/
+typedef struct _ex_text_mem
+{
+	CS_BYTE		*data;
+	CS_BIGINT	len;
+	CS_BIGINT	pos;		/* bytes handed out */
+} EX_TEXT_MEM;
+
+/* extext.c */
+extern CS_RETCODE CS_PUBLIC ex_text_unlimit(
+	CS_CONNECTION *connection
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_reader_init(
+	EX_TEXT_READER *reader,
+	CS_INT chunk
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_read(
+	EX_TEXT_READER *reader,
+	CS_COMMAND *cmd,
+	CS_INT item,
+	EX_TEXT_SINK sink,
+	CS_VOID *arg
+	);
+extern CS_VOID CS_PUBLIC ex_text_reader_free(
+	EX_TEXT_READER *reader
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_writer_init(
+	EX_TEXT_WRITER *writer,
+	CS_INT chunk
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_send(
+	EX_TEXT_WRITER *writer,
+	CS_COMMAND *cmd,
+	CS_IODESC *iodesc,
+	CS_BIGINT total,
+	EX_TEXT_SOURCE source,
+	CS_VOID *arg
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_update(
+	EX_TEXT_WRITER *writer,
+	CS_COMMAND *cmd,
+	CS_IODESC *iodesc,
+	CS_BIGINT total,
+	EX_TEXT_SOURCE source,
+	CS_VOID *arg
+	);
+extern CS_VOID CS_PUBLIC ex_text_writer_free(
+	EX_TEXT_WRITER *writer
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_sink_writer(
+	CS_VOID *arg,
+	CS_BYTE *data,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_sink_hash(
+	CS_VOID *arg,
+	CS_BYTE *data,
+	CS_INT len
+	);
+
+extern CS_RETCODE CS_PUBLIC ex_text_source_mem(
+	CS_VOID *arg,
+	CS_BYTE *buf,
+	CS_INT buflen,
+	CS_BYTE **data,
+	CS_INT *outlen
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_source_fd(
+	CS_VOID *arg,
+	CS_BYTE *buf,
+	CS_INT buflen,
+	CS_BYTE **data,
+	CS_INT *outlen
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_locate(
+	CS_COMMAND *cmd,
+	CS_CHAR *table,
+	CS_CHAR *column,
+	CS_CHAR *where
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_upload(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_CHAR *column,
+	CS_CHAR *where,
+	CS_CHAR *path,
+	CS_BIGINT *bytes
+	);
+extern CS_RETCODE CS_PUBLIC ex_text_download(
+	CS_CONNECTION *connection,
+	CS_CHAR *table,
+	CS_CHAR *column,
+	CS_CHAR *where,
+	CS_CHAR *path,
+	CS_BIGINT *bytes
+	);
+
+#endif /* EXTEXT_H */
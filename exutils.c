@@ -48,14 +48,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
 #include <ctpublic.h>
 #include <ospublic.h>
 #include <oserror.h>
 #include <ossample.h>
 #include "example.h"
 #include "exutils.h"
+#include "exprefork.h"
+#include "exasync.h"
+#include "exstmt.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
 #include "srv_sleep_sig_11.h"
 
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_BOOL ex_batch_flow(
+	CS_CHAR *stmt
+	);
+CS_STATIC CS_RETCODE ex_batch_run(
+	CS_CONNECTION *connection,
+	EX_BATCH *batch,
+	CS_INT first,
+	CS_INT last,
+	CS_CHAR *text
+	);
+CS_STATIC CS_RETCODE ex_batch_marker(
+	CS_COMMAND *cmd,
+	CS_BOOL *ismarker,
+	CS_INT *error
+	);
+
 /* 
 ** The macro PARTIAL_TEXT to enable partial text update is defined at the
 ** Makefile on uctext.
@@ -126,6 +154,11 @@ ex_display_dlen(CS_DATAFMT *column)
 			len = 11;
 			break;
 
+		case CS_BIGINT_TYPE:
+		case CS_UBIGINT_TYPE:
+			len = 20;
+			break;
+
 		case CS_REAL_TYPE:
 		case CS_FLOAT_TYPE:
 			len = 20;
@@ -161,9 +194,11 @@ ex_display_dlen(CS_DATAFMT *column)
 ** example program api
 **
 ** Purpose:
+** 	Writes the column names of a result set and a line of dashes
+**	under them to standard output; see ex_write_header().
 **
 ** Returns:
-** Nothing.
+** CS_SUCCEED.
 **
 ** Side Effects:
 ** None
@@ -171,38 +206,47 @@ ex_display_dlen(CS_DATAFMT *column)
 
 CS_RETCODE CS_PUBLIC
 ex_display_header(CS_INT numcols, CS_DATAFMT columns[])
+{
+	return ex_write_header(ex_writer_stdout(), numcols, columns);
+}
+
+/*
+** ex_write_header()
+**
+** Type of function:
+** example program api
+**
+** Purpose:
+** 	ex_display_header() to any writer.
+**
+** Returns:
+** CS_SUCCEED.
+**
+** Side Effects:
+** None
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_write_header(EX_WRITER *out, CS_INT numcols, CS_DATAFMT columns[])
 {
 	CS_INT		i;
-	CS_INT		l;
-	CS_INT		j;
 	CS_INT		disp_len;
 
-	fputc('\n', stdout);
+	ex_writer_putc(out, '\n');
 	for (i = 0; i < numcols; i++)
 	{
 		disp_len = ex_display_dlen(&columns[i]);
-		fprintf(stdout, "%s", columns[i].name);
-		fflush(stdout);
-		l = disp_len - strlen(columns[i].name);
-		for (j = 0; j < l; j++)
-		{
-			fputc(' ', stdout);
-			fflush(stdout);
-		}
+		ex_writer_puts(out, columns[i].name);
+		ex_writer_pad(out, ' ', disp_len - strlen(columns[i].name));
 	}
-	fputc('\n', stdout);
-	fflush(stdout);
+	ex_writer_putc(out, '\n');
 	for (i = 0; i < numcols; i++)
 	{
 		disp_len = ex_display_dlen(&columns[i]);
-		l = disp_len - 1;
-		for (j = 0; j < l; j++)
-		{
-			fputc('-', stdout);
-		}
-		fputc(' ', stdout);
+		ex_writer_pad(out, '-', disp_len - 1);
+		ex_writer_putc(out, ' ');
 	}
-	fputc('\n', stdout);
+	ex_writer_putc(out, '\n');
 
 	return CS_SUCCEED;
 }
@@ -234,9 +278,9 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 	CS_INT		olen;
 	CS_CHAR		wbuf[MAX_CHAR_BUF];
 	CS_BOOL		res;
-	CS_INT		i;
 	CS_INT		disp_len;
 	CS_SMALLINT	indi;
+	EX_WRITER	*out;
 
 	indi = (CS_SMALLINT)indicator;
 
@@ -285,20 +329,11 @@ ex_display_column(CS_CONTEXT *context, CS_DATAFMT *colfmt, CS_VOID *data,
 		}
 	}
 
-	for (i = 0; i < olen; i++)
-	{
-		fprintf(stdout, "%c", wbuf[i]);
-	}
-
-	fflush(stdout);
-
+	out = ex_writer_stdout();
+	ex_writer_write(out, wbuf, olen);
 	disp_len = ex_display_dlen(colfmt);
-	for (i = 0; i < (disp_len - olen); i++)
-	{
-		fputc(' ', stdout);
-	}
-	fflush(stdout);
-	
+	ex_writer_pad(out, ' ', disp_len - olen);
+
 	return CS_SUCCEED;
 }
 
@@ -355,6 +390,31 @@ ex_error(char *msg)
 	fflush(EX_ERROR_OUT);
 }
 
+/*
+** ex_usecs()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Reads the monotonic clock, for timing work in microseconds.
+**
+** Returns:
+** 	The clock in microseconds.
+**
+** Side Effects:
+** 	none.
+*/
+
+CS_BIGINT CS_PUBLIC
+ex_usecs(CS_VOID)
+{
+	struct timespec	ts;
+
+	(CS_VOID)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CS_BIGINT)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /*****************************************************************************
 ** 
 ** callback functions 
@@ -551,10 +611,25 @@ ex_init(CS_CONTEXT **context, SRV_SERVER **server)
 		}
 	}
 
+	/*
+	** The completion callback is only called for connections that
+	** were switched to asynchronous I/O with ex_async_netio().
+	*/
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ct_callback(*context, NULL, CS_SET, CS_COMPLETION_CB,
+				(CS_VOID *)ex_async_completion_cb);
+		if (retcode != CS_SUCCEED)
+		{
+			ex_error("ex_init: ct_callback(completion) failed");
+		}
+	}
+
 	/* 
 	** This is an synchronous example so set the input/output type
 	** to synchronous (This is the default setting, but show an
-	** example anyway).
+	** example anyway). Connections that want asynchronous I/O set
+	** CS_NETIO on their own, see exasync.c.
 	*/
 	if (retcode == CS_SUCCEED)
 	{
@@ -613,10 +688,10 @@ ex_init(CS_CONTEXT **context, SRV_SERVER **server)
     if (retcode == CS_SUCCEED)
     {
         *server = srv_init(/*srv_config, not used*/(SRV_CONFIG*)NULL,
-                       SERVER_NAME, SRV_NULLTERM);
+                       Ex_srvname, SRV_NULLTERM);
         if (*server == (SRV_SERVER*)NULL)
         {
-            ex_error("ex_init: srv_init("SERVER_NAME") failed");
+            ex_error("ex_init: srv_init(Ex_srvname) failed");
         }
     }
 
@@ -690,6 +765,7 @@ ex_connect(CS_CONTEXT *context, CS_CONNECTION **connection, CS_CHAR *appname,
 	   CS_CHAR *username, CS_CHAR *password, CS_CHAR *server)
 {
 	CS_INT		len;
+	CS_BOOL		bulk = CS_TRUE;
 	CS_RETCODE	retcode;
 
 	/* 
@@ -761,6 +837,19 @@ ex_connect(CS_CONTEXT *context, CS_CONNECTION **connection, CS_CHAR *appname,
 		}
 	}
 
+	/*
+	** Log in for bulk copy as well, so that any connection, pooled
+	** ones included, can be handed to Bulk-Library (see exblk.c).
+	*/
+	if (retcode == CS_SUCCEED)
+	{
+		if ((retcode = ct_con_props(*connection, CS_SET, CS_BULK_LOGIN,
+				&bulk, CS_UNUSED, NULL)) != CS_SUCCEED)
+		{
+			ex_error("ct_con_props(bulk_login) failed");
+		}
+	}
+
 	/*	
 	** Open a Server connection.
 	*/
@@ -791,7 +880,7 @@ ex_connect(CS_CONTEXT *context, CS_CONNECTION **connection, CS_CHAR *appname,
 **
 ** Purpose:
 ** 	The routine closes a connection and deallocates the
-**	CS_CONNECTION structure.
+**	CS_CONNECTION structure, and its prepared statements (exstmt.c).
 **
 ** Parameters:
 ** 	connection	- Pointer to connection structure.
@@ -808,6 +897,14 @@ ex_con_cleanup(CS_CONNECTION *connection, CS_RETCODE status)
 	CS_RETCODE	retcode;
 	CS_INT		close_option;
 
+	/*
+	** Free the prepared statements of the connection first.
+	*/
+	if (ex_stmt_release(connection, status) != CS_SUCCEED)
+	{
+		ex_error("ex_con_cleanup: ex_stmt_release() failed");
+	}
+
 	close_option = (status != CS_SUCCEED) ? CS_FORCE_CLOSE : CS_UNUSED;
 	retcode = ct_close(connection, close_option);
 	if (retcode != CS_SUCCEED)
@@ -992,335 +1089,962 @@ ex_execute_cmd(CS_CONNECTION *connection, CS_CHAR *cmdbuf)
 }
 
 /*
-** ex_fetch_data()
+** ex_batch_init()
 **
 ** Type of function:
 ** 	example program utility api
-** 
+**
 ** Purpose:
-** 	This function processes fetchable results sets. The results include:
+** 	Sets up an empty statement batch.
 **
-**		CS_ROW_RESULT
-**		CS_CURSOR_RESULT 
-**		CS_PARAM_RESULT 
-**		CS_STATUS_RESULT 
-**		CS_COMPUTE_RESULT 
+** Parameters:
+** 	batch		- The batch.
 **
-**	Since the Client-Library result model has been unified, the same
-**	apis are used for each of the above result types.
+** Return:
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+ex_batch_init(EX_BATCH *batch)
+{
+	memset(batch, 0, sizeof (EX_BATCH));
+}
+
+/*
+** ex_batch_add()
 **
-**	One caveat is the processing of CS_COMPUTE_RESULTs. The name field
-**	sent from the server is typically zero length. To display a meaningful
-**	header, the aggregate compute operator name should be found for the
-**	column, and that name used instead. The compute example program has
-**	code which demonstrates this.
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Queues a statement on a batch. A statement is one Transact-SQL
+**	command, which may be a control-of-flow statement such as
+**	"if exists (...) drop table t"; those are sent on their own (see
+**	EX_BATCH). Commands the server only accepts alone in a batch
+**	(create procedure, create view and the like) can't be queued.
 **
 ** Parameters:
-**	cmd - Pointer to command structure
+** 	batch		- The batch.
+** 	stmt		- The statement, null terminated.
 **
 ** Return:
-**	CS_MEM_ERROR	If an memory allocation failed.
-**	CS_SUCCEED	If the data was displayed.
-**	CS_FAIL		If no columns were present.
-** 	<retcode>	Result of the Client-Library function if a failure was
-**			returned.
-**
+** 	CS_SUCCEED, or CS_MEM_ERROR.
 */
 
 CS_RETCODE CS_PUBLIC
-ex_fetch_data(CS_COMMAND *cmd)
+ex_batch_add(EX_BATCH *batch, CS_CHAR *stmt)
 {
-	CS_RETCODE		retcode;
-	CS_INT			num_cols;
-	CS_INT			i;
-	CS_INT			j;
-	CS_INT			row_count = 0;
-	CS_INT			rows_read;
-	CS_INT			disp_len;
-	CS_DATAFMT		*datafmt;
-	EX_COLUMN_DATA		*coldata;
+	CS_INT		len;
+	CS_INT		size;
+	CS_CHAR		*buf;
+	CS_INT		*offsets;
+	CS_BOOL		*alone;
+	CS_RETCODE	*status;
+	CS_INT		*rowcount;
 
-	/*
-	** Find out how many columns there are in this result set.
-	*/
-	retcode = ct_res_info(cmd, CS_NUMDATA, &num_cols, CS_UNUSED, NULL);
-	if (retcode != CS_SUCCEED)
+	len = strlen(stmt);
+
+	if (batch->buflen + len + 1 > batch->bufsize)
 	{
-		ex_error("ex_fetch_data: ct_res_info() failed");
-		return retcode;
+		size = batch->bufsize + MAX(len + 1, EX_BATCH_CHUNK);
+		if ((buf = (CS_CHAR *)realloc(batch->buf, size)) == NULL)
+		{
+			ex_error("ex_batch_add: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		batch->buf = buf;
+		batch->bufsize = size;
 	}
 
-	/*
-	** Make sure we have at least one column
-	*/
-	if (num_cols <= 0)
+	if (batch->nstmts == batch->maxstmts)
 	{
-		ex_error("ex_fetch_data: ct_res_info() returned zero columns");
-		return CS_FAIL;
+		size = MAX(2 * batch->maxstmts, 16);
+		offsets = (CS_INT *)realloc(batch->offsets, size * sizeof (CS_INT));
+		if (offsets != NULL)
+		{
+			batch->offsets = offsets;
+		}
+		alone = (CS_BOOL *)realloc(batch->alone, size * sizeof (CS_BOOL));
+		if (alone != NULL)
+		{
+			batch->alone = alone;
+		}
+		status = (CS_RETCODE *)realloc(batch->status,
+				size * sizeof (CS_RETCODE));
+		if (status != NULL)
+		{
+			batch->status = status;
+		}
+		rowcount = (CS_INT *)realloc(batch->rowcount, size * sizeof (CS_INT));
+		if (rowcount != NULL)
+		{
+			batch->rowcount = rowcount;
+		}
+		if (offsets == NULL || alone == NULL || status == NULL
+			|| rowcount == NULL)
+		{
+			ex_error("ex_batch_add: realloc() failed");
+			return CS_MEM_ERROR;
+		}
+		batch->maxstmts = size;
 	}
 
-	/*
-	** Our program variable, called 'coldata', is an array of 
-	** EX_COLUMN_DATA structures. Each array element represents
-	** one column.  Each array element will re-used for each row.
-	**
-	** First, allocate memory for the data element to process.
-	*/
-	coldata = (EX_COLUMN_DATA *)malloc(num_cols * sizeof (EX_COLUMN_DATA));
-	if (coldata == NULL)
+	batch->offsets[batch->nstmts] = batch->buflen;
+	batch->alone[batch->nstmts] = ex_batch_flow(stmt);
+	batch->status[batch->nstmts] = CS_CANCELED;
+	batch->rowcount[batch->nstmts] = CS_NO_COUNT;
+	batch->nstmts++;
+
+	memcpy(batch->buf + batch->buflen, stmt, len);
+	batch->buflen += len;
+	batch->buf[batch->buflen++] = '\n';
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_execute_batch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sends the statements of a batch to the server, so that a script
+**	costs a round trip per run of plain statements instead of one per
+**	statement, and sorts the results back out per statement. Like
+**	ex_execute_cmd() it expects no rows; a statement that returns
+**	some fails, and its rows are discarded.
+**
+**	Every plain statement is followed by EX_BATCH_MARKER: the results
+**	before a marker row are the statement's, and the marker's @@error
+**	tells whether it failed. Control-of-flow statements go out alone,
+**	so all their results are theirs. batch->status[i] is set to
+**	CS_SUCCEED or CS_FAIL for every statement the server ran, and is
+**	left at CS_CANCELED for the statements it didn't run because an
+**	error aborted the batch; batch->rowcount[i] holds the rows the
+**	statement affected, or CS_NO_COUNT.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+** 	batch		- The batch; it can be run again, or cleared.
+**
+** Return:
+** 	CS_SUCCEED if every statement succeeded.
+** 	Otherwise CS_FAIL, or the result of the CT-Lib call that failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_execute_batch(CS_CONNECTION *connection, EX_BATCH *batch)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_RETCODE	query_code = CS_SUCCEED;
+	CS_CHAR		*text;
+	CS_INT		first;
+	CS_INT		last;
+	CS_INT		end;
+	CS_INT		i;
+
+	if (batch->nstmts == 0)
 	{
-		ex_error("ex_fetch_data: malloc() failed");
-		return CS_MEM_ERROR;
+		return CS_SUCCEED;
+	}
+	for (i = 0; i < batch->nstmts; i++)
+	{
+		batch->status[i] = CS_CANCELED;
+		batch->rowcount[i] = CS_NO_COUNT;
 	}
 
-	datafmt = (CS_DATAFMT *)malloc(num_cols * sizeof (CS_DATAFMT));
-	if (datafmt == NULL)
+	/*
+	** Room for every statement with its marker.
+	*/
+	text = (CS_CHAR *)malloc(batch->buflen
+			+ batch->nstmts * (sizeof (EX_BATCH_MARKER) + 1));
+	if (text == NULL)
 	{
-		ex_error("ex_fetch_data: malloc() failed");
-		free(coldata);
+		ex_error("ex_execute_batch: malloc() failed");
 		return CS_MEM_ERROR;
 	}
 
 	/*
-	** Loop through the columns getting a description of each one
-	** and binding each one to a program variable.
-	**
-	** We're going to bind each column to a character string; 
-	** this will show how conversions from server native datatypes
-	** to strings can occur via bind.
-	**
-	** We're going to use the same datafmt structure for both the describe
-	** and the subsequent bind.
-	**
-	** If an error occurs within the for loop, a break is used to get out
-	** of the loop and the data that was allocated is free'd before
-	** returning.
+	** Run the statements a stretch at a time: a control-of-flow
+	** statement alone, otherwise as many plain ones as follow each
+	** other. A stretch the server aborted part way stops the batch.
 	*/
-	for (i = 0; i < num_cols; i++)
+	for (first = 0; first < batch->nstmts; first = last)
 	{
-		/*
-		** Get the column description.  ct_describe() fills the
-		** datafmt parameter with a description of the column.
-		*/
-		retcode = ct_describe(cmd, (i + 1), &datafmt[i]);
-		if (retcode != CS_SUCCEED)
+		last = first + 1;
+		while (!batch->alone[first] && last < batch->nstmts
+			&& !batch->alone[last])
 		{
-			ex_error("ex_fetch_data: ct_describe() failed");
-			break;
+			last++;
 		}
 
-		/*
-		** update the datafmt structure to indicate that we want the
-		** results in a null terminated character string.
-		**
-		** First, update datafmt.maxlength to contain the maximum
-		** possible length of the column. To do this, call
-		** ex_display_len() to determine the number of bytes needed
-		** for the character string representation, given the
-		** datatype described above.  Add one for the null
-		** termination character.
-		*/
-		datafmt[i].maxlength = ex_display_dlen(&datafmt[i]) + 1;
-		
-		/*
-		** Set datatype and format to tell bind we want things
-		** converted to null terminated strings
-		*/
-		datafmt[i].datatype = CS_CHAR_TYPE;
-		datafmt[i].format   = CS_FMT_NULLTERM;
-
-		/*
-		** Allocate memory for the column string
-		*/
-		coldata[i].value = (CS_CHAR *)malloc(datafmt[i].maxlength);
-		if (coldata[i].value == NULL)
+		retcode = ex_batch_run(connection, batch, first, last, text);
+		if (retcode != CS_SUCCEED)
 		{
-			ex_error("ex_fetch_data: malloc() failed");
-			retcode = CS_MEM_ERROR;
 			break;
 		}
-
-		/*
-		** Now bind.
-		*/
-		retcode = ct_bind(cmd, (i + 1), &datafmt[i],
-				coldata[i].value, &coldata[i].valuelen,
-				(CS_SMALLINT *)&coldata[i].indicator);
-		if (retcode != CS_SUCCEED)
+		if (batch->status[last - 1] == CS_CANCELED)
 		{
-			ex_error("ex_fetch_data: ct_bind() failed");
 			break;
 		}
 	}
+	free(text);
 	if (retcode != CS_SUCCEED)
 	{
-		for (j = 0; j < i; j++)
-		{
-			free(coldata[j].value);
-		}
-		free(coldata);
-		free(datafmt);
-		return retcode;
+		query_code = retcode;
 	}
 
 	/*
-	** Display column header
+	** Report the statements that failed or never ran. Each statement
+	** is followed by a newline in the buffer, which is briefly turned
+	** into a terminator to print it.
 	*/
-	ex_display_header(num_cols, datafmt);
-
-	/*
-	** Fetch the rows.  Loop while ct_fetch() returns CS_SUCCEED or 
-	** CS_ROW_FAIL
-	*/
-	while (((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
-			&rows_read)) == CS_SUCCEED) || (retcode == CS_ROW_FAIL))
+	for (i = 0; i < batch->nstmts; i++)
 	{
-		/*
-		** Increment our row count by the number of rows just fetched.
-		*/
-		row_count = row_count + rows_read;
-
-		/*
-		** Check if we hit a recoverable error.
-		*/
-		if (retcode == CS_ROW_FAIL)
+		if (batch->status[i] == CS_SUCCEED)
 		{
-			fprintf(stdout, "Error on row %d.\n", row_count);
-			fflush(stdout);
+			continue;
+		}
+		if (query_code == CS_SUCCEED)
+		{
+			query_code = CS_FAIL;
 		}
 
-		/*
-		** We have a row.  Loop through the columns displaying the
-		** column values.
-		*/
-		for (i = 0; i < num_cols; i++)
-		{	  
-			/*
-			** Display the column value
-			*/
-			fprintf(stdout, "%s", coldata[i].value);
-			fflush(stdout);
-
-			/*
-			** If not last column, Print out spaces between this
-			** column and next one. 
-			*/
-			if (i != num_cols - 1)
-			{
-				disp_len = ex_display_dlen(&datafmt[i]);
-				disp_len -= coldata[i].valuelen - 1;
-				for (j = 0; j < disp_len; j++)
-				{
-					fputc(' ', stdout);
-				}
-			}
-		} 
-		fprintf(stdout, "\n");
-		fflush(stdout);
-	}
-
-	/*
-	** Free allocated space.
-	*/
-	for (i = 0; i < num_cols; i++)
-	{
-		free(coldata[i].value);
+		end = ((i + 1) < batch->nstmts) ? batch->offsets[i + 1] - 1
+				: batch->buflen - 1;
+		batch->buf[end] = '\0';
+		ex_error((batch->status[i] == CS_FAIL)
+			? "ex_execute_batch: The following statement caused an error:"
+			: "ex_execute_batch: The following statement was not run:");
+		ex_error(batch->buf + batch->offsets[i]);
+		batch->buf[end] = '\n';
 	}
-	free(coldata);
-	free(datafmt);
-
-	/*
-	** We're done processing rows.  Let's check the final return
-	** value of ct_fetch().
-	*/
-	switch ((int)retcode)
-	{
-		case CS_END_DATA:
-			/*
-			** Everything went fine.
-			*/
-			fprintf(stdout, "All done processing rows.\n");
-			fflush(stdout);
-			retcode = CS_SUCCEED;
-			break;
-
-		case CS_FAIL:
-			/*
-			** Something terrible happened.
-			*/
-			ex_error("ex_fetch_data: ct_fetch() failed");
-			break;
-
-		default:
-			/*
-			** We got an unexpected return value.
-			*/
-			ex_error("ex_fetch_data: ct_fetch() returned an expected retcode");
-			break;
 
-	}
-	return retcode;
+	return query_code;
 }
 
-/*****************************************************************************
-** 
-** sql based functions 
-** 
-*****************************************************************************/
-
 /*
-** ex_create_db()
+** ex_batch_clear()
 **
 ** Type of function:
-**      example program utility api
+** 	example program utility api
 **
 ** Purpose:
-**      This routine creates a database and opens it. It first checks
-**      that the database does not already exists. If it does exist
-**      the database is dropped before creating a new one.
+** 	Frees the statements and results of a batch, leaving it empty.
 **
 ** Parameters:
-**      connection      - Pointer to CS_CONNECTION structure.
-**      dbname          - The name to be used for the created database.
+** 	batch		- The batch.
 **
 ** Return:
-**      Result of functions called in CT-Lib.
-**
+** 	Nothing.
+*/
+
+CS_VOID CS_PUBLIC
+ex_batch_clear(EX_BATCH *batch)
+{
+	free(batch->buf);
+	free(batch->offsets);
+	free(batch->alone);
+	free(batch->status);
+	free(batch->rowcount);
+	ex_batch_init(batch);
+}
+
+/*
+** ex_batch_flow()
+**
+** Purpose:
+** 	Tells whether a statement starts with a control-of-flow keyword,
+**	whose scope a marker sent after it could end up inside.
+*/
+
+CS_STATIC CS_BOOL
+ex_batch_flow(CS_CHAR *stmt)
+{
+	static CS_CHAR	*keywords[] = { "if", "while", "begin", NULL };
+	CS_INT		len;
+	CS_INT		i;
+
+	while (isspace((unsigned char)*stmt))
+	{
+		stmt++;
+	}
+	for (i = 0; keywords[i] != NULL; i++)
+	{
+		len = strlen(keywords[i]);
+		if (strncasecmp(stmt, keywords[i], len) == 0
+			&& !isalnum((unsigned char)stmt[len]) && stmt[len] != '_')
+		{
+			return CS_TRUE;
+		}
+	}
+	return CS_FALSE;
+}
+
+/*
+** ex_batch_run()
+**
+** Purpose:
+** 	Sends statements first to last - 1 of a batch as one language
+**	command, each followed by EX_BATCH_MARKER unless it is a lone
+**	control-of-flow statement, and records their outcomes. text has
+**	room for the command.
+**
+** Returns:
+** 	CS_SUCCEED once the results are all read, whatever the
+**	statements did, or the result of the CT-Lib call that failed.
+*/
+
+CS_STATIC CS_RETCODE
+ex_batch_run(CS_CONNECTION *connection, EX_BATCH *batch, CS_INT first,
+	     CS_INT last, CS_CHAR *text)
+{
+	CS_RETCODE	retcode;
+	CS_COMMAND	*cmd;
+	CS_INT		restype;
+	CS_INT		count;
+	CS_INT		len = 0;
+	CS_INT		end;
+	CS_INT		stmt = first;
+	CS_BOOL		marked = !batch->alone[first];
+	CS_BOOL		inmarker = CS_FALSE;
+	CS_BOOL		ismarker;
+	CS_INT		error = 0;
+	CS_INT		i;
+
+	for (i = first; i < last; i++)
+	{
+		end = ((i + 1) < batch->nstmts) ? batch->offsets[i + 1]
+				: batch->buflen;
+		memcpy(text + len, batch->buf + batch->offsets[i],
+			end - batch->offsets[i]);
+		len += end - batch->offsets[i];
+		if (marked)
+		{
+			memcpy(text + len, EX_BATCH_MARKER "\n",
+				sizeof (EX_BATCH_MARKER));
+			len += sizeof (EX_BATCH_MARKER);
+		}
+	}
+
+	if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_batch_run: ct_cmd_alloc() failed");
+		return retcode;
+	}
+
+	if ((retcode = ct_command(cmd, CS_LANG_CMD, text, len,
+			CS_UNUSED)) != CS_SUCCEED)
+	{
+		ex_error("ex_batch_run: ct_command() failed");
+		(void)ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	if ((retcode = ct_send(cmd)) != CS_SUCCEED)
+	{
+		ex_error("ex_batch_run: ct_send() failed");
+		(void)ct_cmd_drop(cmd);
+		return retcode;
+	}
+
+	while ((retcode = ct_results(cmd, &restype)) == CS_SUCCEED)
+	{
+		switch ((int)restype)
+		{
+		    case CS_ROW_RESULT:
+			ismarker = CS_FALSE;
+			if (marked && (retcode = ex_batch_marker(cmd, &ismarker,
+					&error)) != CS_SUCCEED)
+			{
+				break;
+			}
+			if (ismarker)
+			{
+				inmarker = CS_TRUE;
+				if (error != 0)
+				{
+					batch->status[stmt] = CS_FAIL;
+				}
+				break;
+			}
+
+			/*
+			** Rows of the statement itself; they are not expected.
+			*/
+			batch->status[stmt] = CS_FAIL;
+			retcode = ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+			if (retcode != CS_SUCCEED)
+			{
+				ex_error("ex_batch_run: ct_cancel() failed");
+			}
+			break;
+
+		    case CS_CMD_DONE:
+			/*
+			** The end of a marker is the end of its statement.
+			*/
+			if (inmarker)
+			{
+				if (batch->status[stmt] == CS_CANCELED)
+				{
+					batch->status[stmt] = CS_SUCCEED;
+				}
+				inmarker = CS_FALSE;
+				stmt = MIN(stmt + 1, last - 1);
+				break;
+			}
+			if (ct_res_info(cmd, CS_ROW_COUNT, &count, CS_UNUSED,
+					NULL) == CS_SUCCEED && count != CS_NO_COUNT)
+			{
+				batch->rowcount[stmt] = MAX(batch->rowcount[stmt], 0)
+						+ count;
+			}
+			/* fall through */
+
+		    case CS_CMD_SUCCEED:
+			if (!marked && batch->status[stmt] == CS_CANCELED)
+			{
+				batch->status[stmt] = CS_SUCCEED;
+			}
+			break;
+
+		    case CS_CMD_FAIL:
+			batch->status[stmt] = CS_FAIL;
+			break;
+
+		    default:
+			/*
+			** Status results are expected from statements that
+			** execute procedures; anything else is an error of
+			** the statement. Either way the results are thrown
+			** away and the batch goes on.
+			*/
+			if (restype != CS_STATUS_RESULT)
+			{
+				batch->status[stmt] = CS_FAIL;
+			}
+			retcode = ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+			if (retcode != CS_SUCCEED)
+			{
+				ex_error("ex_batch_run: ct_cancel() failed");
+			}
+			break;
+		}
+		if (retcode != CS_SUCCEED)
+		{
+			(void)ct_cancel(NULL, cmd, CS_CANCEL_ALL);
+			break;
+		}
+	}
+
+	/*
+	** Clean up the command handle used
+	*/
+	if (retcode == CS_END_RESULTS)
+	{
+		retcode = ct_cmd_drop(cmd);
+	}
+	else
+	{
+		ex_error("ex_batch_run: ct_results() failed");
+		(void)ct_cmd_drop(cmd);
+		if (retcode == CS_SUCCEED)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+
+	return retcode;
+}
+
+/*
+** ex_batch_marker()
+**
+** Purpose:
+** 	Tells whether the current row result is an EX_BATCH_MARKER and,
+**	if it is, reads the @@error it carries.
+**
+** Returns:
+** 	CS_SUCCEED, or the result of the CT-Lib call that failed.
+*/
+
+CS_STATIC CS_RETCODE
+ex_batch_marker(CS_COMMAND *cmd, CS_BOOL *ismarker, CS_INT *error)
+{
+	CS_RETCODE	retcode;
+	CS_DATAFMT	fmt;
+	CS_INT		count;
+
+	*ismarker = CS_FALSE;
+	*error = 0;
+	if ((retcode = ct_describe(cmd, 1, &fmt)) != CS_SUCCEED)
+	{
+		ex_error("ex_batch_marker: ct_describe() failed");
+		return retcode;
+	}
+	if (fmt.namelen != (CS_INT)strlen(EX_BATCH_MARKER_NAME)
+		|| strncmp(fmt.name, EX_BATCH_MARKER_NAME, fmt.namelen) != 0)
+	{
+		return CS_SUCCEED;
+	}
+	*ismarker = CS_TRUE;
+
+	fmt.datatype = CS_INT_TYPE;
+	fmt.format = CS_FMT_UNUSED;
+	fmt.maxlength = sizeof (CS_INT);
+	fmt.count = 1;
+	fmt.locale = NULL;
+	if ((retcode = ct_bind(cmd, 1, &fmt, error, NULL, NULL)) != CS_SUCCEED)
+	{
+		ex_error("ex_batch_marker: ct_bind() failed");
+		return retcode;
+	}
+	while ((retcode = ct_fetch(cmd, CS_UNUSED, CS_UNUSED, CS_UNUSED,
+			&count)) == CS_SUCCEED || retcode == CS_ROW_FAIL)
+	{
+		;
+	}
+	if (retcode != CS_END_DATA)
+	{
+		ex_error("ex_batch_marker: ct_fetch() failed");
+		return retcode;
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** ex_native_type()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Tells whether EX_BIND_NATIVE binds a datatype as is: the fixed
+**	width types, whose native form is smaller than their string form
+**	and cheaper to fetch.
+*/
+
+CS_BOOL CS_PUBLIC
+ex_native_type(CS_INT datatype)
+{
+	switch ((int)datatype)
+	{
+	    case CS_TINYINT_TYPE:
+	    case CS_SMALLINT_TYPE:
+	    case CS_INT_TYPE:
+	    case CS_BIGINT_TYPE:
+	    case CS_USMALLINT_TYPE:
+	    case CS_UINT_TYPE:
+	    case CS_UBIGINT_TYPE:
+	    case CS_BIT_TYPE:
+	    case CS_REAL_TYPE:
+	    case CS_FLOAT_TYPE:
+	    case CS_MONEY_TYPE:
+	    case CS_MONEY4_TYPE:
+	    case CS_NUMERIC_TYPE:
+	    case CS_DECIMAL_TYPE:
+	    case CS_DATETIME_TYPE:
+	    case CS_DATETIME4_TYPE:
+	    case CS_DATE_TYPE:
+	    case CS_TIME_TYPE:
+	    case CS_BIGDATETIME_TYPE:
+	    case CS_BIGTIME_TYPE:
+		return CS_TRUE;
+
+	    default:
+		return CS_FALSE;
+	}
+}
+
+/*
+** ex_convert_array()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Converts rows values of a natively bound column to null
+**	terminated strings, a column at a time. Integers are formatted
+**	directly; everything else goes through cs_convert(), which gives
+**	the same text as binding the column as a string would have.
+**	NULL values become empty strings, as with a string binding.
+**
+** Parameters:
+** 	context		- Context for cs_convert().
+** 	srcfmt		- Format the column is bound with.
+** 	src		- The fetched values.
+** 	destfmt		- CS_CHAR_TYPE/CS_FMT_NULLTERM format of the strings.
+** 	dest		- Receives the strings; its maxlength must be
+**			  destfmt->maxlength.
+** 	rows		- Number of values.
+**
+** Return:
+** 	CS_SUCCEED, or CS_FAIL if a value doesn't fit in
+**	destfmt->maxlength; a value that can't be converted is shown as
+**	"?".
 */
 
 CS_RETCODE CS_PUBLIC
-ex_create_db(CS_CONNECTION *connection, char *dbname)
+ex_convert_array(CS_CONTEXT *context, CS_DATAFMT *srcfmt, EX_COLUMN_ARRAY *src,
+		 CS_DATAFMT *destfmt, EX_COLUMN_ARRAY *dest, CS_INT rows)
 {
-	CS_RETCODE      retcode;
-	CS_CHAR         *cmdbuf;
+	CS_DATAFMT	fmt;
+	CS_CHAR		*in;
+	CS_CHAR		*out;
+	CS_INT		olen;
+	CS_INT		r;
+
+	fmt = *srcfmt;
+	fmt.count = 1;
+
+	for (r = 0; r < rows; r++)
+	{
+		in = EX_ARRAY_VALUE(src, r);
+		out = EX_ARRAY_VALUE(dest, r);
+		dest->indicator[r] = src->indicator[r];
+
+		if (src->indicator[r] == CS_NULLDATA)
+		{
+			out[0] = '\0';
+			dest->valuelen[r] = 1;
+			continue;
+		}
+
+		switch ((int)srcfmt->datatype)
+		{
+		    case CS_TINYINT_TYPE:
+			olen = snprintf(out, destfmt->maxlength, "%d",
+					(int)*(CS_TINYINT *)in);
+			break;
+		    case CS_SMALLINT_TYPE:
+			olen = snprintf(out, destfmt->maxlength, "%d",
+					(int)*(CS_SMALLINT *)in);
+			break;
+		    case CS_INT_TYPE:
+			olen = snprintf(out, destfmt->maxlength, "%d",
+					(int)*(CS_INT *)in);
+			break;
+		    case CS_BIGINT_TYPE:
+			olen = snprintf(out, destfmt->maxlength, "%lld",
+					(long long)*(CS_BIGINT *)in);
+			break;
+		    default:
+			fmt.maxlength = src->valuelen[r];
+			if (cs_convert(context, &fmt, in, destfmt, out,
+					&olen) != CS_SUCCEED)
+			{
+				strcpy(out, "?");
+			}
+			olen = strlen(out);
+			break;
+		}
+		if (olen < 0 || olen >= destfmt->maxlength)
+		{
+			ex_error("ex_convert_array: value too long for its column");
+			return CS_FAIL;
+		}
+		dest->valuelen[r] = olen + 1;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_fetch_data()
+**
+** Type of function:
+** 	example program utility api
+** 
+** Purpose:
+** 	This function processes fetchable results sets. The results include:
+**
+**		CS_ROW_RESULT
+**		CS_CURSOR_RESULT 
+**		CS_PARAM_RESULT 
+**		CS_STATUS_RESULT 
+**		CS_COMPUTE_RESULT 
+**
+**	Since the Client-Library result model has been unified, the same
+**	apis are used for each of the above result types.
+**
+**	The rows are fetched EX_FETCH_ROWS at a time with array binding,
+**	fixed width columns in their native types; see
+**	ex_fetch_data_rows().
+**
+**	One caveat is the processing of CS_COMPUTE_RESULTs. The name field
+**	sent from the server is typically zero length. To display a meaningful
+**	header, the aggregate compute operator name should be found for the
+**	column, and that name used instead. The compute example program has
+**	code which demonstrates this.
+**
+** Parameters:
+**	cmd - Pointer to command structure
+**
+** Return:
+**	CS_MEM_ERROR	If an memory allocation failed.
+**	CS_SUCCEED	If the data was displayed.
+**	CS_FAIL		If no columns were present.
+** 	<retcode>	Result of the Client-Library function if a failure was
+**			returned.
+**
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_fetch_data(CS_COMMAND *cmd)
+{
+	return ex_fetch_data_rows(cmd, EX_FETCH_ROWS, EX_FETCH_BIND);
+}
+
+/*
+** ex_fetch_data_rows()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	ex_fetch_data() with the number of rows each ct_fetch() returns
+**	and the binding mode, through a batch of its own; see
+**	ex_fetch_data_batch().
+**
+** Parameters:
+**	cmd	- Pointer to command structure
+**	count	- Rows per fetch; 1 binds a single row as before.
+**	mode	- EX_BIND_CHAR or EX_BIND_NATIVE.
+**
+** Return:
+**	As for ex_fetch_data().
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_fetch_data_rows(CS_COMMAND *cmd, CS_INT count, CS_INT mode)
+{
+	CS_RETCODE		retcode;
+	EX_COLBATCH		batch;
+
+	ex_colbatch_init(&batch);
+	retcode = ex_fetch_data_batch(cmd, count, mode, &batch);
+	ex_colbatch_free(&batch);
+
+	return retcode;
+}
+
+/*
+** ex_fetch_data_batch()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Fetches and writes out a result set through a columnar batch (see
+**	excolbatch.c). The columns are bound to arrays of count rows, so
+**	the per-call overhead of ct_fetch() is paid once per count rows
+**	instead of once per row. With EX_BIND_NATIVE the natively bound
+**	columns are converted to text a column of fetched rows at a time,
+**	just before output. The rows are written in the format set with
+**	ex_sink_set_default() (see exsink.c). The batch is left bound, so that a caller
+**	reading several result sets, like ex_handle_results(), passes the
+**	same one each time and only allocates when a result set needs
+**	more room than the previous ones.
+**
+** Parameters:
+**	cmd	- Pointer to command structure
+**	count	- Rows per fetch.
+**	mode	- EX_BIND_CHAR or EX_BIND_NATIVE.
+**	batch	- The batch, initialized with ex_colbatch_init().
+**
+** Return:
+**	As for ex_fetch_data().
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_fetch_data_batch(CS_COMMAND *cmd, CS_INT count, CS_INT mode,
+		    EX_COLBATCH *batch)
+{
+	CS_RETCODE		retcode;
+	CS_INT			row_count = 0;
+	EX_SINK			sink;
 
 	/*
-	** If the database already exists, drop it.
+	** Describe the columns and bind each one to an array, either of
+	** null terminated strings, which shows how conversions from
+	** server native datatypes to strings can occur via bind, or of
+	** the native datatype. Output works on the string form of the
+	** columns, so the batch has string arrays for the natively bound
+	** ones.
 	*/
-	if ((retcode = ex_remove_db(connection, dbname)) != CS_SUCCEED)
+	retcode = ex_colbatch_bind(batch, cmd, mode, count, CS_TRUE);
+	if (retcode != CS_SUCCEED)
 	{
-		ex_error("ex_create_db: ex_remove_db() failed");
+		ex_error("ex_fetch_data: ex_colbatch_bind() failed");
+		return retcode;
 	}
 
 	/*
-	** Allocate the buffer for the command string.
+	** Write the column header, in the format picked with
+	** ex_sink_set_default().
 	*/
-	cmdbuf = (CS_CHAR *) malloc(EX_BUFSIZE);
-	if (cmdbuf == NULL)
+	retcode = ex_sink_begin(&sink, ex_sink_default(), ex_writer_stdout(),
+			batch);
+	if (retcode != CS_SUCCEED)
 	{
-		ex_error("ex_create_db: malloc() failed");
-		return CS_FAIL;
+		ex_sink_end(&sink);
+		return retcode;
 	}
 
 	/*
-	** Set up and send the command to create the database.
+	** Fetch the rows, up to count at a time.  Loop while ct_fetch()
+	** returns CS_SUCCEED or CS_ROW_FAIL
 	*/
-	sprintf(cmdbuf, "create database %s", dbname);
-	if ((retcode = ex_execute_cmd(connection, cmdbuf)) != CS_SUCCEED)
+	while (((retcode = ex_colbatch_fetch(batch, cmd)) == CS_SUCCEED)
+		|| (retcode == CS_ROW_FAIL))
+	{
+		/*
+		** Check if we hit a recoverable error. The row that failed
+		** is the one after the rows of the batch.
+		*/
+		if (retcode == CS_ROW_FAIL)
+		{
+			ex_sink_row_failed(&sink, row_count + batch->numrows + 1);
+		}
+
+		/*
+		** Convert the natively bound columns of the rows just
+		** fetched to strings, and write the rows. The output is
+		** buffered and only written when the buffer fills or the
+		** result set ends.
+		*/
+		if (ex_colbatch_text(batch, cmd) != CS_SUCCEED
+			|| ex_sink_rows(&sink, batch) != CS_SUCCEED)
+		{
+			(CS_VOID)ct_cancel(NULL, cmd, CS_CANCEL_CURRENT);
+			retcode = CS_FAIL;
+			break;
+		}
+
+		/*
+		** Increment our row count by the number of rows just fetched.
+		*/
+		row_count += (retcode == CS_ROW_FAIL) ? batch->numrows + 1
+				: batch->numrows;
+	}
+
+	/*
+	** We're done processing rows.  Let's check the final return
+	** value of ct_fetch().
+	*/
+	switch ((int)retcode)
 	{
-		ex_error("ex_create_db: ex_execute_cmd(create db) failed");
+		case CS_END_DATA:
+			/*
+			** Everything went fine.
+			*/
+			if (sink.format == EX_SINK_TEXT)
+			{
+				ex_writer_puts(sink.writer,
+					"All done processing rows.\n");
+			}
+			retcode = CS_SUCCEED;
+			break;
+
+		case CS_FAIL:
+			/*
+			** Something terrible happened.
+			*/
+			ex_error("ex_fetch_data: ct_fetch() failed");
+			break;
+
+		default:
+			/*
+			** We got an unexpected return value.
+			*/
+			ex_error("ex_fetch_data: ct_fetch() returned an expected retcode");
+			break;
+
 	}
-	free(cmdbuf);
+	if (ex_sink_end(&sink) != CS_SUCCEED && retcode == CS_SUCCEED)
+	{
+		retcode = CS_FAIL;
+	}
+
+	return retcode;
+}
+
+/*****************************************************************************
+** 
+** sql based functions 
+** 
+*****************************************************************************/
+
+/*
+** ex_create_db()
+**
+** Type of function:
+**      example program utility api
+**
+** Purpose:
+**      This routine creates a database. It first checks that the
+**      database does not already exists. If it does exist the database
+**      is dropped before creating a new one. The statements are sent
+**      as one batch (see ex_execute_batch()).
+**
+** Parameters:
+**      connection      - Pointer to CS_CONNECTION structure.
+**      dbname          - The name to be used for the created database.
+**
+** Return:
+**      Result of functions called in CT-Lib.
+**
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_create_db(CS_CONNECTION *connection, char *dbname)
+{
+	CS_RETCODE      retcode;
+	CS_CHAR         cmdbuf[EX_BUFSIZE];
+	EX_BATCH	batch;
+
+	/*
+	** The batch switches to master; statements prepared in the
+	** current database mustn't outlive that.
+	*/
+	if ((retcode = ex_stmt_release(connection, CS_SUCCEED)) != CS_SUCCEED)
+	{
+		ex_error("ex_create_db: ex_stmt_release() failed");
+		return retcode;
+	}
+
+	/*
+	** Switch to master, drop the database if it already exists and
+	** create it, as one statement batch.
+	*/
+	ex_batch_init(&batch);
+	retcode = ex_batch_add(&batch, "use master");
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(cmdbuf,
+			"if exists (select name from sysdatabases where name = \"%s\") \
+			drop database %s", dbname, dbname);
+		retcode = ex_batch_add(&batch, cmdbuf);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(cmdbuf, "create database %s", dbname);
+		retcode = ex_batch_add(&batch, cmdbuf);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("ex_create_db: ex_batch_add() failed");
+		ex_batch_clear(&batch);
+		return retcode;
+	}
+
+	if ((retcode = ex_execute_batch(connection, &batch)) != CS_SUCCEED)
+	{
+		ex_error("ex_create_db: ex_execute_batch(create db) failed");
+	}
+	ex_batch_clear(&batch);
 	return retcode;
 }
 
@@ -1392,6 +2116,8 @@ ex_remove_db(CS_CONNECTION *connection, char *dbname)
 **
 ** Purpose:
 **      This routine changes the current database to the named db passed in.
+**      The prepared statements of the connection are deallocated first
+**      (see ex_stmt_release()).
 **
 ** Parameters:
 **      connection      - Pointer to CS_CONNECTION structure.
@@ -1408,6 +2134,15 @@ ex_use_db(CS_CONNECTION *connection, char *dbname)
 	CS_RETCODE      retcode;
 	CS_CHAR         *cmdbuf;
 
+	/*
+	** Statements prepared in the old database refer to its objects.
+	*/
+	if ((retcode = ex_stmt_release(connection, CS_SUCCEED)) != CS_SUCCEED)
+	{
+		ex_error("ex_use_db: ex_stmt_release() failed");
+		return retcode;
+	}
+
 	/*
 	** Allocate the buffer for the command string.
 	*/
@@ -1442,6 +2177,14 @@ ex_handle_results(CS_COMMAND *cmd)
 	CS_RETCODE retcode;
 	CS_INT res_type;
 	CS_SMALLINT msg_id;
+	CS_CHAR *banner = "";
+	EX_COLBATCH batch;
+
+	/*
+	** The fetchable result sets share one batch, so a command
+	** returning many of the same shape allocates once.
+	*/
+	ex_colbatch_init(&batch);
 
 	/*
 	** Process the results.
@@ -1454,30 +2197,37 @@ ex_handle_results(CS_COMMAND *cmd)
 		  case CS_PARAM_RESULT:
 		  case CS_STATUS_RESULT:
 			/* 
-			** Print the result header based on the result type.
+			** Print the result header based on the result type,
+			** unless the output is for another program.
 			*/
 			switch ((int)res_type)
 			{
 			  case  CS_ROW_RESULT:
-				fprintf(stdout, "\nROW RESULTS\n");
+				banner = "\nROW RESULTS\n";
 				break;
 
 			  case  CS_PARAM_RESULT:
-				fprintf(stdout, "\nPARAMETER RESULTS\n");
+				banner = "\nPARAMETER RESULTS\n";
 				break;
 
 			  case  CS_STATUS_RESULT:
-				fprintf(stdout, "\nSTATUS RESULTS\n");
+				banner = "\nSTATUS RESULTS\n";
 				break;
 			}
+			if (ex_sink_default() == EX_SINK_TEXT)
+			{
+				ex_writer_puts(ex_writer_stdout(), banner);
+			}
 	
 			/*
 			** All three of these result types are fetchable.
 			*/
-			retcode = ex_fetch_data(cmd);
+			retcode = ex_fetch_data_batch(cmd, EX_FETCH_ROWS,
+					EX_FETCH_BIND, &batch);
 			if (retcode != CS_SUCCEED)
 			{
 				ex_error("ex_handle_results: ex_fetch_data() failed");
+				ex_colbatch_free(&batch);
 				return retcode;
 			}
 			break;
@@ -1491,10 +2241,12 @@ ex_handle_results(CS_COMMAND *cmd)
 			if (retcode != CS_SUCCEED)
 			{
 				ex_error("ex_handle_results: ct_res_info(msgtype) failed");
+				ex_colbatch_free(&batch);
 				return retcode;
 			}
-			fprintf(stdout, "ct_result returned CS_MSG_RESULT where msg id = %d.\n",
-				 msg_id);
+			fprintf((ex_sink_default() == EX_SINK_TEXT) ? stdout : EX_ERROR_OUT,
+				"ct_result returned CS_MSG_RESULT where msg id = %d.\n",
+				msg_id);
 			break;
 
 		  case CS_CMD_SUCCEED:
@@ -1515,6 +2267,7 @@ ex_handle_results(CS_COMMAND *cmd)
 			** processing our command.
 			*/
 			ex_error("ex_handle_results: ct_results returned CS_CMD_FAIL.");
+			ex_colbatch_free(&batch);
 			return CS_FAIL;
 			break;
 
@@ -1523,10 +2276,13 @@ ex_handle_results(CS_COMMAND *cmd)
 			** We got something unexpected.
 			*/
 			ex_error("ex_handle_results: ct_results returned unexpected result type");
+			ex_colbatch_free(&batch);
 			return CS_FAIL;
 		}
 	}
 
+	ex_colbatch_free(&batch);
+
 	/*
 	** We're done processing results. Let's check the
 	** return value of ct_results() to see if everything
@@ -88,6 +88,37 @@ typedef struct _ex_column_data
 	CS_INT		valuelen;
 } EX_COLUMN_DATA;
 
+/*
+** A batch of language statements that ex_execute_batch() sends to the
+** server, and the outcome of each statement. Statements are queued with
+** ex_batch_add() and the batch is freed with ex_batch_clear().
+**
+** Each statement is followed on the wire by EX_BATCH_MARKER, whose row
+** closes the statement's results and carries its @@error. A
+** control-of-flow statement (if, while, begin) can't be told apart from
+** what follows it that way, so it is sent as a batch of its own.
+*/
+#define EX_BATCH_CHUNK	4096	/* growth step of the statement buffer */
+#define EX_BATCH_MARKER_NAME	"ex_batch_error"
+#define EX_BATCH_MARKER		"select " EX_BATCH_MARKER_NAME " = @@error"
+
+typedef struct _ex_batch
+{
+	CS_CHAR		*buf;		/* the statements, newline separated */
+	CS_INT		buflen;
+	CS_INT		bufsize;
+	CS_INT		nstmts;
+	CS_INT		maxstmts;
+	CS_INT		*offsets;	/* start of each statement in buf */
+	CS_BOOL		*alone;		/* statement sent as its own batch */
+	CS_RETCODE	*status;	/* outcome of each statement */
+	CS_INT		*rowcount;	/* rows affected by each statement */
+} EX_BATCH;
+
+/*
+** A move of a scrollable cursor: a ct_scroll_fetch() scroll type and,
+** for CS_ABSOLUTE and CS_RELATIVE, its offset. See ex_cursor_walk().
+*/
 typedef struct _ct_scroll_indexlist
 {
         int          index;
@@ -95,21 +126,51 @@ typedef struct _ct_scroll_indexlist
 } CT_SCROLL_INDEX;
 
 /*
-** Data structure for array binding of scrollable cursor
-** results. This is an illustrative example only, there
-** are different and more flexible ways to do columns.
-** Column length is fixed in this example. It is advised
-** to set ARRAY_BND_LEN to CS_CURSOR_ROWS for efficiency.
+** Array binding with the number of rows and the column length picked at
+** runtime, as ex_fetch_data() does it: each column gets count values of
+** maxlength bytes, count lengths and count indicators, each array
+** contiguous, all in one allocation. EX_FETCH_ROWS is the count
+** ex_fetch_data() asks for; ex_colbatch_bind() lowers it so that a fetch
+** doesn't need more than EX_FETCH_MAXBYTES of buffers.
+*/
+#define EX_FETCH_ROWS		256
+#define EX_FETCH_MAXBYTES	(4 * 1024 * 1024)
+
+/*
+** How ex_colbatch_bind() binds columns. EX_BIND_CHAR has CT-Lib convert
+** every value to a null terminated string as it is fetched;
+** EX_BIND_NATIVE binds fixed width types (integers, floats, money,
+** dates, numerics) as ct_describe() reports them, so they are only
+** converted when they are displayed (ex_convert_array()). Character,
+** binary and text columns are bound as strings either way.
+** EX_FETCH_BIND is the mode of ex_fetch_data().
 */
-#define ARRAY_BND_LEN 	5	/* so set CS_CURSOR_ROWS to 5 */
-#define	MAX_COLUMN_LEN	45	/* maximum size of a column */
+#define EX_BIND_CHAR		0
+#define EX_BIND_NATIVE		1
+#define EX_FETCH_BIND		EX_BIND_NATIVE
 
-typedef struct ex_column_array {
-	CS_DATAFMT	datafmt;
-	CS_CHAR		value[ARRAY_BND_LEN][MAX_COLUMN_LEN];
-	CS_INT		valuelen[ARRAY_BND_LEN];
-	CS_SMALLINT	indicator[ARRAY_BND_LEN];
-} COLUMN_ARRAY; 
+typedef struct _ex_column_array
+{
+	CS_INT		maxlength;	/* bytes per value */
+	CS_CHAR		*value;		/* count values of maxlength bytes */
+	CS_INT		*valuelen;
+	CS_SMALLINT	*indicator;
+} EX_COLUMN_ARRAY;
+
+/*
+** Value of row r in an EX_COLUMN_ARRAY.
+*/
+#define EX_ARRAY_VALUE(_col, _r)	((_col)->value + (_r) * (_col)->maxlength)
+
+/*
+** Columnar result batch; see excolbatch.h.
+*/
+typedef struct _ex_colbatch EX_COLBATCH;
+
+/*
+** Buffered output writer; see exwriter.h.
+*/
+typedef struct _ex_writer EX_WRITER;
 
 /*****************************************************************************
 ** 
@@ -124,6 +185,11 @@ extern CS_RETCODE CS_PUBLIC ex_display_header(
 	CS_INT numcols,
 	CS_DATAFMT columns[]
 	);
+extern CS_RETCODE CS_PUBLIC ex_write_header(
+	EX_WRITER *out,
+	CS_INT numcols,
+	CS_DATAFMT columns[]
+	);
 extern CS_RETCODE CS_PUBLIC ex_display_column(
 	CS_CONTEXT *context,
 	CS_DATAFMT *colfmt,
@@ -137,6 +203,9 @@ extern CS_VOID CS_PUBLIC ex_panic(
 extern CS_VOID CS_PUBLIC ex_error(
 	char *msg
 	);
+extern CS_BIGINT CS_PUBLIC ex_usecs(
+	CS_VOID
+	);
 extern CS_RETCODE CS_PUBLIC ex_clientmsg_cb(
 	CS_CONTEXT *context,
 	CS_CONNECTION *connection,
@@ -171,9 +240,45 @@ extern CS_RETCODE CS_PUBLIC ex_execute_cmd(
 	CS_CONNECTION *connection,
 	CS_CHAR *cmdbuf
 	);
+extern CS_VOID CS_PUBLIC ex_batch_init(
+	EX_BATCH *batch
+	);
+extern CS_RETCODE CS_PUBLIC ex_batch_add(
+	EX_BATCH *batch,
+	CS_CHAR *stmt
+	);
+extern CS_RETCODE CS_PUBLIC ex_execute_batch(
+	CS_CONNECTION *connection,
+	EX_BATCH *batch
+	);
+extern CS_VOID CS_PUBLIC ex_batch_clear(
+	EX_BATCH *batch
+	);
+extern CS_BOOL CS_PUBLIC ex_native_type(
+	CS_INT datatype
+	);
+extern CS_RETCODE CS_PUBLIC ex_convert_array(
+	CS_CONTEXT *context,
+	CS_DATAFMT *srcfmt,
+	EX_COLUMN_ARRAY *src,
+	CS_DATAFMT *destfmt,
+	EX_COLUMN_ARRAY *dest,
+	CS_INT rows
+	);
 extern CS_RETCODE CS_PUBLIC ex_fetch_data(
 	CS_COMMAND *cmd
 	);
+extern CS_RETCODE CS_PUBLIC ex_fetch_data_rows(
+	CS_COMMAND *cmd,
+	CS_INT count,
+	CS_INT mode
+	);
+extern CS_RETCODE CS_PUBLIC ex_fetch_data_batch(
+	CS_COMMAND *cmd,
+	CS_INT count,
+	CS_INT mode,
+	EX_COLBATCH *batch
+	);
 extern CS_RETCODE CS_PUBLIC ex_create_db(
 	CS_CONNECTION *connection,
 	char *dbname
@@ -0,0 +1,483 @@
+/*
+** exwriter.c
+** ----------
+**
+** Description
+** -----------
+**	Buffered output writer.
+**
+**	The display routines used to go through stdio a character at a
+**	time, flushing after every column and, in ex_display_header(),
+**	every character, so dumping a result cost a system call or more
+**	per value. An EX_WRITER collects the output in a large buffer
+**	and hands it to write() when the buffer fills or when the caller
+**	flushes, which the display routines do once per result set.
+**
+**	A writer opened on descriptor -1 writes nowhere: its buffer grows
+**	to hold whatever is appended, for callers that assemble output in
+**	memory before handing it on.
+**
+**	ex_writer_stdout() is the writer of the display routines. It is
+**	shared by all threads, so each call holds a lock, and it flushes
+**	stdio's stdout before writing so that text printed with fprintf()
+**	before the rows still comes out first.
+**
+** Routines Used
+** -------------
+**	write, vsnprintf, pthread_mutex_lock, pthread_once
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ctpublic.h>
+#include <ospublic.h>
+#include "example.h"
+#include "exutils.h"
+#include "exwriter.h"
+
+/*
+** Lock of the shared writers.
+*/
+CS_STATIC pthread_mutex_t	Ex_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** The writer of ex_writer_stdout().
+*/
+CS_STATIC pthread_once_t	Ex_writer_once = PTHREAD_ONCE_INIT;
+CS_STATIC EX_WRITER		Ex_writer_stdout;
+CS_STATIC CS_CHAR		Ex_writer_stdout_buf[EX_WRITER_BUFSIZE];
+
+/*
+** Prototypes for routines local to this module.
+*/
+CS_STATIC CS_RETCODE ex_writer_drain(
+	EX_WRITER *writer
+	);
+CS_STATIC CS_RETCODE ex_writer_grow(
+	EX_WRITER *writer,
+	CS_INT len
+	);
+CS_STATIC CS_RETCODE ex_writer_append(
+	EX_WRITER *writer,
+	CS_CHAR *data,
+	CS_INT len
+	);
+CS_STATIC CS_VOID ex_writer_stdout_init(
+	CS_VOID
+	);
+CS_STATIC CS_VOID ex_writer_stdout_exit(
+	CS_VOID
+	);
+
+#define EX_WRITER_LOCK(_w) \
+	if ((_w)->shared) pthread_mutex_lock(&Ex_writer_lock)
+#define EX_WRITER_UNLOCK(_w) \
+	if ((_w)->shared) pthread_mutex_unlock(&Ex_writer_lock)
+
+/*
+** ex_writer_open()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Sets up a writer on a file descriptor.
+**
+** Parameters:
+** 	writer		- The writer.
+** 	fd		- Open descriptor; the writer doesn't close it. -1
+**			  for a writer in memory.
+** 	bufsize		- Buffer size, EX_WRITER_BUFSIZE when 0 or less.
+**
+** Returns:
+** 	CS_SUCCEED or CS_MEM_ERROR.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_open(EX_WRITER *writer, int fd, CS_INT bufsize)
+{
+	memset(writer, 0, sizeof (EX_WRITER));
+	writer->fd = fd;
+	writer->bufsize = (bufsize > 0) ? bufsize : EX_WRITER_BUFSIZE;
+	writer->status = CS_SUCCEED;
+
+	if ((writer->buf = (CS_CHAR *)malloc(writer->bufsize)) == NULL)
+	{
+		ex_error("ex_writer_open: malloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_writer_write()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends len bytes. Data larger than the buffer is written
+**	directly once the buffer is drained.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if a write() failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_write(EX_WRITER *writer, CS_CHAR *data, CS_INT len)
+{
+	CS_RETCODE	retcode;
+
+	EX_WRITER_LOCK(writer);
+	retcode = ex_writer_append(writer, data, len);
+	EX_WRITER_UNLOCK(writer);
+
+	return retcode;
+}
+
+/*
+** ex_writer_puts()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends a null terminated string, without the terminator.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_puts(EX_WRITER *writer, CS_CHAR *str)
+{
+	return ex_writer_write(writer, str, strlen(str));
+}
+
+/*
+** ex_writer_putc()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends one character.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_putc(EX_WRITER *writer, CS_INT c)
+{
+	CS_CHAR		ch = (CS_CHAR)c;
+
+	return ex_writer_write(writer, &ch, 1);
+}
+
+/*
+** ex_writer_pad()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends count copies of c; nothing when count is 0 or less. Used
+**	for the blanks and dashes that align columns.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_pad(EX_WRITER *writer, CS_INT c, CS_INT count)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		n;
+
+	EX_WRITER_LOCK(writer);
+	while (count > 0 && retcode == CS_SUCCEED)
+	{
+		if (writer->len == writer->bufsize)
+		{
+			retcode = (writer->fd < 0) ? ex_writer_grow(writer, count)
+				: ex_writer_drain(writer);
+			continue;
+		}
+		n = MIN(count, writer->bufsize - writer->len);
+		memset(writer->buf + writer->len, c, n);
+		writer->len += n;
+		count -= n;
+	}
+	EX_WRITER_UNLOCK(writer);
+
+	return retcode;
+}
+
+/*
+** ex_writer_printf()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Appends printf() style output, formatted straight into the buffer
+**	when it fits. Output longer than EX_BUFSIZE is truncated when it
+**	doesn't.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_printf(EX_WRITER *writer, CS_CHAR *format, ...)
+{
+	va_list		ap;
+	CS_CHAR		tmp[EX_BUFSIZE];
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_INT		room;
+	int		len;
+
+	EX_WRITER_LOCK(writer);
+	room = writer->bufsize - writer->len;
+	va_start(ap, format);
+	len = vsnprintf(writer->buf + writer->len, room, format, ap);
+	va_end(ap);
+
+	if (len >= 0 && len < room)
+	{
+		writer->len += len;
+	}
+	else if (len >= 0)
+	{
+		va_start(ap, format);
+		len = vsnprintf(tmp, sizeof (tmp), format, ap);
+		va_end(ap);
+		retcode = ex_writer_append(writer, tmp,
+				MIN(len, (CS_INT)sizeof (tmp) - 1));
+	}
+	EX_WRITER_UNLOCK(writer);
+
+	return retcode;
+}
+
+/*
+** ex_writer_flush()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Writes out what is in the buffer. Does nothing for a writer in
+**	memory.
+**
+** Returns:
+** 	CS_SUCCEED, or CS_FAIL if this or an earlier write() failed.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_flush(EX_WRITER *writer)
+{
+	CS_RETCODE	retcode;
+
+	EX_WRITER_LOCK(writer);
+	retcode = ex_writer_drain(writer);
+	EX_WRITER_UNLOCK(writer);
+
+	return retcode;
+}
+
+/*
+** ex_writer_close()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Flushes a writer set up by ex_writer_open() and frees its buffer.
+**	The descriptor stays open.
+*/
+
+CS_RETCODE CS_PUBLIC
+ex_writer_close(EX_WRITER *writer)
+{
+	CS_RETCODE	retcode;
+
+	retcode = ex_writer_flush(writer);
+	free(writer->buf);
+	writer->buf = NULL;
+	writer->bufsize = 0;
+
+	return retcode;
+}
+
+/*
+** ex_writer_stdout()
+**
+** Type of function:
+** 	example program utility api
+**
+** Purpose:
+** 	Returns the shared writer on standard output, which is flushed
+**	when the program exits.
+*/
+
+EX_WRITER * CS_PUBLIC
+ex_writer_stdout(CS_VOID)
+{
+	(CS_VOID)pthread_once(&Ex_writer_once, ex_writer_stdout_init);
+
+	return &Ex_writer_stdout;
+}
+
+/*
+** ex_writer_drain()
+**
+** Purpose:
+** 	Writes the buffer out, retrying short writes. Called with the lock
+**	held for shared writers.
+*/
+
+CS_STATIC CS_RETCODE
+ex_writer_drain(EX_WRITER *writer)
+{
+	CS_INT		off = 0;
+	ssize_t		n;
+
+	if (writer->fd < 0)
+	{
+		return writer->status;
+	}
+	if (writer->len > 0 && writer->fd == STDOUT_FILENO)
+	{
+		fflush(stdout);
+	}
+
+	while (off < writer->len)
+	{
+		n = write(writer->fd, writer->buf + off, writer->len - off);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			ex_error("ex_writer_drain: write() failed");
+			writer->status = CS_FAIL;
+			break;
+		}
+		off += n;
+		writer->bytes += n;
+		writer->writes++;
+	}
+	writer->len = 0;
+
+	return writer->status;
+}
+
+/*
+** ex_writer_grow()
+**
+** Purpose:
+** 	Makes room for len more bytes in the buffer of a writer in
+**	memory, at least doubling it.
+*/
+
+CS_STATIC CS_RETCODE
+ex_writer_grow(EX_WRITER *writer, CS_INT len)
+{
+	CS_CHAR		*buf;
+	CS_INT		size;
+
+	size = MAX(2 * writer->bufsize, writer->len + len);
+	if ((buf = (CS_CHAR *)realloc(writer->buf, size)) == NULL)
+	{
+		ex_error("ex_writer_grow: realloc() failed");
+		writer->status = CS_FAIL;
+		return CS_FAIL;
+	}
+	writer->buf = buf;
+	writer->bufsize = size;
+
+	return CS_SUCCEED;
+}
+
+/*
+** ex_writer_append()
+**
+** Purpose:
+** 	ex_writer_write() without the lock.
+*/
+
+CS_STATIC CS_RETCODE
+ex_writer_append(EX_WRITER *writer, CS_CHAR *data, CS_INT len)
+{
+	CS_CHAR		*buf;
+	CS_INT		bufsize;
+	CS_INT		buflen;
+
+	if (len > writer->bufsize - writer->len && writer->fd < 0
+		&& ex_writer_grow(writer, len) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	if (len <= writer->bufsize - writer->len)
+	{
+		memcpy(writer->buf + writer->len, data, len);
+		writer->len += len;
+		return writer->status;
+	}
+
+	if (ex_writer_drain(writer) != CS_SUCCEED)
+	{
+		return CS_FAIL;
+	}
+	if (len <= writer->bufsize)
+	{
+		memcpy(writer->buf, data, len);
+		writer->len = len;
+		return CS_SUCCEED;
+	}
+
+	/*
+	** Too big to buffer: write it from where it is.
+	*/
+	buf = writer->buf;
+	bufsize = writer->bufsize;
+	buflen = writer->len;
+	writer->buf = data;
+	writer->bufsize = len;
+	writer->len = len;
+	(CS_VOID)ex_writer_drain(writer);
+	writer->buf = buf;
+	writer->bufsize = bufsize;
+	writer->len = buflen;
+
+	return writer->status;
+}
+
+/*
+** ex_writer_stdout_init()
+**
+** Purpose:
+** 	Sets up the writer of ex_writer_stdout(), once.
+*/
+
+CS_STATIC CS_VOID
+ex_writer_stdout_init(CS_VOID)
+{
+	Ex_writer_stdout.fd = STDOUT_FILENO;
+	Ex_writer_stdout.buf = Ex_writer_stdout_buf;
+	Ex_writer_stdout.bufsize = sizeof (Ex_writer_stdout_buf);
+	Ex_writer_stdout.len = 0;
+	Ex_writer_stdout.shared = CS_TRUE;
+	Ex_writer_stdout.status = CS_SUCCEED;
+	(CS_VOID)atexit(ex_writer_stdout_exit);
+}
+
+/*
+** ex_writer_stdout_exit()
+**
+** Purpose:
+** 	Flushes the writer of ex_writer_stdout() at exit.
+*/
+
+CS_STATIC CS_VOID
+ex_writer_stdout_exit(CS_VOID)
+{
+	(CS_VOID)ex_writer_flush(&Ex_writer_stdout);
+}
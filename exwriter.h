@@ -0,0 +1,77 @@
+/*
+** exwriter.h
+** ----------
+**
+** Description
+** -----------
+**	Defines and prototypes for the buffered output writer in
+**	exwriter.c.
+*/
+
+#ifndef EXWRITER_H
+#define EXWRITER_H
+
+/*
+** Buffer size of the writers ex_writer_stdout() and the display
+** routines use.
+*/
+#define EX_WRITER_BUFSIZE	(64 * 1024)
+
+/*
+** Output to a file descriptor, buffered: the routines below append to
+** buf, which goes out in one write() when it fills or is flushed. A
+** writer is used by one thread at a time unless it is shared, in which
+** case every call holds a lock.
+*/
+struct _ex_writer
+{
+	int		fd;
+	CS_CHAR		*buf;
+	CS_INT		bufsize;
+	CS_INT		len;		/* bytes in buf */
+	CS_BOOL		shared;
+	CS_RETCODE	status;		/* CS_FAIL once a write() failed */
+	CS_BIGINT	bytes;		/* bytes written to fd */
+	CS_INT		writes;		/* write() calls */
+};
+
+/* exwriter.c */
+extern CS_RETCODE CS_PUBLIC ex_writer_open(
+	EX_WRITER *writer,
+	int fd,
+	CS_INT bufsize
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_write(
+	EX_WRITER *writer,
+	CS_CHAR *data,
+	CS_INT len
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_puts(
+	EX_WRITER *writer,
+	CS_CHAR *str
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_putc(
+	EX_WRITER *writer,
+	CS_INT c
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_pad(
+	EX_WRITER *writer,
+	CS_INT c,
+	CS_INT count
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_printf(
+	EX_WRITER *writer,
+	CS_CHAR *format,
+	...
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_flush(
+	EX_WRITER *writer
+	);
+extern CS_RETCODE CS_PUBLIC ex_writer_close(
+	EX_WRITER *writer
+	);
+extern EX_WRITER * CS_PUBLIC ex_writer_stdout(
+	CS_VOID
+	);
+
+#endif /* EXWRITER_H */
@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <pthread.h>
 #include <unistd.h>
@@ -42,6 +43,24 @@
 #include <ossample.h>
 #include "example.h"
 #include "exutils.h"
+#include "exprefork.h"
+#include "exrouter.h"
+#include "excache.h"
+#include "exqstats.h"
+#include "exoffload.h"
+#include "expool.h"
+#include "exevloop.h"
+#include "excoro.h"
+#include "exstmt.h"
+#include "excolbatch.h"
+#include "exwriter.h"
+#include "exsink.h"
+#include "exexport.h"
+#include "exextract.h"
+#include "exblk.h"
+#include "excursor.h"
+#include "extext.h"
+#include "exsync.h"
 #include "srv_sleep_sig_11.h"
 
 /*****************************************************************************
@@ -67,6 +86,11 @@ CS_CHAR *Ex_password = EX_PASSWORD;
 #define	INFO_MSG1	(CS_INT)5555
 #define	INFO_MSG2	(CS_INT)6666
 
+/*
+** Number of queries each connection of the workload driver runs.
+*/
+#define	EX_WORKLOAD_QUERIES	100
+
 /*
 ** Define what text values that we will manipulate
 */
@@ -74,6 +98,11 @@ CS_CHAR *Ex_password = EX_PASSWORD;
 #define	EX_TXT_UPD1_VALUE	"This is the text value after the first update"
 #define	EX_TXT_UPD2_VALUE	"The second update changed the text to this"
 
+/*
+** Search condition of the row the text is read and updated in.
+*/
+#define	EX_TXT_WHERE		"i1 = 35"
+
 /*
 ** The maximum length of text that this example program may use
 */
@@ -88,11 +117,37 @@ typedef struct _text_data
 	CS_IODESC	iodesc;		/* iodesc associated with text value */
 	CS_TEXT		textbuf[EX_MAX_TEXT];	/* holds the value */
 	CS_INT		textlen;	/* number of bytes in textbuf */
+	CS_BIGINT	valuelen;	/* length of the whole value */
 } TEXT_DATA;
 
+/*
+** Arguments of a fingerprinting job run on the offload pool.
+*/
+typedef struct _fprint_job
+{
+	CS_CHAR		*cmd;
+	CS_INT		len;
+	CS_CHAR		*buf;		/* EX_FPRINT_BUFLEN(len) bytes */
+	EX_FPRINT	*fp;
+} EX_FPRINT_JOB;
+
+/*
+** State shared by the connections of the workload driver.
+*/
+typedef struct _workload
+{
+	CS_CHAR		cmdbuf[EX_BUFSIZE];	/* the query every connection runs */
+	CS_INT		queries;		/* queries per connection */
+	CS_BIGINT	rows;			/* rows fetched by all of them */
+} WORKLOAD;
+
 /*
 ** Prototypes for routines in the example code.
 */
+CS_STATIC CS_INT ParseCount(
+	CS_CHAR *arg,
+	CS_INT max
+	);
 CS_STATIC CS_RETCODE CreateDatabase(
         CS_CONNECTION *connection1,
         CS_CONNECTION *connection2
@@ -104,10 +159,37 @@ CS_STATIC CS_RETCODE RemoveDatabase(
 CS_STATIC CS_RETCODE CreateTable(
         CS_CONNECTION *connection
 	);
-CS_STATIC CS_INT DoGetSend(
+CS_STATIC CS_RETCODE DoGetSend(
         CS_CONNECTION *connection1,
-        CS_CONNECTION *connection2
+        CS_CONNECTION *connection2,
+        CS_INT window
         );
+CS_STATIC CS_RETCODE CS_PUBLIC SyncUpper(
+        CS_VOID *arg,
+        CS_INT key,
+        EX_WRITER *value
+	);
+CS_STATIC CS_RETCODE RunWorkload(
+        CS_CONTEXT *context,
+        CS_INT nconns,
+        CS_BOOL coro
+	);
+CS_STATIC CS_RETCODE RunExtract(
+        CS_INT nparts
+	);
+CS_STATIC CS_RETCODE RunScroll(
+        CS_CONNECTION *connection,
+        CS_INT pagerows
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC WorkloadNext(
+        EX_EVCONN *evconn
+	);
+CS_STATIC CS_RETCODE CS_PUBLIC WorkloadRow(
+        EX_ASYNC *async,
+        CS_INT numcols,
+        CS_DATAFMT *datafmt,
+        EX_COLUMN_DATA *coldata
+	);
 CS_STATIC CS_RETCODE RetrieveData(
         CS_CONNECTION *connection,
         TEXT_DATA *textdata
@@ -116,6 +198,11 @@ CS_STATIC CS_RETCODE FetchResults(
         CS_COMMAND *cmd,
         TEXT_DATA *textdata
 	);
+CS_STATIC CS_RETCODE CS_PUBLIC TextDataSink(
+        CS_VOID *arg,
+        CS_BYTE *data,
+        CS_INT len
+	);
 CS_STATIC CS_RETCODE UpdateTextData(
         CS_CONNECTION *connection,
         TEXT_DATA *textdata,
@@ -135,6 +222,35 @@ CS_STATIC CS_VOID DisplayData(
 CS_STATIC CS_VOID done_error(
         SRV_PROC *sp
     );
+CS_STATIC CS_RETCODE CS_PUBLIC echo_handler(
+        SRV_PROC *sp,
+        CS_CHAR *cmd,
+        CS_INT len,
+        EX_ROUTE *route,
+        CS_VOID *arg
+    );
+CS_STATIC CS_RETCODE CS_PUBLIC ltl_handler(
+        SRV_PROC *sp,
+        CS_CHAR *cmd,
+        CS_INT len,
+        EX_ROUTE *route,
+        CS_VOID *arg
+    );
+CS_STATIC CS_RETCODE CS_PUBLIC select_handler(
+        SRV_PROC *sp,
+        CS_CHAR *cmd,
+        CS_INT len,
+        EX_ROUTE *route,
+        CS_VOID *arg
+    );
+CS_STATIC CS_RETCODE CS_PUBLIC fprint_job(
+	CS_VOID *arg
+	);
+CS_STATIC CS_RETCODE produce_rows(
+        CS_CHAR *cmd,
+        CS_INT len,
+        EX_ROWBUF *rows
+    );
 
 
 /*
@@ -142,9 +258,48 @@ CS_STATIC CS_VOID done_error(
 ** 
 ** Purpose:
 **	Entry point for example program.
+**
+**	With "-P <n>" the program runs as a pre-fork supervisor of n Open
+**	Server worker processes instead (see exprefork.c), and the
+**	Client-Library part of the example is not run.
+**
+**	With "-W <n>" the example also runs a query workload on n
+**	connections at once from a single thread (see RunWorkload());
+**	"-C <n>" runs the same workload with coroutines (see excoro.cpp).
+**
+**	"-O <format>" writes result sets as csv, tsv or ndjson instead of
+**	padded text (see exsink.c).
+**
+**	"-X <file>" exports the sample table to a binary columnar file
+**	(see exexport.c).
+**
+**	"-E <n>" extracts the sample table in key order over n connections
+**	at once, one thread each (see exextract.c).
+**
+**	"-L <file>" bulk copies a CSV file, as written with "-O csv", into
+**	the sample table before the table is exported or extracted (see
+**	exblk.c). "-B <file>" bulk copies the sample table out to a file in
+**	the output format.
+**
+**	"-R <n>" pages through the sample table with a scrollable cursor,
+**	n rows a page (see excursor.c).
+**
+**	"-U <file>" replaces the text of the sample row with the contents
+**	of a file, and "-D <file>" writes the text of the sample row to a
+**	file, after the getsend updates (see extext.c).
+**
+**	"-S <n>" ends the getsend updates by rewriting the text of every
+**	row with reads and updates overlapped, n rows read ahead (see
+**	exsync.c).
+**
+**	Every count is a whole number from 1 to the limit of its option:
+**	EX_PREFORK_MAX_WORKERS, EX_EVLOOP_MAX_CONNS, EX_EXTRACT_MAX_PARTS,
+**	EX_CURSOR_MAX_PAGE or EX_SYNC_MAX_WINDOW. Anything else gets the
+**	usage message.
 ** 
 ** Parameters:
-**	None, argc and argv will not be used.
+**	argc		- Number of command line arguments.
+**	argv		- Command line arguments.
 **
 ** Return:
 ** 	EX_EXIT_ERROR  or EX_EXIT_SUCCEED
@@ -158,9 +313,100 @@ main(int argc, char *argv[])
 	CS_CONNECTION	*connection1 = NULL;
 	CS_CONNECTION	*connection2 = NULL;
 	CS_RETCODE	retcode;
+	CS_INT		nworkers = 0;
+	CS_INT		nconns = 0;
+	CS_INT		nparts = 0;
+	CS_INT		pagerows = 0;
+	CS_INT		window = 0;
+	CS_BOOL		coro = CS_FALSE;
+	CS_INT		format;
+	CS_CHAR		*exportpath = NULL;
+	CS_CHAR		*loadpath = NULL;
+	CS_CHAR		*unloadpath = NULL;
+	CS_CHAR		*uploadpath = NULL;
+	CS_CHAR		*downloadpath = NULL;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	CS_BIGINT	rows;
+	CS_INT		i;
 	
 	EX_SCREEN_INIT();
 
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-P") == 0 && (i + 1) < argc
+			&& (nworkers = ParseCount(argv[i + 1],
+				EX_PREFORK_MAX_WORKERS)) > 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-W") == 0 && (i + 1) < argc
+			&& (nconns = ParseCount(argv[i + 1], EX_EVLOOP_MAX_CONNS)) > 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-C") == 0 && (i + 1) < argc
+			&& (nconns = ParseCount(argv[i + 1], EX_EVLOOP_MAX_CONNS)) > 0)
+		{
+			i++;
+			coro = CS_TRUE;
+		}
+		else if (strcmp(argv[i], "-O") == 0 && (i + 1) < argc
+			&& ex_sink_lookup(argv[i + 1], &format) == CS_SUCCEED)
+		{
+			ex_sink_set_default(format);
+			i++;
+		}
+		else if (strcmp(argv[i], "-X") == 0 && (i + 1) < argc)
+		{
+			exportpath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-E") == 0 && (i + 1) < argc
+			&& (nparts = ParseCount(argv[i + 1], EX_EXTRACT_MAX_PARTS)) > 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-L") == 0 && (i + 1) < argc)
+		{
+			loadpath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-B") == 0 && (i + 1) < argc)
+		{
+			unloadpath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-R") == 0 && (i + 1) < argc
+			&& (pagerows = ParseCount(argv[i + 1], EX_CURSOR_MAX_PAGE)) > 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-S") == 0 && (i + 1) < argc
+			&& (window = ParseCount(argv[i + 1], EX_SYNC_MAX_WINDOW)) > 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-U") == 0 && (i + 1) < argc)
+		{
+			uploadpath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-D") == 0 && (i + 1) < argc)
+		{
+			downloadpath = argv[++i];
+		}
+		else
+		{
+			fprintf(EX_ERROR_OUT, "usage: %s [-P nworkers] [-W nconns | -C nconns] "
+				"[-O text|csv|tsv|ndjson] [-X exportfile] [-E nparts] "
+				"[-L csvfile] [-B outfile] [-R pagerows] "
+				"[-U infile] [-D outfile] [-S window]\n", argv[0]);
+			return EX_EXIT_FAIL;
+		}
+	}
+
+	if (nworkers > 0)
+	{
+		retcode = ex_prefork_run(nworkers);
+		return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
+	}
+
 	fprintf(stdout,"srv_sleep() signal 11 Example\n");
 	fflush(stdout);
 
@@ -211,17 +457,35 @@ main(int argc, char *argv[])
 	/* 
 	** Establish two connections. Connection1 is used to 
 	** select data. Connection2 is used for doing updates.
-	** Allocate the connection structure, set their properties, and  
-	** establish the connections.
+	** The connections come from the connection pool, which logs
+	** in new ones only when it has no warm connection to hand out.
 	*/
-	retcode = ex_connect(context, &connection1, Ex_appname,
-				Ex_username, Ex_password, Ex_server);
+	retcode = ex_pool_init(context, EX_POOL_MAX_PER_KEY);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_pool_checkout(&connection1, Ex_appname,
+					Ex_username, Ex_password, Ex_server);
+	}
 	if (retcode == CS_SUCCEED)
 	{
-		retcode = ex_connect(context, &connection2, Ex_appname,
+		retcode = ex_pool_checkout(&connection2, Ex_appname,
 					Ex_username, Ex_password, Ex_server);
 	}
 
+	/*
+	** Text values are read and sent in chunks, so nothing needs them
+	** cut at the default text size. ex_pool_checkin() puts the limits
+	** back.
+	*/
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_text_unlimit(connection1);
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_text_unlimit(connection2);
+	}
+
 	/*
 	** Create a database for the sample program and change to it. The
 	** routine will use the global variable Ex_dbname, which is defined in
@@ -249,7 +513,104 @@ main(int argc, char *argv[])
 	*/
 	if (retcode == CS_SUCCEED)
 	{
-		retcode = DoGetSend(connection1, connection2);
+		retcode = DoGetSend(connection1, connection2, window);
+	}
+
+	/*
+	** Move the text of the sample row to and from files, if asked
+	** to; the value goes through in chunks, however large it is.
+	*/
+	if (retcode == CS_SUCCEED && uploadpath != NULL)
+	{
+		retcode = ex_text_upload(connection2, Ex_tabname, "t",
+				EX_TXT_WHERE, uploadpath, &rows);
+		if (retcode == CS_SUCCEED)
+		{
+			fprintf(stdout, "Uploaded %lld bytes from %s\n",
+				(long long)rows, uploadpath);
+			fflush(stdout);
+		}
+	}
+	if (retcode == CS_SUCCEED && downloadpath != NULL)
+	{
+		retcode = ex_text_download(connection1, Ex_tabname, "t",
+				EX_TXT_WHERE, downloadpath, &rows);
+		if (retcode == CS_SUCCEED)
+		{
+			fprintf(stdout, "Downloaded %lld bytes to %s\n",
+				(long long)rows, downloadpath);
+			fflush(stdout);
+		}
+	}
+
+	/*
+	** Bulk load the sample table, whose four columns the file must
+	** have, if asked to.
+	*/
+	if (retcode == CS_SUCCEED && loadpath != NULL)
+	{
+		retcode = ex_blk_load_csv(connection1, Ex_tabname, 4, loadpath,
+				&rows);
+		if (retcode == CS_SUCCEED)
+		{
+			fprintf(stdout, "Loaded %lld rows from %s\n",
+				(long long)rows, loadpath);
+			fflush(stdout);
+		}
+	}
+
+	/*
+	** Bulk copy the sample table out if asked to.
+	*/
+	if (retcode == CS_SUCCEED && unloadpath != NULL)
+	{
+		retcode = ex_blk_unload(connection1, Ex_tabname, 4,
+				ex_sink_default(), unloadpath, &rows);
+		if (retcode == CS_SUCCEED)
+		{
+			fprintf(stdout, "Unloaded %lld rows to %s\n",
+				(long long)rows, unloadpath);
+			fflush(stdout);
+		}
+	}
+
+	/*
+	** Export the sample table if asked to.
+	*/
+	if (retcode == CS_SUCCEED && exportpath != NULL)
+	{
+		sprintf(cmdbuf, "select * from %s", Ex_tabname);
+		retcode = ex_export_query(connection1, cmdbuf, exportpath, &rows);
+		if (retcode == CS_SUCCEED)
+		{
+			fprintf(stdout, "Exported %lld rows to %s\n",
+				(long long)rows, exportpath);
+			fflush(stdout);
+		}
+	}
+
+	/*
+	** Page through the sample table if asked to.
+	*/
+	if (retcode == CS_SUCCEED && pagerows > 0)
+	{
+		retcode = RunScroll(connection1, pagerows);
+	}
+
+	/*
+	** Extract the sample table in parallel if asked to.
+	*/
+	if (retcode == CS_SUCCEED && nparts > 0)
+	{
+		retcode = RunExtract(nparts);
+	}
+
+	/*
+	** Run the multi-connection workload if one was asked for.
+	*/
+	if (retcode == CS_SUCCEED && nconns > 0)
+	{
+		retcode = RunWorkload(context, nconns, coro);
 	}
 
 	/*
@@ -261,17 +622,18 @@ main(int argc, char *argv[])
 	}
 
 	/*
-	** Deallocate the allocated structures, close the connection,
-	** and exit Client-Library.
+	** Give the connections back to the pool, close the pooled
+	** connections, and exit Client-Library.
 	*/
 	if (connection1 != NULL)
 	{
-		retcode = ex_con_cleanup(connection1, retcode);
+		retcode = ex_pool_checkin(connection1, retcode);
 	}
 	if (connection2 != NULL)
 	{
-		retcode = ex_con_cleanup(connection2, retcode);
+		retcode = ex_pool_checkin(connection2, retcode);
 	}
+	retcode = ex_pool_drain(retcode);
 	
 	if (context != NULL)
 	{
@@ -281,6 +643,38 @@ main(int argc, char *argv[])
 	return (retcode == CS_SUCCEED) ? EX_EXIT_SUCCEED : EX_EXIT_FAIL;
 }
 
+/*
+** ParseCount()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Parses the count argument of an option.
+**
+** Parameters:
+** 	arg		- The argument.
+** 	max		- Largest count allowed.
+**
+** Return:
+**	The count, or 0 if arg isn't a whole number from 1 to max.
+*/
+CS_STATIC CS_INT
+ParseCount(CS_CHAR *arg, CS_INT max)
+{
+	CS_CHAR		*end;
+	long		value;
+
+	errno = 0;
+	value = strtol(arg, &end, 10);
+	if (errno != 0 || end == arg || *end != '\0'
+		|| value < 1 || value > max)
+	{
+		return 0;
+	}
+	return (CS_INT)value;
+}
+
 /*
 ** CreateDatabase()
 **
@@ -404,53 +798,42 @@ CreateTable(CS_CONNECTION *connection)
 {
 
 	CS_RETCODE	retcode;
-	CS_CHAR		*cmdbuf;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	EX_BATCH	batch;
 	
-	/* 
-	** Allocate the buffer for the command string.
-	*/
-	cmdbuf = (CS_CHAR *) malloc(EX_BUFSIZE);
-	if (cmdbuf == (CS_CHAR *)NULL)
-	{
-		ex_error("CreateTable: malloc() failed");
-		return CS_MEM_ERROR;
-	}
-
 	/*
-	** If the table exists, drop it.
+	** Drop the table if it exists, then create it and insert an
+	** initial value in a single round trip.
 	*/
+	ex_batch_init(&batch);
 	sprintf(cmdbuf, "if exists (select name from sysobjects \
 			where name = \"%s\") drop table %s",
 					Ex_tabname, Ex_tabname);
-        if ((retcode = ex_execute_cmd(connection, cmdbuf)) != CS_SUCCEED)
-        {
-                ex_error("CreateTable: ex_execute_cmd(drop table) failed");
-		free (cmdbuf);
-		return retcode;
+	retcode = ex_batch_add(&batch, cmdbuf);
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(cmdbuf, "create table %s (i1 int, t text, f float, i2 int)",
+					Ex_tabname);
+		retcode = ex_batch_add(&batch, cmdbuf);
 	}
-		
-	/*
-	** Set up and send the command to create the table.  
-	*/
-	sprintf(cmdbuf, "create table %s (i1 int, t text, f float, i2 int)",
-				Ex_tabname);
-        if ((retcode = ex_execute_cmd(connection, cmdbuf)) != CS_SUCCEED)
-        {
-                ex_error("CreateTable: ex_execute_cmd(drop table) failed");
-		free (cmdbuf);
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(cmdbuf, "insert %s values (35, '%s', 20.3, 50)",
+				Ex_tabname, EX_TXT_INIT_VALUE);
+		retcode = ex_batch_add(&batch, cmdbuf);
+	}
+	if (retcode != CS_SUCCEED)
+	{
+		ex_error("CreateTable: ex_batch_add() failed");
+		ex_batch_clear(&batch);
 		return retcode;
 	}
 
-	/*
-	** Insert an initial value into the table
-	*/
-	sprintf(cmdbuf, "insert %s values (35, '%s', 20.3, 50)",
-			Ex_tabname, EX_TXT_INIT_VALUE);
-        if ((retcode = ex_execute_cmd(connection, cmdbuf)) != CS_SUCCEED)
+        if ((retcode = ex_execute_batch(connection, &batch)) != CS_SUCCEED)
         {
-                ex_error("CreateTable: ex_execute_cmd(insert table) failed");
+                ex_error("CreateTable: ex_execute_batch() failed");
 	}
-	free(cmdbuf);	
+	ex_batch_clear(&batch);
 	return retcode;
 }
 
@@ -464,17 +847,28 @@ CreateTable(CS_CONNECTION *connection)
 ** 	This routine is the main driver for doing the getdata operation.
 ** 	It assumes that tha database and tables have been set up.
 **
+**	Each update needs the descriptor the read before it returned, and
+**	each read checks the update before it, so these steps run in
+**	turn. With a window, the text of every row is then rewritten in
+**	upper case by the pipelined sync (see exsync.c), which reads the
+**	next rows on connection1 while an update goes out on connection2.
+**
 ** Parameters:
-** 	connection	- Pointer to CS_CONNECTION structure.
-** 	connection	- Pointer to CS_CONNECTION structure.
+** 	connection1	- Pointer to CS_CONNECTION structure to read on.
+** 	connection2	- Pointer to CS_CONNECTION structure to update on.
+**	window		- Rows the sync reads ahead, 0 not to run it.
 **
 ** Return:
 */
 CS_STATIC CS_RETCODE 
-DoGetSend(CS_CONNECTION *connection1, CS_CONNECTION *connection2)
+DoGetSend(CS_CONNECTION *connection1, CS_CONNECTION *connection2,
+	  CS_INT window)
 {
 	CS_RETCODE	retcode;
 	TEXT_DATA	textdata;
+	EX_SYNC_STATS	stats;
+	CS_CHAR		upper[] = EX_TXT_UPD2_VALUE;
+	CS_INT		i;
 
 	/* 
 	** Retrieve the data initially in the table and
@@ -502,33 +896,397 @@ DoGetSend(CS_CONNECTION *connection1, CS_CONNECTION *connection2)
                 return retcode;
 	}
 
-	if ((retcode = RetrieveData(connection1, &textdata)) != CS_SUCCEED)
+	if ((retcode = RetrieveData(connection1, &textdata)) != CS_SUCCEED)
+	{
+                ex_error("DoGetSend: RetrieveData failed");
+                return retcode;
+	}
+	DisplayData(&textdata);
+	ValidateTxt(&textdata, EX_TXT_UPD1_VALUE);
+
+	/*
+	** Do it again with another text value.
+	*/
+	retcode = UpdateTextData(connection2, &textdata, EX_TXT_UPD2_VALUE);
+	if (retcode != CS_SUCCEED)
+	{
+                ex_error("DoGetSend: UpdateTextData failed");
+                return retcode;
+	}
+
+	if ((retcode = RetrieveData(connection1, &textdata)) != CS_SUCCEED)
+	{
+                ex_error("DoGetSend: RetrieveData failed");
+                return retcode;
+	}
+	DisplayData(&textdata);
+	ValidateTxt(&textdata, EX_TXT_UPD2_VALUE);
+
+	if (window <= 0)
+	{
+		return retcode;
+	}
+
+	/*
+	** Rewrite the text of every row, reading ahead of the updates.
+	*/
+	retcode = ex_sync_text(connection1, connection2, Ex_tabname, "i1", "t",
+			window, SyncUpper, NULL, &stats);
+	if (retcode != CS_SUCCEED)
+	{
+                ex_error("DoGetSend: ex_sync_text failed");
+                return retcode;
+	}
+	fprintf(stdout, "\nSync: %lld rows, %lld skipped, window %d: "
+		"read %.3f s (%.3f s waiting), update %.3f s (%.3f s waiting), "
+		"%.3f s in all.\n", (long long)stats.rows,
+		(long long)stats.skipped, stats.window, stats.readtime / 1e6,
+		stats.readwait / 1e6, stats.updatetime / 1e6,
+		stats.updatewait / 1e6, stats.elapsed / 1e6);
+	fflush(stdout);
+
+	if ((retcode = RetrieveData(connection1, &textdata)) != CS_SUCCEED)
+	{
+                ex_error("DoGetSend: RetrieveData failed");
+                return retcode;
+	}
+	for (i = 0; upper[i] != '\0'; i++)
+	{
+		upper[i] = (CS_CHAR)toupper((unsigned char)upper[i]);
+	}
+	DisplayData(&textdata);
+	ValidateTxt(&textdata, upper);
+
+	return retcode;
+}
+
+/*
+** SyncUpper()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+**	Rewrite routine of the sync in DoGetSend(): turns the value to
+**	upper case in place.
+**
+** Parameters:
+**	arg		- Unused.
+**	key		- i1 of the row.
+**	value		- The value, in memory.
+**
+** Return:
+**	CS_SUCCEED
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+SyncUpper(CS_VOID *arg, CS_INT key, EX_WRITER *value)
+{
+	CS_INT		i;
+
+	for (i = 0; i < value->len; i++)
+	{
+		value->buf[i] = (CS_CHAR)toupper((unsigned char)value->buf[i]);
+	}
+	return CS_SUCCEED;
+}
+
+/*
+** RunExtract()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Extracts the sample table in key order, split on i1 into nparts
+**	ranges selected at the same time on pooled connections, writing
+**	the rows to stdout in the output format, and reports the time per
+**	partition.
+**
+** Parameters:
+** 	nparts		- Number of partitions, 1 to EX_EXTRACT_MAX_PARTS.
+**
+** Return:
+**	CS_SUCCEED if every partition succeeded.
+**	Otherwise a Client-Library failure code.
+*/
+CS_STATIC CS_RETCODE
+RunExtract(CS_INT nparts)
+{
+	CS_RETCODE		retcode = CS_SUCCEED;
+	CS_CONNECTION		**connections;
+	CS_CHAR			table[EX_BUFSIZE];
+	EX_EXTRACT_STATS	stats;
+	FILE			*out;
+	CS_INT			i;
+
+	if (nparts < 1 || nparts > EX_EXTRACT_MAX_PARTS)
+	{
+		ex_error("RunExtract: partition count out of range");
+		return CS_FAIL;
+	}
+
+	connections = (CS_CONNECTION **)calloc(nparts, sizeof (CS_CONNECTION *));
+	if (connections == NULL)
+	{
+		ex_error("RunExtract: calloc() failed");
+		return CS_MEM_ERROR;
+	}
+
+	for (i = 0; i < nparts && retcode == CS_SUCCEED; i++)
+	{
+		retcode = ex_pool_checkout(&connections[i], Ex_appname,
+					Ex_username, Ex_password, Ex_server);
+	}
+
+	if (retcode == CS_SUCCEED)
+	{
+		sprintf(table, "%s..%s", Ex_dbname, Ex_tabname);
+		retcode = ex_extract_table(connections, nparts, table, "i1",
+				ex_sink_default(), ex_writer_stdout(), CS_TRUE,
+				&stats);
+
+		/*
+		** Keep the report out of the rows unless they are text.
+		*/
+		out = (ex_sink_default() == EX_SINK_TEXT) ? stdout : EX_ERROR_OUT;
+		fprintf(out, "\nExtract: %d partitions of i1 %lld..%lld, "
+			"%lld rows in %.3f s.\n", stats.nparts,
+			(long long)stats.lo, (long long)stats.hi,
+			(long long)stats.rows, stats.elapsed / 1e6);
+		for (i = 0; i < stats.nparts; i++)
+		{
+			fprintf(out, "  partition %d: %lld rows in %.3f s\n", i,
+				(long long)stats.partrows[i],
+				stats.parttime[i] / 1e6);
+		}
+		fflush(out);
+	}
+
+	for (i = 0; i < nparts; i++)
+	{
+		if (connections[i] != NULL)
+		{
+			(CS_VOID)ex_pool_checkin(connections[i], retcode);
+		}
+	}
+	free(connections);
+
+	return retcode;
+}
+
+/*
+** RunScroll()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Pages back and forth through the sample table with a scrollable
+**	cursor, writing each page in the output format, and reports how
+**	many pages needed a round trip.
+**
+** Parameters:
+** 	connection	- Pointer to CS_CONNECTION structure.
+** 	pagerows	- Rows per page.
+**
+** Return:
+**	CS_SUCCEED if the cursor could be read.
+**	Otherwise a Client-Library failure code.
+*/
+CS_STATIC CS_RETCODE
+RunScroll(CS_CONNECTION *connection, CS_INT pagerows)
+{
+	CS_RETCODE	retcode;
+	EX_CURSOR	cursor;
+	CS_CHAR		cmdbuf[EX_BUFSIZE];
+	FILE		*out;
+	CT_SCROLL_INDEX	moves[] = {
+		{ 0, CS_FIRST }, { 0, CS_NEXT }, { 0, CS_NEXT }, { 0, CS_PREV },
+		{ 1, CS_ABSOLUTE }, { 0, CS_LAST }, { 0, CS_PREV }
+	};
+
+	sprintf(cmdbuf, "select * from %s", Ex_tabname);
+	retcode = ex_cursor_open(&cursor, connection, "scroll_cursor", cmdbuf,
+			pagerows, EX_CURSOR_PREFETCH, EX_FETCH_BIND);
+	if (retcode == CS_SUCCEED)
+	{
+		retcode = ex_cursor_walk(&cursor, moves,
+				sizeof (moves) / sizeof (moves[0]),
+				ex_sink_default(), ex_writer_stdout());
+	}
+	if (retcode == CS_SUCCEED)
+	{
+		out = (ex_sink_default() == EX_SINK_TEXT) ? stdout : EX_ERROR_OUT;
+		fprintf(out, "\nScroll: %d pages, %d round trips.\n",
+			cursor.hits + cursor.fetches, cursor.fetches);
+		fflush(out);
+	}
+
+	return ex_cursor_close(&cursor, retcode);
+}
+
+/*
+** RunWorkload()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Runs EX_WORKLOAD_QUERIES selects of the sample table on each of
+**	nconns connections, all in flight at the same time and all served
+**	by one thread, and reports the throughput. The connections are
+**	served by the event loop in exevloop.c, or with coro by a
+**	coroutine each (see excoro.cpp).
+**
+** Parameters:
+** 	context		- Pointer to CS_CONTEXT structure.
+** 	nconns		- Number of connections, 1 to EX_EVLOOP_MAX_CONNS.
+** 	coro		- CS_TRUE to run the workload with coroutines.
+**
+** Return:
+**	CS_SUCCEED if every query succeeded.
+**	Otherwise a Client-Library failure code.
+*/
+CS_STATIC CS_RETCODE
+RunWorkload(CS_CONTEXT *context, CS_INT nconns, CS_BOOL coro)
+{
+	CS_RETCODE	retcode = CS_SUCCEED;
+	CS_RETCODE	ret;
+	CS_CONNECTION	**connections;
+	EX_EVCONN	*evconns;
+	EX_EVLOOP	loop;
+	WORKLOAD	workload;
+	CS_BIGINT	start;
+	double		secs;
+	CS_INT		requests = 0;
+	CS_INT		errors = 0;
+	CS_INT		i;
+
+	if (nconns < 1 || nconns > EX_EVLOOP_MAX_CONNS)
+	{
+		ex_error("RunWorkload: connection count out of range");
+		return CS_FAIL;
+	}
+
+	connections = (CS_CONNECTION **)calloc(nconns, sizeof (CS_CONNECTION *));
+	evconns = (EX_EVCONN *)calloc(nconns, sizeof (EX_EVCONN));
+	if (connections == NULL || evconns == NULL)
+	{
+		ex_error("RunWorkload: calloc() failed");
+		free(connections);
+		free(evconns);
+		return CS_MEM_ERROR;
+	}
+
+	memset(&workload, 0, sizeof (workload));
+	sprintf(workload.cmdbuf, "select * from %s..%s", Ex_dbname, Ex_tabname);
+	workload.queries = EX_WORKLOAD_QUERIES;
+
+	(CS_VOID)ex_evloop_init(&loop, context);
+	for (i = 0; i < nconns && retcode == CS_SUCCEED; i++)
+	{
+		retcode = ex_pool_checkout(&connections[i], Ex_appname,
+					Ex_username, Ex_password, Ex_server);
+		if (retcode == CS_SUCCEED && !coro)
+		{
+			retcode = ex_evloop_add(&loop, &evconns[i], connections[i],
+					WorkloadNext, &workload);
+		}
+	}
+
+	if (retcode == CS_SUCCEED)
+	{
+		start = ex_usecs();
+		if (coro)
+		{
+			retcode = ex_coro_workload(connections, nconns,
+					workload.cmdbuf, workload.queries,
+					&requests, &errors, &workload.rows);
+		}
+		else
+		{
+			retcode = ex_evloop_run(&loop);
+			for (i = 0; i < nconns; i++)
+			{
+				requests += evconns[i].requests;
+				errors += evconns[i].errors;
+			}
+		}
+		secs = (ex_usecs() - start) / 1e6;
+		fprintf(stdout, "Workload: %d connections, %d queries, %d errors, "
+			"%lld rows in %.3f s (%.0f queries/s).\n",
+			nconns, requests, errors, (long long)workload.rows, secs,
+			(secs > 0) ? requests / secs : 0.0);
+		fflush(stdout);
+
+		if (retcode == CS_SUCCEED && errors > 0)
+		{
+			retcode = CS_FAIL;
+		}
+	}
+
+	/*
+	** Connections that are left in a bad state are closed by the
+	** pool rather than kept.
+	*/
+	ret = ex_evloop_cleanup(&loop);
+	for (i = 0; i < nconns; i++)
+	{
+		if (connections[i] != NULL)
+		{
+			(CS_VOID)ex_pool_checkin(connections[i],
+				(ret == CS_SUCCEED) ? retcode : ret);
+		}
+	}
+
+	free(connections);
+	free(evconns);
+
+	return retcode;
+}
+
+/*
+** WorkloadNext()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Event loop routine of the workload driver: starts the next query
+**	of a connection, until it has run its share.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+WorkloadNext(EX_EVCONN *evconn)
+{
+	WORKLOAD	*workload = (WORKLOAD *)evconn->userdata;
+
+	if (evconn->requests >= workload->queries)
 	{
-                ex_error("DoGetSend: RetrieveData failed");
-                return retcode;
+		return CS_END_DATA;
 	}
-	DisplayData(&textdata);
-	ValidateTxt(&textdata, EX_TXT_UPD1_VALUE);
 
-	/*
-	** Do it again with another text value.
-	*/
-	retcode = UpdateTextData(connection2, &textdata, EX_TXT_UPD2_VALUE);
-	if (retcode != CS_SUCCEED)
-	{
-                ex_error("DoGetSend: UpdateTextData failed");
-                return retcode;
-	}
+	(CS_VOID)ex_async_fetch_data(&evconn->async, evconn->connection,
+			workload->cmdbuf, WorkloadRow, NULL, workload);
 
-	if ((retcode = RetrieveData(connection1, &textdata)) != CS_SUCCEED)
-	{
-                ex_error("DoGetSend: RetrieveData failed");
-                return retcode;
-	}
-	DisplayData(&textdata);
-	ValidateTxt(&textdata, EX_TXT_UPD2_VALUE);
+	return CS_SUCCEED;
+}
 
-	return retcode;
+/*
+** WorkloadRow()
+**
+** Type of function:
+** 	getsend program internal api
+**
+** Purpose:
+** 	Row routine of the workload driver: only counts the rows.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+WorkloadRow(EX_ASYNC *async, CS_INT numcols, CS_DATAFMT *datafmt,
+	    EX_COLUMN_DATA *coldata)
+{
+	((WORKLOAD *)async->userdata)->rows++;
+
+	return CS_SUCCEED;
 }
 
 /*
@@ -554,50 +1312,18 @@ RetrieveData(CS_CONNECTION *connection, TEXT_DATA *textdata)
 {
 	CS_RETCODE	retcode;
 	CS_INT		res_type;
-	CS_CHAR         *cmdbuf;
+	CS_CHAR         cmdbuf[EX_BUFSIZE];
 	CS_COMMAND	*cmd;
 
-	/* 
-	** Allocate the buffer for the command string.
-	*/
-	cmdbuf = (CS_CHAR *) malloc(EX_BUFSIZE);
-	if (cmdbuf == (CS_CHAR *)NULL)
-	{
-		ex_error("RetrieveData: malloc() failed");
-		return (CS_FAIL);
-	}
-
-	/*
-	** Allocate a command handle to send the select query with
-	*/
-        if ((retcode = ct_cmd_alloc(connection, &cmd)) != CS_SUCCEED)
-        {
-                ex_error("RetrieveData: ct_cmd_alloc() failed");
-		free(cmdbuf);
-                return retcode;
-        }
-
 	/*
-	** Set up the command to select from the table.  
+	** Select from the table. The statement is prepared on the first
+	** call and only executed on the following ones.
 	*/
 	sprintf(cmdbuf, "select * from %s", Ex_tabname);
-	retcode = ct_command(cmd, CS_LANG_CMD, cmdbuf, CS_NULLTERM, CS_UNUSED);
-	if (retcode != CS_SUCCEED)
-	{
-                ex_error("RetrieveData: ct_command() failed");
-		free(cmdbuf);
-		ct_cmd_drop(cmd);
-                return retcode;
-	}
-	free(cmdbuf);
-
-	/*
-	** Send the command to the server 
-	*/
-	if (ct_send(cmd) != CS_SUCCEED)
+	if ((retcode = ex_stmt_execute(connection, cmdbuf, 0, NULL, &cmd))
+			!= CS_SUCCEED)
 	{
-                ex_error("RetrieveData: ct_send() failed");
-		ct_cmd_drop(cmd);
+                ex_error("RetrieveData: ex_stmt_execute() failed");
                 return retcode;
 	}
 					
@@ -722,10 +1448,10 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 	CS_RETCODE	retcode;
 	CS_DATAFMT	fmt;
 	CS_INT		firstcol;
-	CS_TEXT		*txtptr;
 	CS_FLOAT	floatitem;
 	CS_INT		count;
 	CS_INT		len;
+	EX_TEXT_READER	reader;
 
 	/* 
 	** All binds must be of columns prior to the columns
@@ -745,6 +1471,11 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 		return retcode;
 	}
 
+	if ((retcode = ex_text_reader_init(&reader, EX_TEXT_CHUNK)) != CS_SUCCEED)
+	{
+		return retcode;
+	}
+
 	/*
 	** Retrieve and display the results.
 	*/
@@ -761,36 +1492,25 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 		}
 		
 		/*
-		** Get the text data item in the second column.
-		** Loop until we have all the data for this item.
-		** The text used for this example could be retrieved
-		** in one ct_get_data call, but data could be too large
-		** for this to be the case. Instead, the data would have to
-		** be retrieved in chunks. The example will retrieve
-		** the text in 5 byte increments to demonstrate retrieving
-		** data items in chunks.
+		** Stream the text data item in the second column. The
+		** reader takes it in EX_TEXT_CHUNK pieces, however large
+		** it is, and TextDataSink() keeps what fits in textbuf.
 		*/
-		txtptr = textdata->textbuf;
 		textdata->textlen = 0;
-		do
-		{
-			retcode = ct_get_data(cmd, 2, txtptr, 5, &len);
-			textdata->textlen += len;
-			/*
-			** Protect against overflowing the string buffer.
-			*/
-			if ((textdata->textlen + 5) > (EX_MAX_TEXT - 1))
-			{
-				break;
-			}
-			txtptr += len;
-		} while (retcode == CS_SUCCEED);
-		
+		retcode = ex_text_read(&reader, cmd, 2, TextDataSink, textdata);
 		if (retcode != CS_END_ITEM)
 		{
-			ex_error("FetchResults: ct_get_data() failed");
+			ex_error("FetchResults: ex_text_read() failed");
+			ex_text_reader_free(&reader);
 			return retcode;
 		}
+		textdata->valuelen = reader.bytes;
+		if (textdata->valuelen > textdata->textlen)
+		{
+			fprintf(stdout, "Text value of %lld bytes, kept %d\n",
+				(long long)textdata->valuelen, textdata->textlen);
+			fflush(stdout);
+		}
 		
 		/* 
 		** Retrieve the descriptor of the text data. It is  
@@ -801,6 +1521,7 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 		if (retcode != CS_SUCCEED)
 		{
 			ex_error("FetchResults: cs_data_info() failed");
+			ex_text_reader_free(&reader);
 			return retcode;
 		}
 		
@@ -812,6 +1533,7 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 		if (retcode != CS_END_ITEM)
 		{
 			ex_error("FetchResults: ct_get_data() failed");
+			ex_text_reader_free(&reader);
 			return(retcode);
 		}
 		
@@ -841,9 +1563,48 @@ FetchResults(CS_COMMAND *cmd, TEXT_DATA *textdata)
 		ex_error("FetchResults: ct_fetch() failed");
 	}
 
+	ex_text_reader_free(&reader);
 	return retcode;
 }
 
+/*
+** TextDataSink()
+**
+** Type of function:
+** 	getsend program internal api
+** 
+** Purpose:
+**	Text sink of FetchResults(): copies the chunks of the value into
+**	textbuf while they fit, leaving room for a terminator, and drops
+**	the rest.
+**
+** Parameters:
+** 	arg		- The TEXT_DATA to fill.
+**	data		- The chunk.
+**	len		- Its length.
+**
+** Return:
+**	CS_SUCCEED
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+TextDataSink(CS_VOID *arg, CS_BYTE *data, CS_INT len)
+{
+	TEXT_DATA	*textdata = (TEXT_DATA *)arg;
+	CS_INT		room;
+
+	room = (EX_MAX_TEXT - 1) - textdata->textlen;
+	if (len > room)
+	{
+		len = room;
+	}
+	if (len > 0)
+	{
+		memcpy(textdata->textbuf + textdata->textlen, data, len);
+		textdata->textlen += len;
+	}
+	return CS_SUCCEED;
+}
+
 /*
 ** UpdateTextData()
 **
@@ -871,9 +1632,8 @@ UpdateTextData(CS_CONNECTION *connection, TEXT_DATA *textdata, char *newdata)
 	CS_RETCODE	retcode;
 	CS_INT		res_type;
 	CS_COMMAND	*cmd;
-	CS_INT		i;
-	CS_TEXT		*txtptr;
-	CS_INT		txtlen;
+	EX_TEXT_WRITER	writer;
+	EX_TEXT_MEM	mem;
 
 	/*
 	** Allocate a command handle to send the text with
@@ -897,37 +1657,32 @@ UpdateTextData(CS_CONNECTION *connection, TEXT_DATA *textdata, char *newdata)
 	}
 		
 	/*
-	** Fill in the description information for the update
-	** and send it to Client-Library.
+	** Send the new value from memory. ex_text_send() fills in the
+	** description of the update, then sends the value in chunks of
+	** EX_TEXT_CHUNK bytes, one ct_send_data() each, straight from
+	** newdata.
 	*/
-	txtptr = (CS_TEXT *)newdata;
-	txtlen = strlen(newdata);
+	mem.data = (CS_BYTE *)newdata;
+	mem.len = strlen(newdata);
+	mem.pos = 0;
 
-	textdata->iodesc.total_txtlen = txtlen;
 	textdata->iodesc.log_on_update = CS_TRUE;
-	retcode = ct_data_info(cmd, CS_SET, CS_UNUSED, &textdata->iodesc);
+	if ((retcode = ex_text_writer_init(&writer, EX_TEXT_CHUNK)) == CS_SUCCEED)
+	{
+		retcode = ex_text_send(&writer, cmd, &textdata->iodesc, mem.len,
+				ex_text_source_mem, &mem);
+		ex_text_writer_free(&writer);
+	}
 	if (retcode != CS_SUCCEED)
 	{
-                ex_error("UpdateTextData: ct_data_info() failed");
+		ex_error("UpdateTextData: ex_text_send() failed");
 		ct_cmd_drop(cmd);
 		return retcode;
 	}
-
-	/*
-	** Send the text one byte at a time. This is not the best thing to do 
-	** for performance reasons, but does demonstrate the ct_send_data()
-	** can handle arbitrary amounts of data.
-	*/
-	for (i = 0; i < txtlen; i++, txtptr++)
-	{
-		retcode = ct_send_data(cmd, txtptr, (CS_INT)1);
-		if (retcode != CS_SUCCEED)
-		{
-			ex_error("UpdateTextData: ct_send_data() failed");
-			ct_cmd_drop(cmd);
-			return retcode;
-		}
-	}
+	fprintf(stdout, "Sent %lld bytes in %d ct_send_data() calls, "
+		"%.1f MB/s\n", (long long)writer.bytes, writer.calls,
+		(writer.usecs > 0) ? writer.bytes / (CS_FLOAT)writer.usecs : 0.0);
+	fflush(stdout);
 
 	/*
 	** ct_send_data() does writes to internal network buffers. To insure
@@ -1222,9 +1977,42 @@ start_handler(SRV_SERVER *server)
         return CS_FAIL;
     }
 
-    sprintf(msgbuf, "Server %s is started.\n", SERVER_NAME);
+    sprintf(msgbuf, "Server %s is started.\n", Ex_srvname);
     srv_log(server, CS_TRUE, msgbuf, CS_NULLTERM);
 
+    /*
+    ** Build the language command router before any client can connect.
+    */
+    if ( ex_router_init(echo_handler, ltl_handler, echo_handler) != CS_SUCCEED )
+    {
+        return CS_FAIL;
+    }
+
+    /*
+    ** Selects are answered from the result cache when possible.
+    */
+    if ( ex_router_register("select", 0, select_handler) != CS_SUCCEED )
+    {
+        return CS_FAIL;
+    }
+    (CS_VOID)ex_cache_init(EX_CACHE_MAX_BYTES, EX_CACHE_TTL_SECS);
+    if ( ex_cache_regproc(server) != CS_SUCCEED )
+    {
+        return CS_FAIL;
+    }
+    if ( ex_qstats_regproc(server) != CS_SUCCEED )
+    {
+        return CS_FAIL;
+    }
+
+    /*
+    ** CPU-heavy handler work runs on native threads.
+    */
+    if ( ex_offload_init(EX_OFFLOAD_THREADS) != CS_SUCCEED )
+    {
+        return CS_FAIL;
+    }
+
     return stop_regproc(server);
 }
 
@@ -1251,6 +2039,7 @@ connect_handler(SRV_PROC *sp)
     ** Initialization.
     */
     srv_bzero(&msg, sizeof(msg));
+    EX_STATS_ADD(connects, 1);
 
     /*
     ** Get the CS_CONTEXT we're using.
@@ -1368,43 +2157,41 @@ connect_handler(SRV_PROC *sp)
 /*
 ** lang_handler
 ** This routine is the SRV_LANGUAGE event handler. All we do here
-** is get the incoming language string, and send it back to the
-** client via an informational message.
+** is get the incoming language string and hand it to the command
+** router, which picks the handler for it from its leading words.
+** Each batch is timed and charged to its fingerprint, see exqstats.c.
 */
 CS_RETCODE CS_PUBLIC
 lang_handler(SRV_PROC *sp)
 {
-    CS_CONTEXT	*cp;			/* Context structure. */
-    CS_SERVERMSG	msg;			/* The message we'll send. */
-    CS_CHAR		sname[CS_MAX_NAME];	/* The server name. */
-    CS_INT		slen;			/* The server name length. */
     CS_CHAR		*cmd;
     CS_INT		len;			/* the length of the message. */
+    CS_CHAR		*fpbuf;
+    EX_FPRINT		fp;
+    EX_QSTATS_QUERY	query;
+    EX_FPRINT_JOB	job;
+    CS_RETCODE		retcode;
 
     /*
-    ** Initialization.
-    */
-    srv_bzero(&msg, sizeof(msg));
-
-
-    /*
-    ** Get the CS_CONTEXT structure.
+    ** Get the length of the language string.
     */
-    if ( cs_ctx_global(EX_SRV_VERSION, &cp) == CS_FAIL )
+    if ( (len = srv_langlen(sp)) == -1 )
     {
         /*
         ** An error was already raised.
         */
+
         done_error(sp);
 
         return CS_FAIL;
     }
+    EX_STATS_ADD(langcmds, 1);
+    EX_STATS_ADD(langbytes, len);
 
     /*
-    ** Get the name of the server.
+    ** Allocate enough space to hold the language string.
     */
-    if ( srv_props(cp, CS_GET, SRV_S_SERVERNAME, sname,
-                   CS_MAX_NAME, &slen) == CS_FAIL )
+    if ( (cmd = (CS_CHAR *)srv_alloc(len + 1)) == (CS_CHAR *)NULL )
     {
         /*
         ** An error was already raised.
@@ -1416,23 +2203,89 @@ lang_handler(SRV_PROC *sp)
 
 
     /*
-    ** Get the length of the language string.
+    ** Get the language string itself.
     */
-    if ( (len = srv_langlen(sp)) == -1 )
+    if ( srv_langcpy(sp, 0, -1, cmd) == -1 )
     {
         /*
         ** An error was already raised.
         */
+        srv_free(cmd);
+        done_error(sp);
+
+        return CS_FAIL;
+    }
+    cmd[len] = (CS_CHAR)'\0';
 
+    /*
+    ** Fingerprint the batch before a route handler gets to modify it.
+    ** Huge batches are fingerprinted on the offload pool so they don't
+    ** hold up the other client threads.
+    */
+    if ( (fpbuf = (CS_CHAR *)srv_alloc(EX_FPRINT_BUFLEN(len))) != NULL )
+    {
+        job.cmd = cmd;
+        job.len = len;
+        job.buf = fpbuf;
+        job.fp = &fp;
+        retcode = (len >= EX_OFFLOAD_MIN_BYTES)
+                  ? ex_offload_run(sp, fprint_job, &job)
+                  : fprint_job(&job);
+    }
+    if ( fpbuf == NULL || retcode != CS_SUCCEED )
+    {
+        if ( fpbuf != NULL )
+        {
+            srv_free(fpbuf);
+        }
+        srv_free(cmd);
         done_error(sp);
 
         return CS_FAIL;
     }
 
     /*
-    ** Allocate enough space to hold the language string.
+    ** The route handler sends the final done; it gets the fingerprint
+    ** too, so that it need not compute it again.
     */
-    if ( (cmd = (CS_CHAR *)srv_alloc(len + 1)) == (CS_CHAR *)NULL )
+    ex_qstats_begin(sp, &query);
+    retcode = ex_router_dispatch(sp, cmd, len, &fp);
+    ex_qstats_end(sp, &query, &fp, len);
+
+    /*
+    ** Let's clean up.
+    */
+    srv_free(fpbuf);
+    srv_free(cmd);
+
+    return retcode;
+}
+
+/*
+** echo_handler
+** This is the route handler for T-SQL batches and for anything the
+** router doesn't recognize. It sends the language string back to the
+** client via an informational message.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+echo_handler(SRV_PROC *sp, CS_CHAR *cmd, CS_INT len, EX_ROUTE *route,
+             CS_VOID *arg)
+{
+    CS_CONTEXT	*cp;			/* Context structure. */
+    CS_SERVERMSG	msg;			/* The message we'll send. */
+    CS_CHAR		sname[CS_MAX_NAME];	/* The server name. */
+    CS_INT		slen;			/* The server name length. */
+
+    /*
+    ** Initialization.
+    */
+    srv_bzero(&msg, sizeof(msg));
+
+
+    /*
+    ** Get the CS_CONTEXT structure.
+    */
+    if ( cs_ctx_global(EX_SRV_VERSION, &cp) == CS_FAIL )
     {
         /*
         ** An error was already raised.
@@ -1442,11 +2295,11 @@ lang_handler(SRV_PROC *sp)
         return CS_FAIL;
     }
 
-
     /*
-    ** Get the language string itself.
+    ** Get the name of the server.
     */
-    if ( srv_langcpy(sp, 0, -1, cmd) == -1 )
+    if ( srv_props(cp, CS_GET, SRV_S_SERVERNAME, sname,
+                   CS_MAX_NAME, &slen) == CS_FAIL )
     {
         /*
         ** An error was already raised.
@@ -1496,11 +2349,6 @@ lang_handler(SRV_PROC *sp)
         return CS_FAIL;
     }
 
-    /*
-    ** Let's clean up.
-    */
-    srv_free(cmd);
-
     /*
     ** And finally, send a done to complete the command.
     */
@@ -1512,6 +2360,127 @@ lang_handler(SRV_PROC *sp)
     return CS_SUCCEED;
 }
 
+/*
+** ltl_handler
+** This is the route handler for Log Transfer Language verbs. LTL
+** commands arrive at a high rate and only need an acknowledgement,
+** so all we do is complete the command.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+ltl_handler(SRV_PROC *sp, CS_CHAR *cmd, CS_INT len, EX_ROUTE *route,
+            CS_VOID *arg)
+{
+    if ( srv_senddone(sp, SRV_DONE_FINAL, CS_TRAN_COMPLETED, (CS_INT)0)
+         == CS_FAIL )
+    {
+        /*
+        ** An error was already raised.
+        */
+        return CS_FAIL;
+    }
+
+    return CS_SUCCEED;
+}
+
+/*
+** select_handler
+** This is the route handler for select batches. The rows for a batch
+** are looked up in the result cache by the fingerprint of the batch
+** (its normalized text plus its literals); only on a miss are they
+** produced, and then cached for the next identical batch. The
+** fingerprint is the one lang_handler computed, passed as arg.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+select_handler(SRV_PROC *sp, CS_CHAR *cmd, CS_INT len, EX_ROUTE *route,
+               CS_VOID *arg)
+{
+    EX_FPRINT		*fp = (EX_FPRINT *)arg;
+    EX_CACHE_ENTRY	*entry;
+    EX_ROWBUF		rows;
+    CS_RETCODE		retcode;
+
+    /*
+    ** Send the cached row stream if there is one.
+    */
+    if ( (entry = ex_cache_get(fp)) != NULL )
+    {
+        EX_STATS_ADD(cachehits, 1);
+        retcode = ex_rowbuf_send(sp, entry->value, entry->valuelen);
+        ex_cache_release(entry);
+
+        return retcode;
+    }
+    EX_STATS_ADD(cachemisses, 1);
+
+    /*
+    ** Produce the rows, send them and keep them for next time.
+    */
+    if ( (retcode = produce_rows(cmd, len, &rows)) != CS_SUCCEED )
+    {
+        ex_rowbuf_free(&rows);
+        done_error(sp);
+
+        return retcode;
+    }
+
+    retcode = ex_rowbuf_send(sp, rows.data, rows.len);
+    if ( retcode == CS_SUCCEED )
+    {
+        (CS_VOID)ex_cache_put(fp, rows.data, rows.len);
+    }
+
+    ex_rowbuf_free(&rows);
+
+    return retcode;
+}
+
+/*
+** fprint_job
+** This routine fingerprints a language batch; it is run either on the
+** client thread or on the offload pool.
+*/
+CS_STATIC CS_RETCODE CS_PUBLIC
+fprint_job(CS_VOID *arg)
+{
+    EX_FPRINT_JOB	*job = (EX_FPRINT_JOB *)arg;
+
+    return ex_fprint_compute(job->cmd, job->len, job->buf,
+                             EX_FPRINT_BUFLEN(job->len), job->fp);
+}
+
+/*
+** produce_rows
+** This routine stands in for whatever produces the rows of a select.
+** This example has no data of its own, so it returns the batch it was
+** given as a single row with a single "batch" column.
+*/
+CS_STATIC CS_RETCODE
+produce_rows(CS_CHAR *cmd, CS_INT len, EX_ROWBUF *rows)
+{
+    CS_DATAFMT		fmt;
+    CS_RETCODE		retcode;
+
+    if ( (retcode = ex_rowbuf_init(rows, 1)) != CS_SUCCEED )
+    {
+        return retcode;
+    }
+
+    srv_bzero(&fmt, sizeof(fmt));
+    (CS_VOID)strcpy(fmt.name, "batch");
+    fmt.namelen = strlen(fmt.name);
+    fmt.datatype = CS_CHAR_TYPE;
+    fmt.format = CS_FMT_UNUSED;
+    fmt.maxlength = MAX(len, 1);
+    fmt.status = CS_CANNULL;
+
+    if ( (retcode = ex_rowbuf_describe(rows, 1, &fmt)) != CS_SUCCEED )
+    {
+        return retcode;
+    }
+
+    return ex_rowbuf_add(rows, cmd, len, CS_GOODDATA);
+}
+
 /*
 ** done_error
 **
@@ -1524,6 +2493,8 @@ CS_STATIC CS_VOID
 done_error(SRV_PROC *sp)
 {
 
+    EX_STATS_ADD(errors, 1);
+
     /*
     ** All we need to do is send the done. If this fails,
     ** print an error to the screen and return.